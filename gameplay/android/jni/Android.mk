@@ -42,6 +42,7 @@ LOCAL_SRC_FILES := \
     HeightField.cpp \
     Image.cpp \
 	ImageControl.cpp \
+    JobScheduler.cpp \
     Joint.cpp \
     Joystick.cpp \
     Label.cpp \
@@ -59,6 +60,7 @@ LOCAL_SRC_FILES := \
     Model.cpp \
     Node.cpp \
     ParticleEmitter.cpp \
+    ParticleStreams.cpp \
     Pass.cpp \
     PhysicsCharacter.cpp \
     PhysicsCollisionObject.cpp \
@@ -84,6 +86,7 @@ LOCAL_SRC_FILES := \
     Rectangle.cpp \
     Ref.cpp \
     RenderState.cpp \
+    RenderQueue.cpp \
     RenderTarget.cpp \
     Scene.cpp \
     SceneLoader.cpp \
@@ -91,6 +94,7 @@ LOCAL_SRC_FILES := \
     ScriptController.cpp \
     ScriptTarget.cpp \
     Slider.cpp \
+    SpatialIndex.cpp \
     SpriteBatch.cpp \
     Technique.cpp \
     Terrain.cpp \
@@ -1,25 +1,57 @@
+#if defined(INSTANCING)
+
+attribute vec4 a_instanceRow0;								// Rows of the 4x3 transform of the instance,
+attribute vec4 a_instanceRow1;								// relative to the model's node
+attribute vec4 a_instanceRow2;
+
+vec3 transformByInstance(vec3 v)
+{
+    return vec3(dot(a_instanceRow0.xyz, v), dot(a_instanceRow1.xyz, v), dot(a_instanceRow2.xyz, v));
+}
+
+vec4 getPosition()
+{
+    return vec4(dot(a_instanceRow0, a_position), dot(a_instanceRow1, a_position), dot(a_instanceRow2, a_position), a_position.w);
+}
+
+#else
+
 vec4 getPosition()
 {
     return a_position;    
 }
 
+#endif
+
 #if defined(LIGHTING)
 
 vec3 getNormal()
 {
+    #if defined(INSTANCING)
+    return transformByInstance(a_normal);
+    #else
     return a_normal;
+    #endif
 }
 
 #if defined(BUMPED)
 
 vec3 getTangent()
 {
+    #if defined(INSTANCING)
+    return transformByInstance(a_tangent);
+    #else
     return a_tangent;
+    #endif
 }
 
 vec3 getBinormal()
 {
+    #if defined(INSTANCING)
+    return transformByInstance(a_binormal);
+    #else
     return a_binormal;
+    #endif
 }
 
 #endif
@@ -5,12 +5,14 @@
 namespace gameplay
 {
 
+static const ScriptTarget::Event __messageEvent = { "message", "<AIMessage>" };
+
 AIAgent::AIAgent()
-    : _stateMachine(NULL), _node(NULL), _enabled(true), _listener(NULL), _next(NULL)
+    : _stateMachine(NULL), _node(NULL), _enabled(true), _listener(NULL)
 {
     _stateMachine = new AIStateMachine(this);
 
-    addScriptEvent("message", "<AIMessage>");
+    addScriptEvent(&__messageEvent);
 }
 
 AIAgent::~AIAgent()
@@ -84,7 +86,7 @@ bool AIAgent::processMessage(AIMessage* message)
     if (_listener && _listener->messageReceived(message))
         return true;
     
-    if (fireScriptEvent<bool>("message", message))
+    if (fireScriptEvent<bool>(&__messageEvent, message))
         return true;
     
     return false;
@@ -160,7 +160,6 @@ private:
     Node* _node;
     bool _enabled;
     Listener* _listener;
-    AIAgent* _next;
 
 };
 
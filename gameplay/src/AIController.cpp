@@ -2,11 +2,29 @@
 #include "AIController.h"
 #include "Game.h"
 
+// Number of agents updated by a single job when updating in parallel.
+#define AGENT_UPDATE_GRAIN_SIZE 16
+
 namespace gameplay
 {
 
+/**
+ * Hashes an agent ID (FNV-1a).
+ */
+static unsigned int hashId(const char* id)
+{
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)id; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
 AIController::AIController()
-    : _paused(false), _firstMessage(NULL), _firstAgent(NULL)
+    : _paused(false), _messageSequence(0), _agentIndexDirty(false), _agentIndexInvalidated(false), _parallelUpdate(false),
+      _updatingParallel(false), _parallelElapsedTime(0)
 {
 }
 
@@ -21,24 +39,23 @@ void AIController::initialize()
 void AIController::finalize()
 {
     // Remove all agents
-    AIAgent* agent = _firstAgent;
-    while (agent)
+    for (size_t i = 0, count = _agents.size(); i < count; ++i)
     {
-        AIAgent* temp = agent;
-        agent = agent->_next;
-        SAFE_RELEASE(temp);
+        SAFE_RELEASE(_agents[i]);
     }
-    _firstAgent = NULL;
+    _agents.clear();
+    _agentIndex.clear();
+    _agentIndexDirty = false;
 
     // Remove all messages
-    AIMessage* message = _firstMessage;
-    while (message)
+    for (size_t i = 0, count = _messageQueue.size(); i < count; ++i)
     {
-        AIMessage* temp = message;
-        message = message->_next;
-        AIMessage::destroy(temp);
+        AIMessage::destroy(_messageQueue[i].message);
     }
-    _firstMessage = NULL;
+    _messageQueue.clear();
+
+    // Free the messages kept for reuse
+    AIMessage::clearPool();
 }
 
 void AIController::pause()
@@ -51,20 +68,42 @@ void AIController::resume()
     _paused = false;
 }
 
+void AIController::setParallelUpdateEnabled(bool enabled)
+{
+    _parallelUpdate = enabled;
+}
+
+bool AIController::isParallelUpdateEnabled() const
+{
+    return _parallelUpdate;
+}
+
 void AIController::sendMessage(AIMessage* message, float delay)
 {
+    if (_updatingParallel)
+    {
+        // Sent from an agent being updated on a worker thread; delivered once all of them are done.
+        DeferredMessage deferred;
+        deferred.sender = 0;
+        deferred.message = message;
+        deferred.delay = delay;
+
+        _deferredMutex.lock();
+        _deferredMessages.push_back(deferred);
+        _deferredMutex.unlock();
+        return;
+    }
+
     if (delay <= 0)
     {
         // Send instantly
         if (message->getReceiver() == NULL || strlen(message->getReceiver()) == 0)
         {
             // Broadcast message to all agents
-            AIAgent* agent = _firstAgent;
-            while (agent)
+            for (size_t i = 0; i < _agents.size(); ++i)
             {
-                if (agent->processMessage(message))
+                if (_agents[i]->processMessage(message))
                     break; // message consumed by this agent - stop bubbling
-                agent = agent->_next;
             }
         }
         else
@@ -87,9 +126,14 @@ void AIController::sendMessage(AIMessage* message, float delay)
     else
     {
         // Queue for later delivery
-        if (_firstMessage)
-            message->_next = _firstMessage;
-        _firstMessage = message;
+        QueuedMessage queued;
+        queued.deliveryTime = Game::getInstance()->getGameTime() + delay;
+        queued.sequence = _messageSequence++;
+        queued.message = message;
+        message->_deliveryTime = queued.deliveryTime;
+
+        _messageQueue.push_back(queued);
+        std::push_heap(_messageQueue.begin(), _messageQueue.end(), &compareQueuedMessages);
     }
 }
 
@@ -100,89 +144,179 @@ void AIController::update(float elapsedTime)
 
     static Game* game = Game::getInstance();
 
-    // Send all pending messages that have expired
-    AIMessage* prevMsg = NULL;
-    AIMessage* msg = _firstMessage;
-    while (msg)
+    // Send all pending messages that have expired, earliest first. Only due messages are
+    // touched; messages sent by the receivers are queued and picked up if they are due too.
+    double gameTime = game->getGameTime();
+    while (!_messageQueue.empty() && _messageQueue.front().deliveryTime <= gameTime)
     {
-        // If the message delivery time has expired, send it (this also deletes it)
-        if (msg->getDeliveryTime() >= game->getGameTime())
-        {
-            // Link the message out of our list
-            if (prevMsg)
-                prevMsg->_next = msg->_next;
-
-            AIMessage* temp = msg;
-            msg = msg->_next;
-            temp->_next = NULL;
-            sendMessage(temp);
-        }
-        else
-        {
-            prevMsg = msg;
-            msg = msg->_next;
-        }
+        AIMessage* message = _messageQueue.front().message;
+        std::pop_heap(_messageQueue.begin(), _messageQueue.end(), &compareQueuedMessages);
+        _messageQueue.pop_back();
+
+        // Send the message (this also deletes it)
+        sendMessage(message);
     }
 
-    // Update all enabled agents
-    AIAgent* agent = _firstAgent;
-    while (agent)
+    // Update all enabled agents, setting aside those that can be updated in parallel
+    _parallelAgents.clear();
+    for (size_t i = 0; i < _agents.size(); ++i)
     {
-        if (agent->isEnabled())
+        AIAgent* agent = _agents[i];
+        if (!agent->isEnabled())
+            continue;
+
+        if (_parallelUpdate && agent->getStateMachine()->getActiveState()->isThreadSafe())
+            _parallelAgents.push_back(agent);
+        else
             agent->update(elapsedTime);
+    }
+
+    if (!_parallelAgents.empty())
+        updateParallel(elapsedTime);
+}
+
+void AIController::updateParallel(float elapsedTime)
+{
+    // Lookups from the worker threads must not rebuild the index.
+    if (_agentIndexDirty || _agentIndex.empty())
+        buildAgentIndex();
+
+    _parallelElapsedTime = elapsedTime;
+    _updatingParallel = true;
+    Game::getInstance()->getJobScheduler()->parallelFor((unsigned int)_parallelAgents.size(), &updateAgentJob, this, AGENT_UPDATE_GRAIN_SIZE);
+    _updatingParallel = false;
+
+    if (_agentIndexInvalidated)
+    {
+        _agentIndexInvalidated = false;
+        _agentIndexDirty = true;
+    }
+
+    if (_deferredMessages.empty())
+        return;
 
-        agent = agent->_next;
+    // Messages from the same sender were sent from a single job and so are already in order;
+    // ordering by sender makes the delivery order independent of the job scheduling. Messages
+    // whose sender is not a registered agent are delivered last.
+    for (size_t i = 0, count = _deferredMessages.size(); i < count; ++i)
+    {
+        const char* sender = _deferredMessages[i].message->getSender();
+        _deferredMessages[i].sender = findAgentIndex(sender ? sender : "");
     }
+    std::stable_sort(_deferredMessages.begin(), _deferredMessages.end(), &compareDeferredMessages);
+
+    for (size_t i = 0, count = _deferredMessages.size(); i < count; ++i)
+    {
+        sendMessage(_deferredMessages[i].message, _deferredMessages[i].delay);
+    }
+    _deferredMessages.clear();
+}
+
+void AIController::updateAgentJob(unsigned int index, void* cookie)
+{
+    AIController* controller = (AIController*)cookie;
+    controller->_parallelAgents[index]->update(controller->_parallelElapsedTime);
 }
 
 void AIController::addAgent(AIAgent* agent)
 {
+    GP_ASSERT(!_updatingParallel);
+
     agent->addRef();
+    _agents.push_back(agent);
+    _agentIndexDirty = true;
+}
 
-    if (_firstAgent)
-        agent->_next = _firstAgent;
+void AIController::removeAgent(AIAgent* agent)
+{
+    GP_ASSERT(!_updatingParallel);
 
-    _firstAgent = agent;
+    std::vector<AIAgent*>::iterator itr = std::find(_agents.begin(), _agents.end(), agent);
+    if (itr != _agents.end())
+    {
+        _agents.erase(itr);
+        _agentIndexDirty = true;
+        agent->release();
+    }
 }
 
-void AIController::removeAgent(AIAgent* agent)
+void AIController::invalidateAgentIndex()
 {
-    // Search our linked list of agents and link this agent out.
-    AIAgent* prevAgent = NULL;
-    AIAgent* itr = _firstAgent;
-    while (itr)
+    if (_updatingParallel)
     {
-        if (itr == agent)
-        {
-            if (prevAgent)
-                prevAgent->_next = agent->_next;
-            else
-                _firstAgent = agent->_next;
+        // A node was renamed by an agent being updated on a worker thread. The index is read
+        // by the other workers, so it is only marked out of date once all of them are done.
+        _deferredMutex.lock();
+        _agentIndexInvalidated = true;
+        _deferredMutex.unlock();
+        return;
+    }
 
-            agent->_next = NULL;
-            agent->release();
-            break;
-        }
+    _agentIndexDirty = true;
+}
+
+void AIController::buildAgentIndex() const
+{
+    // Open addressing table of agent indices + 1 (0 marks an empty slot), kept at most half full.
+    unsigned int count = (unsigned int)_agents.size();
+    unsigned int tableSize = 16;
+    while (tableSize < count * 2)
+        tableSize <<= 1;
 
-        prevAgent = itr;
-        itr = itr->_next;
+    _agentIndex.assign(tableSize, 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        unsigned int slot = hashId(_agents[i]->getId()) & (tableSize - 1);
+        while (_agentIndex[slot] != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        _agentIndex[slot] = i + 1;
     }
+    _agentIndexDirty = false;
 }
 
-AIAgent* AIController::findAgent(const char* id) const
+unsigned int AIController::findAgentIndex(const char* id) const
 {
     GP_ASSERT(id);
 
-    AIAgent* agent = _firstAgent;
-    while (agent)
+    unsigned int count = (unsigned int)_agents.size();
+
+    if (_agentIndexDirty || _agentIndex.empty())
     {
-        if (strcmp(id, agent->getId()) == 0)
-            return agent;
+        // The index is built before a parallel update, and does not become out of date during one.
+        GP_ASSERT(!_updatingParallel);
+        buildAgentIndex();
+    }
 
-        agent = agent->_next;
+    // Agents with equal IDs are inserted in registration order, so the first one is found first.
+    unsigned int mask = (unsigned int)_agentIndex.size() - 1;
+    for (unsigned int slot = hashId(id) & mask; _agentIndex[slot] != 0; slot = (slot + 1) & mask)
+    {
+        unsigned int index = _agentIndex[slot] - 1;
+        if (strcmp(id, _agents[index]->getId()) == 0)
+            return index;
     }
+    return count;
+}
 
-    return NULL;
+bool AIController::compareQueuedMessages(const QueuedMessage& a, const QueuedMessage& b)
+{
+    // std::push_heap keeps the greatest element at the top, so later messages compare as smaller.
+    if (a.deliveryTime != b.deliveryTime)
+        return a.deliveryTime > b.deliveryTime;
+    return (int)(a.sequence - b.sequence) > 0;
+}
+
+bool AIController::compareDeferredMessages(const DeferredMessage& a, const DeferredMessage& b)
+{
+    return a.sender < b.sender;
+}
+
+AIAgent* AIController::findAgent(const char* id) const
+{
+    unsigned int index = findAgentIndex(id);
+    return index < _agents.size() ? _agents[index] : NULL;
 }
 
 }
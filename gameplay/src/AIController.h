@@ -3,6 +3,7 @@
 
 #include "AIAgent.h"
 #include "AIMessage.h"
+#include "JobScheduler.h"
 
 namespace gameplay
 {
@@ -43,6 +44,26 @@ public:
      */
     AIAgent* findAgent(const char* id) const;
 
+    /**
+     * Sets whether agents may be updated in parallel on the game's worker threads.
+     *
+     * When enabled, agents whose active state is thread-safe (see AIState::setThreadSafe)
+     * are updated concurrently after all other agents have been updated on the main thread.
+     * Messages sent while they are updating are held back and then delivered on the main
+     * thread, grouped by sending agent in registration order, so that the result does not
+     * depend on how the agents were scheduled. Parallel update is disabled by default.
+     *
+     * @param enabled true to update thread-safe agents in parallel.
+     */
+    void setParallelUpdateEnabled(bool enabled);
+
+    /**
+     * Determines whether agents may be updated in parallel.
+     *
+     * @return true if parallel update is enabled.
+     */
+    bool isParallelUpdateEnabled() const;
+
 private:
 
     /**
@@ -96,9 +117,80 @@ private:
 
     void removeAgent(AIAgent* agent);
 
+    /**
+     * Marks the agent ID index as out of date, so that it is rebuilt on the next lookup.
+     *
+     * When called during a parallel update, the index is marked out of date once the update
+     * is done, and lookups until then do not find agents by their new ID.
+     */
+    void invalidateAgentIndex();
+
+    /**
+     * Rebuilds the agent ID index from the registered agents.
+     */
+    void buildAgentIndex() const;
+
+    /**
+     * Returns the registration index of the agent with the given ID, or the number of
+     * registered agents if there is no such agent.
+     */
+    unsigned int findAgentIndex(const char* id) const;
+
+    /**
+     * Updates the agents collected for parallel update, and then delivers the messages
+     * they sent.
+     */
+    void updateParallel(float elapsedTime);
+
+    /**
+     * Job function updating one of the agents collected for parallel update.
+     */
+    static void updateAgentJob(unsigned int index, void* cookie);
+
+    /**
+     * A message waiting in the queue for its delivery time.
+     */
+    struct QueuedMessage
+    {
+        double deliveryTime;
+        unsigned int sequence;
+        AIMessage* message;
+    };
+
+    /**
+     * Orders queued messages so that the earliest delivery time is at the top of the heap,
+     * and messages with equal delivery times are delivered in the order they were sent.
+     */
+    static bool compareQueuedMessages(const QueuedMessage& a, const QueuedMessage& b);
+
+    /**
+     * A message sent by an agent while agents were being updated in parallel.
+     */
+    struct DeferredMessage
+    {
+        unsigned int sender;
+        AIMessage* message;
+        float delay;
+    };
+
+    /**
+     * Orders deferred messages by the registration index of their sending agent.
+     */
+    static bool compareDeferredMessages(const DeferredMessage& a, const DeferredMessage& b);
+
     bool _paused;
-    AIMessage* _firstMessage;
-    AIAgent* _firstAgent;
+    std::vector<QueuedMessage> _messageQueue;
+    unsigned int _messageSequence;
+    std::vector<AIAgent*> _agents;
+    mutable std::vector<unsigned int> _agentIndex;
+    mutable bool _agentIndexDirty;
+    bool _agentIndexInvalidated;
+    bool _parallelUpdate;
+    bool _updatingParallel;
+    float _parallelElapsedTime;
+    std::vector<AIAgent*> _parallelAgents;
+    std::vector<DeferredMessage> _deferredMessages;
+    JobScheduler::Mutex _deferredMutex;
 
 };
 
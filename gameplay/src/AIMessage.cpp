@@ -1,11 +1,17 @@
 #include "Base.h"
 #include "AIMessage.h"
+#include "JobScheduler.h"
 
 namespace gameplay
 {
 
+AIMessage* AIMessage::_pool = NULL;
+
+// Messages may be created by AI states that are updated on worker threads.
+static JobScheduler::Mutex __poolMutex;
+
 AIMessage::AIMessage()
-    : _id(0), _deliveryTime(0), _parameters(NULL), _parameterCount(0), _messageType(MESSAGE_TYPE_CUSTOM), _next(NULL)
+    : _id(0), _deliveryTime(0), _parameters(NULL), _parameterCount(0), _parameterCapacity(0), _messageType(MESSAGE_TYPE_CUSTOM), _next(NULL)
 {
 }
 
@@ -16,19 +22,65 @@ AIMessage::~AIMessage()
 
 AIMessage* AIMessage::create(unsigned int id, const char* sender, const char* receiver, unsigned int parameterCount)
 {
-    AIMessage* message = new AIMessage();
+    // Reuse a destroyed message if there is one.
+    __poolMutex.lock();
+    AIMessage* message = _pool;
+    if (message)
+        _pool = message->_next;
+    __poolMutex.unlock();
+
+    if (message)
+    {
+        message->_next = NULL;
+    }
+    else
+    {
+        message = new AIMessage();
+    }
+
     message->_id = id;
     message->_sender = sender;
     message->_receiver = receiver;
-    message->_parameterCount = parameterCount;
-    if (parameterCount > 0)
+    message->_deliveryTime = 0;
+    message->_messageType = MESSAGE_TYPE_CUSTOM;
+    if (parameterCount > message->_parameterCapacity)
+    {
+        SAFE_DELETE_ARRAY(message->_parameters);
         message->_parameters = new AIMessage::Parameter[parameterCount];
+        message->_parameterCapacity = parameterCount;
+    }
+    message->_parameterCount = parameterCount;
     return message;
 }
 
 void AIMessage::destroy(AIMessage* message)
 {
-    SAFE_DELETE(message);
+    if (!message)
+        return;
+
+    // Release the parameters' strings and keep the message for reuse.
+    for (unsigned int i = 0; i < message->_parameterCount; ++i)
+    {
+        message->_parameters[i].clear();
+    }
+    message->_parameterCount = 0;
+
+    __poolMutex.lock();
+    message->_next = _pool;
+    _pool = message;
+    __poolMutex.unlock();
+}
+
+void AIMessage::clearPool()
+{
+    __poolMutex.lock();
+    while (_pool)
+    {
+        AIMessage* message = _pool;
+        _pool = message->_next;
+        SAFE_DELETE(message);
+    }
+    __poolMutex.unlock();
 }
 
 unsigned int AIMessage::getId() const
@@ -267,15 +267,27 @@ private:
 
     void clearParameter(unsigned int index);
 
+    /**
+     * Deletes the messages kept for reuse by create().
+     */
+    static void clearPool();
+
     unsigned int _id;
     std::string _sender;
     std::string _receiver;
     double _deliveryTime;
     Parameter* _parameters;
     unsigned int _parameterCount;
+    unsigned int _parameterCapacity;
     MessageType _messageType;
     AIMessage* _next;
 
+    /**
+     * Destroyed messages kept for reuse, linked through _next. Their parameter arrays are
+     * kept too, so that most messages are created without any allocation.
+     */
+    static AIMessage* _pool;
+
 };
 
 }
@@ -5,14 +5,18 @@
 namespace gameplay
 {
 
+static const ScriptTarget::Event __enterEvent = { "enter", "<AIAgent><AIState>" };
+static const ScriptTarget::Event __exitEvent = { "exit", "<AIAgent><AIState>" };
+static const ScriptTarget::Event __updateEvent = { "update", "<AIAgent><AIState>f" };
+
 AIState* AIState::_empty = NULL;
 
 AIState::AIState(const char* id)
-    : _id(id), _listener(NULL)
+    : _id(id), _listener(NULL), _threadSafe(false)
 {
-    addScriptEvent("enter", "<AIAgent><AIState>");
-    addScriptEvent("exit", "<AIAgent><AIState>");
-    addScriptEvent("update", "<AIAgent><AIState>f");
+    addScriptEvent(&__enterEvent);
+    addScriptEvent(&__exitEvent);
+    addScriptEvent(&__updateEvent);
 }
 
 AIState::~AIState()
@@ -34,12 +38,22 @@ void AIState::setListener(Listener* listener)
     _listener = listener;
 }
 
+void AIState::setThreadSafe(bool threadSafe)
+{
+    _threadSafe = threadSafe;
+}
+
+bool AIState::isThreadSafe() const
+{
+    return _threadSafe && !hasScriptCallbacks();
+}
+
 void AIState::enter(AIStateMachine* stateMachine)
 {
     if (_listener)
         _listener->stateEnter(stateMachine->getAgent(), this);
 
-    fireScriptEvent<void>("enter", stateMachine->getAgent(), this);
+    fireScriptEvent<void>(&__enterEvent, stateMachine->getAgent(), this);
 }
 
 void AIState::exit(AIStateMachine* stateMachine)
@@ -47,7 +61,7 @@ void AIState::exit(AIStateMachine* stateMachine)
     if (_listener)
         _listener->stateExit(stateMachine->getAgent(), this);
 
-    fireScriptEvent<void>("exit", stateMachine->getAgent(), this);
+    fireScriptEvent<void>(&__exitEvent, stateMachine->getAgent(), this);
 }
 
 void AIState::update(AIStateMachine* stateMachine, float elapsedTime)
@@ -55,7 +69,7 @@ void AIState::update(AIStateMachine* stateMachine, float elapsedTime)
     if (_listener)
         _listener->stateUpdate(stateMachine->getAgent(), this, elapsedTime);
 
-    fireScriptEvent<void>("update", stateMachine->getAgent(), this, elapsedTime);
+    fireScriptEvent<void>(&__updateEvent, stateMachine->getAgent(), this, elapsedTime);
 }
 
 AIState::Listener::~Listener()
@@ -89,6 +89,26 @@ public:
      */
     void setListener(Listener* listener);
 
+    /**
+     * Sets whether this state may be updated on a worker thread.
+     *
+     * When the AIController's parallel update is enabled, agents whose active state is
+     * thread-safe are updated concurrently. The state's listener must then only touch
+     * data owned by the agent being updated; messages it sends are held back and
+     * delivered on the main thread after all agents have been updated. States with
+     * script callbacks are always updated on the main thread.
+     *
+     * @param threadSafe true if this state may be updated on a worker thread.
+     */
+    void setThreadSafe(bool threadSafe);
+
+    /**
+     * Determines whether this state may be updated on a worker thread.
+     *
+     * @return true if this state is marked thread-safe and has no script callbacks.
+     */
+    bool isThreadSafe() const;
+
 private:
 
     /**
@@ -128,6 +148,7 @@ private:
 
     std::string _id;
     Listener* _listener;
+    bool _threadSafe;
 
     // The default/empty state.
     static AIState* _empty;
@@ -34,6 +34,15 @@ Animation::Animation(const char* id, AnimationTarget* target, int propertyId, un
     GP_ASSERT(getRefCount() == 1);
 }
 
+Animation::Animation(const char* id, AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, unsigned short* keyValues, float* offset, float* scale)
+    : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL)
+{
+    createChannel(target, propertyId, keyCount, keyTimes, keyValues, offset, scale);
+    // Release the animation because a newly created animation has a ref count of 1 and the channels hold the ref to animation.
+    release();
+    GP_ASSERT(getRefCount() == 1);
+}
+
 Animation::Animation(const char* id)
     : _controller(Game::getInstance()->getAnimationController()), _id(id), _duration(0L), _defaultClip(NULL), _clips(NULL)
 {
@@ -399,6 +408,40 @@ Animation::Channel* Animation::createChannel(AnimationTarget* target, int proper
     return channel;
 }
 
+Animation::Channel* Animation::createChannel(AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, unsigned short* keyValues, float* offset, float* scale)
+{
+    GP_ASSERT(target);
+    GP_ASSERT(keyCount > 0 && keyTimes);
+    GP_ASSERT(keyValues && offset && scale);
+
+    unsigned int propertyComponentCount = target->getAnimationPropertyComponentCount(propertyId);
+    GP_ASSERT(propertyComponentCount > 0);
+
+    unsigned long lowest = keyTimes[0];
+    unsigned long duration = keyTimes[keyCount-1] - lowest;
+
+    float* normalizedKeyTimes = new float[keyCount];
+    normalizedKeyTimes[0] = 0.0f;
+    for (unsigned int i = 1; i < keyCount - 1; i++)
+    {
+        normalizedKeyTimes[i] = (float) (keyTimes[i] - lowest) / (float) duration;
+    }
+    if (keyCount > 1)
+        normalizedKeyTimes[keyCount - 1] = 1.0f;
+
+    Curve* curve = Curve::createQuantized(keyCount, propertyComponentCount, normalizedKeyTimes, keyValues, offset, scale);
+    GP_ASSERT(curve);
+    if (target->_targetType == AnimationTarget::TRANSFORM)
+        setTransformRotationOffset(curve, propertyId);
+
+    SAFE_DELETE_ARRAY(normalizedKeyTimes);
+
+    Channel* channel = new Channel(this, target, propertyId, curve, duration);
+    curve->release();
+    addChannel(channel);
+    return channel;
+}
+
 void Animation::addChannel(Channel* channel)
 {
     GP_ASSERT(channel);
@@ -155,6 +155,11 @@ private:
      */
     Animation(const char* id, AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, unsigned int type);
 
+    /**
+     * Constructor (for a linear channel with quantized key values).
+     */
+    Animation(const char* id, AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, unsigned short* keyValues, float* offset, float* scale);
+
     /**
      * Constructor.
      */
@@ -200,6 +205,13 @@ private:
      */
     Channel* createChannel(AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, float* keyValues, float* keyInValue, float* keyOutValue, unsigned int type);
 
+    /**
+     * Creates a linear channel within this animation whose key values are quantized to 16 bits.
+     *
+     * @see Curve::createQuantized
+     */
+    Channel* createChannel(AnimationTarget* target, int propertyId, unsigned int keyCount, unsigned int* keyTimes, unsigned short* keyValues, float* offset, float* scale);
+
     /**
      * Adds a channel to the animation.
      */
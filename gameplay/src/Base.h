@@ -220,10 +220,12 @@ using std::va_list;
     #define GLEW_STATIC
     #include <GL/glew.h>
     #define USE_VAO
+    #define USE_INSTANCED_ARRAYS
 #elif __linux__
         #define GLEW_STATIC
         #include <GL/glew.h>
         #define USE_VAO
+        #define USE_INSTANCED_ARRAYS
 #elif __APPLE__
     #include "TargetConditionals.h"
     #if TARGET_OS_IPHONE || TARGET_IPHONE_SIMULATOR
@@ -247,12 +249,26 @@ using std::va_list;
         #define glDeleteVertexArrays glDeleteVertexArraysAPPLE
         #define glGenVertexArrays glGenVertexArraysAPPLE
         #define glIsVertexArray glIsVertexArrayAPPLE
+        #define glVertexAttribDivisor glVertexAttribDivisorARB
+        #define glDrawArraysInstanced glDrawArraysInstancedARB
+        #define glDrawElementsInstanced glDrawElementsInstancedARB
         #define USE_VAO
+        #define USE_INSTANCED_ARRAYS
     #else
         #error "Unsupported Apple Device"
     #endif
 #endif
 
+// SIMD
+// Defining GP_NO_SIMD builds the scalar math and particle code on every platform, so it
+// can be tested and compared with the SIMD code.
+#if defined(GP_NO_SIMD)
+    #undef USE_NEON
+#elif !defined(USE_NEON) && (defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2))
+    #include <emmintrin.h>
+    #define USE_SSE
+#endif
+
 // Graphics (GLSL)
 #define VERTEX_ATTRIBUTE_POSITION_NAME              "a_position"
 #define VERTEX_ATTRIBUTE_NORMAL_NAME                "a_normal"
@@ -262,6 +278,7 @@ using std::va_list;
 #define VERTEX_ATTRIBUTE_BLENDWEIGHTS_NAME          "a_blendWeights"
 #define VERTEX_ATTRIBUTE_BLENDINDICES_NAME          "a_blendIndices"
 #define VERTEX_ATTRIBUTE_TEXCOORD_PREFIX_NAME       "a_texCoord"
+#define VERTEX_ATTRIBUTE_INSTANCE_ROW_PREFIX_NAME   "a_instanceRow"
 
 // Hardware buffer
 namespace gameplay
@@ -127,14 +127,18 @@ float BoundingSphere::intersects(const Ray& ray) const
     float vx = origin.x - center.x;
     float vy = origin.y - center.y;
     float vz = origin.z - center.z;
-    float d2 = vx * vx + vy * vy + vz * vz;
 
     // Solve the quadratic equation using the ray's and sphere's equations together.
     // Since the ray's direction is guaranteed to be 1 by the Ray, we don't need to
     // calculate and use A (A=ray.getDirection().lengthSquared()).
-    float B = 2.0f * (vx * direction.x + vy * direction.y + vz * direction.z);
-    float C = d2 - radius * radius;
-    float discriminant = B * B - 4.0f * C;
+    float B = vx * direction.x + vy * direction.y + vz * direction.z;
+
+    // The discriminant is computed from the distance between the sphere's center and the
+    // ray's line rather than as B * B - C, which loses all precision far from the origin.
+    float px = vx - B * direction.x;
+    float py = vy - B * direction.y;
+    float pz = vz - B * direction.z;
+    float discriminant = radius * radius - (px * px + py * py + pz * pz);
 
     // If the discriminant is negative, then there is no intersection.
     if (discriminant < 0.0f)
@@ -145,8 +149,13 @@ float BoundingSphere::intersects(const Ray& ray) const
     {
         // The intersection is at the smaller positive root.
         float sqrtDisc = sqrt(discriminant);
-        float t0 = (-B - sqrtDisc) * 0.5f;
-        float t1 = (-B + sqrtDisc) * 0.5f;
+        float t0 = -B - sqrtDisc;
+        float t1 = -B + sqrtDisc;
+
+        // The sphere is behind the ray.
+        if (t1 < 0.0f)
+            return Ray::INTERSECTS_NONE;
+
         return (t0 > 0.0f && t0 < t1) ? t0 : t1;
     }
 }
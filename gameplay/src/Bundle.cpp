@@ -6,7 +6,10 @@
 #include "Joint.h"
 
 #define BUNDLE_VERSION_MAJOR            1
-#define BUNDLE_VERSION_MINOR            2
+#define BUNDLE_VERSION_MINOR            4
+
+// Oldest minor version that can still be read (before vertex element encodings).
+#define BUNDLE_VERSION_MINOR_MIN        2
 
 #define BUNDLE_TYPE_SCENE               1
 #define BUNDLE_TYPE_NODE                2
@@ -26,6 +29,18 @@
 // For sanity checking string reads
 #define BUNDLE_MAX_STRING_LENGTH        5000
 
+// Vertex element encodings (version 1.3 and later)
+#define BUNDLE_VERTEX_FLOAT             0
+#define BUNDLE_VERTEX_SNORM16           1
+#define BUNDLE_VERTEX_OCTAHEDRAL16      2
+#define BUNDLE_VERTEX_UNORM16           3
+#define BUNDLE_VERTEX_UNORM8            4
+#define BUNDLE_VERTEX_UINT8             5
+
+// Animation channel key value encodings (version 1.4 and later)
+#define BUNDLE_KEYS_FLOAT               0
+#define BUNDLE_KEYS_UNORM16             1
+
 namespace gameplay
 {
 
@@ -34,6 +49,8 @@ static std::vector<Bundle*> __bundleCache;
 Bundle::Bundle(const char* path) :
     _path(path), _referenceCount(0), _references(NULL), _stream(NULL), _trackedNodes(NULL)
 {
+    _version[0] = BUNDLE_VERSION_MAJOR;
+    _version[1] = BUNDLE_VERSION_MINOR;
 }
 
 Bundle::~Bundle()
@@ -154,6 +171,116 @@ static std::string readString(Stream* stream)
     return str;
 }
 
+/**
+ * Reads a block of data from the stream. When inPlace is true and the stream is mapped into
+ * memory, the returned pointer refers directly to the stream's memory and owned is set to false.
+ * Otherwise the data is copied into a new array that the caller must delete.
+ */
+static unsigned char* readData(Stream* stream, unsigned int size, bool inPlace, bool* owned)
+{
+    GP_ASSERT(stream);
+    GP_ASSERT(owned);
+
+    if (inPlace)
+    {
+        const void* data = stream->readInPlace(size);
+        if (data)
+        {
+            *owned = false;
+            return (unsigned char*)data;
+        }
+    }
+
+    unsigned char* data = new unsigned char[size];
+    if (stream->read(data, 1, size) != size)
+    {
+        SAFE_DELETE_ARRAY(data);
+        return NULL;
+    }
+    *owned = true;
+    return data;
+}
+
+/**
+ * Describes how a vertex element is stored in a bundle.
+ */
+struct VertexElementEncoding
+{
+    unsigned int encoding;
+    // Range of SNORM16 elements: value = offset + scale * snorm.
+    float offset[4];
+    float scale[4];
+};
+
+/**
+ * Reads a signed normalized 16 bit value.
+ */
+static float readSnorm16(const unsigned char* data)
+{
+    short value;
+    memcpy(&value, data, sizeof(short));
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+/**
+ * Decodes vertices stored in a bundle with the given element encodings into the runtime vertex format.
+ *
+ * SNORM16 elements are decoded to floats, since they are relative to the mesh bounds, and octahedral
+ * unit vectors are decoded to normalized shorts. All other elements are copied as they are.
+ */
+static void decodeVertices(const VertexFormat& srcFormat, const VertexFormat& dstFormat, const std::vector<VertexElementEncoding>& encodings,
+                           const unsigned char* src, unsigned char* dst, unsigned int vertexCount)
+{
+    GP_ASSERT(srcFormat.getElementCount() == dstFormat.getElementCount() && encodings.size() == srcFormat.getElementCount());
+
+    unsigned int elementCount = srcFormat.getElementCount();
+    for (unsigned int v = 0; v < vertexCount; ++v)
+    {
+        for (unsigned int i = 0; i < elementCount; ++i)
+        {
+            const VertexFormat::Element& srcElement = srcFormat.getElement(i);
+            const VertexFormat::Element& dstElement = dstFormat.getElement(i);
+            const VertexElementEncoding& encoding = encodings[i];
+
+            switch (encoding.encoding)
+            {
+            case BUNDLE_VERTEX_SNORM16:
+                {
+                    float values[4];
+                    for (unsigned int j = 0; j < srcElement.size; ++j)
+                        values[j] = encoding.offset[j] + encoding.scale[j] * readSnorm16(src + j * sizeof(short));
+                    memcpy(dst, values, srcElement.size * sizeof(float));
+                }
+                break;
+            case BUNDLE_VERTEX_OCTAHEDRAL16:
+                {
+                    // Unfold the octahedron: the lower hemisphere is stored mirrored across the diagonals.
+                    float x = readSnorm16(src);
+                    float y = readSnorm16(src + sizeof(short));
+                    float z = 1.0f - fabs(x) - fabs(y);
+                    if (z < 0.0f)
+                    {
+                        float foldedX = x;
+                        x = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+                        y = (1.0f - fabs(foldedX)) * (y >= 0.0f ? 1.0f : -1.0f);
+                    }
+                    float length = sqrt(x * x + y * y + z * z);
+                    short values[4] = { (short)floor(x / length * 32767.0f + 0.5f), (short)floor(y / length * 32767.0f + 0.5f),
+                        (short)floor(z / length * 32767.0f + 0.5f), 0 };
+                    memcpy(dst, values, dstElement.getByteSize());
+                }
+                break;
+            default:
+                memcpy(dst, src, srcElement.getByteSize());
+                break;
+            }
+
+            src += srcElement.getByteSize();
+            dst += dstElement.getByteSize();
+        }
+    }
+}
+
 Bundle* Bundle::create(const char* path)
 {
     GP_ASSERT(path);
@@ -171,8 +298,9 @@ Bundle* Bundle::create(const char* path)
         }
     }
 
-    // Open the bundle.
-    Stream* stream = FileSystem::open(path);
+    // Open the bundle, mapping it into memory where supported so that vertex, index
+    // and texture data can be uploaded straight from the file without copying it.
+    Stream* stream = FileSystem::open(path, FileSystem::READ | FileSystem::MAPPED);
     if (!stream)
     {
         GP_ERROR("Failed to open file '%s'.", path);
@@ -196,10 +324,11 @@ Bundle* Bundle::create(const char* path)
         GP_ERROR("Failed to read GPB version for bundle '%s'.", path);
         return NULL;
     }
-    if (ver[0] != BUNDLE_VERSION_MAJOR || ver[1] != BUNDLE_VERSION_MINOR)
+    if (ver[0] != BUNDLE_VERSION_MAJOR || ver[1] < BUNDLE_VERSION_MINOR_MIN || ver[1] > BUNDLE_VERSION_MINOR)
     {
         SAFE_DELETE(stream);
-        GP_ERROR("Unsupported version (%d.%d) for bundle '%s' (expected %d.%d).", (int)ver[0], (int)ver[1], path, BUNDLE_VERSION_MAJOR, BUNDLE_VERSION_MINOR);
+        GP_ERROR("Unsupported version (%d.%d) for bundle '%s' (expected %d.%d to %d.%d).", (int)ver[0], (int)ver[1], path,
+            BUNDLE_VERSION_MAJOR, BUNDLE_VERSION_MINOR_MIN, BUNDLE_VERSION_MAJOR, BUNDLE_VERSION_MINOR);
         return NULL;
     }
 
@@ -232,22 +361,81 @@ Bundle* Bundle::create(const char* path)
     bundle->_referenceCount = refCount;
     bundle->_references = refs;
     bundle->_stream = stream;
+    bundle->_version[0] = ver[0];
+    bundle->_version[1] = ver[1];
+    bundle->buildReferenceIndex();
 
     return bundle;
 }
 
+/**
+ * Hashes a reference id (FNV-1a).
+ */
+static unsigned int hashId(const char* id)
+{
+    unsigned int hash = 2166136261u;
+    for (const unsigned char* c = (const unsigned char*)id; *c; ++c)
+    {
+        hash ^= *c;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+/**
+ * Orders (offset, index) pairs by offset only, so that a stable sort keeps refs with equal offsets in table order.
+ */
+static bool compareOffsets(const std::pair<unsigned int, unsigned int>& a, const std::pair<unsigned int, unsigned int>& b)
+{
+    return a.first < b.first;
+}
+
+void Bundle::buildReferenceIndex()
+{
+    GP_ASSERT(_references || _referenceCount == 0);
+
+    // Size the id hash table to a power of two at least twice the ref count, to keep probe sequences short.
+    unsigned int tableSize = 16;
+    while (tableSize < _referenceCount * 2)
+        tableSize <<= 1;
+    _referenceTable.assign(tableSize, 0);
+    _referenceOffsets.clear();
+    _referenceOffsets.reserve(_referenceCount);
+
+    for (unsigned int i = 0; i < _referenceCount; ++i)
+    {
+        // Insert in table order, so that the first of any refs with duplicate ids is found first.
+        unsigned int slot = hashId(_references[i].id.c_str()) & (tableSize - 1);
+        while (_referenceTable[slot] != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        _referenceTable[slot] = i + 1;
+
+        if (_references[i].id.length() > 0)
+        {
+            _referenceOffsets.push_back(std::make_pair(_references[i].offset, i));
+        }
+    }
+
+    std::stable_sort(_referenceOffsets.begin(), _referenceOffsets.end(), &compareOffsets);
+}
+
 Bundle::Reference* Bundle::find(const char* id) const
 {
     GP_ASSERT(id);
     GP_ASSERT(_references);
+    GP_ASSERT(!_referenceTable.empty());
 
-    // Search the ref table for the given id (case-sensitive).
-    for (unsigned int i = 0; i < _referenceCount; ++i)
+    // Look up the given id (case-sensitive) in the hash table of refs.
+    unsigned int mask = (unsigned int)_referenceTable.size() - 1;
+    for (unsigned int slot = hashId(id) & mask; _referenceTable[slot] != 0; slot = (slot + 1) & mask)
     {
-        if (_references[i].id == id)
+        Reference* ref = &_references[_referenceTable[slot] - 1];
+        if (ref->id == id)
         {
             // Found a match
-            return &_references[i];
+            return ref;
         }
     }
 
@@ -271,16 +459,15 @@ const char* Bundle::getIdFromOffset() const
 
 const char* Bundle::getIdFromOffset(unsigned int offset) const
 {
-    // Search the ref table for the given offset.
+    // Search the refs with non-empty ids, sorted by offset, for the given offset.
     if (offset > 0)
     {
         GP_ASSERT(_references);
-        for (unsigned int i = 0; i < _referenceCount; ++i)
+        std::vector<std::pair<unsigned int, unsigned int> >::const_iterator itr =
+            std::lower_bound(_referenceOffsets.begin(), _referenceOffsets.end(), std::make_pair(offset, 0u), &compareOffsets);
+        if (itr != _referenceOffsets.end() && itr->first == offset)
         {
-            if (_references[i].offset == offset && _references[i].id.length() > 0)
-            {
-                return _references[i].id.c_str();
-            }
+            return _references[itr->second].id.c_str();
         }
     }
     return NULL;
@@ -1271,6 +1458,9 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
 
     std::vector<unsigned int> keyTimes;
     std::vector<float> values;
+    std::vector<unsigned short> quantizedValues;
+    std::vector<float> valueOffsets;
+    std::vector<float> valueScales;
     std::vector<float> tangentsIn;
     std::vector<float> tangentsOut;
     std::vector<unsigned int> interpolation;
@@ -1290,7 +1480,29 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
     }
 
     // Read key values.
-    if (!readArray(&valuesCount, &values))
+    unsigned int valueEncoding = BUNDLE_KEYS_FLOAT;
+    if (_version[1] >= 4 && !read(&valueEncoding))
+    {
+        GP_ERROR("Failed to read key value encoding for animation '%s'.", id);
+        return NULL;
+    }
+    if (valueEncoding == BUNDLE_KEYS_UNORM16)
+    {
+        // Quantized values, with the offset and scale of each component.
+        unsigned int offsetCount, scaleCount;
+        if (!readArray(&offsetCount, &valueOffsets) || !readArray(&scaleCount, &valueScales) || offsetCount != scaleCount ||
+            !readArray(&valuesCount, &quantizedValues) || (offsetCount > 0 && valuesCount != keyTimesCount * offsetCount))
+        {
+            GP_ERROR("Failed to read quantized key values for animation '%s'.", id);
+            return NULL;
+        }
+    }
+    else if (valueEncoding != BUNDLE_KEYS_FLOAT)
+    {
+        GP_ERROR("Unsupported key value encoding %d for animation '%s'.", valueEncoding, id);
+        return NULL;
+    }
+    else if (!readArray(&valuesCount, &values))
     {
         GP_ERROR("Failed to read key values for animation '%s'.", id);
         return NULL;
@@ -1317,7 +1529,24 @@ Animation* Bundle::readAnimationChannelData(Animation* animation, const char* id
         return NULL;
     }
 
-    if (targetAttribute > 0)
+    if (targetAttribute > 0 && valueEncoding == BUNDLE_KEYS_UNORM16)
+    {
+        GP_ASSERT(target);
+        if (keyTimes.empty() || valueOffsets.size() != target->getAnimationPropertyComponentCount(targetAttribute))
+        {
+            GP_ERROR("Invalid quantized key values for animation '%s'.", id);
+            return NULL;
+        }
+        if (animation == NULL)
+        {
+            animation = new Animation(id, target, targetAttribute, keyTimesCount, &keyTimes[0], &quantizedValues[0], &valueOffsets[0], &valueScales[0]);
+        }
+        else
+        {
+            animation->createChannel(target, targetAttribute, keyTimesCount, &keyTimes[0], &quantizedValues[0], &valueOffsets[0], &valueScales[0]);
+        }
+    }
+    else if (targetAttribute > 0)
     {
         GP_ASSERT(target);
         GP_ASSERT(keyTimes.size() > 0 && values.size() > 0);
@@ -1361,8 +1590,8 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
         return NULL;
     }
 
-    // Read mesh data.
-    MeshData* meshData = readMeshData();
+    // Read mesh data, in place since it is only needed until it has been uploaded.
+    MeshData* meshData = readMeshData(true);
     if (meshData == NULL)
     {
         GP_ERROR("Failed to load mesh data for mesh '%s'.", id);
@@ -1374,7 +1603,7 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     if (mesh == NULL)
     {
         GP_ERROR("Failed to create mesh '%s'.", id);
-        SAFE_DELETE_ARRAY(meshData);
+        SAFE_DELETE(meshData);
         return NULL;
     }
 
@@ -1415,7 +1644,7 @@ Mesh* Bundle::loadMesh(const char* id, const char* nodeId)
     return mesh;
 }
 
-Bundle::MeshData* Bundle::readMeshData()
+Bundle::MeshData* Bundle::readMeshData(bool inPlace)
 {
     // Read vertex format/elements.
     unsigned int vertexElementCount;
@@ -1430,7 +1659,11 @@ Bundle::MeshData* Bundle::readMeshData()
         return NULL;
     }
 
+    // Elements as stored in the bundle, and as they are used at runtime.
     VertexFormat::Element* vertexElements = new VertexFormat::Element[vertexElementCount];
+    VertexFormat::Element* storedElements = new VertexFormat::Element[vertexElementCount];
+    std::vector<VertexElementEncoding> encodings(vertexElementCount);
+    bool decode = false;
     for (unsigned int i = 0; i < vertexElementCount; ++i)
     {
         unsigned int vUsage, vSize;
@@ -1438,21 +1671,78 @@ Bundle::MeshData* Bundle::readMeshData()
         {
             GP_ERROR("Failed to load vertex usage.");
             SAFE_DELETE_ARRAY(vertexElements);
+            SAFE_DELETE_ARRAY(storedElements);
             return NULL;
         }
-        if (_stream->read(&vSize, 4, 1) != 1)
+        if (_stream->read(&vSize, 4, 1) != 1 || vSize < 1 || vSize > 4)
         {
             GP_ERROR("Failed to load vertex size.");
             SAFE_DELETE_ARRAY(vertexElements);
+            SAFE_DELETE_ARRAY(storedElements);
             return NULL;
         }
 
-        vertexElements[i].usage = (VertexFormat::Usage)vUsage;
-        vertexElements[i].size = vSize;
+        VertexElementEncoding& encoding = encodings[i];
+        encoding.encoding = BUNDLE_VERTEX_FLOAT;
+        if (_version[1] >= 3 && _stream->read(&encoding.encoding, 4, 1) != 1)
+        {
+            GP_ERROR("Failed to load vertex encoding.");
+            SAFE_DELETE_ARRAY(vertexElements);
+            SAFE_DELETE_ARRAY(storedElements);
+            return NULL;
+        }
+
+        VertexFormat::Usage usage = (VertexFormat::Usage)vUsage;
+        vertexElements[i] = VertexFormat::Element(usage, vSize);
+        switch (encoding.encoding)
+        {
+        case BUNDLE_VERTEX_FLOAT:
+            storedElements[i] = vertexElements[i];
+            break;
+        case BUNDLE_VERTEX_SNORM16:
+            if (_stream->read(encoding.offset, 4, vSize) != vSize || _stream->read(encoding.scale, 4, vSize) != vSize)
+            {
+                GP_ERROR("Failed to load vertex encoding range.");
+                SAFE_DELETE_ARRAY(vertexElements);
+                SAFE_DELETE_ARRAY(storedElements);
+                return NULL;
+            }
+            storedElements[i] = VertexFormat::Element(usage, vSize, VertexFormat::SHORT, true);
+            decode = true;
+            break;
+        case BUNDLE_VERTEX_OCTAHEDRAL16:
+            if (vSize != 3)
+            {
+                GP_ERROR("Invalid vertex size %d for octahedral encoding (must be 3).", vSize);
+                SAFE_DELETE_ARRAY(vertexElements);
+                SAFE_DELETE_ARRAY(storedElements);
+                return NULL;
+            }
+            storedElements[i] = VertexFormat::Element(usage, 2, VertexFormat::SHORT, true);
+            vertexElements[i] = VertexFormat::Element(usage, vSize, VertexFormat::SHORT, true);
+            decode = true;
+            break;
+        case BUNDLE_VERTEX_UNORM16:
+            vertexElements[i] = storedElements[i] = VertexFormat::Element(usage, vSize, VertexFormat::UNSIGNED_SHORT, true);
+            break;
+        case BUNDLE_VERTEX_UNORM8:
+            vertexElements[i] = storedElements[i] = VertexFormat::Element(usage, vSize, VertexFormat::UNSIGNED_BYTE, true);
+            break;
+        case BUNDLE_VERTEX_UINT8:
+            vertexElements[i] = storedElements[i] = VertexFormat::Element(usage, vSize, VertexFormat::UNSIGNED_BYTE, false);
+            break;
+        default:
+            GP_ERROR("Unsupported vertex encoding %d.", encoding.encoding);
+            SAFE_DELETE_ARRAY(vertexElements);
+            SAFE_DELETE_ARRAY(storedElements);
+            return NULL;
+        }
     }
 
     MeshData* meshData = new MeshData(VertexFormat(vertexElements, vertexElementCount));
+    VertexFormat storedFormat(storedElements, vertexElementCount);
     SAFE_DELETE_ARRAY(vertexElements);
+    SAFE_DELETE_ARRAY(storedElements);
 
     // Read vertex data.
     unsigned int vertexByteCount;
@@ -1469,15 +1759,28 @@ Bundle::MeshData* Bundle::readMeshData()
         return NULL;
     }
 
-    GP_ASSERT(meshData->vertexFormat.getVertexSize());
-    meshData->vertexCount = vertexByteCount / meshData->vertexFormat.getVertexSize();
-    meshData->vertexData = new unsigned char[vertexByteCount];
-    if (_stream->read(meshData->vertexData, 1, vertexByteCount) != vertexByteCount)
+    GP_ASSERT(storedFormat.getVertexSize());
+    meshData->vertexCount = vertexByteCount / storedFormat.getVertexSize();
+    meshData->vertexData = readData(_stream, vertexByteCount, inPlace || decode, &meshData->vertexDataOwned);
+    if (meshData->vertexData == NULL)
     {
         GP_ERROR("Failed to load vertex data.");
         SAFE_DELETE(meshData);
         return NULL;
     }
+    if (decode)
+    {
+        // The stored data is only needed until it has been decoded, so it is read in place when possible.
+        unsigned char* storedData = meshData->vertexData;
+        bool storedDataOwned = meshData->vertexDataOwned;
+        meshData->vertexData = new unsigned char[meshData->vertexCount * meshData->vertexFormat.getVertexSize()];
+        meshData->vertexDataOwned = true;
+        decodeVertices(storedFormat, meshData->vertexFormat, encodings, storedData, meshData->vertexData, meshData->vertexCount);
+        if (storedDataOwned)
+        {
+            SAFE_DELETE_ARRAY(storedData);
+        }
+    }
 
     // Read mesh bounds (bounding box and bounding sphere).
     if (_stream->read(&meshData->boundingBox.min.x, 4, 3) != 3 || _stream->read(&meshData->boundingBox.max.x, 4, 3) != 3)
@@ -1550,8 +1853,8 @@ Bundle::MeshData* Bundle::readMeshData()
         GP_ASSERT(indexSize);
         partData->indexCount = iByteCount / indexSize;
 
-        partData->indexData = new unsigned char[iByteCount];
-        if (_stream->read(partData->indexData, 1, iByteCount) != iByteCount)
+        partData->indexData = readData(_stream, iByteCount, inPlace, &partData->indexDataOwned);
+        if (partData->indexData == NULL)
         {
             GP_ERROR("Failed to read index data for mesh part with index %d.", i);
             SAFE_DELETE(meshData);
@@ -1694,13 +1997,13 @@ Font* Bundle::loadFont(const char* id)
         return NULL;
     }
 
-    // Read texture data.
-    unsigned char* textureData = new unsigned char[textureByteCount];
-    if (_stream->read(textureData, 1, textureByteCount) != textureByteCount)
+    // Read texture data, in place when possible since it is only needed for the upload.
+    bool textureDataOwned;
+    unsigned char* textureData = readData(_stream, textureByteCount, true, &textureDataOwned);
+    if (textureData == NULL)
     {
         GP_ERROR("Failed to read texture data for font '%s'.", id);
         SAFE_DELETE_ARRAY(glyphs);
-        SAFE_DELETE_ARRAY(textureData);
         return NULL;
     }
 
@@ -1708,7 +2011,10 @@ Font* Bundle::loadFont(const char* id)
     Texture* texture = Texture::create(Texture::ALPHA, width, height, textureData, true);
 
     // Free the texture data (no longer needed).
-    SAFE_DELETE_ARRAY(textureData);
+    if (textureDataOwned)
+    {
+        SAFE_DELETE_ARRAY(textureData);
+    }
 
     if (texture == NULL)
     {
@@ -1775,23 +2081,29 @@ Bundle::Reference::~Reference()
 }
 
 Bundle::MeshPartData::MeshPartData() :
-    indexCount(0), indexData(NULL)
+    indexCount(0), indexData(NULL), indexDataOwned(true)
 {
 }
 
 Bundle::MeshPartData::~MeshPartData()
 {
-    SAFE_DELETE_ARRAY(indexData);
+    if (indexDataOwned)
+    {
+        SAFE_DELETE_ARRAY(indexData);
+    }
 }
 
 Bundle::MeshData::MeshData(const VertexFormat& vertexFormat)
-    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL)
+    : vertexFormat(vertexFormat), vertexCount(0), vertexData(NULL), vertexDataOwned(true)
 {
 }
 
 Bundle::MeshData::~MeshData()
 {
-    SAFE_DELETE_ARRAY(vertexData);
+    if (vertexDataOwned)
+    {
+        SAFE_DELETE_ARRAY(vertexData);
+    }
 
     for (unsigned int i = 0; i < parts.size(); ++i)
     {
@@ -133,6 +133,7 @@ private:
         Mesh::IndexFormat indexFormat;
         unsigned int indexCount;
         unsigned char* indexData;
+        bool indexDataOwned;
     };
 
     struct MeshData
@@ -143,6 +144,7 @@ private:
         VertexFormat vertexFormat;
         unsigned int vertexCount;
         unsigned char* vertexData;
+        bool vertexDataOwned;
         BoundingBox boundingBox;
         BoundingSphere boundingSphere;
         Mesh::PrimitiveType primitiveType;
@@ -166,6 +168,12 @@ private:
      */
     Reference* find(const char* id) const;
 
+    /**
+     * Builds the indices used to look up refs by id and by offset.
+     * Called once the ref table has been read.
+     */
+    void buildReferenceIndex();
+
     /**
      * Resets any load session specific state for the bundle.
      */
@@ -348,8 +356,12 @@ private:
 
     /**
      * Reads mesh data from the current file position.
+     *
+     * @param inPlace true to reference the vertex and index data directly in the bundle's
+     *      memory mapped stream rather than copying it, when the stream supports it. Such
+     *      data is only valid as long as the bundle is open.
      */
-    MeshData* readMeshData();
+    MeshData* readMeshData(bool inPlace = false);
 
     /**
      * Reads mesh data for the specified URL.
@@ -437,7 +449,12 @@ private:
     std::string _materialPath;
     unsigned int _referenceCount;
     Reference* _references;
+    // Open addressing hash table of refs by id, holding ref indices plus one (zero marks an empty slot).
+    std::vector<unsigned int> _referenceTable;
+    // Refs with non-empty ids as (offset, index) pairs, sorted by offset.
+    std::vector<std::pair<unsigned int, unsigned int> > _referenceOffsets;
     Stream* _stream;
+    unsigned char _version[2];
 
     std::vector<MeshSkinData*> _meshSkins;
     std::map<std::string, Node*>* _trackedNodes;
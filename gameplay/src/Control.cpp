@@ -5,12 +5,14 @@
 namespace gameplay
 {
 
+static const ScriptTarget::Event __controlEvent = { "controlEvent", "<Control>[Control::Listener::EventType]" };
+
 Control::Control()
     : _id(""), _state(Control::NORMAL), _bounds(Rectangle::empty()), _clipBounds(Rectangle::empty()), _viewportClipBounds(Rectangle::empty()),
     _clearBounds(Rectangle::empty()), _dirty(true), _consumeInputEvents(false), _alignment(ALIGN_TOP_LEFT), _isAlignmentSet(false), _autoWidth(false), _autoHeight(false), _listeners(NULL), _visible(true),
     _zIndex(-1), _contactIndex(INVALID_CONTACT_INDEX), _focusIndex(-1), _parent(NULL), _styleOverridden(false), _skin(NULL), _previousState(NORMAL)
 {
-    addScriptEvent("controlEvent", "<Control>[Control::Listener::EventType]");
+    addScriptEvent(&__controlEvent);
 }
 
 Control::~Control()
@@ -928,7 +930,7 @@ void Control::notifyListeners(Control::Listener::EventType eventType)
         }
     }
 
-    fireScriptEvent<void>("controlEvent", this, eventType);
+    fireScriptEvent<void>(&__controlEvent, this, eventType);
 
     release();
 }
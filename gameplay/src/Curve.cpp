@@ -88,8 +88,15 @@ Curve* Curve::create(unsigned int pointCount, unsigned int componentCount)
     return new Curve(pointCount, componentCount);
 }
 
+Curve* Curve::createQuantized(unsigned int pointCount, unsigned int componentCount, const float* times,
+                              const unsigned short* values, const float* offset, const float* scale)
+{
+    return new Curve(pointCount, componentCount, times, values, offset, scale);
+}
+
 Curve::Curve(unsigned int pointCount, unsigned int componentCount)
-    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL)
+    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL),
+      _times(NULL), _quantizedValues(NULL), _quantizedRange(NULL)
 {
     _points = new Point[_pointCount];
     for (unsigned int i = 0; i < _pointCount; i++)
@@ -103,10 +110,34 @@ Curve::Curve(unsigned int pointCount, unsigned int componentCount)
     _points[_pointCount - 1].time = 1.0f;
 }
 
+Curve::Curve(unsigned int pointCount, unsigned int componentCount, const float* times,
+             const unsigned short* values, const float* offset, const float* scale)
+    : _pointCount(pointCount), _componentCount(componentCount), _componentSize(sizeof(float)*componentCount), _quaternionOffset(NULL), _points(NULL),
+      _times(NULL), _quantizedValues(NULL), _quantizedRange(NULL)
+{
+    assert(pointCount > 0 && componentCount > 0 && times && values && offset && scale);
+
+    _times = new float[_pointCount];
+    memcpy(_times, times, sizeof(float) * _pointCount);
+    _quantizedValues = new unsigned short[_pointCount * _componentCount];
+    memcpy(_quantizedValues, values, sizeof(unsigned short) * _pointCount * _componentCount);
+
+    // Fold the 1/65535 of the decoding into the scales.
+    _quantizedRange = new float[_componentCount * 2];
+    for (unsigned int i = 0; i < _componentCount; i++)
+    {
+        _quantizedRange[i * 2] = offset[i];
+        _quantizedRange[i * 2 + 1] = scale[i] / 65535.0f;
+    }
+}
+
 Curve::~Curve()
 {
     SAFE_DELETE_ARRAY(_points);
     SAFE_DELETE_ARRAY(_quaternionOffset);
+    SAFE_DELETE_ARRAY(_times);
+    SAFE_DELETE_ARRAY(_quantizedValues);
+    SAFE_DELETE_ARRAY(_quantizedRange);
 }
 
 Curve::Point::Point()
@@ -114,6 +145,11 @@ Curve::Point::Point()
 {
 }
 
+Curve::Cursor::Cursor()
+    : startTime(-1.0f), endTime(-1.0f), min(0), max(0), index(0)
+{
+}
+
 Curve::Point::~Point()
 {
     SAFE_DELETE_ARRAY(value);
@@ -133,12 +169,12 @@ unsigned int Curve::getComponentCount() const
 
 float Curve::getStartTime() const
 {
-    return _points[0].time;
+    return getTime(0);
 }
 
 float Curve::getEndTime() const
 {
-    return _points[_pointCount-1].time;
+    return getTime(_pointCount-1);
 }
 
 void Curve::setPoint(unsigned int index, float time, float* value, InterpolationType type)
@@ -148,6 +184,12 @@ void Curve::setPoint(unsigned int index, float time, float* value, Interpolation
 
 void Curve::setPoint(unsigned int index, float time, float* value, InterpolationType type, float* inValue, float* outValue)
 {
+    if (!_points)
+    {
+        assert(!"Cannot set a point of a quantized curve.");
+        return;
+    }
+
     assert(index < _pointCount && time >= 0.0f && time <= 1.0f && !(_pointCount > 1 && index == 0 && time != 0.0f) && !(_pointCount != 1 && index == _pointCount - 1 && time != 1.0f));
 
     _points[index].time = time;
@@ -165,6 +207,12 @@ void Curve::setPoint(unsigned int index, float time, float* value, Interpolation
 
 void Curve::setTangent(unsigned int index, InterpolationType type, float* inValue, float* outValue)
 {
+    if (!_points)
+    {
+        assert(!"Cannot set a tangent of a quantized curve.");
+        return;
+    }
+
     assert(index < _pointCount);
 
     _points[index].type = type;
@@ -184,9 +232,20 @@ void Curve::evaluate(float time, float* dst) const
 }
 
 void Curve::evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst) const
+{
+    evaluate(time, startTime, endTime, loopBlendTime, dst, NULL);
+}
+
+void Curve::evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst, Cursor* cursor) const
 {
     assert(dst && startTime >= 0.0f && startTime <= endTime && endTime <= 1.0f && loopBlendTime >= 0.0f);
 
+    if (_quantizedValues)
+    {
+        evaluateQuantized(time, startTime, endTime, loopBlendTime, dst, cursor);
+        return;
+    }
+
     // If there's only one point on the curve, return its value.
     if (_pointCount == 1)
     {
@@ -200,8 +259,23 @@ void Curve::evaluate(float time, float startTime, float endTime, float loopBlend
     if (startTime > 0.0f || endTime < 1.0f)
     {
         // Evaluating a sub section of the curve
-        min = determineIndex(startTime, 0, max);
-        max = determineIndex(endTime, min, max);
+        if (cursor && cursor->startTime == startTime && cursor->endTime == endTime)
+        {
+            min = cursor->min;
+            max = cursor->max;
+        }
+        else
+        {
+            min = determineIndex(startTime, 0, max);
+            max = determineIndex(endTime, min, max);
+            if (cursor)
+            {
+                cursor->startTime = startTime;
+                cursor->endTime = endTime;
+                cursor->min = min;
+                cursor->max = max;
+            }
+        }
 
         // Convert time to fall within the subregion
         localTime = _points[min].time + (_points[max].time - _points[min].time) * time;
@@ -256,8 +330,8 @@ void Curve::evaluate(float time, float startTime, float endTime, float loopBlend
     }
     else
     {
-        // Locate the points we are interpolating between using a binary search.
-        index = determineIndex(localTime, min, max);
+        // Locate the points we are interpolating between.
+        index = determineIndex(localTime, min, max, cursor);
         from = &_points[index];
         to = &_points[index == max ? index : index+1];
 
@@ -1220,6 +1294,135 @@ void Curve::interpolateQuaternion(float s, float* from, float* to, float* dst) c
         Quaternion::slerp(to[0], to[1], to[2], to[3], from[0], from[1], from[2], from[3], s, dst, dst + 1, dst + 2, dst + 3);
 }
 
+void Curve::evaluateQuantized(float time, float startTime, float endTime, float loopBlendTime, float* dst, Cursor* cursor) const
+{
+    // Same as evaluate(), except that points are decoded as they are interpolated.
+    if (_pointCount == 1)
+    {
+        decodeQuantized(0, dst);
+        return;
+    }
+
+    unsigned int min = 0;
+    unsigned int max = _pointCount - 1;
+    float localTime = time;
+    if (startTime > 0.0f || endTime < 1.0f)
+    {
+        // Evaluating a sub section of the curve
+        if (cursor && cursor->startTime == startTime && cursor->endTime == endTime)
+        {
+            min = cursor->min;
+            max = cursor->max;
+        }
+        else
+        {
+            min = determineIndex(startTime, 0, max);
+            max = determineIndex(endTime, min, max);
+            if (cursor)
+            {
+                cursor->startTime = startTime;
+                cursor->endTime = endTime;
+                cursor->min = min;
+                cursor->max = max;
+            }
+        }
+
+        // Convert time to fall within the subregion
+        localTime = _times[min] + (_times[max] - _times[min]) * time;
+    }
+
+    if (loopBlendTime == 0.0f)
+    {
+        // If no loop blend time is specified, clamp time to end points
+        if (localTime < _times[min])
+            localTime = _times[min];
+        else if (localTime > _times[max])
+            localTime = _times[max];
+    }
+
+    // If an exact endpoint was specified, skip interpolation and return the value directly
+    if (localTime == _times[min])
+    {
+        decodeQuantized(min, dst);
+        return;
+    }
+    if (localTime == _times[max])
+    {
+        decodeQuantized(max, dst);
+        return;
+    }
+
+    unsigned int from;
+    unsigned int to;
+    float t;
+    if (localTime > _times[max])
+    {
+        // Looping forward
+        from = max;
+        to = min;
+        t = (localTime - _times[from]) / loopBlendTime;
+    }
+    else if (localTime < _times[min])
+    {
+        // Looping in reverse
+        from = min;
+        to = max;
+        t = (_times[from] - localTime) / loopBlendTime;
+    }
+    else
+    {
+        from = determineIndex(localTime, min, max, cursor);
+        to = from == max ? from : from + 1;
+        t = (localTime - _times[from]) / (_times[to] - _times[from]);
+    }
+
+    interpolateQuantized(t, from, to, dst);
+}
+
+void Curve::decodeQuantized(unsigned int index, float* dst) const
+{
+    const unsigned short* value = _quantizedValues + index * _componentCount;
+    for (unsigned int i = 0; i < _componentCount; i++)
+    {
+        dst[i] = _quantizedRange[i * 2] + _quantizedRange[i * 2 + 1] * value[i];
+    }
+}
+
+void Curve::interpolateQuantized(float s, unsigned int from, unsigned int to, float* dst) const
+{
+    const unsigned short* fromValue = _quantizedValues + from * _componentCount;
+    const unsigned short* toValue = _quantizedValues + to * _componentCount;
+    unsigned int quaternionOffset = _quaternionOffset ? *_quaternionOffset : _componentCount;
+
+    for (unsigned int i = 0; i < _componentCount; i++)
+    {
+        if (i == quaternionOffset)
+        {
+            // Decode both quaternions to interpolate them.
+            float fromQuaternion[4];
+            float toQuaternion[4];
+            for (unsigned int j = 0; j < 4; j++)
+            {
+                const float* range = _quantizedRange + (i + j) * 2;
+                fromQuaternion[j] = range[0] + range[1] * fromValue[i + j];
+                toQuaternion[j] = range[0] + range[1] * toValue[i + j];
+            }
+            interpolateQuaternion(s, fromQuaternion, toQuaternion, dst + i);
+            i += 3;
+        }
+        else
+        {
+            const float* range = _quantizedRange + i * 2;
+            dst[i] = range[0] + range[1] * lerpInl(s, (float)fromValue[i], (float)toValue[i]);
+        }
+    }
+}
+
+float Curve::getTime(unsigned int index) const
+{
+    return _times ? _times[index] : _points[index].time;
+}
+
 int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
 {
     unsigned int mid;
@@ -1229,9 +1432,9 @@ int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
     {
         mid = (min + max) >> 1;
 
-        if (time >= _points[mid].time && time <= _points[mid + 1].time)
+        if (time >= getTime(mid) && time <= getTime(mid + 1))
             return mid;
-        else if (time < _points[mid].time)
+        else if (time < getTime(mid))
             max = mid - 1;
         else
             min = mid + 1;
@@ -1241,6 +1444,34 @@ int Curve::determineIndex(float time, unsigned int min, unsigned int max) const
     return -1;
 }
 
+unsigned int Curve::determineIndex(float time, unsigned int min, unsigned int max, Cursor* cursor) const
+{
+    if (!cursor)
+        return determineIndex(time, min, max);
+
+    // Try the keyframe used by the previous evaluation, then the one after it.
+    // A time exactly on a keyframe always resolves to the segment starting there.
+    unsigned int index = cursor->index;
+    if (index >= min && index < max && time >= getTime(index))
+    {
+        if (time < getTime(index + 1))
+            return index;
+
+        if (index + 1 < max && time < getTime(index + 2))
+        {
+            cursor->index = index + 1;
+            return index + 1;
+        }
+    }
+
+    // Fall back to a binary search after a seek, a loop or a large time step.
+    index = (unsigned int)determineIndex(time, min, max);
+    while (index + 1 < max && time >= getTime(index + 1))
+        ++index;
+    cursor->index = index;
+    return index;
+}
+
 int Curve::getInterpolationType(const char* curveId)
 {
     if (strcmp(curveId, "BEZIER") == 0)
@@ -284,6 +284,24 @@ public:
      */
     static Curve* create(unsigned int pointCount, unsigned int componentCount);
 
+    /**
+     * Creates a new linearly interpolated curve whose values are stored quantized to 16 bits.
+     *
+     * Component i of a value is decoded as offset[i] + scale[i] * quantized / 65535. Points are
+     * decoded as the curve is evaluated, so the curve only takes the memory of its quantized
+     * values. The points of a quantized curve cannot be changed.
+     *
+     * @param pointCount The number of points in the curve.
+     * @param componentCount The number of float component values per key value.
+     * @param times The times of the points, increasing from 0.0 to 1.0.
+     * @param values The quantized values of the points (componentCount values per point).
+     * @param offset The offset of each component.
+     * @param scale The scale of each component.
+     * @script{ignore}
+     */
+    static Curve* createQuantized(unsigned int pointCount, unsigned int componentCount, const float* times,
+                                  const unsigned short* values, const float* offset, const float* scale);
+
     /**
      * Gets the number of points in the curve.
      *
@@ -425,6 +443,43 @@ private:
         Point& operator=(const Point&);
     };
 
+    /**
+     * Remembers where the keyframes were found by the previous evaluation of a curve.
+     *
+     * Animation playback almost always moves forward by a small step each frame, so
+     * the keyframe needed next is usually the same one or the one after it. A cursor
+     * is owned by whoever evaluates the curve (one per clip and channel) since curves
+     * are shared between clips.
+     */
+    class Cursor
+    {
+    public:
+
+        /**
+         * Constructor.
+         */
+        Cursor();
+
+        /** The start time of the subregion that min was found for. */
+        float startTime;
+        /** The end time of the subregion that max was found for. */
+        float endTime;
+        /** The first keyframe of the subregion. */
+        unsigned int min;
+        /** The last keyframe of the subregion. */
+        unsigned int max;
+        /** The keyframe interpolated from by the last evaluation. */
+        unsigned int index;
+    };
+
+    /**
+     * Evaluates the curve within the specified subregion, using and updating the given
+     * cursor to avoid searching for the keyframes at each call.
+     *
+     * @see evaluate(float, float, float, float, float*)
+     */
+    void evaluate(float time, float startTime, float endTime, float loopBlendTime, float* dst, Cursor* cursor) const;
+
     /**
      * Constructor.
      */
@@ -438,6 +493,14 @@ private:
      */
     Curve(unsigned int pointCount, unsigned int componentCount);
 
+    /**
+     * Constructs a new quantized curve.
+     *
+     * @see createQuantized
+     */
+    Curve(unsigned int pointCount, unsigned int componentCount, const float* times,
+          const unsigned short* values, const float* offset, const float* scale);
+
     /**
      * Constructor.
      */
@@ -487,12 +550,41 @@ private:
      * Quaternion interpolation function.
      */
     void interpolateQuaternion(float s, float* from, float* to, float* dst) const;
+
+    /**
+     * Evaluates a quantized curve.
+     *
+     * @see evaluate(float, float, float, float, float*, Cursor*)
+     */
+    void evaluateQuantized(float time, float startTime, float endTime, float loopBlendTime, float* dst, Cursor* cursor) const;
+
+    /**
+     * Decodes the value of a point of a quantized curve.
+     */
+    void decodeQuantized(unsigned int index, float* dst) const;
+
+    /**
+     * Linear interpolation function for quantized curves.
+     */
+    void interpolateQuantized(float s, unsigned int from, unsigned int to, float* dst) const;
+
+    /**
+     * Returns the time of the point at the specified index.
+     */
+    float getTime(unsigned int index) const;
     
     /**
      * Determines the current keyframe to interpolate from based on the specified time.
      */ 
     int determineIndex(float time, unsigned int min, unsigned int max) const;
 
+    /**
+     * Determines the current keyframe to interpolate from based on the specified time,
+     * checking the keyframe stored in the cursor and the one after it before searching.
+     * The time must lie strictly between the times of the min and max keyframes.
+     */
+    unsigned int determineIndex(float time, unsigned int min, unsigned int max, Cursor* cursor) const;
+
     /**
      * Sets the offset for the beginning of a Quaternion piece of data within the curve's value span at the specified
      * index. The next four components of data starting at the given index will be interpolated as a Quaternion.
@@ -516,6 +608,9 @@ private:
     unsigned int _componentSize;        // The component size (in bytes).
     unsigned int* _quaternionOffset;    // Offset for the rotation component.
     Point* _points;                     // The points on the curve.
+    float* _times;                      // The point times of a quantized curve.
+    unsigned short* _quantizedValues;   // The point values of a quantized curve.
+    float* _quantizedRange;             // The offset and scale of each component of a quantized curve.
 };
 
 }
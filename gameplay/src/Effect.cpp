@@ -4,6 +4,9 @@
 
 #define OPENGL_ES_DEFINE  "#define OPENGL_ES\n"
 
+// Number of texture units whose bound samplers are tracked.
+#define TRACKED_TEXTURE_UNITS 32
+
 namespace gameplay
 {
 
@@ -11,6 +14,11 @@ namespace gameplay
 static std::map<std::string, Effect*> __effectCache;
 static Effect* __currentEffect = NULL;
 
+// Textures bound to each texture unit, tracked while drawing a render queue.
+static bool __textureTracking = false;
+static TextureHandle __boundTextures[TRACKED_TEXTURE_UNITS];
+static unsigned int __textureBindCount = 0;
+
 Effect::Effect() : _program(0)
 {
 }
@@ -561,10 +569,7 @@ void Effect::setValue(Uniform* uniform, const Texture::Sampler* sampler)
     GP_ASSERT(uniform->_type == GL_SAMPLER_2D);
     GP_ASSERT(sampler);
 
-    GL_ASSERT( glActiveTexture(GL_TEXTURE0 + uniform->_index) );
-
-    // Bind the sampler - this binds the texture and applies sampler state
-    const_cast<Texture::Sampler*>(sampler)->bind();
+    bindSampler(uniform->_index, sampler);
 
     GL_ASSERT( glUniform1i(uniform->_location, uniform->_index) );
 }
@@ -579,10 +584,7 @@ void Effect::setValue(Uniform* uniform, const Texture::Sampler** values, unsigne
     GLint units[32];
     for (unsigned int i = 0; i < count; ++i)
     {
-        GL_ASSERT( glActiveTexture(GL_TEXTURE0 + uniform->_index + i) );
-
-        // Bind the sampler - this binds the texture and applies sampler state
-        const_cast<Texture::Sampler*>(values[i])->bind();
+        bindSampler(uniform->_index + i, values[i]);
 
         units[i] = uniform->_index + i;
     }
@@ -603,6 +605,38 @@ Effect* Effect::getCurrentEffect()
     return __currentEffect;
 }
 
+void Effect::bindSampler(unsigned int unit, const Texture::Sampler* sampler)
+{
+    GP_ASSERT(sampler);
+    GP_ASSERT(sampler->getTexture());
+
+    if (__textureTracking && unit < TRACKED_TEXTURE_UNITS)
+    {
+        // Samplers of the same texture may differ in their wrap and filter modes.
+        TextureHandle handle = sampler->getTexture()->getHandle();
+        if (__boundTextures[unit] == handle && sampler->isStateApplied())
+            return;
+        __boundTextures[unit] = handle;
+    }
+
+    GL_ASSERT( glActiveTexture(GL_TEXTURE0 + unit) );
+
+    // Bind the sampler - this binds the texture and applies sampler state
+    const_cast<Texture::Sampler*>(sampler)->bind();
+    ++__textureBindCount;
+}
+
+void Effect::setTextureTrackingEnabled(bool enabled)
+{
+    __textureTracking = enabled;
+    memset(__boundTextures, 0, sizeof(__boundTextures));
+}
+
+unsigned int Effect::getTextureBindCount()
+{
+    return __textureBindCount;
+}
+
 Uniform::Uniform() :
     _location(-1), _type(0), _index(0)
 {
@@ -25,6 +25,8 @@ class Uniform;
  */
 class Effect: public Ref
 {
+    friend class RenderQueue;
+
 public:
 
     /**
@@ -241,6 +243,27 @@ private:
 
     static Effect* createFromSource(const char* vshPath, const char* vshSource, const char* fshPath, const char* fshSource, const char* defines = NULL);
 
+    /**
+     * Binds a sampler to a texture unit.
+     *
+     * While texture tracking is enabled, the sampler is not bound if its texture is already
+     * bound to the unit with the state of the sampler.
+     */
+    static void bindSampler(unsigned int unit, const Texture::Sampler* sampler);
+
+    /**
+     * Enables or disables the tracking of the textures bound to each texture unit.
+     *
+     * Tracking is only enabled while a render queue is drawn, since the textures bound
+     * outside of effects are not tracked. Enabling it forgets all previously bound textures.
+     */
+    static void setTextureTrackingEnabled(bool enabled);
+
+    /**
+     * Returns the number of times a texture has been bound by effects.
+     */
+    static unsigned int getTextureBindCount();
+
     GLuint _program;
     std::string _id;
     std::map<std::string, VertexAttribute> _vertexAttributes;
@@ -26,6 +26,13 @@
 extern AAssetManager* __assetManager;
 #endif
 
+#if !defined(WIN32) && !defined(__ANDROID__)
+    #include <sys/mman.h>
+    #include <fcntl.h>
+    #include <unistd.h>
+    #define USE_MAPPED_FILES
+#endif
+
 namespace gameplay
 {
 
@@ -144,6 +151,47 @@ private:
     bool _canWrite;
 };
 
+#ifdef USE_MAPPED_FILES
+
+/**
+ * A read-only stream over a file that is mapped into memory.
+ * 
+ * @script{ignore}
+ */
+class FileStreamMapped : public Stream
+{
+public:
+    friend class FileSystem;
+    
+    ~FileStreamMapped();
+    virtual bool canRead();
+    virtual bool canWrite();
+    virtual bool canSeek();
+    virtual void close();
+    virtual size_t read(void* ptr, size_t size, size_t count);
+    virtual const void* readInPlace(size_t size);
+    virtual char* readLine(char* str, int num);
+    virtual size_t write(const void* ptr, size_t size, size_t count);
+    virtual bool eof();
+    virtual size_t length();
+    virtual long int position();
+    virtual bool seek(long int offset, int origin);
+    virtual bool rewind();
+
+    static FileStreamMapped* create(const char* filePath);
+
+private:
+    FileStreamMapped(void* data, size_t length);
+
+private:
+    void* _data;
+    size_t _length;
+    size_t _position;
+    bool _open;
+};
+
+#endif
+
 #ifdef __ANDROID__
 
 /**
@@ -161,6 +209,7 @@ public:
     virtual bool canSeek();
     virtual void close();
     virtual size_t read(void* ptr, size_t size, size_t count);
+    virtual const void* readInPlace(size_t size);
     virtual char* readLine(char* str, int num);
     virtual size_t write(const void* ptr, size_t size, size_t count);
     virtual bool eof();
@@ -423,6 +472,15 @@ Stream* FileSystem::open(const char* path, size_t mode)
             }
         }
     }
+#endif
+#ifdef USE_MAPPED_FILES
+    if ((mode & MAPPED) != 0 && (mode & WRITE) == 0)
+    {
+        // Fall back to a regular stream if the file cannot be mapped.
+        FileStreamMapped* stream = FileStreamMapped::create(fullPath.c_str());
+        if (stream)
+            return stream;
+    }
 #endif
     FileStream* stream = FileStream::create(fullPath.c_str(), modeStr);
     return stream;
@@ -746,6 +804,187 @@ bool FileStream::rewind()
 
 ////////////////////////////////
 
+#ifdef USE_MAPPED_FILES
+
+FileStreamMapped::FileStreamMapped(void* data, size_t length)
+    : _data(data), _length(length), _position(0), _open(true)
+{
+}
+
+FileStreamMapped::~FileStreamMapped()
+{
+    if (_open)
+    {
+        close();
+    }
+}
+
+FileStreamMapped* FileStreamMapped::create(const char* filePath)
+{
+    int file = ::open(filePath, O_RDONLY);
+    if (file == -1)
+        return NULL;
+
+    struct stat s;
+    if (fstat(file, &s) != 0 || !S_ISREG(s.st_mode))
+    {
+        ::close(file);
+        return NULL;
+    }
+
+    // Empty files cannot be mapped, but are still valid streams.
+    size_t length = (size_t)s.st_size;
+    void* data = NULL;
+    if (length > 0)
+    {
+        data = mmap(NULL, length, PROT_READ, MAP_PRIVATE, file, 0);
+        if (data == MAP_FAILED)
+        {
+            ::close(file);
+            return NULL;
+        }
+    }
+
+    // The mapping keeps the file contents accessible after the descriptor is closed.
+    ::close(file);
+
+    return new FileStreamMapped(data, length);
+}
+
+bool FileStreamMapped::canRead()
+{
+    return _open;
+}
+
+bool FileStreamMapped::canWrite()
+{
+    return false;
+}
+
+bool FileStreamMapped::canSeek()
+{
+    return _open;
+}
+
+void FileStreamMapped::close()
+{
+    if (_data)
+        munmap(_data, _length);
+    _data = NULL;
+    _length = 0;
+    _position = 0;
+    _open = false;
+}
+
+size_t FileStreamMapped::read(void* ptr, size_t size, size_t count)
+{
+    if (!_open || size == 0)
+        return 0;
+
+    // Like fread, only read whole elements.
+    size_t available = (_length - _position) / size;
+    if (count > available)
+        count = available;
+
+    memcpy(ptr, (const char*)_data + _position, size * count);
+    _position += size * count;
+    return count;
+}
+
+const void* FileStreamMapped::readInPlace(size_t size)
+{
+    if (!_open || size > _length - _position)
+        return NULL;
+
+    const void* ptr = (const char*)_data + _position;
+    _position += size;
+    return ptr;
+}
+
+char* FileStreamMapped::readLine(char* str, int num)
+{
+    if (!_open || num <= 0 || _position >= _length)
+        return NULL;
+
+    // Like fgets, read up to num - 1 characters, stopping after a new line.
+    const char* data = (const char*)_data;
+    int i = 0;
+    while (i < num - 1 && _position < _length)
+    {
+        char c = data[_position++];
+        str[i++] = c;
+        if (c == '\n')
+            break;
+    }
+    str[i] = '\0';
+    return str;
+}
+
+size_t FileStreamMapped::write(const void* ptr, size_t size, size_t count)
+{
+    return 0;
+}
+
+bool FileStreamMapped::eof()
+{
+    return !_open || _position >= _length;
+}
+
+size_t FileStreamMapped::length()
+{
+    return _length;
+}
+
+long int FileStreamMapped::position()
+{
+    if (!_open)
+        return -1;
+    return (long int)_position;
+}
+
+bool FileStreamMapped::seek(long int offset, int origin)
+{
+    if (!_open)
+        return false;
+
+    long int base;
+    switch (origin)
+    {
+    case SEEK_SET:
+        base = 0;
+        break;
+    case SEEK_CUR:
+        base = (long int)_position;
+        break;
+    case SEEK_END:
+        base = (long int)_length;
+        break;
+    default:
+        return false;
+    }
+
+    long int newPosition = base + offset;
+    if (newPosition < 0 || (size_t)newPosition > _length)
+        return false;
+
+    _position = (size_t)newPosition;
+    return true;
+}
+
+bool FileStreamMapped::rewind()
+{
+    if (canSeek())
+    {
+        _position = 0;
+        return true;
+    }
+    return false;
+}
+
+#endif
+
+////////////////////////////////
+
 #ifdef __ANDROID__
 
 FileStreamAndroid::FileStreamAndroid(AAsset* asset)
@@ -798,6 +1037,19 @@ size_t FileStreamAndroid::read(void* ptr, size_t size, size_t count)
     return result > 0 ? ((size_t)result) / size : 0;
 }
 
+const void* FileStreamAndroid::readInPlace(size_t size)
+{
+    // Uncompressed assets are mapped directly from the package; compressed ones are decompressed once.
+    const char* buffer = (const char*)AAsset_getBuffer(_asset);
+    if (!buffer)
+        return NULL;
+
+    long int pos = position();
+    if (pos < 0 || size > length() - (size_t)pos || AAsset_seek(_asset, size, SEEK_CUR) == -1)
+        return NULL;
+    return buffer + pos;
+}
+
 char* FileStreamAndroid::readLine(char* str, int num)
 {
     if (num <= 0)
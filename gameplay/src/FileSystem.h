@@ -18,12 +18,18 @@ public:
 
     /**
      * Mode flags for opening a stream.
+     *
+     * MAPPED may be combined with READ to map the file into memory on platforms that
+     * support it, so that its contents can be accessed without copying through
+     * Stream::readInPlace(). It is ignored when combined with WRITE.
+     *
      * @script{ignore}
      */
     enum StreamMode
     {
         READ = 1,
-        WRITE = 2
+        WRITE = 2,
+        MAPPED = 4
     };
 
     /**
@@ -127,7 +133,7 @@ public:
      * resource path.
      *
      * @param path The path to the resource to be opened, relative to the currently set resource path.
-     * @param mode The mode used to open the file.
+     * @param mode The mode used to open the file, as a combination of StreamMode flags.
      * 
      * @return A stream that can be used to read or write to the file depending on the mode.
      *         Returns NULL if there was an error. (Request mode not supported).
@@ -23,7 +23,7 @@ Game::Game()
       _frameLastFPS(0), _frameCount(0), _frameRate(0),
       _clearDepth(1.0f), _clearStencil(0), _properties(NULL),
       _animationController(NULL), _audioController(NULL),
-      _physicsController(NULL), _aiController(NULL), _audioListener(NULL),
+      _physicsController(NULL), _aiController(NULL), _jobScheduler(NULL), _audioListener(NULL),
       _timeEvents(NULL), _scriptController(NULL), _scriptListeners(NULL)
 {
     GP_ASSERT(__gameInstance == NULL);
@@ -99,6 +99,9 @@ bool Game::startup()
     RenderState::initialize();
     FrameBuffer::initialize();
 
+    _jobScheduler = new JobScheduler();
+    _jobScheduler->initialize();
+
     _animationController = new AnimationController();
     _animationController->initialize();
 
@@ -158,6 +161,7 @@ void Game::shutdown()
         GP_ASSERT(_audioController);
         GP_ASSERT(_physicsController);
         GP_ASSERT(_aiController);
+        GP_ASSERT(_jobScheduler);
 
         Platform::signalShutdown();
 
@@ -194,6 +198,9 @@ void Game::shutdown()
         _aiController->finalize();
         SAFE_DELETE(_aiController);
 
+        _jobScheduler->finalize();
+        SAFE_DELETE(_jobScheduler);
+
         // Note: we do not clean up the script controller here
         // because users can call Game::exit() from a script.
 
@@ -335,6 +342,9 @@ void Game::frame()
         // Run script render.
         _scriptController->render(elapsedTime);
 
+        // Publish the skinning statistics of this frame.
+        MeshSkin::resetStatistics();
+
         // Update FPS.
         ++_frameCount;
         if ((Game::getGameTime() - _frameLastFPS) >= 1000)
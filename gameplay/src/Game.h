@@ -10,6 +10,7 @@
 #include "AnimationController.h"
 #include "PhysicsController.h"
 #include "AIController.h"
+#include "JobScheduler.h"
 #include "AudioListener.h"
 #include "Rectangle.h"
 #include "Vector4.h"
@@ -250,6 +251,15 @@ public:
      */
     inline AIController* getAIController() const;
 
+    /**
+     * Gets the job scheduler for running work in parallel
+     * on the worker threads owned by the game.
+     *
+     * @return The job scheduler for this game.
+     * @script{ignore}
+     */
+    inline JobScheduler* getJobScheduler() const;
+
     /**
      * Gets the script controller for managing control of Lua scripts
      * associated with the game.
@@ -737,6 +747,7 @@ private:
     AudioController* _audioController;          // Controls audio sources that are playing in the game.
     PhysicsController* _physicsController;      // Controls the simulation of a physics scene and entities.
     AIController* _aiController;                // Controls AI simulation.
+    JobScheduler* _jobScheduler;                // Runs jobs on the worker threads.
     AudioListener* _audioListener;              // The audio listener in 3D space.
     std::priority_queue<TimeEvent, std::vector<TimeEvent>, std::less<TimeEvent> >* _timeEvents;     // Contains the scheduled time events.
     ScriptController* _scriptController;            // Controls the scripting engine.
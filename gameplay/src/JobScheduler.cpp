@@ -0,0 +1,387 @@
+#include "Base.h"
+#include "JobScheduler.h"
+
+#ifdef WIN32
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#endif
+
+namespace gameplay
+{
+
+#ifdef WIN32
+
+typedef CRITICAL_SECTION MutexHandle;
+typedef CONDITION_VARIABLE ConditionHandle;
+typedef HANDLE ThreadHandle;
+
+static void initializeMutex(MutexHandle* mutex) { InitializeCriticalSection(mutex); }
+static void destroyMutex(MutexHandle* mutex) { DeleteCriticalSection(mutex); }
+static void lockMutex(MutexHandle* mutex) { EnterCriticalSection(mutex); }
+static void unlockMutex(MutexHandle* mutex) { LeaveCriticalSection(mutex); }
+static void initializeCondition(ConditionHandle* condition) { InitializeConditionVariable(condition); }
+static void destroyCondition(ConditionHandle* condition) { }
+static void waitCondition(ConditionHandle* condition, MutexHandle* mutex) { SleepConditionVariableCS(condition, mutex, INFINITE); }
+static void broadcastCondition(ConditionHandle* condition) { WakeAllConditionVariable(condition); }
+static int atomicAdd(volatile int* value, int amount) { return InterlockedExchangeAdd((volatile LONG*)value, amount) + amount; }
+static int atomicLoad(volatile int* value) { return InterlockedCompareExchange((volatile LONG*)value, 0, 0); }
+static void yieldThread() { SwitchToThread(); }
+
+static unsigned int getProcessorCount()
+{
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned int)info.dwNumberOfProcessors;
+}
+
+#else
+
+typedef pthread_mutex_t MutexHandle;
+typedef pthread_cond_t ConditionHandle;
+typedef pthread_t ThreadHandle;
+
+static void initializeMutex(MutexHandle* mutex) { pthread_mutex_init(mutex, NULL); }
+static void destroyMutex(MutexHandle* mutex) { pthread_mutex_destroy(mutex); }
+static void lockMutex(MutexHandle* mutex) { pthread_mutex_lock(mutex); }
+static void unlockMutex(MutexHandle* mutex) { pthread_mutex_unlock(mutex); }
+static void initializeCondition(ConditionHandle* condition) { pthread_cond_init(condition, NULL); }
+static void destroyCondition(ConditionHandle* condition) { pthread_cond_destroy(condition); }
+static void waitCondition(ConditionHandle* condition, MutexHandle* mutex) { pthread_cond_wait(condition, mutex); }
+static void broadcastCondition(ConditionHandle* condition) { pthread_cond_broadcast(condition); }
+static int atomicAdd(volatile int* value, int amount) { return __sync_add_and_fetch(value, amount); }
+static int atomicLoad(volatile int* value) { return __sync_fetch_and_add(value, 0); }
+static void yieldThread() { sched_yield(); }
+
+static unsigned int getProcessorCount()
+{
+    long count = sysconf(_SC_NPROCESSORS_ONLN);
+    return count > 0 ? (unsigned int)count : 1;
+}
+
+#endif
+
+struct JobScheduler::Batch
+{
+    JobFunction function;
+    void* cookie;
+    volatile int remaining;
+};
+
+struct JobScheduler::Job
+{
+    Batch* batch;
+    unsigned int begin;
+    unsigned int end;
+};
+
+/**
+ * A double-ended queue of jobs owned by one thread. The owner pushes and takes
+ * from the back while other threads steal from the front.
+ */
+class JobScheduler::JobQueue
+{
+public:
+
+    JobQueue() { initializeMutex(&_mutex); }
+
+    ~JobQueue() { destroyMutex(&_mutex); }
+
+    void push(const Job& job)
+    {
+        lockMutex(&_mutex);
+        _jobs.push_back(job);
+        unlockMutex(&_mutex);
+    }
+
+    bool pop(Job* job, bool steal)
+    {
+        bool found = false;
+        lockMutex(&_mutex);
+        if (!_jobs.empty())
+        {
+            if (steal)
+            {
+                *job = _jobs.front();
+                _jobs.pop_front();
+            }
+            else
+            {
+                *job = _jobs.back();
+                _jobs.pop_back();
+            }
+            found = true;
+        }
+        unlockMutex(&_mutex);
+        return found;
+    }
+
+private:
+
+    MutexHandle _mutex;
+    std::deque<Job> _jobs;
+};
+
+/**
+ * Wakes idle worker threads when new jobs are submitted.
+ */
+class JobScheduler::Signal
+{
+public:
+
+    Signal()
+    {
+        initializeMutex(&mutex);
+        initializeCondition(&condition);
+    }
+
+    ~Signal()
+    {
+        destroyCondition(&condition);
+        destroyMutex(&mutex);
+    }
+
+    MutexHandle mutex;
+    ConditionHandle condition;
+};
+
+/**
+ * A worker thread servicing one of the job queues.
+ */
+class JobScheduler::Worker
+{
+public:
+
+    JobScheduler* scheduler;
+    unsigned int queueIndex;
+    ThreadHandle thread;
+
+#ifdef WIN32
+    static DWORD WINAPI threadMain(LPVOID arg)
+    {
+        Worker* worker = (Worker*)arg;
+        JobScheduler::workerMain(worker->scheduler, worker->queueIndex);
+        return 0;
+    }
+
+    bool start() { return (thread = CreateThread(NULL, 0, &threadMain, this, 0, NULL)) != NULL; }
+
+    void join()
+    {
+        WaitForSingleObject(thread, INFINITE);
+        CloseHandle(thread);
+    }
+#else
+    static void* threadMain(void* arg)
+    {
+        Worker* worker = (Worker*)arg;
+        JobScheduler::workerMain(worker->scheduler, worker->queueIndex);
+        return NULL;
+    }
+
+    bool start() { return pthread_create(&thread, NULL, &threadMain, this) == 0; }
+
+    void join() { pthread_join(thread, NULL); }
+#endif
+};
+
+JobScheduler::Mutex::Mutex()
+    : _handle(new MutexHandle)
+{
+    initializeMutex((MutexHandle*)_handle);
+}
+
+JobScheduler::Mutex::~Mutex()
+{
+    destroyMutex((MutexHandle*)_handle);
+    delete (MutexHandle*)_handle;
+}
+
+void JobScheduler::Mutex::lock()
+{
+    lockMutex((MutexHandle*)_handle);
+}
+
+void JobScheduler::Mutex::unlock()
+{
+    unlockMutex((MutexHandle*)_handle);
+}
+
+JobScheduler::JobScheduler()
+    : _threadCount(1), _queues(NULL), _workers(NULL), _signal(NULL), _pendingJobs(0), _running(false)
+{
+}
+
+JobScheduler::~JobScheduler()
+{
+}
+
+void JobScheduler::initialize()
+{
+    _threadCount = getProcessorCount();
+    if (_threadCount == 0)
+        _threadCount = 1;
+
+    _queues = new JobQueue[_threadCount];
+    _signal = new Signal();
+    _pendingJobs = 0;
+    _running = true;
+
+    // Queue 0 belongs to the thread submitting work; the others each get a worker thread.
+    if (_threadCount > 1)
+    {
+        _workers = new Worker[_threadCount - 1];
+        for (unsigned int i = 0; i < _threadCount - 1; ++i)
+        {
+            _workers[i].scheduler = this;
+            _workers[i].queueIndex = i + 1;
+            if (!_workers[i].start())
+            {
+                GP_WARN("Failed to start job worker thread %d; continuing with %d threads.", i + 1, i + 1);
+                _threadCount = i + 1;
+                break;
+            }
+        }
+    }
+}
+
+void JobScheduler::finalize()
+{
+    if (_signal)
+    {
+        lockMutex(&_signal->mutex);
+        _running = false;
+        broadcastCondition(&_signal->condition);
+        unlockMutex(&_signal->mutex);
+    }
+
+    if (_workers)
+    {
+        for (unsigned int i = 0; i < _threadCount - 1; ++i)
+        {
+            _workers[i].join();
+        }
+    }
+
+    SAFE_DELETE_ARRAY(_workers);
+    SAFE_DELETE_ARRAY(_queues);
+    SAFE_DELETE(_signal);
+    _threadCount = 1;
+}
+
+unsigned int JobScheduler::getThreadCount() const
+{
+    return _threadCount;
+}
+
+void JobScheduler::parallelFor(unsigned int count, JobFunction function, void* cookie, unsigned int grainSize)
+{
+    GP_ASSERT(function);
+
+    if (grainSize == 0)
+        grainSize = 1;
+
+    // Run small loops, or everything when there are no worker threads, directly on the calling thread.
+    if (_threadCount <= 1 || !_running || count <= grainSize)
+    {
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            function(i, cookie);
+        }
+        return;
+    }
+
+    unsigned int jobCount = (count + grainSize - 1) / grainSize;
+
+    Batch batch;
+    batch.function = function;
+    batch.cookie = cookie;
+    batch.remaining = (int)jobCount;
+
+    // Deal the jobs out across all queues and wake the workers.
+    lockMutex(&_signal->mutex);
+    atomicAdd(&_pendingJobs, (int)jobCount);
+    for (unsigned int i = 0; i < jobCount; ++i)
+    {
+        Job job;
+        job.batch = &batch;
+        job.begin = i * grainSize;
+        job.end = std::min(job.begin + grainSize, count);
+        _queues[i % _threadCount].push(job);
+    }
+    broadcastCondition(&_signal->condition);
+    unlockMutex(&_signal->mutex);
+
+    // Help out until every job of this batch has finished. The count is read with a
+    // barrier so the jobs' writes are visible to the caller once it reaches zero.
+    while (atomicLoad(&batch.remaining) > 0)
+    {
+        Job job;
+        if (takeJob(0, &job))
+            executeJob(job);
+        else
+            yieldThread();
+    }
+}
+
+bool JobScheduler::takeJob(unsigned int queueIndex, Job* job)
+{
+    GP_ASSERT(job);
+
+    for (unsigned int i = 0; i < _threadCount; ++i)
+    {
+        unsigned int index = (queueIndex + i) % _threadCount;
+        if (_queues[index].pop(job, index != queueIndex))
+        {
+            atomicAdd(&_pendingJobs, -1);
+            return true;
+        }
+    }
+    return false;
+}
+
+void JobScheduler::executeJob(const Job& job)
+{
+    Batch* batch = job.batch;
+    GP_ASSERT(batch);
+
+    for (unsigned int i = job.begin; i < job.end; ++i)
+    {
+        batch->function(i, batch->cookie);
+    }
+
+    // The batch lives on the submitting thread's stack, so it must not be touched after this.
+    atomicAdd(&batch->remaining, -1);
+}
+
+void JobScheduler::workerMain(JobScheduler* scheduler, unsigned int queueIndex)
+{
+    GP_ASSERT(scheduler);
+
+    while (true)
+    {
+        Job job;
+        if (scheduler->takeJob(queueIndex, &job))
+        {
+            executeJob(job);
+            continue;
+        }
+
+        // Sleep until more jobs are submitted or the scheduler shuts down.
+        Signal* signal = scheduler->_signal;
+        lockMutex(&signal->mutex);
+        while (scheduler->_running && scheduler->_pendingJobs <= 0)
+        {
+            waitCondition(&signal->condition, &signal->mutex);
+        }
+        bool running = scheduler->_running;
+        unlockMutex(&signal->mutex);
+
+        if (!running)
+            break;
+    }
+}
+
+}
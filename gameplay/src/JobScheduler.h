@@ -0,0 +1,159 @@
+#ifndef JOBSCHEDULER_H_
+#define JOBSCHEDULER_H_
+
+namespace gameplay
+{
+
+/**
+ * The JobScheduler runs independent pieces of work on a pool of worker threads.
+ *
+ * The pool is sized to the number of processor cores; the calling thread counts
+ * as one of them and always helps to execute the work it submits. Each thread owns
+ * its own queue of jobs and idle threads steal jobs from the queues of busy ones,
+ * so uneven workloads are balanced automatically.
+ *
+ * Jobs must not call into the graphics API, the script controller or other
+ * systems that are only safe to use from the main thread.
+ *
+ * @script{ignore}
+ */
+class JobScheduler
+{
+    friend class Game;
+
+public:
+
+    /**
+     * Function invoked for each index of a parallel loop.
+     *
+     * @param index The index of the loop iteration being executed.
+     * @param cookie The user data pointer passed to parallelFor.
+     */
+    typedef void (*JobFunction)(unsigned int index, void* cookie);
+
+    /**
+     * A lock protecting data that is shared between jobs running on different threads.
+     */
+    class Mutex
+    {
+    public:
+
+        /**
+         * Constructor.
+         */
+        Mutex();
+
+        /**
+         * Destructor.
+         */
+        ~Mutex();
+
+        /**
+         * Blocks until the lock is acquired by the calling thread.
+         */
+        void lock();
+
+        /**
+         * Releases the lock held by the calling thread.
+         */
+        void unlock();
+
+    private:
+
+        Mutex(const Mutex&);
+        Mutex& operator=(const Mutex&);
+
+        void* _handle;
+    };
+
+    /**
+     * Executes the given function for every index in [0, count) and returns once all
+     * of them have completed.
+     *
+     * Indices are split into batches of at most grainSize iterations that are run
+     * concurrently on the worker threads and the calling thread. The order in which
+     * indices are executed is unspecified.
+     *
+     * @param count The number of iterations to execute.
+     * @param function The function to invoke for each iteration.
+     * @param cookie User data passed through to the function.
+     * @param grainSize The maximum number of iterations run by a single job.
+     */
+    void parallelFor(unsigned int count, JobFunction function, void* cookie, unsigned int grainSize = 1);
+
+    /**
+     * Gets the number of threads that execute jobs, including the calling thread.
+     *
+     * @return The number of threads used to execute jobs.
+     */
+    unsigned int getThreadCount() const;
+
+private:
+
+    struct Batch;
+    struct Job;
+    class JobQueue;
+    class Signal;
+    class Worker;
+
+    /**
+     * Constructor.
+     */
+    JobScheduler();
+
+    /**
+     * Destructor.
+     */
+    ~JobScheduler();
+
+    /**
+     * Hidden copy constructor.
+     */
+    JobScheduler(const JobScheduler&);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    JobScheduler& operator=(const JobScheduler&);
+
+    /**
+     * Called during startup to start the worker threads.
+     */
+    void initialize();
+
+    /**
+     * Called during shutdown to stop and join the worker threads.
+     */
+    void finalize();
+
+    /**
+     * Takes a job from the given queue, or steals one from another queue when it is empty.
+     *
+     * @param queueIndex The index of the queue owned by the calling thread.
+     * @param job Populated with the job that was taken.
+     *
+     * @return true if a job was taken, false if all queues are empty.
+     */
+    bool takeJob(unsigned int queueIndex, Job* job);
+
+    /**
+     * Runs a job and marks it as completed in its batch.
+     */
+    static void executeJob(const Job& job);
+
+    /**
+     * Entry point of the worker threads.
+     */
+    static void workerMain(JobScheduler* scheduler, unsigned int queueIndex);
+
+    unsigned int _threadCount;
+    JobQueue* _queues;
+    Worker* _workers;
+    Signal* _signal;
+    volatile int _pendingJobs;
+    volatile bool _running;
+};
+
+}
+
+#endif
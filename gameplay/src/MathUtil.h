@@ -10,6 +10,7 @@ class MathUtil
 {
     friend class Matrix;
     friend class Vector3;
+    friend class MeshSkin;
 
 public:
 
@@ -62,8 +63,33 @@ private:
 
     inline static void transformVector4(const float* m, const float* v, float* dst);
 
+    /**
+     * Transforms an array of three-component vectors, using w as their fourth component.
+     * Strides are in bytes, and src may be the same array as dst when both strides are equal.
+     */
+    inline static void transformVector3Array(const float* m, const float* src, unsigned int srcStride, float w, float* dst, unsigned int dstStride, unsigned int count);
+
+    /**
+     * Transforms an array of four-component vectors. Strides are in bytes, and src may be
+     * the same array as dst when both strides are equal.
+     */
+    inline static void transformVector4Array(const float* m, const float* src, unsigned int srcStride, float* dst, unsigned int dstStride, unsigned int count);
+
+    /**
+     * Transforms in place three-component vectors whose components are stored in separate
+     * arrays, using w as their fourth component.
+     */
+    inline static void transformVector3Planar(const float* m, float w, float* x, float* y, float* z, unsigned int count);
+
     inline static void crossVector3(const float* v1, const float* v2, float* dst);
 
+    /**
+     * Computes the top three rows of the product m * b, where b is given as its four
+     * consecutive rows, and writes them to dst as three rows of four floats.
+     * This is the layout of a matrix in a skinning palette.
+     */
+    inline static void multiplyMatrixPalette(const float* m, const float* rows, float* dst);
+
     MathUtil();
 };
 
@@ -71,8 +97,10 @@ private:
 
 #define MATRIX_SIZE ( sizeof(float) * 16)
 
-#ifdef USE_NEON
+#if defined(USE_NEON)
 #include "MathUtilNeon.inl"
+#elif defined(USE_SSE)
+#include "MathUtilSSE.inl"
 #else
 #include "MathUtil.inl"
 #endif
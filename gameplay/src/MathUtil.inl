@@ -161,6 +161,39 @@ inline void MathUtil::transformVector4(const float* m, const float* v, float* ds
     dst[3] = w;
 }
 
+inline void MathUtil::transformVector3Array(const float* m, const float* src, unsigned int srcStride, float w, float* dst, unsigned int dstStride, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* v = (const float*)((const char*)src + i * srcStride);
+        transformVector4(m, v[0], v[1], v[2], w, (float*)((char*)dst + i * dstStride));
+    }
+}
+
+inline void MathUtil::transformVector4Array(const float* m, const float* src, unsigned int srcStride, float* dst, unsigned int dstStride, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        transformVector4(m, (const float*)((const char*)src + i * srcStride), (float*)((char*)dst + i * dstStride));
+    }
+}
+
+inline void MathUtil::transformVector3Planar(const float* m, float w, float* x, float* y, float* z, unsigned int count)
+{
+    float tx = w * m[12];
+    float ty = w * m[13];
+    float tz = w * m[14];
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float vx = x[i] * m[0] + y[i] * m[4] + z[i] * m[8] + tx;
+        float vy = x[i] * m[1] + y[i] * m[5] + z[i] * m[9] + ty;
+        float vz = x[i] * m[2] + y[i] * m[6] + z[i] * m[10] + tz;
+        x[i] = vx;
+        y[i] = vy;
+        z[i] = vz;
+    }
+}
+
 inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
 {
     float x = (v1[1] * v2[2]) - (v1[2] * v2[1]);
@@ -172,6 +205,19 @@ inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
     dst[2] = z;
 }
 
+inline void MathUtil::multiplyMatrixPalette(const float* m, const float* rows, float* dst)
+{
+    // Row i of the product is the sum of the rows of b scaled by the elements of row i of m.
+    for (int i = 0; i < 3; ++i)
+    {
+        float* row = dst + i * 4;
+        row[0] = m[i] * rows[0] + m[i + 4] * rows[4] + m[i + 8] * rows[8]  + m[i + 12] * rows[12];
+        row[1] = m[i] * rows[1] + m[i + 4] * rows[5] + m[i + 8] * rows[9]  + m[i + 12] * rows[13];
+        row[2] = m[i] * rows[2] + m[i + 4] * rows[6] + m[i + 8] * rows[10] + m[i + 12] * rows[14];
+        row[3] = m[i] * rows[3] + m[i + 4] * rows[7] + m[i + 8] * rows[11] + m[i + 12] * rows[15];
+    }
+}
+
 }
 
 
@@ -201,6 +201,39 @@ inline void MathUtil::transformVector4(const float* m, const float* v, float* ds
     );
 }
 
+inline void MathUtil::transformVector3Array(const float* m, const float* src, unsigned int srcStride, float w, float* dst, unsigned int dstStride, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* v = (const float*)((const char*)src + i * srcStride);
+        transformVector4(m, v[0], v[1], v[2], w, (float*)((char*)dst + i * dstStride));
+    }
+}
+
+inline void MathUtil::transformVector4Array(const float* m, const float* src, unsigned int srcStride, float* dst, unsigned int dstStride, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        transformVector4(m, (const float*)((const char*)src + i * srcStride), (float*)((char*)dst + i * dstStride));
+    }
+}
+
+inline void MathUtil::transformVector3Planar(const float* m, float w, float* x, float* y, float* z, unsigned int count)
+{
+    float tx = w * m[12];
+    float ty = w * m[13];
+    float tz = w * m[14];
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        float vx = x[i] * m[0] + y[i] * m[4] + z[i] * m[8] + tx;
+        float vy = x[i] * m[1] + y[i] * m[5] + z[i] * m[9] + ty;
+        float vz = x[i] * m[2] + y[i] * m[6] + z[i] * m[10] + tz;
+        x[i] = vx;
+        y[i] = vy;
+        z[i] = vz;
+    }
+}
+
 inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
 {
     asm volatile(
@@ -226,4 +259,35 @@ inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
     );
 }
 
+inline void MathUtil::multiplyMatrixPalette(const float* m, const float* rows, float* dst)
+{
+    asm volatile(
+        "vld1.32    {d0 - d3}, [%1]!      \n\t" // M[m0-m7]
+        "vld1.32    {d4 - d7}, [%1]       \n\t" // M[m8-m15]
+        "vld1.32    {d16 - d19}, [%2]!    \n\t" // B[row0, row1]
+        "vld1.32    {d20 - d23}, [%2]     \n\t" // B[row2, row3]
+
+        "vmul.f32   q12, q8, d0[0]        \n\t" // DST->row0 = B[row0] * M[m0]
+        "vmla.f32   q12, q9, d2[0]        \n\t" // DST->row0 += B[row1] * M[m4]
+        "vmla.f32   q12, q10, d4[0]       \n\t" // DST->row0 += B[row2] * M[m8]
+        "vmla.f32   q12, q11, d6[0]       \n\t" // DST->row0 += B[row3] * M[m12]
+
+        "vmul.f32   q13, q8, d0[1]        \n\t" // DST->row1 = B[row0] * M[m1]
+        "vmla.f32   q13, q9, d2[1]        \n\t" // DST->row1 += B[row1] * M[m5]
+        "vmla.f32   q13, q10, d4[1]       \n\t" // DST->row1 += B[row2] * M[m9]
+        "vmla.f32   q13, q11, d6[1]       \n\t" // DST->row1 += B[row3] * M[m13]
+
+        "vmul.f32   q14, q8, d1[0]        \n\t" // DST->row2 = B[row0] * M[m2]
+        "vmla.f32   q14, q9, d3[0]        \n\t" // DST->row2 += B[row1] * M[m6]
+        "vmla.f32   q14, q10, d5[0]       \n\t" // DST->row2 += B[row2] * M[m10]
+        "vmla.f32   q14, q11, d7[0]       \n\t" // DST->row2 += B[row3] * M[m14]
+
+        "vst1.32    {d24 - d27}, [%0]!    \n\t" // DST->row0, row1
+        "vst1.32    {d28, d29}, [%0]      \n\t" // DST->row2
+        :
+        : "r"(dst), "r"(m), "r"(rows)
+        : "q0", "q1", "q2", "q3", "q8", "q9", "q10", "q11", "q12", "q13", "q14", "memory"
+    );
+}
+
 }
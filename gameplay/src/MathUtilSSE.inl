@@ -0,0 +1,214 @@
+namespace gameplay
+{
+
+inline void MathUtil::addMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    _mm_storeu_ps(dst,      _mm_add_ps(_mm_loadu_ps(m),      s));
+    _mm_storeu_ps(dst + 4,  _mm_add_ps(_mm_loadu_ps(m + 4),  s));
+    _mm_storeu_ps(dst + 8,  _mm_add_ps(_mm_loadu_ps(m + 8),  s));
+    _mm_storeu_ps(dst + 12, _mm_add_ps(_mm_loadu_ps(m + 12), s));
+}
+
+inline void MathUtil::addMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(dst,      _mm_add_ps(_mm_loadu_ps(m1),      _mm_loadu_ps(m2)));
+    _mm_storeu_ps(dst + 4,  _mm_add_ps(_mm_loadu_ps(m1 + 4),  _mm_loadu_ps(m2 + 4)));
+    _mm_storeu_ps(dst + 8,  _mm_add_ps(_mm_loadu_ps(m1 + 8),  _mm_loadu_ps(m2 + 8)));
+    _mm_storeu_ps(dst + 12, _mm_add_ps(_mm_loadu_ps(m1 + 12), _mm_loadu_ps(m2 + 12)));
+}
+
+inline void MathUtil::subtractMatrix(const float* m1, const float* m2, float* dst)
+{
+    _mm_storeu_ps(dst,      _mm_sub_ps(_mm_loadu_ps(m1),      _mm_loadu_ps(m2)));
+    _mm_storeu_ps(dst + 4,  _mm_sub_ps(_mm_loadu_ps(m1 + 4),  _mm_loadu_ps(m2 + 4)));
+    _mm_storeu_ps(dst + 8,  _mm_sub_ps(_mm_loadu_ps(m1 + 8),  _mm_loadu_ps(m2 + 8)));
+    _mm_storeu_ps(dst + 12, _mm_sub_ps(_mm_loadu_ps(m1 + 12), _mm_loadu_ps(m2 + 12)));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m, float scalar, float* dst)
+{
+    __m128 s = _mm_set1_ps(scalar);
+    _mm_storeu_ps(dst,      _mm_mul_ps(_mm_loadu_ps(m),      s));
+    _mm_storeu_ps(dst + 4,  _mm_mul_ps(_mm_loadu_ps(m + 4),  s));
+    _mm_storeu_ps(dst + 8,  _mm_mul_ps(_mm_loadu_ps(m + 8),  s));
+    _mm_storeu_ps(dst + 12, _mm_mul_ps(_mm_loadu_ps(m + 12), s));
+}
+
+inline void MathUtil::multiplyMatrix(const float* m1, const float* m2, float* dst)
+{
+    // All of m1 is loaded before anything is stored, so m1 or m2 may be the same array as dst.
+    __m128 c0 = _mm_loadu_ps(m1);
+    __m128 c1 = _mm_loadu_ps(m1 + 4);
+    __m128 c2 = _mm_loadu_ps(m1 + 8);
+    __m128 c3 = _mm_loadu_ps(m1 + 12);
+
+    // Column i of the product is the sum of the columns of m1 scaled by the elements of column i of m2.
+    __m128 p[4];
+    for (int i = 0; i < 4; ++i)
+    {
+        __m128 b = _mm_loadu_ps(m2 + i * 4);
+        __m128 col = _mm_mul_ps(c0, _mm_shuffle_ps(b, b, _MM_SHUFFLE(0, 0, 0, 0)));
+        col = _mm_add_ps(col, _mm_mul_ps(c1, _mm_shuffle_ps(b, b, _MM_SHUFFLE(1, 1, 1, 1))));
+        col = _mm_add_ps(col, _mm_mul_ps(c2, _mm_shuffle_ps(b, b, _MM_SHUFFLE(2, 2, 2, 2))));
+        col = _mm_add_ps(col, _mm_mul_ps(c3, _mm_shuffle_ps(b, b, _MM_SHUFFLE(3, 3, 3, 3))));
+        p[i] = col;
+    }
+
+    _mm_storeu_ps(dst,      p[0]);
+    _mm_storeu_ps(dst + 4,  p[1]);
+    _mm_storeu_ps(dst + 8,  p[2]);
+    _mm_storeu_ps(dst + 12, p[3]);
+}
+
+inline void MathUtil::negateMatrix(const float* m, float* dst)
+{
+    // Flip the sign bits, which matches the scalar negation for zeros and NaNs.
+    __m128 sign = _mm_set1_ps(-0.0f);
+    _mm_storeu_ps(dst,      _mm_xor_ps(_mm_loadu_ps(m),      sign));
+    _mm_storeu_ps(dst + 4,  _mm_xor_ps(_mm_loadu_ps(m + 4),  sign));
+    _mm_storeu_ps(dst + 8,  _mm_xor_ps(_mm_loadu_ps(m + 8),  sign));
+    _mm_storeu_ps(dst + 12, _mm_xor_ps(_mm_loadu_ps(m + 12), sign));
+}
+
+inline void MathUtil::transposeMatrix(const float* m, float* dst)
+{
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+
+    _MM_TRANSPOSE4_PS(c0, c1, c2, c3);
+
+    _mm_storeu_ps(dst,      c0);
+    _mm_storeu_ps(dst + 4,  c1);
+    _mm_storeu_ps(dst + 8,  c2);
+    _mm_storeu_ps(dst + 12, c3);
+}
+
+inline void MathUtil::transformVector4(const float* m, float x, float y, float z, float w, float* dst)
+{
+    __m128 v = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(x));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(m + 4),  _mm_set1_ps(y)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(m + 8),  _mm_set1_ps(z)));
+    v = _mm_add_ps(v, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(w)));
+
+    // dst only has room for three components.
+    float t[4];
+    _mm_storeu_ps(t, v);
+    dst[0] = t[0];
+    dst[1] = t[1];
+    dst[2] = t[2];
+}
+
+inline void MathUtil::transformVector4(const float* m, const float* v, float* dst)
+{
+    // v is fully read before dst is written, so v may be the same array as dst.
+    __m128 r = _mm_mul_ps(_mm_loadu_ps(m), _mm_set1_ps(v[0]));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 4),  _mm_set1_ps(v[1])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 8),  _mm_set1_ps(v[2])));
+    r = _mm_add_ps(r, _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(v[3])));
+    _mm_storeu_ps(dst, r);
+}
+
+inline void MathUtil::transformVector3Array(const float* m, const float* src, unsigned int srcStride, float w, float* dst, unsigned int dstStride, unsigned int count)
+{
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_mul_ps(_mm_loadu_ps(m + 12), _mm_set1_ps(w));
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const float* v = (const float*)((const char*)src + i * srcStride);
+        float* d = (float*)((char*)dst + i * dstStride);
+
+        __m128 r = _mm_add_ps(_mm_mul_ps(c0, _mm_set1_ps(v[0])), c3);
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_set1_ps(v[1])));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_set1_ps(v[2])));
+
+        // Store exactly three components, since the next element may follow immediately.
+        _mm_storel_pi((__m64*)d, r);
+        _mm_store_ss(d + 2, _mm_movehl_ps(r, r));
+    }
+}
+
+inline void MathUtil::transformVector4Array(const float* m, const float* src, unsigned int srcStride, float* dst, unsigned int dstStride, unsigned int count)
+{
+    __m128 c0 = _mm_loadu_ps(m);
+    __m128 c1 = _mm_loadu_ps(m + 4);
+    __m128 c2 = _mm_loadu_ps(m + 8);
+    __m128 c3 = _mm_loadu_ps(m + 12);
+
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        __m128 v = _mm_loadu_ps((const float*)((const char*)src + i * srcStride));
+        __m128 r = _mm_mul_ps(c0, _mm_shuffle_ps(v, v, _MM_SHUFFLE(0, 0, 0, 0)));
+        r = _mm_add_ps(r, _mm_mul_ps(c1, _mm_shuffle_ps(v, v, _MM_SHUFFLE(1, 1, 1, 1))));
+        r = _mm_add_ps(r, _mm_mul_ps(c2, _mm_shuffle_ps(v, v, _MM_SHUFFLE(2, 2, 2, 2))));
+        r = _mm_add_ps(r, _mm_mul_ps(c3, _mm_shuffle_ps(v, v, _MM_SHUFFLE(3, 3, 3, 3))));
+        _mm_storeu_ps((float*)((char*)dst + i * dstStride), r);
+    }
+}
+
+inline void MathUtil::transformVector3Planar(const float* m, float w, float* x, float* y, float* z, unsigned int count)
+{
+    // Transform four vectors at a time, with each register holding one component of all four.
+    unsigned int i = 0;
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        for (int j = 0; j < 3; ++j)
+        {
+            __m128 r = _mm_add_ps(_mm_mul_ps(vx, _mm_set1_ps(m[j])), _mm_set1_ps(w * m[j + 12]));
+            r = _mm_add_ps(r, _mm_mul_ps(vy, _mm_set1_ps(m[j + 4])));
+            r = _mm_add_ps(r, _mm_mul_ps(vz, _mm_set1_ps(m[j + 8])));
+            _mm_storeu_ps((j == 0 ? x : (j == 1 ? y : z)) + i, r);
+        }
+    }
+
+    for (; i < count; ++i)
+    {
+        float vx = x[i] * m[0] + y[i] * m[4] + z[i] * m[8] + w * m[12];
+        float vy = x[i] * m[1] + y[i] * m[5] + z[i] * m[9] + w * m[13];
+        float vz = x[i] * m[2] + y[i] * m[6] + z[i] * m[10] + w * m[14];
+        x[i] = vx;
+        y[i] = vy;
+        z[i] = vz;
+    }
+}
+
+inline void MathUtil::crossVector3(const float* v1, const float* v2, float* dst)
+{
+    // Three-component vectors cannot be loaded or stored as a whole without touching
+    // memory beyond them, and the shuffles would cost more than they save.
+    float x = (v1[1] * v2[2]) - (v1[2] * v2[1]);
+    float y = (v1[2] * v2[0]) - (v1[0] * v2[2]);
+    float z = (v1[0] * v2[1]) - (v1[1] * v2[0]);
+
+    dst[0] = x;
+    dst[1] = y;
+    dst[2] = z;
+}
+
+inline void MathUtil::multiplyMatrixPalette(const float* m, const float* rows, float* dst)
+{
+    __m128 r0 = _mm_loadu_ps(rows);
+    __m128 r1 = _mm_loadu_ps(rows + 4);
+    __m128 r2 = _mm_loadu_ps(rows + 8);
+    __m128 r3 = _mm_loadu_ps(rows + 12);
+
+    // Row i of the product is the sum of the rows of b scaled by the elements of row i of m.
+    for (int i = 0; i < 3; ++i)
+    {
+        __m128 row = _mm_mul_ps(r0, _mm_set1_ps(m[i]));
+        row = _mm_add_ps(row, _mm_mul_ps(r1, _mm_set1_ps(m[i + 4])));
+        row = _mm_add_ps(row, _mm_mul_ps(r2, _mm_set1_ps(m[i + 8])));
+        row = _mm_add_ps(row, _mm_mul_ps(r3, _mm_set1_ps(m[i + 12])));
+        _mm_storeu_ps(dst + i * 4, row);
+    }
+}
+
+}
@@ -927,6 +927,41 @@ void Matrix::transformVector(const Vector4& vector, Vector4* dst) const
     MathUtil::transformVector4(m, (const float*) &vector, (float*)dst);
 }
 
+void Matrix::transformPoints(const Vector3* points, unsigned int count, Vector3* dst, unsigned int stride, unsigned int dstStride) const
+{
+    GP_ASSERT(count == 0 || (points && dst));
+
+    MathUtil::transformVector3Array(m, (const float*)points, stride, 1.0f, (float*)dst, dstStride, count);
+}
+
+void Matrix::transformPoints(float* x, float* y, float* z, unsigned int count) const
+{
+    GP_ASSERT(count == 0 || (x && y && z));
+
+    MathUtil::transformVector3Planar(m, 1.0f, x, y, z, count);
+}
+
+void Matrix::transformVectors(const Vector3* vectors, unsigned int count, Vector3* dst, unsigned int stride, unsigned int dstStride) const
+{
+    GP_ASSERT(count == 0 || (vectors && dst));
+
+    MathUtil::transformVector3Array(m, (const float*)vectors, stride, 0.0f, (float*)dst, dstStride, count);
+}
+
+void Matrix::transformVectors(float* x, float* y, float* z, unsigned int count) const
+{
+    GP_ASSERT(count == 0 || (x && y && z));
+
+    MathUtil::transformVector3Planar(m, 0.0f, x, y, z, count);
+}
+
+void Matrix::transformVectors(const Vector4* vectors, unsigned int count, Vector4* dst, unsigned int stride, unsigned int dstStride) const
+{
+    GP_ASSERT(count == 0 || (vectors && dst));
+
+    MathUtil::transformVector4Array(m, (const float*)vectors, stride, (float*)dst, dstStride, count);
+}
+
 void Matrix::translate(float x, float y, float z)
 {
     translate(x, y, z, this);
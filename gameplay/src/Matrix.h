@@ -798,6 +798,77 @@ public:
      */
     void transformVector(const Vector4& vector, Vector4* dst) const;
 
+    /**
+     * Transforms an array of points by this matrix, and stores the results in dst.
+     *
+     * The strides allow the points to be read from and written to interleaved data, such as
+     * the positions in an array of vertices. The points and dst may be the same array as long
+     * as both strides are equal.
+     *
+     * @param points The first point to transform.
+     * @param count The number of points to transform.
+     * @param dst The location to store the first transformed point in.
+     * @param stride The number of bytes from the start of one point to the start of the next.
+     * @param dstStride The number of bytes from the start of one transformed point to the start of the next.
+     * @script{ignore}
+     */
+    void transformPoints(const Vector3* points, unsigned int count, Vector3* dst,
+                         unsigned int stride = sizeof(Vector3), unsigned int dstStride = sizeof(Vector3)) const;
+
+    /**
+     * Transforms in place an array of points whose coordinates are stored in separate arrays.
+     *
+     * @param x The x-coordinates of the points.
+     * @param y The y-coordinates of the points.
+     * @param z The z-coordinates of the points.
+     * @param count The number of points to transform.
+     * @script{ignore}
+     */
+    void transformPoints(float* x, float* y, float* z, unsigned int count) const;
+
+    /**
+     * Transforms an array of vectors by this matrix by treating their fourth (w) coordinate
+     * as zero, and stores the results in dst.
+     *
+     * The vectors and dst may be the same array as long as both strides are equal.
+     *
+     * @param vectors The first vector to transform.
+     * @param count The number of vectors to transform.
+     * @param dst The location to store the first transformed vector in.
+     * @param stride The number of bytes from the start of one vector to the start of the next.
+     * @param dstStride The number of bytes from the start of one transformed vector to the start of the next.
+     * @script{ignore}
+     */
+    void transformVectors(const Vector3* vectors, unsigned int count, Vector3* dst,
+                          unsigned int stride = sizeof(Vector3), unsigned int dstStride = sizeof(Vector3)) const;
+
+    /**
+     * Transforms in place an array of vectors whose coordinates are stored in separate arrays,
+     * by treating their fourth (w) coordinate as zero.
+     *
+     * @param x The x-coordinates of the vectors.
+     * @param y The y-coordinates of the vectors.
+     * @param z The z-coordinates of the vectors.
+     * @param count The number of vectors to transform.
+     * @script{ignore}
+     */
+    void transformVectors(float* x, float* y, float* z, unsigned int count) const;
+
+    /**
+     * Transforms an array of vectors by this matrix, and stores the results in dst.
+     *
+     * The vectors and dst may be the same array as long as both strides are equal.
+     *
+     * @param vectors The first vector to transform.
+     * @param count The number of vectors to transform.
+     * @param dst The location to store the first transformed vector in.
+     * @param stride The number of bytes from the start of one vector to the start of the next.
+     * @param dstStride The number of bytes from the start of one transformed vector to the start of the next.
+     * @script{ignore}
+     */
+    void transformVectors(const Vector4* vectors, unsigned int count, Vector4* dst,
+                          unsigned int stride = sizeof(Vector4), unsigned int dstStride = sizeof(Vector4)) const;
+
     /**
      * Post-multiplies this matrix by the matrix corresponding to the
      * specified translation.
@@ -1,6 +1,7 @@
 #include "Base.h"
 #include "MeshBatch.h"
 #include "Material.h"
+#include "RenderQueue.h"
 
 namespace gameplay
 {
@@ -256,17 +257,39 @@ void MeshBatch::draw()
         Pass* pass = technique->getPassByIndex(i);
         GP_ASSERT(pass);
         pass->bind();
+        drawGeometry();
+        pass->unbind();
+    }
+}
 
-        if (_indexed)
-        {
-            GL_ASSERT( glDrawElements(_primitiveType, _indexCount, GL_UNSIGNED_SHORT, (GLvoid*)_indices) );
-        }
-        else
-        {
-            GL_ASSERT( glDrawArrays(_primitiveType, 0, _vertexCount) );
-        }
+void MeshBatch::draw(RenderQueue* queue, const Vector3& position)
+{
+    GP_ASSERT(queue);
 
-        pass->unbind();
+    if (_vertexCount == 0 || (_indexed && _indexCount == 0))
+        return; // nothing to draw
+
+    GP_ASSERT(_material);
+    Technique* technique = _material->getTechnique();
+    GP_ASSERT(technique);
+    for (unsigned int i = 0, passCount = technique->getPassCount(); i < passCount; ++i)
+    {
+        Pass* pass = technique->getPassByIndex(i);
+        GP_ASSERT(pass);
+        queue->add(pass, i, this, position);
+    }
+}
+
+void MeshBatch::drawGeometry()
+{
+    if (_indexed)
+    {
+        GP_ASSERT(_indices);
+        GL_ASSERT( glDrawElements(_primitiveType, _indexCount, GL_UNSIGNED_SHORT, (GLvoid*)_indices) );
+    }
+    else
+    {
+        GL_ASSERT( glDrawArrays(_primitiveType, 0, _vertexCount) );
     }
 }
     
@@ -7,12 +7,15 @@ namespace gameplay
 {
 
 class Material;
+class RenderQueue;
 
 /**
  * Defines a class for rendering multiple mesh into a single draw call on the graphics device.
  */
 class MeshBatch
 {
+    friend class RenderQueue;
+
 public:
 
     /**
@@ -136,6 +139,17 @@ public:
      */
     void draw();
 
+    /**
+     * Adds the draws of the primitives currently in the batch to a render queue instead
+     * of drawing them.
+     *
+     * The primitives must not be changed until the queue has been drawn.
+     *
+     * @param queue The render queue to add the draws to.
+     * @param position The world space position the draws are ordered by depth from.
+     */
+    void draw(RenderQueue* queue, const Vector3& position);
+
 private:
 
     /**
@@ -159,6 +173,11 @@ private:
 
     bool resize(unsigned int capacity);
 
+    /**
+     * Issues the draw call for the primitives once a pass has been bound.
+     */
+    void drawGeometry();
+
     const VertexFormat _vertexFormat;
     Mesh::PrimitiveType _primitiveType;
     Material* _material;
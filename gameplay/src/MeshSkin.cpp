@@ -1,15 +1,34 @@
 #include "Base.h"
 #include "MeshSkin.h"
 #include "Joint.h"
+#include "MathUtil.h"
+#include "Model.h"
+#include "Game.h"
+
+#ifdef USE_NEON
+#include <arm_neon.h>
+#endif
 
 // The number of rows in each palette matrix.
 #define PALETTE_ROWS 3
 
+// The number of vertices skinned by each job of a CPU skinning pass.
+#define SKINNING_VERTICES_PER_JOB 512
+
 namespace gameplay
 {
 
+// Statistics gathered during the current frame, and those of the previous frame.
+static MeshSkin::Statistics __frameStatistics = { 0, 0, 0 };
+static MeshSkin::Statistics __statistics = { 0, 0, 0 };
+
+// The number of the current frame, so that each skin is counted once per frame.
+static unsigned int __statisticsFrame = 1;
+
 MeshSkin::MeshSkin()
-    : _rootJoint(NULL), _rootNode(NULL), _matrixPalette(NULL), _model(NULL)
+    : _rootJoint(NULL), _rootNode(NULL), _matrixPalette(NULL), _bindMatrices(NULL),
+      _bindMatricesDirty(true), _matrixPaletteDirty(true), _matrixPaletteVersion(0), _statisticsFrame(0),
+      _poseSource(NULL), _cpuSkinningVertices(NULL), _cpuSkinnedVertices(NULL), _cpuSkinnedVersion(0), _model(NULL)
 {
 }
 
@@ -18,6 +37,9 @@ MeshSkin::~MeshSkin()
     clearJoints();
 
     SAFE_DELETE_ARRAY(_matrixPalette);
+    SAFE_DELETE_ARRAY(_bindMatrices);
+    SAFE_DELETE_ARRAY(_cpuSkinningVertices);
+    SAFE_DELETE_ARRAY(_cpuSkinnedVertices);
 }
 
 const Matrix& MeshSkin::getBindShape() const
@@ -28,6 +50,7 @@ const Matrix& MeshSkin::getBindShape() const
 void MeshSkin::setBindShape(const float* matrix)
 {
     _bindShape.set(matrix);
+    _bindMatricesDirty = true;
 }
 
 unsigned int MeshSkin::getJointCount() const
@@ -61,6 +84,8 @@ MeshSkin* MeshSkin::clone(NodeCloneContext &context) const
 {
     MeshSkin* skin = new MeshSkin();
     skin->_bindShape = _bindShape;
+    skin->_bindMatricesDirty = true;
+    skin->_poseSource = _poseSource;
     if (_rootNode && _rootJoint)
     {
         const unsigned int jointCount = getJointCount();
@@ -122,9 +147,13 @@ void MeshSkin::setJointCount(unsigned int jointCount)
 
     // Rebuild the matrix palette. Each matrix is 3 rows of Vector4.
     SAFE_DELETE_ARRAY(_matrixPalette);
+    SAFE_DELETE_ARRAY(_bindMatrices);
+    _bindMatricesDirty = true;
+    _matrixPaletteDirty = true;
 
     if (jointCount > 0)
     {
+        _bindMatrices = new Matrix[jointCount];
         _matrixPalette = new Vector4[jointCount * PALETTE_ROWS];
         for (unsigned int i = 0; i < jointCount * PALETTE_ROWS; i+=PALETTE_ROWS)
         {
@@ -146,6 +175,7 @@ void MeshSkin::setJoint(Joint* joint, unsigned int index)
     }
 
     _joints[index] = joint;
+    _bindMatricesDirty = true;
 
     if (joint)
     {
@@ -156,21 +186,359 @@ void MeshSkin::setJoint(Joint* joint, unsigned int index)
 
 Vector4* MeshSkin::getMatrixPalette() const
 {
+    // The palette is fetched for each draw and pass, but each skin is only counted once per frame.
+    bool counted = _statisticsFrame == __statisticsFrame;
+    _statisticsFrame = __statisticsFrame;
+
+    if (_poseSource)
+    {
+        if (!counted)
+            ++__frameStatistics.palettesReused;
+        return _poseSource->getMatrixPalette();
+    }
+
     GP_ASSERT(_matrixPalette);
 
-    for (size_t i = 0, count = _joints.size(); i < count; i++)
+    size_t count = _joints.size();
+    if (_bindMatricesDirty)
+    {
+        // The inverse bind pose and bind shape rarely change, so combine them once up front.
+        _bindMatricesDirty = false;
+        _matrixPaletteDirty = true;
+
+        Matrix m;
+        for (size_t i = 0; i < count; i++)
+        {
+            GP_ASSERT(_joints[i]);
+            Matrix::multiply(_joints[i]->getInverseBindPose(), _bindShape, &m);
+            m.transpose(&_bindMatrices[i]);
+        }
+    }
+
+    if (!_matrixPaletteDirty)
     {
-        GP_ASSERT(_joints[i]);
-        _joints[i]->updateJointMatrix(getBindShape(), &_matrixPalette[i * PALETTE_ROWS]);
+        if (!counted)
+            ++__frameStatistics.palettesReused;
+    }
+    else
+    {
+        _matrixPaletteDirty = false;
+        ++_matrixPaletteVersion;
+        ++__frameStatistics.posesEvaluated;
+
+        // Write world * inverse bind pose * bind shape for each joint straight into the palette rows.
+        float* palette = &_matrixPalette[0].x;
+        for (size_t i = 0; i < count; i++)
+        {
+            GP_ASSERT(_joints[i]);
+            MathUtil::multiplyMatrixPalette(_joints[i]->getWorldMatrix().m, _bindMatrices[i].m, palette + i * PALETTE_ROWS * 4);
+        }
     }
     return _matrixPalette;
 }
 
 unsigned int MeshSkin::getMatrixPaletteSize() const
 {
+    if (_poseSource)
+        return _poseSource->getMatrixPaletteSize();
+
     return (unsigned int)_joints.size() * PALETTE_ROWS;
 }
 
+void MeshSkin::setPoseSource(MeshSkin* source)
+{
+#ifdef _DEBUG
+    for (MeshSkin* skin = source; skin; skin = skin->_poseSource)
+    {
+        GP_ASSERT(skin != this);
+    }
+#endif
+    _poseSource = source;
+}
+
+MeshSkin* MeshSkin::getPoseSource() const
+{
+    return _poseSource;
+}
+
+void MeshSkin::setCpuSkinning(const float* vertexData)
+{
+    SAFE_DELETE_ARRAY(_cpuSkinningVertices);
+    SAFE_DELETE_ARRAY(_cpuSkinnedVertices);
+
+    if (vertexData)
+    {
+        GP_ASSERT(_model && _model->getMesh());
+        Mesh* mesh = _model->getMesh();
+        unsigned int floatCount = mesh->getVertexCount() * mesh->getVertexSize() / sizeof(float);
+
+        _cpuSkinningVertices = new float[floatCount];
+        memcpy(_cpuSkinningVertices, vertexData, floatCount * sizeof(float));
+        _cpuSkinnedVertices = new float[floatCount];
+
+        // Force the vertices to be skinned before the next draw.
+        _cpuSkinnedVersion = _matrixPaletteVersion - 1;
+    }
+}
+
+bool MeshSkin::isCpuSkinning() const
+{
+    return _cpuSkinningVertices != NULL;
+}
+
+/**
+ * Arguments shared by the jobs of a CPU skinning pass.
+ */
+struct SkinVerticesJob
+{
+    const float* palette;
+    const float* src;
+    float* dst;
+    unsigned int vertexCount;
+    unsigned int stride;
+    int position;
+    int directions[3];
+    unsigned int directionCount;
+    int weights;
+    int indices;
+    unsigned int influenceCount;
+};
+
+static void skinVerticesJob(unsigned int index, void* cookie)
+{
+    const SkinVerticesJob* job = (const SkinVerticesJob*)cookie;
+    GP_ASSERT(job);
+
+    unsigned int start = index * SKINNING_VERTICES_PER_JOB;
+    unsigned int end = std::min(start + SKINNING_VERTICES_PER_JOB, job->vertexCount);
+    const float* palette = job->palette;
+
+    for (unsigned int v = start; v < end; ++v)
+    {
+        const float* src = job->src + v * job->stride;
+        float* dst = job->dst + v * job->stride;
+        if (dst != src)
+        {
+            memcpy(dst, src, job->stride * sizeof(float));
+        }
+
+        const float* p = src + job->position;
+        const float* weights = src + job->weights;
+        const float* indices = src + job->indices;
+
+#if defined(USE_SSE)
+        // Blend the palette matrices of the influencing joints.
+        __m128 row0 = _mm_setzero_ps();
+        __m128 row1 = _mm_setzero_ps();
+        __m128 row2 = _mm_setzero_ps();
+        for (unsigned int i = 0; i < job->influenceCount; ++i)
+        {
+            if (weights[i] == 0.0f)
+                continue;
+            const float* m = palette + (int)indices[i] * PALETTE_ROWS * 4;
+            __m128 w = _mm_set1_ps(weights[i]);
+            row0 = _mm_add_ps(row0, _mm_mul_ps(_mm_loadu_ps(m), w));
+            row1 = _mm_add_ps(row1, _mm_mul_ps(_mm_loadu_ps(m + 4), w));
+            row2 = _mm_add_ps(row2, _mm_mul_ps(_mm_loadu_ps(m + 8), w));
+        }
+
+        // Transpose the rows to columns so that points transform with multiply-adds.
+        __m128 row3 = _mm_setzero_ps();
+        _MM_TRANSPOSE4_PS(row0, row1, row2, row3);
+
+        __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row0, _mm_set1_ps(p[0])), _mm_mul_ps(row1, _mm_set1_ps(p[1]))),
+                              _mm_add_ps(_mm_mul_ps(row2, _mm_set1_ps(p[2])), row3));
+        float out[4];
+        _mm_storeu_ps(out, r);
+        memcpy(dst + job->position, out, 3 * sizeof(float));
+
+        for (unsigned int i = 0; i < job->directionCount; ++i)
+        {
+            const float* d = src + job->directions[i];
+            r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(row0, _mm_set1_ps(d[0])), _mm_mul_ps(row1, _mm_set1_ps(d[1]))),
+                           _mm_mul_ps(row2, _mm_set1_ps(d[2])));
+            _mm_storeu_ps(out, r);
+            memcpy(dst + job->directions[i], out, 3 * sizeof(float));
+        }
+#elif defined(USE_NEON)
+        // Blend the palette matrices of the influencing joints.
+        float32x4_t row0 = vdupq_n_f32(0.0f);
+        float32x4_t row1 = vdupq_n_f32(0.0f);
+        float32x4_t row2 = vdupq_n_f32(0.0f);
+        for (unsigned int i = 0; i < job->influenceCount; ++i)
+        {
+            if (weights[i] == 0.0f)
+                continue;
+            const float* m = palette + (int)indices[i] * PALETTE_ROWS * 4;
+            row0 = vmlaq_n_f32(row0, vld1q_f32(m), weights[i]);
+            row1 = vmlaq_n_f32(row1, vld1q_f32(m + 4), weights[i]);
+            row2 = vmlaq_n_f32(row2, vld1q_f32(m + 8), weights[i]);
+        }
+
+        // Each output component is the dot product of a row with the homogeneous input.
+        float h[4] = { p[0], p[1], p[2], 1.0f };
+        float32x4_t in = vld1q_f32(h);
+        float32x2_t xy = vpadd_f32(vpadd_f32(vget_low_f32(vmulq_f32(row0, in)), vget_high_f32(vmulq_f32(row0, in))),
+                                   vpadd_f32(vget_low_f32(vmulq_f32(row1, in)), vget_high_f32(vmulq_f32(row1, in))));
+        float32x4_t z = vmulq_f32(row2, in);
+        float32x2_t zz = vpadd_f32(vget_low_f32(z), vget_high_f32(z));
+        float out[3] = { vget_lane_f32(xy, 0), vget_lane_f32(xy, 1), vget_lane_f32(zz, 0) + vget_lane_f32(zz, 1) };
+        memcpy(dst + job->position, out, sizeof(out));
+
+        for (unsigned int i = 0; i < job->directionCount; ++i)
+        {
+            const float* d = src + job->directions[i];
+            h[0] = d[0]; h[1] = d[1]; h[2] = d[2]; h[3] = 0.0f;
+            in = vld1q_f32(h);
+            xy = vpadd_f32(vpadd_f32(vget_low_f32(vmulq_f32(row0, in)), vget_high_f32(vmulq_f32(row0, in))),
+                           vpadd_f32(vget_low_f32(vmulq_f32(row1, in)), vget_high_f32(vmulq_f32(row1, in))));
+            z = vmulq_f32(row2, in);
+            zz = vpadd_f32(vget_low_f32(z), vget_high_f32(z));
+            out[0] = vget_lane_f32(xy, 0);
+            out[1] = vget_lane_f32(xy, 1);
+            out[2] = vget_lane_f32(zz, 0) + vget_lane_f32(zz, 1);
+            memcpy(dst + job->directions[i], out, sizeof(out));
+        }
+#else
+        // Blend the palette matrices of the influencing joints.
+        float m[PALETTE_ROWS * 4] = { 0 };
+        for (unsigned int i = 0; i < job->influenceCount; ++i)
+        {
+            if (weights[i] == 0.0f)
+                continue;
+            const float* joint = palette + (int)indices[i] * PALETTE_ROWS * 4;
+            for (unsigned int j = 0; j < PALETTE_ROWS * 4; ++j)
+            {
+                m[j] += joint[j] * weights[i];
+            }
+        }
+
+        float x = p[0], y = p[1], z = p[2];
+        dst[job->position + 0] = m[0] * x + m[1] * y + m[2]  * z + m[3];
+        dst[job->position + 1] = m[4] * x + m[5] * y + m[6]  * z + m[7];
+        dst[job->position + 2] = m[8] * x + m[9] * y + m[10] * z + m[11];
+
+        for (unsigned int i = 0; i < job->directionCount; ++i)
+        {
+            const float* d = src + job->directions[i];
+            x = d[0]; y = d[1]; z = d[2];
+            float* out = dst + job->directions[i];
+            out[0] = m[0] * x + m[1] * y + m[2]  * z;
+            out[1] = m[4] * x + m[5] * y + m[6]  * z;
+            out[2] = m[8] * x + m[9] * y + m[10] * z;
+        }
+#endif
+    }
+}
+
+void MeshSkin::skinVertices(const VertexFormat& vertexFormat, const float* src, float* dst, unsigned int vertexCount) const
+{
+    GP_ASSERT(src && dst);
+
+    // Locate the elements to read and transform in each vertex.
+    SkinVerticesJob job;
+    job.palette = &getMatrixPalette()[0].x;
+    job.src = src;
+    job.dst = dst;
+    job.vertexCount = vertexCount;
+    job.stride = vertexFormat.getVertexSize() / sizeof(float);
+    job.position = job.weights = job.indices = -1;
+    job.directionCount = 0;
+    job.influenceCount = 4;
+
+    unsigned int offset = 0;
+    for (unsigned int i = 0, count = vertexFormat.getElementCount(); i < count; ++i)
+    {
+        const VertexFormat::Element& element = vertexFormat.getElement(i);
+        if (element.type != VertexFormat::FLOAT)
+        {
+            GP_ERROR("CPU skinning requires vertex formats with float elements only (element '%s' is not a float).", VertexFormat::toString(element.usage));
+            return;
+        }
+        switch (element.usage)
+        {
+        case VertexFormat::POSITION:
+            job.position = offset;
+            break;
+        case VertexFormat::NORMAL:
+        case VertexFormat::TANGENT:
+        case VertexFormat::BINORMAL:
+            if (element.size >= 3)
+                job.directions[job.directionCount++] = offset;
+            break;
+        case VertexFormat::BLENDWEIGHTS:
+            job.weights = offset;
+            job.influenceCount = std::min(job.influenceCount, element.size);
+            break;
+        case VertexFormat::BLENDINDICES:
+            job.indices = offset;
+            job.influenceCount = std::min(job.influenceCount, element.size);
+            break;
+        default:
+            break;
+        }
+        offset += element.size;
+    }
+
+    if (job.position < 0 || job.weights < 0 || job.indices < 0)
+    {
+        GP_ERROR("Vertex format must contain position, blend weights and blend indices for CPU skinning.");
+        return;
+    }
+
+    unsigned int jobCount = (vertexCount + SKINNING_VERTICES_PER_JOB - 1) / SKINNING_VERTICES_PER_JOB;
+    JobScheduler* scheduler = Game::getInstance()->getJobScheduler();
+    if (scheduler)
+    {
+        scheduler->parallelFor(jobCount, &skinVerticesJob, &job);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < jobCount; ++i)
+        {
+            skinVerticesJob(i, &job);
+        }
+    }
+
+    __frameStatistics.verticesSkinned += vertexCount;
+}
+
+void MeshSkin::updateSkinnedVertices()
+{
+    // The skinned vertices belong to the skin the pose comes from.
+    MeshSkin* skin = this;
+    while (skin->_poseSource)
+    {
+        skin = skin->_poseSource;
+    }
+
+    if (!skin->_cpuSkinningVertices)
+        return;
+
+    // Rebuild the palette if needed, and skip skinning when it has not changed since the last pass.
+    skin->getMatrixPalette();
+    if (skin->_cpuSkinnedVersion == skin->_matrixPaletteVersion)
+        return;
+    skin->_cpuSkinnedVersion = skin->_matrixPaletteVersion;
+
+    GP_ASSERT(skin->_model && skin->_model->getMesh());
+    Mesh* mesh = skin->_model->getMesh();
+    skin->skinVertices(mesh->getVertexFormat(), skin->_cpuSkinningVertices, skin->_cpuSkinnedVertices, mesh->getVertexCount());
+    mesh->setVertexData(skin->_cpuSkinnedVertices);
+}
+
+const MeshSkin::Statistics& MeshSkin::getStatistics()
+{
+    return __statistics;
+}
+
+void MeshSkin::resetStatistics()
+{
+    __statistics = __frameStatistics;
+    memset(&__frameStatistics, 0, sizeof(__frameStatistics));
+    ++__statisticsFrame;
+}
+
 Model* MeshSkin::getModel() const
 {
     return _model;
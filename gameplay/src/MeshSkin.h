@@ -11,6 +11,7 @@ class Bundle;
 class Model;
 class Joint;
 class Node;
+class VertexFormat;
 
 /**
  * Represents the skin for a mesh.
@@ -22,9 +23,33 @@ class MeshSkin : public Transform::Listener
     friend class Joint;
     friend class Node;
     friend class Scene;
+    friend class Game;
 
 public:
 
+    /**
+     * Skinning work done during a frame, summed over all mesh skins.
+     */
+    struct Statistics
+    {
+        /**
+         * The number of matrix palettes that were rebuilt from their joints.
+         */
+        unsigned int posesEvaluated;
+
+        /**
+         * The number of skins whose matrix palette was used without being rebuilt, either
+         * because none of its joints moved or because it was shared by another skin. Each
+         * skin is counted at most once per frame, however many times it is drawn.
+         */
+        unsigned int palettesReused;
+
+        /**
+         * The number of vertices skinned on the CPU.
+         */
+        unsigned int verticesSkinned;
+    };
+
     /**
      * Returns the bind shape matrix.
      * 
@@ -101,6 +126,78 @@ public:
      */
     unsigned int getMatrixPaletteSize() const;
 
+    /**
+     * Sets a skin whose pose is used instead of the pose of this skin's own joints.
+     *
+     * This is meant for crowds of identical characters: one skin is animated and many
+     * models share its matrix palette, so the pose is only evaluated once per frame no
+     * matter how many instances are drawn. The palette is computed from the joint world
+     * transforms of the source skin, so to place instances individually keep the source
+     * joint hierarchy at the origin and draw the instances with the WORLD_VIEW_PROJECTION_MATRIX
+     * auto-binding. The source skin must have the same joints and must outlive this skin.
+     *
+     * @param source The skin to share the pose of, or NULL to use this skin's own joints.
+     * @script{ignore}
+     */
+    void setPoseSource(MeshSkin* source);
+
+    /**
+     * Returns the skin whose pose is used by this skin, or NULL if it uses its own joints.
+     *
+     * @return The pose source.
+     * @script{ignore}
+     */
+    MeshSkin* getPoseSource() const;
+
+    /**
+     * Enables skinning the vertices of this skin's model on the CPU.
+     *
+     * Whenever the pose changes, the bind pose vertices are skinned on the game's job scheduler
+     * and uploaded to the vertex buffer of the model's mesh before it is drawn. The mesh should
+     * be dynamic and its materials must not define SKINNING. Models that share the mesh and use
+     * this skin as their pose source reuse the skinned vertices, so a single skinning pass
+     * drives all of them.
+     *
+     * The positions are skinned together with the normals, tangents and binormals when present;
+     * the mesh's vertex format must contain BLENDWEIGHTS and BLENDINDICES elements.
+     *
+     * @param vertexData The bind pose vertices in the vertex format of the model's mesh,
+     *      or NULL to disable CPU skinning. The data is copied.
+     * @script{ignore}
+     */
+    void setCpuSkinning(const float* vertexData);
+
+    /**
+     * Returns whether the vertices of this skin's model are skinned on the CPU.
+     *
+     * @return true if CPU skinning is enabled.
+     */
+    bool isCpuSkinning() const;
+
+    /**
+     * Skins vertices on the CPU with the current matrix palette.
+     *
+     * The work is split across the game's job scheduler. Elements other than the position,
+     * normal, tangent and binormal are copied unchanged. The source and destination may
+     * be the same.
+     *
+     * @param vertexFormat The format of the vertices, which must contain POSITION,
+     *      BLENDWEIGHTS and BLENDINDICES elements.
+     * @param src The vertices to skin.
+     * @param dst Receives the skinned vertices.
+     * @param vertexCount The number of vertices.
+     * @script{ignore}
+     */
+    void skinVertices(const VertexFormat& vertexFormat, const float* src, float* dst, unsigned int vertexCount) const;
+
+    /**
+     * Returns the skinning statistics of the previous frame.
+     *
+     * @return The statistics.
+     * @script{ignore}
+     */
+    static const Statistics& getStatistics();
+
     /**
      * Returns our parent Model.
      */
@@ -170,6 +267,17 @@ private:
      */
     void clearJoints();
 
+    /**
+     * Skins the CPU skinned vertices of the model with the current pose and uploads them,
+     * unless that was already done for this pose. Called before the model is drawn.
+     */
+    void updateSkinnedVertices();
+
+    /**
+     * Called by the game at the end of each frame to publish the frame's statistics.
+     */
+    static void resetStatistics();
+
     Matrix _bindShape;
     std::vector<Joint*> _joints;
     Joint* _rootJoint;
@@ -184,6 +292,30 @@ private:
     // Each 4x3 row-wise matrix is represented as 3 Vector4's.
     // The number of Vector4's is (_joints.size() * 3).
     Vector4* _matrixPalette;
+
+    // The inverse bind pose of each joint multiplied by the bind shape, stored
+    // transposed so that the rows read by the palette update are contiguous.
+    Matrix* _bindMatrices;
+
+    // Set when a joint's inverse bind pose or the bind shape changes.
+    mutable bool _bindMatricesDirty;
+
+    // Set when a joint transform changes, so that the palette is only rebuilt when needed.
+    mutable bool _matrixPaletteDirty;
+
+    // Incremented each time the matrix palette is rebuilt.
+    mutable unsigned int _matrixPaletteVersion;
+
+    // The last frame in which the palette was used, so that the statistics count it once per frame.
+    mutable unsigned int _statisticsFrame;
+
+    // The skin whose pose is shared by this skin, if any.
+    MeshSkin* _poseSource;
+
+    // Bind pose vertices for CPU skinning, the skinned result and the palette version it was skinned with.
+    float* _cpuSkinningVertices;
+    float* _cpuSkinnedVertices;
+    unsigned int _cpuSkinnedVersion;
     Model* _model;
 };
 
@@ -5,12 +5,34 @@
 #include "Technique.h"
 #include "Pass.h"
 #include "Node.h"
+#include "RenderQueue.h"
+
+// Number of rows of the 4x3 instance transforms, each passed to shaders as a vec4 attribute.
+#define INSTANCE_ROW_COUNT 3
 
 namespace gameplay
 {
 
+static const char* __instanceRowNames[INSTANCE_ROW_COUNT] =
+{
+    VERTEX_ATTRIBUTE_INSTANCE_ROW_PREFIX_NAME "0",
+    VERTEX_ATTRIBUTE_INSTANCE_ROW_PREFIX_NAME "1",
+    VERTEX_ATTRIBUTE_INSTANCE_ROW_PREFIX_NAME "2"
+};
+
+#ifdef USE_INSTANCED_ARRAYS
+/**
+ * Determines whether the driver provides instanced arrays.
+ */
+static bool isInstancingSupported()
+{
+    return glVertexAttribDivisor != NULL && glDrawElementsInstanced != NULL && glDrawArraysInstanced != NULL;
+}
+#endif
+
 Model::Model(Mesh* mesh) :
-    _mesh(mesh), _material(NULL), _partCount(0), _partMaterials(NULL), _node(NULL), _skin(NULL)
+    _mesh(mesh), _material(NULL), _partCount(0), _partMaterials(NULL), _node(NULL), _skin(NULL),
+    _instanceBuffer(0), _instanceBufferCapacity(0), _instanceBufferDirty(false), _instanceBoundsDirty(false)
 {
     GP_ASSERT(mesh);
     _partCount = mesh->getPartCount();
@@ -31,6 +53,12 @@ Model::~Model()
 
     SAFE_RELEASE(_mesh);
 
+    if (_instanceBuffer)
+    {
+        GL_ASSERT( glDeleteBuffers(1, &_instanceBuffer) );
+        _instanceBuffer = 0;
+    }
+
     SAFE_DELETE(_skin);
 }
 
@@ -232,6 +260,123 @@ Node* Model::getNode() const
     return _node;
 }
 
+unsigned int Model::addInstance(const Matrix& transform)
+{
+    unsigned int index = getInstanceCount();
+    _instanceRows.resize(_instanceRows.size() + INSTANCE_ROW_COUNT * 4);
+    setInstance(index, transform);
+    return index;
+}
+
+void Model::setInstance(unsigned int index, const Matrix& transform)
+{
+    GP_ASSERT(index < getInstanceCount());
+
+    // Store the rows of the transform; the matrix is column-major.
+    float* row = &_instanceRows[index * INSTANCE_ROW_COUNT * 4];
+    for (unsigned int i = 0; i < INSTANCE_ROW_COUNT; ++i, row += 4)
+    {
+        row[0] = transform.m[i];
+        row[1] = transform.m[4 + i];
+        row[2] = transform.m[8 + i];
+        row[3] = transform.m[12 + i];
+    }
+    instancesChanged();
+}
+
+void Model::removeInstance(unsigned int index)
+{
+    GP_ASSERT(index < getInstanceCount());
+
+    const unsigned int size = INSTANCE_ROW_COUNT * 4;
+    unsigned int last = getInstanceCount() - 1;
+    if (index != last)
+    {
+        memcpy(&_instanceRows[index * size], &_instanceRows[last * size], size * sizeof(float));
+    }
+    _instanceRows.resize(last * size);
+    instancesChanged();
+}
+
+void Model::clearInstances()
+{
+    _instanceRows.clear();
+    instancesChanged();
+}
+
+unsigned int Model::getInstanceCount() const
+{
+    return (unsigned int)(_instanceRows.size() / (INSTANCE_ROW_COUNT * 4));
+}
+
+void Model::instancesChanged()
+{
+    _instanceBufferDirty = true;
+    _instanceBoundsDirty = true;
+    if (_node)
+    {
+        _node->setBoundsDirty();
+    }
+}
+
+void Model::updateInstanceBuffer()
+{
+    if (!_instanceBufferDirty)
+        return;
+    _instanceBufferDirty = false;
+
+    if (!_instanceBuffer)
+    {
+        GL_ASSERT( glGenBuffers(1, &_instanceBuffer) );
+    }
+    GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer) );
+
+    // Grow the buffer to fit, otherwise update it in place.
+    unsigned int instanceCount = getInstanceCount();
+    const GLvoid* data = instanceCount ? &_instanceRows[0] : NULL;
+    if (instanceCount > _instanceBufferCapacity)
+    {
+        GL_ASSERT( glBufferData(GL_ARRAY_BUFFER, _instanceRows.size() * sizeof(float), data, GL_DYNAMIC_DRAW) );
+        _instanceBufferCapacity = instanceCount;
+    }
+    else if (instanceCount > 0)
+    {
+        GL_ASSERT( glBufferSubData(GL_ARRAY_BUFFER, 0, _instanceRows.size() * sizeof(float), data) );
+    }
+}
+
+const BoundingSphere& Model::getBoundingSphere() const
+{
+    GP_ASSERT(_mesh);
+
+    unsigned int instanceCount = getInstanceCount();
+    if (instanceCount == 0)
+        return _mesh->getBoundingSphere();
+
+    if (_instanceBoundsDirty)
+    {
+        _instanceBoundsDirty = false;
+
+        // Merge the bounding sphere of the mesh transformed by each instance.
+        Matrix transform;
+        const float* row = &_instanceRows[0];
+        for (unsigned int i = 0; i < instanceCount; ++i, row += INSTANCE_ROW_COUNT * 4)
+        {
+            transform.set(row[0], row[1], row[2], row[3],
+                          row[4], row[5], row[6], row[7],
+                          row[8], row[9], row[10], row[11],
+                          0, 0, 0, 1);
+            BoundingSphere sphere(_mesh->getBoundingSphere());
+            sphere.transform(transform);
+            if (i == 0)
+                _instanceBounds.set(sphere);
+            else
+                _instanceBounds.merge(sphere);
+        }
+    }
+    return _instanceBounds;
+}
+
 void Model::setNode(Node* node)
 {
     _node = node;
@@ -336,6 +481,12 @@ void Model::draw(bool wireframe)
 {
     GP_ASSERT(_mesh);
 
+    // Bring the vertices of a CPU skinned mesh up to date with the current pose.
+    if (_skin)
+    {
+        _skin->updateSkinnedVertices();
+    }
+
     unsigned int partCount = _mesh->getPartCount();
     if (partCount == 0)
     {
@@ -351,10 +502,7 @@ void Model::draw(bool wireframe)
                 GP_ASSERT(pass);
                 pass->bind();
                 GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, 0) );
-                if (!wireframe || !drawWireframe(_mesh))
-                {
-                    GL_ASSERT( glDrawArrays(_mesh->getPrimitiveType(), 0, _mesh->getVertexCount()) );
-                }
+                drawGeometry(pass, NULL, wireframe);
                 pass->unbind();
             }
         }
@@ -379,10 +527,7 @@ void Model::draw(bool wireframe)
                     GP_ASSERT(pass);
                     pass->bind();
                     GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, part->_indexBuffer) );
-                    if (!wireframe || !drawWireframe(part))
-                    {
-                        GL_ASSERT( glDrawElements(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), 0) );
-                    }
+                    drawGeometry(pass, part, wireframe);
                     pass->unbind();
                 }
             }
@@ -390,6 +535,129 @@ void Model::draw(bool wireframe)
     }
 }
 
+void Model::draw(RenderQueue* queue, bool wireframe)
+{
+    addToQueue(queue, wireframe, _node ? _node->getTranslationWorld() : Vector3::zero());
+}
+
+void Model::addToQueue(RenderQueue* queue, bool wireframe, const Vector3& position)
+{
+    GP_ASSERT(queue);
+    GP_ASSERT(_mesh);
+
+    // The skinned vertices are uploaded now, since the pose may change before the queue is drawn.
+    if (_skin)
+    {
+        _skin->updateSkinnedVertices();
+    }
+
+    // A mesh without parts (index buffers) is drawn as a whole with the model's material.
+    unsigned int partCount = _mesh->getPartCount();
+    unsigned int drawCount = partCount > 0 ? partCount : 1;
+    for (unsigned int i = 0; i < drawCount; ++i)
+    {
+        MeshPart* part = partCount > 0 ? _mesh->getPart(i) : NULL;
+        Material* material = partCount > 0 ? getMaterial(i) : _material;
+        if (!material)
+            continue;
+
+        Technique* technique = material->getTechnique();
+        GP_ASSERT(technique);
+        for (unsigned int j = 0, passCount = technique->getPassCount(); j < passCount; ++j)
+        {
+            Pass* pass = technique->getPassByIndex(j);
+            GP_ASSERT(pass);
+            queue->add(pass, j, this, part, wireframe, position);
+        }
+    }
+}
+
+void Model::drawGeometry(Pass* pass, MeshPart* part, bool wireframe)
+{
+    unsigned int instanceCount = getInstanceCount();
+    if (instanceCount == 0)
+    {
+        drawMesh(part, wireframe);
+        return;
+    }
+
+    // Look up the attributes of the rows of the instance transforms.
+    GP_ASSERT(pass && pass->getEffect());
+    Effect* effect = pass->getEffect();
+    VertexAttribute rows[INSTANCE_ROW_COUNT];
+    for (unsigned int i = 0; i < INSTANCE_ROW_COUNT; ++i)
+    {
+        rows[i] = effect->getVertexAttribute(__instanceRowNames[i]);
+        if (rows[i] == -1)
+        {
+            // The effect was not compiled with INSTANCING.
+            drawMesh(part, wireframe);
+            return;
+        }
+    }
+
+#ifdef USE_INSTANCED_ARRAYS
+    if (isInstancingSupported() && !wireframe)
+    {
+        // Draw all instances at once, advancing the transform attributes once per instance.
+        updateInstanceBuffer();
+        GL_ASSERT( glBindBuffer(GL_ARRAY_BUFFER, _instanceBuffer) );
+        for (unsigned int i = 0; i < INSTANCE_ROW_COUNT; ++i)
+        {
+            GL_ASSERT( glEnableVertexAttribArray(rows[i]) );
+            GL_ASSERT( glVertexAttribPointer(rows[i], 4, GL_FLOAT, GL_FALSE, INSTANCE_ROW_COUNT * 4 * sizeof(float), (const GLvoid*)(i * 4 * sizeof(float))) );
+            GL_ASSERT( glVertexAttribDivisor(rows[i], 1) );
+        }
+
+        if (part)
+        {
+            GL_ASSERT( glDrawElementsInstanced(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), 0, instanceCount) );
+        }
+        else
+        {
+            GL_ASSERT( glDrawArraysInstanced(_mesh->getPrimitiveType(), 0, _mesh->getVertexCount(), instanceCount) );
+        }
+
+        for (unsigned int i = 0; i < INSTANCE_ROW_COUNT; ++i)
+        {
+            GL_ASSERT( glVertexAttribDivisor(rows[i], 0) );
+            GL_ASSERT( glDisableVertexAttribArray(rows[i]) );
+        }
+        return;
+    }
+#endif
+
+    // Without instanced arrays, set the transform attributes to constant values for each
+    // instance; this still binds the pass only once for all instances.
+    const float* row = &_instanceRows[0];
+    for (unsigned int i = 0; i < instanceCount; ++i)
+    {
+        for (unsigned int j = 0; j < INSTANCE_ROW_COUNT; ++j, row += 4)
+        {
+            GL_ASSERT( glVertexAttrib4fv(rows[j], row) );
+        }
+        drawMesh(part, wireframe);
+    }
+}
+
+void Model::drawMesh(MeshPart* part, bool wireframe)
+{
+    if (part)
+    {
+        if (!wireframe || !drawWireframe(part))
+        {
+            GL_ASSERT( glDrawElements(part->getPrimitiveType(), part->getIndexCount(), part->getIndexFormat(), 0) );
+        }
+    }
+    else
+    {
+        if (!wireframe || !drawWireframe(_mesh))
+        {
+            GL_ASSERT( glDrawArrays(_mesh->getPrimitiveType(), 0, _mesh->getVertexCount()) );
+        }
+    }
+}
+
 void Model::validatePartCount()
 {
     GP_ASSERT(_mesh);
@@ -455,6 +723,11 @@ Model* Model::clone(NodeCloneContext &context)
             }
         }
     }
+    if (!_instanceRows.empty())
+    {
+        model->_instanceRows = _instanceRows;
+        model->instancesChanged();
+    }
     return model;
 }
 
@@ -12,6 +12,7 @@ class Bundle;
 class MeshSkin;
 class Node;
 class NodeCloneContext;
+class RenderQueue;
 
 /**
  * Defines a Model which is an instance of a Mesh that can be drawn
@@ -23,6 +24,8 @@ class Model : public Ref
     friend class Scene;
     friend class Mesh;
     friend class Bundle;
+    friend class RenderQueue;
+    friend class TerrainPatch;
 
 public:
 
@@ -135,6 +138,55 @@ public:
      */
     Node* getNode() const;
 
+    /**
+     * Adds an instance of this model.
+     *
+     * A model with instances draws its mesh once for each instance, transformed by the
+     * instance's transform and then by the world transform of the model's node. Where
+     * instanced arrays are supported, the transforms are kept in a vertex buffer and all
+     * instances are drawn with a single draw call per mesh part and pass.
+     *
+     * The vertex shaders of the model's materials must be compiled with the INSTANCING
+     * define, which applies the instance transform to the vertex position and normal.
+     * The built-in shaders support it, except when combined with SKINNING. Normals are
+     * transformed by the rotation and scale of the instance, so instance transforms should
+     * have a uniform scale.
+     *
+     * @param transform The transform of the instance, relative to the model's node.
+     *
+     * @return The index of the new instance.
+     */
+    unsigned int addInstance(const Matrix& transform);
+
+    /**
+     * Sets the transform of an instance.
+     *
+     * @param index The index of the instance.
+     * @param transform The transform of the instance, relative to the model's node.
+     */
+    void setInstance(unsigned int index, const Matrix& transform);
+
+    /**
+     * Removes an instance.
+     *
+     * The last instance is moved to the index of the removed one.
+     *
+     * @param index The index of the instance to remove.
+     */
+    void removeInstance(unsigned int index);
+
+    /**
+     * Removes all instances, so that the model is drawn once.
+     */
+    void clearInstances();
+
+    /**
+     * Returns the number of instances of this model.
+     *
+     * @return The number of instances, or 0 if the model is not instanced.
+     */
+    unsigned int getInstanceCount() const;
+
     /**
      * Sets the node that is associated with this model.
      *
@@ -157,6 +209,17 @@ public:
      */
     void draw(bool wireframe = false);
 
+    /**
+     * Adds the draws of this mesh instance to a render queue instead of drawing it.
+     *
+     * One item is added for each pass of the material of each MeshPart. The items
+     * are ordered by depth from the position of the node of this model.
+     *
+     * @param queue The render queue to add the draws to.
+     * @param wireframe If true, draw the model in wireframe mode.
+     */
+    void draw(RenderQueue* queue, bool wireframe = false);
+
 private:
 
     /**
@@ -188,6 +251,40 @@ private:
 
     void validatePartCount();
 
+    /**
+     * Adds the draws of this mesh instance to a render queue, ordering them by depth
+     * from the given world space position.
+     */
+    void addToQueue(RenderQueue* queue, bool wireframe, const Vector3& position);
+
+    /**
+     * Issues the draw calls for a mesh part, or for the mesh if part is NULL, once the
+     * pass and the index buffer have been bound. The mesh is drawn once for each instance
+     * if the model has instances.
+     */
+    void drawGeometry(Pass* pass, MeshPart* part, bool wireframe);
+
+    /**
+     * Issues the draw call for a mesh part, or for the mesh if part is NULL, once.
+     */
+    void drawMesh(MeshPart* part, bool wireframe);
+
+    /**
+     * Uploads the instance transforms to the instance buffer if they have changed.
+     */
+    void updateInstanceBuffer();
+
+    /**
+     * Called when the instances change.
+     */
+    void instancesChanged();
+
+    /**
+     * Returns the bounding sphere of the mesh, or of all instances if the model has any,
+     * relative to the model's node.
+     */
+    const BoundingSphere& getBoundingSphere() const;
+
     /**
      * Clones the model and returns a new model.
      * 
@@ -202,6 +299,12 @@ private:
     Material** _partMaterials;
     Node* _node;
     MeshSkin* _skin;
+    std::vector<float> _instanceRows;
+    VertexBufferHandle _instanceBuffer;
+    unsigned int _instanceBufferCapacity;
+    bool _instanceBufferDirty;
+    mutable BoundingSphere _instanceBounds;
+    mutable bool _instanceBoundsDirty;
 };
 
 }
@@ -22,7 +22,8 @@ namespace gameplay
 Node::Node(const char* id)
     : _scene(NULL), _firstChild(NULL), _nextSibling(NULL), _prevSibling(NULL), _parent(NULL), _childCount(0),
     _tags(NULL), _camera(NULL), _light(NULL), _model(NULL), _terrain(NULL), _form(NULL), _audioSource(NULL), _particleEmitter(NULL),
-    _collisionObject(NULL), _agent(NULL), _dirtyBits(NODE_DIRTY_ALL), _notifyHierarchyChanged(true), _userData(NULL)
+    _collisionObject(NULL), _agent(NULL), _dirtyBits(NODE_DIRTY_ALL), _notifyHierarchyChanged(true), _userData(NULL),
+    _spatialProxy(-1), _spatialQueued(false)
 {
     if (id)
     {
@@ -80,6 +81,10 @@ void Node::setId(const char* id)
     if (id)
     {
         _id = id;
+
+        // Agents are looked up by their node's ID.
+        if (_agent)
+            Game::getInstance()->getAIController()->invalidateAgentIndex();
     }
 }
 
@@ -126,6 +131,12 @@ void Node::addChild(Node* child)
 
     ++_childCount;
 
+    // Children of an indexed node join the scene's spatial index with it.
+    if (_spatialProxy >= 0 || _spatialQueued)
+    {
+        getSpatialIndexScene()->addToSpatialIndex(child);
+    }
+
     setBoundsDirty();
 
     if (_notifyHierarchyChanged)
@@ -163,6 +174,12 @@ void Node::removeAllChildren()
 
 void Node::remove()
 {
+    // Leave the spatial index of our scene along with our descendants.
+    if (_spatialProxy >= 0 || _spatialQueued)
+    {
+        getSpatialIndexScene()->removeFromSpatialIndex(this);
+    }
+
     // Re-link our neighbours.
     if (_prevSibling)
     {
@@ -631,6 +648,11 @@ Vector3 Node::getActiveCameraTranslationView() const
 
 void Node::hierarchyChanged()
 {
+    // Any flattened copy of the scene hierarchy is now out of date.
+    Scene* scene = getScene();
+    if (scene)
+        scene->_transformOrderDirty = true;
+
     // When our hierarchy changes our world transform is affected, so we must dirty it.
     transformChanged();
 }
@@ -638,7 +660,8 @@ void Node::hierarchyChanged()
 void Node::transformChanged()
 {
     // Our local transform was changed, so mark our world matrices dirty.
-    _dirtyBits |= NODE_DIRTY_WORLD | NODE_DIRTY_BOUNDS;
+    _dirtyBits |= NODE_DIRTY_ALL;
+    queueSpatialUpdate();
 
     // Notify our children that their transform has also changed (since transforms are inherited).
     for (Node* n = getFirstChild(); n != NULL; n = n->getNextSibling())
@@ -665,12 +688,66 @@ void Node::setBoundsDirty()
 {
     // Mark ourself and our parent nodes as dirty
     _dirtyBits |= NODE_DIRTY_BOUNDS;
+    queueSpatialUpdate();
 
     // Mark our parent bounds as dirty as well
     if (_parent)
         _parent->setBoundsDirty();
 }
 
+void Node::queueSpatialUpdate()
+{
+    if (_spatialProxy >= 0 && !_spatialQueued)
+    {
+        Scene* scene = getSpatialIndexScene();
+        GP_ASSERT(scene && scene->_spatialIndex);
+        scene->_spatialUpdates.push_back(this);
+        _spatialQueued = true;
+    }
+}
+
+Scene* Node::getSpatialIndexScene() const
+{
+    // Unlike getScene(), this ignores the skins that joints are bound to.
+    const Node* node = this;
+    while (node->_parent)
+    {
+        node = node->_parent;
+    }
+    return node->_scene;
+}
+
+void Node::resolveWorldMatrices(Node* const* nodes, const int* parents, size_t count)
+{
+    for (size_t i = 0; i < count; ++i)
+    {
+        Node* node = nodes[i];
+        GP_ASSERT(node);
+        GP_ASSERT(parents[i] < (int)i);
+
+        if (node->_dirtyBits & NODE_DIRTY_WORLD)
+        {
+            node->_dirtyBits &= ~NODE_DIRTY_WORLD;
+
+            // Mirror the rules of getWorldMatrix(): static nodes keep their world matrix and
+            // dynamic (non-kinematic) physics nodes ignore their parent transform. The parent
+            // comes earlier in the array, so its world matrix is already resolved.
+            if (!node->isStatic())
+            {
+                int parent = parents[i];
+                if (parent >= 0 && (!node->_collisionObject || node->_collisionObject->isKinematic()))
+                {
+                    Matrix::multiply(nodes[parent]->_world, node->getMatrix(), &node->_world);
+                }
+                else
+                {
+                    node->_world = node->getMatrix();
+                }
+            }
+        }
+    }
+}
+
 Animation* Node::getAnimation(const char* id) const
 {
     Animation* animation = ((AnimationTarget*)this)->getAnimation(id);
@@ -880,12 +957,12 @@ const BoundingSphere& Node::getBoundingSphere() const
         {
             if (empty)
             {
-                _bounds.set(_model->getMesh()->getBoundingSphere());
+                _bounds.set(_model->getBoundingSphere());
                 empty = false;
             }
             else
             {
-                _bounds.merge(_model->getMesh()->getBoundingSphere());
+                _bounds.merge(_model->getBoundingSphere());
             }
         }
         if (_light)
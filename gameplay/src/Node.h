@@ -30,6 +30,7 @@ class Node : public Transform, public Ref
     friend class Bundle;
     friend class MeshSkin;
     friend class Light;
+    friend class Model;
 
 public:
 
@@ -708,6 +709,28 @@ protected:
      */
     void setBoundsDirty();
 
+    /**
+     * Queues the node to be updated in its scene's spatial index, if it is held in one.
+     */
+    void queueSpatialUpdate();
+
+    /**
+     * Returns the scene owning the root of this node's hierarchy, whose spatial index holds the node.
+     */
+    Scene* getSpatialIndexScene() const;
+
+    /**
+     * Resolves the world matrices of a topologically sorted array of nodes in a single pass.
+     *
+     * Each node must appear after its parent in the array. Only nodes whose world matrix
+     * is dirty are recomputed; the result is identical to calling getWorldMatrix() on each node.
+     *
+     * @param nodes The sorted array of nodes.
+     * @param parents The index of each node's parent within the array, or -1 for root nodes.
+     * @param count The number of nodes in the arrays.
+     */
+    static void resolveWorldMatrices(Node* const* nodes, const int* parents, size_t count);
+
 private:
 
     /**
@@ -860,6 +883,16 @@ protected:
      * lowest common ancestor.
      */
     std::vector<Node*> _advertisedDescendants;
+
+    /**
+     * The proxy of the Node in its scene's spatial index, or -1 if it has not been inserted.
+     */
+    int _spatialProxy;
+
+    /**
+     * A flag indicating if the Node is queued for insertion or update in its scene's spatial index.
+     */
+    bool _spatialQueued;
 };
 
 /**
@@ -5,6 +5,7 @@
 #include "Scene.h"
 #include "Quaternion.h"
 #include "Properties.h"
+#include "ParticleStreams.h"
 
 #define PARTICLE_COUNT_MAX                       100
 #define PARTICLE_EMISSION_RATE                   10
@@ -28,10 +29,11 @@ ParticleEmitter::ParticleEmitter(SpriteBatch* batch, unsigned int particleCountM
     _spriteBatch(batch), _spriteTextureBlending(BLEND_TRANSPARENT),  _spriteTextureWidth(0), _spriteTextureHeight(0), _spriteTextureWidthRatio(0), _spriteTextureHeightRatio(0), _spriteTextureCoords(NULL),
     _spriteAnimated(false),  _spriteLooped(false), _spriteFrameCount(1), _spriteFrameRandomOffset(0),_spriteFrameDuration(0L), _spriteFrameDurationSecs(0.0f), _spritePercentPerFrame(0.0f),
     _node(NULL), _orbitPosition(false), _orbitVelocity(false), _orbitAcceleration(false),
-    _timePerEmission(PARTICLE_EMISSION_RATE_TIME_INTERVAL), _timeRunning(0)
+    _timePerEmission(PARTICLE_EMISSION_RATE_TIME_INTERVAL), _timeRunning(0), _randomState(0)
 {
     GP_ASSERT(particleCountMax);
-    _particles = new Particle[particleCountMax];
+    _particles = new ParticleStreams(particleCountMax);
+    setRandomSeed((unsigned int)rand());
 
     GP_ASSERT(_spriteBatch);
     GP_ASSERT(_spriteBatch->getStateBlock());
@@ -42,7 +44,7 @@ ParticleEmitter::ParticleEmitter(SpriteBatch* batch, unsigned int particleCountM
 ParticleEmitter::~ParticleEmitter()
 {
     SAFE_DELETE(_spriteBatch);
-    SAFE_DELETE_ARRAY(_particles);
+    SAFE_DELETE(_particles);
     SAFE_DELETE_ARRAY(_spriteTextureCoords);
 }
 
@@ -251,7 +253,7 @@ bool ParticleEmitter::isActive() const
     bool active = false;
     for (unsigned int i = 0; i < _particleCount; i++)
     {
-        if (_particles[i]._energy > 0)
+        if (_particles->_energy[i] > 0)
         {
             active = true;
             break;
@@ -272,77 +274,107 @@ void ParticleEmitter::emitOnce(unsigned int particleCount)
         particleCount = _particleCountMax - _particleCount;
     }
 
+    const Matrix& world = _node->getWorldMatrix();
     Vector3 translation;
-    Matrix world = _node->getWorldMatrix();
     world.getTranslation(&translation);
 
-    // Take translation out of world matrix so it can be used to rotate orbiting properties.
-    world.m[12] = 0.0f;
-    world.m[13] = 0.0f;
-    world.m[14] = 0.0f;
-
     // Emit the new particles.
+    ParticleStreams* p = _particles;
+    unsigned int first = _particleCount;
+    Vector4 colorStart;
+    Vector4 colorEnd;
+    Vector3 position;
+    Vector3 velocity;
+    Vector3 acceleration;
+    Vector3 rotationAxis;
     for (unsigned int i = 0; i < particleCount; i++)
     {
-        Particle* p = &_particles[_particleCount];
-        p->_visible = true;
+        unsigned int index = _particleCount;
+        p->_visible[index] = ~0;
 
-        generateColor(_colorStart, _colorStartVar, &p->_colorStart);
-        generateColor(_colorEnd, _colorEndVar, &p->_colorEnd);
-        p->_color.set(p->_colorStart);
+        generateColor(_colorStart, _colorStartVar, &colorStart);
+        generateColor(_colorEnd, _colorEndVar, &colorEnd);
 
-        p->_energy = p->_energyStart = generateScalar(_energyMin, _energyMax);
-        p->_size = p->_sizeStart = generateScalar(_sizeStartMin, _sizeStartMax);
-        p->_sizeEnd = generateScalar(_sizeEndMin, _sizeEndMax);
-        p->_rotationPerParticleSpeed = generateScalar(_rotationPerParticleSpeedMin, _rotationPerParticleSpeedMax);
-        p->_angle = generateScalar(0.0f, p->_rotationPerParticleSpeed);
-        p->_rotationSpeed = generateScalar(_rotationSpeedMin, _rotationSpeedMax);
+        long energy = generateScalar(_energyMin, _energyMax);
+        p->_energy[index] = (int)energy;
+        p->_energyStart[index] = (float)energy;
+        p->_size[index] = p->_sizeStart[index] = generateScalar(_sizeStartMin, _sizeStartMax);
+        p->_sizeEnd[index] = generateScalar(_sizeEndMin, _sizeEndMax);
+        p->_rotationPerParticleSpeed[index] = generateScalar(_rotationPerParticleSpeedMin, _rotationPerParticleSpeedMax);
+        p->_angle[index] = generateScalar(0.0f, p->_rotationPerParticleSpeed[index]);
+        p->_rotationSpeed[index] = generateScalar(_rotationSpeedMin, _rotationSpeedMax);
 
         // Only initial position can be generated within an ellipsoidal domain.
-        generateVector(_position, _positionVar, &p->_position, _ellipsoid);
-        generateVector(_velocity, _velocityVar, &p->_velocity, false);
-        generateVector(_acceleration, _accelerationVar, &p->_acceleration, false);
-        generateVector(_rotationAxis, _rotationAxisVar, &p->_rotationAxis, false);
-
-        // Initial position, velocity and acceleration can all be relative to the emitter's transform.
-        // Rotate specified properties by the node's rotation.
-        if (_orbitPosition)
-        {
-            world.transformPoint(p->_position, &p->_position);
-        }
+        generateVector(_position, _positionVar, &position, _ellipsoid);
+        generateVector(_velocity, _velocityVar, &velocity, false);
+        generateVector(_acceleration, _accelerationVar, &acceleration, false);
+        generateVector(_rotationAxis, _rotationAxisVar, &rotationAxis, false);
+
+        p->_colorStartR[index] = p->_colorR[index] = colorStart.x;
+        p->_colorStartG[index] = p->_colorG[index] = colorStart.y;
+        p->_colorStartB[index] = p->_colorB[index] = colorStart.z;
+        p->_colorStartA[index] = p->_colorA[index] = colorStart.w;
+        p->_colorEndR[index] = colorEnd.x;
+        p->_colorEndG[index] = colorEnd.y;
+        p->_colorEndB[index] = colorEnd.z;
+        p->_colorEndA[index] = colorEnd.w;
+        p->_positionX[index] = position.x;
+        p->_positionY[index] = position.y;
+        p->_positionZ[index] = position.z;
+        p->_velocityX[index] = velocity.x;
+        p->_velocityY[index] = velocity.y;
+        p->_velocityZ[index] = velocity.z;
+        p->_accelerationX[index] = acceleration.x;
+        p->_accelerationY[index] = acceleration.y;
+        p->_accelerationZ[index] = acceleration.z;
+        p->_rotationAxisX[index] = rotationAxis.x;
+        p->_rotationAxisY[index] = rotationAxis.y;
+        p->_rotationAxisZ[index] = rotationAxis.z;
 
-        if (_orbitVelocity)
+        // Initial sprite frame.
+        if (_spriteFrameRandomOffset > 0)
         {
-            world.transformPoint(p->_velocity, &p->_velocity);
+            p->_frame[index] = generateRandom() % _spriteFrameRandomOffset;
         }
-
-        if (_orbitAcceleration)
+        else
         {
-            world.transformPoint(p->_acceleration, &p->_acceleration);
+            p->_frame[index] = 0;
         }
+        p->_timeOnCurrentFrame[index] = 0.0f;
 
-        // The rotation axis always orbits the node.
-        if (p->_rotationSpeed != 0.0f && !p->_rotationAxis.isZero())
-        {
-            world.transformPoint(p->_rotationAxis, &p->_rotationAxis);
-        }
+        ++_particleCount;
+    }
 
+    // Initial position, velocity and acceleration can all be relative to the emitter's transform.
+    // Transform the specified properties of all new particles at once.
+    unsigned int count = _particleCount - first;
+    if (_orbitPosition)
+    {
+        world.transformPoints(p->_positionX + first, p->_positionY + first, p->_positionZ + first, count);
+    }
+    else
+    {
         // Translate position relative to the node's world space.
-        p->_position.add(translation);
-
-        // Initial sprite frame.
-        if (_spriteFrameRandomOffset > 0)
+        for (unsigned int i = first; i < _particleCount; ++i)
         {
-            p->_frame = rand() % _spriteFrameRandomOffset;
+            p->_positionX[i] += translation.x;
+            p->_positionY[i] += translation.y;
+            p->_positionZ[i] += translation.z;
         }
-        else
-        {
-            p->_frame = 0;
-        }
-        p->_timeOnCurrentFrame = 0.0f;
+    }
 
-        ++_particleCount;
+    if (_orbitVelocity)
+    {
+        world.transformVectors(p->_velocityX + first, p->_velocityY + first, p->_velocityZ + first, count);
+    }
+
+    if (_orbitAcceleration)
+    {
+        world.transformVectors(p->_accelerationX + first, p->_accelerationY + first, p->_accelerationZ + first, count);
     }
+
+    // The rotation axis always orbits the node.
+    world.transformVectors(p->_rotationAxisX + first, p->_rotationAxisY + first, p->_rotationAxisZ + first, count);
 }
 
 unsigned int ParticleEmitter::getParticlesCount() const
@@ -685,6 +717,41 @@ void ParticleEmitter::setOrbit(bool orbitPosition, bool orbitVelocity, bool orbi
     _orbitAcceleration = orbitAcceleration;
 }
 
+void ParticleEmitter::setRandomSeed(unsigned int seed)
+{
+    // Scramble the seed so that consecutive seeds give unrelated sequences.
+    seed ^= seed >> 16;
+    seed *= 0x85EBCA6B;
+    seed ^= seed >> 13;
+    seed *= 0xC2B2AE35;
+    seed ^= seed >> 16;
+
+    // Xorshift must never be in the all-zero state.
+    _randomState = seed ? seed : 0x9E3779B9;
+}
+
+unsigned int ParticleEmitter::generateRandom()
+{
+    // Marsaglia's xorshift32.
+    unsigned int x = _randomState;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    _randomState = x;
+    return x;
+}
+
+float ParticleEmitter::generateRandom0To1()
+{
+    // Use the top 24 bits so the result is exactly representable as a float.
+    return (float)(generateRandom() >> 8) * (1.0f / 16777215.0f);
+}
+
+float ParticleEmitter::generateRandomMinus1To1()
+{
+    return 2.0f * generateRandom0To1() - 1.0f;
+}
+
 long ParticleEmitter::generateScalar(long min, long max)
 {
     // Note: this is not a very good RNG, but it should be suitable for our purposes.
@@ -692,7 +759,7 @@ long ParticleEmitter::generateScalar(long min, long max)
     for (unsigned int i = 0; i < sizeof(long)/sizeof(int); i++)
     {
         r = r << 8; // sizeof(int) * CHAR_BITS
-        r |= rand();
+        r |= (long)(generateRandom() & 0x7FFFFFFF);
     }
 
     // Now we have a random long between 0 and MAX_LONG.  We need to clamp it between min and max.
@@ -704,7 +771,7 @@ long ParticleEmitter::generateScalar(long min, long max)
 
 float ParticleEmitter::generateScalar(float min, float max)
 {
-    return min + (max - min) * MATH_RANDOM_0_1();
+    return min + (max - min) * generateRandom0To1();
 }
 
 void ParticleEmitter::generateVectorInRect(const Vector3& base, const Vector3& variance, Vector3* dst)
@@ -713,9 +780,9 @@ void ParticleEmitter::generateVectorInRect(const Vector3& base, const Vector3& v
 
     // Scale each component of the variance vector by a random float
     // between -1 and 1, then add this to the corresponding base component.
-    dst->x = base.x + variance.x * MATH_RANDOM_MINUS1_1();
-    dst->y = base.y + variance.y * MATH_RANDOM_MINUS1_1();
-    dst->z = base.z + variance.z * MATH_RANDOM_MINUS1_1();
+    dst->x = base.x + variance.x * generateRandomMinus1To1();
+    dst->y = base.y + variance.y * generateRandomMinus1To1();
+    dst->z = base.z + variance.z * generateRandomMinus1To1();
 }
 
 void ParticleEmitter::generateVectorInEllipsoid(const Vector3& center, const Vector3& scale, Vector3* dst)
@@ -725,9 +792,9 @@ void ParticleEmitter::generateVectorInEllipsoid(const Vector3& center, const Vec
     // Generate a point within a unit cube, then reject if the point is not in a unit sphere.
     do
     {
-        dst->x = MATH_RANDOM_MINUS1_1();
-        dst->y = MATH_RANDOM_MINUS1_1();
-        dst->z = MATH_RANDOM_MINUS1_1();
+        dst->x = generateRandomMinus1To1();
+        dst->y = generateRandomMinus1To1();
+        dst->z = generateRandomMinus1To1();
     } while (dst->length() > 1.0f);
     
     // Scale this point by the scaling vector.
@@ -757,10 +824,10 @@ void ParticleEmitter::generateColor(const Vector4& base, const Vector4& variance
 
     // Scale each component of the variance color by a random float
     // between -1 and 1, then add this to the corresponding base component.
-    dst->x = base.x + variance.x * MATH_RANDOM_MINUS1_1();
-    dst->y = base.y + variance.y * MATH_RANDOM_MINUS1_1();
-    dst->z = base.z + variance.z * MATH_RANDOM_MINUS1_1();
-    dst->w = base.w + variance.w * MATH_RANDOM_MINUS1_1();
+    dst->x = base.x + variance.x * generateRandomMinus1To1();
+    dst->y = base.y + variance.y * generateRandomMinus1To1();
+    dst->z = base.z + variance.z * generateRandomMinus1To1();
+    dst->w = base.w + variance.w * generateRandomMinus1To1();
 }
 
 ParticleEmitter::TextureBlending ParticleEmitter::getTextureBlendingFromString(const char* str)
@@ -823,101 +890,164 @@ void ParticleEmitter::update(float elapsedTime)
 
     // Now update all currently living particles.
     GP_ASSERT(_particles);
-    for (unsigned int particlesIndex = 0; particlesIndex < _particleCount; ++particlesIndex)
+    updateParticles(elapsedTime, frustum);
+
+    // Remove dead particles. Move the particle furthest from the start of the array
+    // down to take its place, and re-use the slot at the end of the list of living particles.
+    for (unsigned int particlesIndex = 0; particlesIndex < _particleCount; )
     {
-        Particle* p = &_particles[particlesIndex];
-        p->_energy -= elapsedTime;
+        if (_particles->_energy[particlesIndex] > 0)
+        {
+            ++particlesIndex;
+            continue;
+        }
 
-        if (p->_energy > 0L)
+        if (particlesIndex != _particleCount - 1)
         {
-            if (p->_rotationSpeed != 0.0f && !p->_rotationAxis.isZero())
-            {
-                Matrix::createRotation(p->_rotationAxis, p->_rotationSpeed * elapsedSecs, &_rotation);
+            _particles->copy(particlesIndex, _particleCount - 1);
+        }
+        --_particleCount;
+    }
+}
 
-                _rotation.transformPoint(p->_velocity, &p->_velocity);
-                _rotation.transformPoint(p->_acceleration, &p->_acceleration);
-            }
+// Arguments shared by the jobs of ParticleEmitter::updateEmitters.
+struct ParticleEmitterUpdateJob
+{
+    ParticleEmitter* const* emitters;
+    float elapsedTime;
+};
+
+static void updateEmitterJob(unsigned int index, void* cookie)
+{
+    ParticleEmitterUpdateJob* job = (ParticleEmitterUpdateJob*)cookie;
+    GP_ASSERT(job && job->emitters[index]);
+    job->emitters[index]->update(job->elapsedTime);
+}
 
-            // Particle is still alive.
-            p->_velocity.x += p->_acceleration.x * elapsedSecs;
-            p->_velocity.y += p->_acceleration.y * elapsedSecs;
-            p->_velocity.z += p->_acceleration.z * elapsedSecs;
+void ParticleEmitter::updateEmitters(ParticleEmitter* const* emitters, unsigned int emitterCount, float elapsedTime)
+{
+    GP_ASSERT(emitters || emitterCount == 0);
 
-            p->_position.x += p->_velocity.x * elapsedSecs;
-            p->_position.y += p->_velocity.y * elapsedSecs;
-            p->_position.z += p->_velocity.z * elapsedSecs;
+    // The node world matrices and camera frustums are computed lazily on first use,
+    // which is not safe to do from several threads at once, so resolve them up front.
+    for (unsigned int i = 0; i < emitterCount; ++i)
+    {
+        ParticleEmitter* emitter = emitters[i];
+        GP_ASSERT(emitter);
+        if (emitter->isActive())
+        {
+            GP_ASSERT(emitter->_node && emitter->_node->getScene() && emitter->_node->getScene()->getActiveCamera());
+            emitter->_node->getWorldMatrix();
+            emitter->_node->getScene()->getActiveCamera()->getFrustum();
+        }
+    }
 
-            if (!frustum.intersects(p->_position))
-            {
-                p->_visible = false;
-                continue;
-            }
+    ParticleEmitterUpdateJob job;
+    job.emitters = emitters;
+    job.elapsedTime = elapsedTime;
 
-            p->_angle += p->_rotationPerParticleSpeed * elapsedSecs;
+    JobScheduler* scheduler = Game::getInstance()->getJobScheduler();
+    if (scheduler)
+    {
+        scheduler->parallelFor(emitterCount, &updateEmitterJob, &job);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < emitterCount; ++i)
+        {
+            updateEmitterJob(i, &job);
+        }
+    }
+}
 
-            // Simple linear interpolation of color and size.
-            float percent = 1.0f - ((float)p->_energy / (float)p->_energyStart);
+void ParticleEmitter::updateParticles(float elapsedTime, const Frustum& frustum)
+{
+    ParticleStreams* p = _particles;
+    float elapsedSecs = elapsedTime * 0.001f;
 
-            p->_color.x = p->_colorStart.x + (p->_colorEnd.x - p->_colorStart.x) * percent;
-            p->_color.y = p->_colorStart.y + (p->_colorEnd.y - p->_colorStart.y) * percent;
-            p->_color.z = p->_colorStart.z + (p->_colorEnd.z - p->_colorStart.z) * percent;
-            p->_color.w = p->_colorStart.w + (p->_colorEnd.w - p->_colorStart.w) * percent;
+    // Spin the velocity and acceleration of particles around their rotation axis.
+    if (_rotationSpeedMin != 0.0f || _rotationSpeedMax != 0.0f)
+    {
+        for (unsigned int i = 0; i < _particleCount; ++i)
+        {
+            Vector3 axis(p->_rotationAxisX[i], p->_rotationAxisY[i], p->_rotationAxisZ[i]);
+            if (p->_rotationSpeed[i] != 0.0f && !axis.isZero())
+            {
+                Vector3 velocity(p->_velocityX[i], p->_velocityY[i], p->_velocityZ[i]);
+                Vector3 acceleration(p->_accelerationX[i], p->_accelerationY[i], p->_accelerationZ[i]);
+                Matrix::createRotation(axis, p->_rotationSpeed[i] * elapsedSecs, &_rotation);
+                _rotation.transformPoint(&velocity);
+                _rotation.transformPoint(&acceleration);
+                p->_velocityX[i] = velocity.x;
+                p->_velocityY[i] = velocity.y;
+                p->_velocityZ[i] = velocity.z;
+                p->_accelerationX[i] = acceleration.x;
+                p->_accelerationY[i] = acceleration.y;
+                p->_accelerationZ[i] = acceleration.z;
+            }
+        }
+    }
 
-            p->_size = p->_sizeStart + (p->_sizeEnd - p->_sizeStart) * percent;
+    // Integrate, cull and interpolate the color and size of the particles.
+    p->update(_particleCount, elapsedTime, frustum);
 
-            // Handle sprite animations.
-            if (_spriteAnimated)
+    // Handle sprite animations.
+    if (_spriteAnimated)
+    {
+        for (unsigned int i = 0; i < _particleCount; ++i)
+        {
+            if (!_spriteLooped)
             {
-                if (!_spriteLooped)
+                // The last frame should finish exactly when the particle dies.
+                float percent = 1.0f - ((float)p->_energy[i] / p->_energyStart[i]);
+                p->_timeOnCurrentFrame[i] = percent - (float)p->_frame[i] * _spritePercentPerFrame;
+                if ((unsigned int)p->_frame[i] < _spriteFrameCount - 1 &&
+                    p->_timeOnCurrentFrame[i] >= _spritePercentPerFrame)
                 {
-                    // The last frame should finish exactly when the particle dies.
-                    float percentSpent = 0.0f;
-                    for (unsigned int i = 0; i < p->_frame; i++)
-                    {
-                        percentSpent += _spritePercentPerFrame;
-                    }
-                    p->_timeOnCurrentFrame = percent - percentSpent;
-                    if (p->_frame < _spriteFrameCount - 1 &&
-                        p->_timeOnCurrentFrame >= _spritePercentPerFrame)
-                    {
-                        ++p->_frame;
-                    }
+                    ++p->_frame[i];
                 }
-                else
+            }
+            else
+            {
+                // _spriteFrameDurationSecs is an absolute time measured in seconds,
+                // and the animation repeats indefinitely.
+                p->_timeOnCurrentFrame[i] += elapsedSecs;
+                if (p->_timeOnCurrentFrame[i] >= _spriteFrameDurationSecs)
                 {
-                    // _spriteFrameDurationSecs is an absolute time measured in seconds,
-                    // and the animation repeats indefinitely.
-                    p->_timeOnCurrentFrame += elapsedSecs;
-                    if (p->_timeOnCurrentFrame >= _spriteFrameDurationSecs)
+                    p->_timeOnCurrentFrame[i] -= _spriteFrameDurationSecs;
+                    ++p->_frame[i];
+                    if ((unsigned int)p->_frame[i] == _spriteFrameCount)
                     {
-                        p->_timeOnCurrentFrame -= _spriteFrameDurationSecs;
-                        ++p->_frame;
-                        if (p->_frame == _spriteFrameCount)
-                        {
-                            p->_frame = 0;
-                        }
+                        p->_frame[i] = 0;
                     }
                 }
             }
         }
-        else
-        {
-            // Particle is dead.  Move the particle furthest from the start of the array
-            // down to take its place, and re-use the slot at the end of the list of living particles.
-            if (particlesIndex != _particleCount - 1)
-            {
-                _particles[particlesIndex] = _particles[_particleCount - 1];
-            }
-            --_particleCount;
-        }
     }
 }
 
 void ParticleEmitter::draw()
+{
+    if (fillSpriteBatch())
+    {
+        // Render.
+        _spriteBatch->finish();
+    }
+}
+
+void ParticleEmitter::draw(RenderQueue* queue)
+{
+    if (fillSpriteBatch())
+    {
+        _spriteBatch->finish(queue, _node ? _node->getTranslationWorld() : Vector3::zero());
+    }
+}
+
+bool ParticleEmitter::fillSpriteBatch()
 {
     if (!isActive())
     {
-        return;
+        return false;
     }
 
     if (_particleCount > 0)
@@ -947,21 +1077,20 @@ void ParticleEmitter::draw()
         Vector3 up;
         cameraWorldMatrix.getUpVector(&up);
 
+        ParticleStreams* p = _particles;
         for (unsigned int i = 0; i < _particleCount; i++)
         {
-            Particle* p = &_particles[i];
-
-            if (p->_visible)
+            if (p->_visible[i])
             {
-                _spriteBatch->draw(p->_position, right, up, p->_size, p->_size,
-                                   _spriteTextureCoords[p->_frame * 4], _spriteTextureCoords[p->_frame * 4 + 1], _spriteTextureCoords[p->_frame * 4 + 2], _spriteTextureCoords[p->_frame * 4 + 3],
-                                   p->_color, pivot, p->_angle);
+                const float* texCoords = &_spriteTextureCoords[p->_frame[i] * 4];
+                _spriteBatch->draw(Vector3(p->_positionX[i], p->_positionY[i], p->_positionZ[i]), right, up, p->_size[i], p->_size[i],
+                                   texCoords[0], texCoords[1], texCoords[2], texCoords[3],
+                                   Vector4(p->_colorR[i], p->_colorG[i], p->_colorB[i], p->_colorA[i]), pivot, p->_angle[i]);
             }
         }
-
-        // Render.
-        _spriteBatch->finish();
+        return true;
     }
+    return false;
 }
 
 }
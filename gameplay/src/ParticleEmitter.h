@@ -14,6 +14,9 @@ namespace gameplay
 {
 
 class Node;
+class Frustum;
+class ParticleStreams;
+class RenderQueue;
 
 /**
  * Defines a particle emitter that can be made to simulate and render a particle system.
@@ -606,6 +609,17 @@ public:
      */
     void setOrbit(bool orbitPosition, bool orbitVelocity, bool orbitAcceleration);
 
+    /**
+     * Sets the seed of the random number generator used to emit new particles.
+     *
+     * Each emitter owns its random state, so an emitter seeded with the same value
+     * always emits the same particles, independent of other emitters and of the
+     * thread it is updated on. Emitters are seeded from rand() when they are created.
+     *
+     * @param seed The seed value.
+     */
+    void setRandomSeed(unsigned int seed);
+
     /**
      * Updates the particles currently being emitted.
      *
@@ -613,11 +627,34 @@ public:
      */
     void update(float elapsedTime);
 
+    /**
+     * Updates a list of emitters in parallel using the game's job scheduler.
+     *
+     * This gives the same results as calling update() on each emitter in turn. Must be called
+     * from the main thread, and each emitter may only appear once in the list.
+     *
+     * @param emitters The emitters to update.
+     * @param emitterCount The number of emitters in the list.
+     * @param elapsedTime The amount of time that has passed since the last call to update(), in milliseconds.
+     * @script{ignore}
+     */
+    static void updateEmitters(ParticleEmitter* const* emitters, unsigned int emitterCount, float elapsedTime);
+
     /**
      * Draws the particles currently being emitted.
      */
     void draw();
 
+    /**
+     * Adds the particles currently being emitted to a render queue instead of drawing them.
+     *
+     * The particles are ordered by depth from the position of the emitter's node, and must
+     * not be updated until the queue has been drawn.
+     *
+     * @param queue The render queue to add the particles to.
+     */
+    void draw(RenderQueue* queue);
+
     /**
      * Gets a TextureBlending enum from a corresponding string.
      */
@@ -650,6 +687,22 @@ private:
      */
     void setNode(Node* node);
 
+    /**
+     * Fills the sprite batch with the visible particles.
+     *
+     * @return True if the batch was started and must be finished, false if there is nothing to draw.
+     */
+    bool fillSpriteBatch();
+
+    // Returns the next value of the emitter's random sequence.
+    unsigned int generateRandom();
+
+    // Returns a random float between 0 and 1.
+    float generateRandom0To1();
+
+    // Returns a random float between -1 and 1.
+    float generateRandomMinus1To1();
+
     // Generates a scalar within the range defined by min and max.
     float generateScalar(float min, float max);
 
@@ -667,35 +720,13 @@ private:
     void generateColor(const Vector4& base, const Vector4& variance, Vector4* dst);
 
     /**
-     * Defines the data for a single particle in the system.
+     * Advances the simulation of all living particles and culls them against the given frustum.
      */
-    class Particle
-    {
-
-    public:
-        Vector3 _position;
-        Vector3 _velocity;
-        Vector3 _acceleration;
-        Vector4 _colorStart;
-        Vector4 _colorEnd;
-        Vector4 _color;
-        float _rotationPerParticleSpeed;
-        Vector3 _rotationAxis;
-        float _rotationSpeed;
-        float _angle;
-        long _energyStart;
-        long _energy;
-        float _sizeStart;
-        float _sizeEnd;
-        float _size;
-        unsigned int _frame;
-        float _timeOnCurrentFrame;
-        bool _visible;
-    };
+    void updateParticles(float elapsedTime, const Frustum& frustum);
 
     unsigned int _particleCountMax;
     unsigned int _particleCount;
-    Particle* _particles;
+    ParticleStreams* _particles;
     unsigned int _emissionRate;
     bool _started;
     bool _ellipsoid;
@@ -742,6 +773,7 @@ private:
     bool _orbitAcceleration;
     float _timePerEmission;
     double _timeRunning;
+    unsigned int _randomState;
 };
 
 }
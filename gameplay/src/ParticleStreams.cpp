@@ -0,0 +1,240 @@
+#include "Base.h"
+#include "ParticleStreams.h"
+#include "Frustum.h"
+
+// Number of particles simulated together by the vectorized update.
+#define PARTICLE_SIMD_WIDTH                      4
+
+// Number of float and int attribute arrays in ParticleStreams.
+#define PARTICLE_FLOAT_ATTRIBUTES                32
+#define PARTICLE_INT_ATTRIBUTES                  3
+
+#ifdef USE_NEON
+#include <arm_neon.h>
+#endif
+
+namespace gameplay
+{
+
+#if defined(USE_SSE)
+
+typedef __m128 simd4f;
+typedef __m128i simd4i;
+
+static inline simd4f simdLoad(const float* p) { return _mm_loadu_ps(p); }
+static inline void simdStore(float* p, simd4f v) { _mm_storeu_ps(p, v); }
+static inline simd4i simdLoadInt(const int* p) { return _mm_loadu_si128((const __m128i*)p); }
+static inline void simdStoreInt(int* p, simd4i v) { _mm_storeu_si128((__m128i*)p, v); }
+static inline simd4f simdSplat(float f) { return _mm_set1_ps(f); }
+static inline simd4f simdAdd(simd4f a, simd4f b) { return _mm_add_ps(a, b); }
+static inline simd4f simdSub(simd4f a, simd4f b) { return _mm_sub_ps(a, b); }
+static inline simd4f simdMul(simd4f a, simd4f b) { return _mm_mul_ps(a, b); }
+static inline simd4f simdDiv(simd4f a, simd4f b) { return _mm_div_ps(a, b); }
+static inline simd4i simdGreater(simd4f a, simd4f b) { return _mm_castps_si128(_mm_cmpgt_ps(a, b)); }
+static inline simd4i simdAnd(simd4i a, simd4i b) { return _mm_and_si128(a, b); }
+static inline simd4f simdToFloat(simd4i v) { return _mm_cvtepi32_ps(v); }
+static inline simd4i simdToInt(simd4f v) { return _mm_cvttps_epi32(v); }
+
+#elif defined(USE_NEON)
+
+typedef float32x4_t simd4f;
+typedef int32x4_t simd4i;
+
+static inline simd4f simdLoad(const float* p) { return vld1q_f32(p); }
+static inline void simdStore(float* p, simd4f v) { vst1q_f32(p, v); }
+static inline simd4i simdLoadInt(const int* p) { return vld1q_s32(p); }
+static inline void simdStoreInt(int* p, simd4i v) { vst1q_s32(p, v); }
+static inline simd4f simdSplat(float f) { return vdupq_n_f32(f); }
+static inline simd4f simdAdd(simd4f a, simd4f b) { return vaddq_f32(a, b); }
+static inline simd4f simdSub(simd4f a, simd4f b) { return vsubq_f32(a, b); }
+static inline simd4f simdMul(simd4f a, simd4f b) { return vmulq_f32(a, b); }
+static inline simd4f simdDiv(simd4f a, simd4f b)
+{
+    // NEON has no divide instruction, so refine the reciprocal estimate with two Newton-Raphson steps.
+    simd4f r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+}
+static inline simd4i simdGreater(simd4f a, simd4f b) { return vreinterpretq_s32_u32(vcgtq_f32(a, b)); }
+static inline simd4i simdAnd(simd4i a, simd4i b) { return vandq_s32(a, b); }
+static inline simd4f simdToFloat(simd4i v) { return vcvtq_f32_s32(v); }
+static inline simd4i simdToInt(simd4f v) { return vcvtq_s32_f32(v); }
+
+#endif
+
+#if defined(USE_SSE) || defined(USE_NEON)
+
+// Returns a mask of the particles lying strictly in front of the given plane.
+static inline simd4i simdInFront(const Plane& plane, simd4f x, simd4f y, simd4f z)
+{
+    const Vector3& n = plane.getNormal();
+    simd4f d = simdAdd(simdAdd(simdAdd(simdMul(simdSplat(n.x), x), simdMul(simdSplat(n.y), y)), simdMul(simdSplat(n.z), z)), simdSplat(plane.getDistance()));
+    return simdGreater(d, simdSplat(0.0f));
+}
+
+#endif
+
+ParticleStreams::ParticleStreams(unsigned int particleCountMax)
+    : _capacity(particleCountMax), _floats(NULL), _ints(NULL)
+{
+    _floats = new float[_capacity * PARTICLE_FLOAT_ATTRIBUTES];
+    memset(_floats, 0, _capacity * PARTICLE_FLOAT_ATTRIBUTES * sizeof(float));
+    _ints = new int[_capacity * PARTICLE_INT_ATTRIBUTES];
+    memset(_ints, 0, _capacity * PARTICLE_INT_ATTRIBUTES * sizeof(int));
+
+    float* f = _floats;
+    _positionX = f; f += _capacity;
+    _positionY = f; f += _capacity;
+    _positionZ = f; f += _capacity;
+    _velocityX = f; f += _capacity;
+    _velocityY = f; f += _capacity;
+    _velocityZ = f; f += _capacity;
+    _accelerationX = f; f += _capacity;
+    _accelerationY = f; f += _capacity;
+    _accelerationZ = f; f += _capacity;
+    _colorStartR = f; f += _capacity;
+    _colorStartG = f; f += _capacity;
+    _colorStartB = f; f += _capacity;
+    _colorStartA = f; f += _capacity;
+    _colorEndR = f; f += _capacity;
+    _colorEndG = f; f += _capacity;
+    _colorEndB = f; f += _capacity;
+    _colorEndA = f; f += _capacity;
+    _colorR = f; f += _capacity;
+    _colorG = f; f += _capacity;
+    _colorB = f; f += _capacity;
+    _colorA = f; f += _capacity;
+    _rotationPerParticleSpeed = f; f += _capacity;
+    _rotationAxisX = f; f += _capacity;
+    _rotationAxisY = f; f += _capacity;
+    _rotationAxisZ = f; f += _capacity;
+    _rotationSpeed = f; f += _capacity;
+    _angle = f; f += _capacity;
+    _energyStart = f; f += _capacity;
+    _sizeStart = f; f += _capacity;
+    _sizeEnd = f; f += _capacity;
+    _size = f; f += _capacity;
+    _timeOnCurrentFrame = f; f += _capacity;
+    GP_ASSERT(f == _floats + _capacity * PARTICLE_FLOAT_ATTRIBUTES);
+
+    int* n = _ints;
+    _energy = n; n += _capacity;
+    _frame = n; n += _capacity;
+    _visible = n; n += _capacity;
+    GP_ASSERT(n == _ints + _capacity * PARTICLE_INT_ATTRIBUTES);
+}
+
+ParticleStreams::~ParticleStreams()
+{
+    SAFE_DELETE_ARRAY(_floats);
+    SAFE_DELETE_ARRAY(_ints);
+}
+
+void ParticleStreams::copy(unsigned int dst, unsigned int src)
+{
+    GP_ASSERT(dst < _capacity && src < _capacity);
+
+    for (unsigned int i = 0; i < PARTICLE_FLOAT_ATTRIBUTES; ++i)
+    {
+        float* attribute = _floats + i * _capacity;
+        attribute[dst] = attribute[src];
+    }
+    for (unsigned int i = 0; i < PARTICLE_INT_ATTRIBUTES; ++i)
+    {
+        int* attribute = _ints + i * _capacity;
+        attribute[dst] = attribute[src];
+    }
+}
+
+void ParticleStreams::update(unsigned int count, float elapsedTime, const Frustum& frustum, bool vectorized)
+{
+    GP_ASSERT(count <= _capacity);
+
+    // Energy is kept in whole milliseconds and truncated the same way by both implementations.
+    unsigned int i = 0;
+#if defined(USE_SSE) || defined(USE_NEON)
+    if (vectorized)
+    {
+        const float elapsedSecs = elapsedTime * 0.001f;
+        const simd4f dt = simdSplat(elapsedSecs);
+        const simd4f elapsed = simdSplat(elapsedTime);
+        const simd4f one = simdSplat(1.0f);
+        for (; i + PARTICLE_SIMD_WIDTH <= count; i += PARTICLE_SIMD_WIDTH)
+        {
+            simd4i energy = simdToInt(simdSub(simdToFloat(simdLoadInt(_energy + i)), elapsed));
+            simdStoreInt(_energy + i, energy);
+
+            simd4f vx = simdAdd(simdLoad(_velocityX + i), simdMul(simdLoad(_accelerationX + i), dt));
+            simd4f vy = simdAdd(simdLoad(_velocityY + i), simdMul(simdLoad(_accelerationY + i), dt));
+            simd4f vz = simdAdd(simdLoad(_velocityZ + i), simdMul(simdLoad(_accelerationZ + i), dt));
+            simdStore(_velocityX + i, vx);
+            simdStore(_velocityY + i, vy);
+            simdStore(_velocityZ + i, vz);
+
+            simd4f px = simdAdd(simdLoad(_positionX + i), simdMul(vx, dt));
+            simd4f py = simdAdd(simdLoad(_positionY + i), simdMul(vy, dt));
+            simd4f pz = simdAdd(simdLoad(_positionZ + i), simdMul(vz, dt));
+            simdStore(_positionX + i, px);
+            simdStore(_positionY + i, py);
+            simdStore(_positionZ + i, pz);
+
+            simd4i visible = simdInFront(frustum.getNear(), px, py, pz);
+            visible = simdAnd(visible, simdInFront(frustum.getFar(), px, py, pz));
+            visible = simdAnd(visible, simdInFront(frustum.getLeft(), px, py, pz));
+            visible = simdAnd(visible, simdInFront(frustum.getRight(), px, py, pz));
+            visible = simdAnd(visible, simdInFront(frustum.getTop(), px, py, pz));
+            visible = simdAnd(visible, simdInFront(frustum.getBottom(), px, py, pz));
+            simdStoreInt(_visible + i, visible);
+
+            simdStore(_angle + i, simdAdd(simdLoad(_angle + i), simdMul(simdLoad(_rotationPerParticleSpeed + i), dt)));
+
+            // Simple linear interpolation of color and size.
+            simd4f percent = simdSub(one, simdDiv(simdToFloat(energy), simdLoad(_energyStart + i)));
+            simd4f start = simdLoad(_colorStartR + i);
+            simdStore(_colorR + i, simdAdd(start, simdMul(simdSub(simdLoad(_colorEndR + i), start), percent)));
+            start = simdLoad(_colorStartG + i);
+            simdStore(_colorG + i, simdAdd(start, simdMul(simdSub(simdLoad(_colorEndG + i), start), percent)));
+            start = simdLoad(_colorStartB + i);
+            simdStore(_colorB + i, simdAdd(start, simdMul(simdSub(simdLoad(_colorEndB + i), start), percent)));
+            start = simdLoad(_colorStartA + i);
+            simdStore(_colorA + i, simdAdd(start, simdMul(simdSub(simdLoad(_colorEndA + i), start), percent)));
+            start = simdLoad(_sizeStart + i);
+            simdStore(_size + i, simdAdd(start, simdMul(simdSub(simdLoad(_sizeEnd + i), start), percent)));
+        }
+    }
+#endif
+
+    // The particles left over from the groups of four.
+    updateScalar(i, count, elapsedTime, frustum);
+}
+
+void ParticleStreams::updateScalar(unsigned int first, unsigned int last, float elapsedTime, const Frustum& frustum)
+{
+    const float elapsedSecs = elapsedTime * 0.001f;
+    for (unsigned int i = first; i < last; ++i)
+    {
+        _energy[i] -= elapsedTime;
+
+        _velocityX[i] += _accelerationX[i] * elapsedSecs;
+        _velocityY[i] += _accelerationY[i] * elapsedSecs;
+        _velocityZ[i] += _accelerationZ[i] * elapsedSecs;
+        _positionX[i] += _velocityX[i] * elapsedSecs;
+        _positionY[i] += _velocityY[i] * elapsedSecs;
+        _positionZ[i] += _velocityZ[i] * elapsedSecs;
+
+        _visible[i] = frustum.intersects(_positionX[i], _positionY[i], _positionZ[i]) ? ~0 : 0;
+
+        _angle[i] += _rotationPerParticleSpeed[i] * elapsedSecs;
+
+        // Simple linear interpolation of color and size.
+        float percent = 1.0f - ((float)_energy[i] / _energyStart[i]);
+        _colorR[i] = _colorStartR[i] + (_colorEndR[i] - _colorStartR[i]) * percent;
+        _colorG[i] = _colorStartG[i] + (_colorEndG[i] - _colorStartG[i]) * percent;
+        _colorB[i] = _colorStartB[i] + (_colorEndB[i] - _colorStartB[i]) * percent;
+        _colorA[i] = _colorStartA[i] + (_colorEndA[i] - _colorStartA[i]) * percent;
+        _size[i] = _sizeStart[i] + (_sizeEnd[i] - _sizeStart[i]) * percent;
+    }
+}
+
+}
@@ -0,0 +1,106 @@
+#ifndef PARTICLESTREAMS_H_
+#define PARTICLESTREAMS_H_
+
+namespace gameplay
+{
+
+class Frustum;
+
+/**
+ * Defines the data for all particles of a ParticleEmitter, stored as a structure of arrays.
+ *
+ * Each attribute of the particles is kept in its own contiguous array so that the
+ * update loop can process several particles at once using SIMD instructions.
+ *
+ * @see ParticleEmitter
+ * @script{ignore}
+ */
+class ParticleStreams
+{
+public:
+
+    /**
+     * Constructor.
+     *
+     * @param particleCountMax The number of particles that the streams can hold.
+     */
+    ParticleStreams(unsigned int particleCountMax);
+
+    /**
+     * Destructor.
+     */
+    ~ParticleStreams();
+
+    /**
+     * Copies all attributes of the particle at index src to index dst.
+     */
+    void copy(unsigned int dst, unsigned int src);
+
+    /**
+     * Advances the first count particles by the elapsed time: decreases their energy,
+     * integrates their motion and angle, culls them against the given frustum and
+     * interpolates their color and size.
+     *
+     * Groups of four particles are updated with SSE2 or NEON instructions where they are
+     * available, and any remaining particles with the scalar implementation.
+     *
+     * @param count The number of particles to update.
+     * @param elapsedTime The elapsed time, in milliseconds.
+     * @param frustum The frustum that visible particles lie in.
+     * @param vectorized false to update all particles with the scalar implementation.
+     */
+    void update(unsigned int count, float elapsedTime, const Frustum& frustum, bool vectorized = true);
+
+    unsigned int _capacity;
+    float* _floats;
+    int* _ints;
+    float* _positionX;
+    float* _positionY;
+    float* _positionZ;
+    float* _velocityX;
+    float* _velocityY;
+    float* _velocityZ;
+    float* _accelerationX;
+    float* _accelerationY;
+    float* _accelerationZ;
+    float* _colorStartR;
+    float* _colorStartG;
+    float* _colorStartB;
+    float* _colorStartA;
+    float* _colorEndR;
+    float* _colorEndG;
+    float* _colorEndB;
+    float* _colorEndA;
+    float* _colorR;
+    float* _colorG;
+    float* _colorB;
+    float* _colorA;
+    float* _rotationPerParticleSpeed;
+    float* _rotationAxisX;
+    float* _rotationAxisY;
+    float* _rotationAxisZ;
+    float* _rotationSpeed;
+    float* _angle;
+    float* _energyStart;
+    float* _sizeStart;
+    float* _sizeEnd;
+    float* _size;
+    float* _timeOnCurrentFrame;
+    int* _energy;
+    int* _frame;
+    int* _visible;
+
+private:
+
+    ParticleStreams(const ParticleStreams&);
+    ParticleStreams& operator=(const ParticleStreams&);
+
+    /**
+     * Updates the particles in [first, last) with the scalar implementation.
+     */
+    void updateScalar(unsigned int first, unsigned int last, float elapsedTime, const Frustum& frustum);
+};
+
+}
+
+#endif
@@ -231,7 +231,7 @@ bool PhysicsCollisionObject::CollisionPair::operator < (const CollisionPair& col
 }
 
 PhysicsCollisionObject::PhysicsMotionState::PhysicsMotionState(Node* node, PhysicsCollisionObject* collisionObject, const Vector3* centerOfMassOffset) :
-    _node(node), _collisionObject(collisionObject), _centerOfMassOffset(btTransform::getIdentity())
+    _node(node), _collisionObject(collisionObject), _centerOfMassOffset(btTransform::getIdentity()), _interpolating(false)
 {
     if (centerOfMassOffset)
     {
@@ -240,6 +240,7 @@ PhysicsCollisionObject::PhysicsMotionState::PhysicsMotionState(Node* node, Physi
     }
 
     updateTransformFromNode();
+    _previousTransform = _worldTransform;
 }
 
 PhysicsCollisionObject::PhysicsMotionState::~PhysicsMotionState()
@@ -260,8 +261,20 @@ void PhysicsCollisionObject::PhysicsMotionState::getWorldTransform(btTransform &
 void PhysicsCollisionObject::PhysicsMotionState::setWorldTransform(const btTransform &transform)
 {
     GP_ASSERT(_node);
+    GP_ASSERT(_collisionObject && _collisionObject->getCollisionObject());
 
-    _worldTransform = transform * _centerOfMassOffset;
+    // Bullet extrapolates the given transform by the time it carries over to its next simulation,
+    // which the physics controller does not use, so the body's state after the step is used instead.
+    _previousTransform = _worldTransform;
+    _worldTransform = _collisionObject->getCollisionObject()->getWorldTransform() * _centerOfMassOffset;
+
+    // With interpolation, the node is set once all the steps of the update are done.
+    GP_ASSERT(Game::getInstance()->getPhysicsController());
+    if (Game::getInstance()->getPhysicsController()->isInterpolationEnabled())
+    {
+        _interpolating = true;
+        return;
+    }
         
     const btQuaternion& rot = _worldTransform.getRotation();
     const btVector3& pos = _worldTransform.getOrigin();
@@ -270,6 +283,32 @@ void PhysicsCollisionObject::PhysicsMotionState::setWorldTransform(const btTrans
     _node->setTranslation(pos.x(), pos.y(), pos.z());
 }
 
+void PhysicsCollisionObject::PhysicsMotionState::interpolate(float alpha)
+{
+    GP_ASSERT(_node);
+    GP_ASSERT(_collisionObject && _collisionObject->getCollisionObject());
+
+    if (!_interpolating)
+        return;
+
+    // A body that has gone to sleep stays where its last step left it.
+    if (alpha >= 1.0f || !_collisionObject->getCollisionObject()->isActive())
+    {
+        alpha = 1.0f;
+        _interpolating = false;
+    }
+
+    const btQuaternion& previousRotation = _previousTransform.getRotation();
+    const btQuaternion& rotation = _worldTransform.getRotation();
+    Quaternion rot;
+    Quaternion::slerp(Quaternion(previousRotation.x(), previousRotation.y(), previousRotation.z(), previousRotation.w()),
+        Quaternion(rotation.x(), rotation.y(), rotation.z(), rotation.w()), alpha, &rot);
+    btVector3 pos = _previousTransform.getOrigin().lerp(_worldTransform.getOrigin(), alpha);
+
+    _node->setRotation(rot);
+    _node->setTranslation(pos.x(), pos.y(), pos.z());
+}
+
 void PhysicsCollisionObject::PhysicsMotionState::updateTransformFromNode() const
 {
     GP_ASSERT(_node);
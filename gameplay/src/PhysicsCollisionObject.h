@@ -402,6 +402,13 @@ private:
          * Sets the center of mass offset for the associated collision shape.
          */
         void setCenterOfMassOffset(const Vector3& centerOfMassOffset);
+
+        /**
+         * Sets the node's transform to the interpolation of the world transforms of the last two steps.
+         *
+         * @param alpha The fraction of a step from the previous state to the current one.
+         */
+        void interpolate(float alpha);
         
     private:
         
@@ -409,6 +416,8 @@ private:
         PhysicsCollisionObject* _collisionObject;
         btTransform _centerOfMassOffset;
         mutable btTransform _worldTransform;
+        btTransform _previousTransform;
+        bool _interpolating;
     };
 
     /** 
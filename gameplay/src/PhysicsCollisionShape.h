@@ -241,6 +241,11 @@ private:
     {
         float* vertexData;
         std::vector<unsigned char*> indexData;
+        // The URL of the mesh and the scale the shape was created for (used by the shape cache).
+        std::string url;
+        Vector3 scale;
+        // For a scaled shape, the unscaled shape whose triangles and BVH it shares (NULL otherwise).
+        PhysicsCollisionShape* source;
     };
 
     struct HeightfieldData
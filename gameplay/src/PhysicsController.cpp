@@ -11,6 +11,9 @@
 #undef new
 #endif
 #include "BulletCollision/CollisionShapes/btHeightfieldTerrainShape.h"
+#include "BulletCollision/CollisionDispatch/btConvexConvexAlgorithm.h"
+#include "BulletCollision/NarrowPhaseCollision/btVoronoiSimplexSolver.h"
+#include "LinearMath/btAabbUtil2.h"
 #ifdef GAMEPLAY_MEM_LEAK_DETECTION
 #define new DEBUG_NEW
 #endif
@@ -18,29 +21,363 @@
 // The initial capacity of the Bullet debug drawer's vertex batch.
 #define INITIAL_CAPACITY 280
 
+// Weight of the latest update in the running average of the step time.
+#define STEP_TIME_SMOOTHING 0.25f
+
+// Fraction of a step that the elapsed time may fall short of it by and still have it simulated.
+#define STEP_TOLERANCE 0.0001
+
+// The number of consecutive overlapping pairs that a collision detection job processes at a time.
+#define DISPATCH_BLOCK_SIZE 32
+
+// The number of consecutive queries of a batched ray or sweep test that share a broadphase query.
+#define QUERY_GROUP_SIZE 16
+
+// The number of objects above which the queries of a group are tested separately instead.
+#define QUERY_GROUP_PROXIES 64
+
 namespace gameplay
 {
 
-const int PhysicsController::DIRTY         = 0x01;
-const int PhysicsController::COLLISION     = 0x02;
-const int PhysicsController::REGISTERED    = 0x04;
-const int PhysicsController::REMOVE        = 0x08;
+const int PhysicsController::COLLISION     = 0x01;
+const int PhysicsController::REGISTERED    = 0x02;
+const int PhysicsController::REMOVE        = 0x04;
+
+static const ScriptTarget::Event __statusEvent = { "statusEvent", "[PhysicsController::Listener::EventType]" };
+
+/**
+ * Hashes a collision pair (FNV-1a over the two object addresses), independently of the order of its objects.
+ */
+static unsigned int hashCollisionPair(const PhysicsCollisionObject* objectA, const PhysicsCollisionObject* objectB)
+{
+    size_t a = (size_t)objectA;
+    size_t b = (size_t)objectB;
+    if (a > b)
+        std::swap(a, b);
+
+    unsigned int hash = 2166136261u;
+    hash = (hash ^ (unsigned int)(a >> 3)) * 16777619u;
+    hash = (hash ^ (unsigned int)(b >> 3)) * 16777619u;
+    return hash ^ (hash >> 16);
+}
+
+/**
+ * Convex-convex collision algorithm with a simplex solver of its own, so that the collisions
+ * of different pairs can be detected at the same time.
+ */
+class ConvexConvexAlgorithm : public btConvexConvexAlgorithm
+{
+public:
+
+    /**
+     * Creates the algorithms with the settings of the default convex-convex creation function.
+     */
+    struct CreateFunc : public btCollisionAlgorithmCreateFunc
+    {
+        CreateFunc(btConvexConvexAlgorithm::CreateFunc* source) : source(source) { }
+
+        btCollisionAlgorithm* CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap);
+
+        btConvexConvexAlgorithm::CreateFunc* source;
+    };
+
+    ConvexConvexAlgorithm(const btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap,
+                          btConvexPenetrationDepthSolver* pdSolver, int numPerturbationIterations, int minimumPointsPerturbationThreshold)
+        : btConvexConvexAlgorithm(ci.m_manifold, ci, body0Wrap, body1Wrap, &_simplexSolver, pdSolver, numPerturbationIterations, minimumPointsPerturbationThreshold)
+    {
+    }
+
+private:
+
+    btVoronoiSimplexSolver _simplexSolver;
+};
+
+#ifdef GAMEPLAY_MEM_LEAK_DETECTION
+#undef new
+#endif
+btCollisionAlgorithm* ConvexConvexAlgorithm::CreateFunc::CreateCollisionAlgorithm(btCollisionAlgorithmConstructionInfo& ci, const btCollisionObjectWrapper* body0Wrap, const btCollisionObjectWrapper* body1Wrap)
+{
+    GP_ASSERT(ci.m_dispatcher1);
+    GP_ASSERT(source);
+
+    void* mem = ci.m_dispatcher1->allocateCollisionAlgorithm(sizeof(ConvexConvexAlgorithm));
+    return new(mem) ConvexConvexAlgorithm(ci, body0Wrap, body1Wrap, source->m_pdSolver, source->m_numPerturbationIterations, source->m_minimumPointsPerturbationThreshold);
+}
+#ifdef GAMEPLAY_MEM_LEAK_DETECTION
+#define new DEBUG_NEW
+#endif
+
+/**
+ * Gets the construction info of the collision configuration, with room in the collision
+ * algorithm pool for the convex-convex algorithms and their simplex solvers.
+ */
+static btDefaultCollisionConstructionInfo getCollisionConstructionInfo()
+{
+    btDefaultCollisionConstructionInfo info;
+    info.m_customCollisionAlgorithmMaxElementSize = sizeof(ConvexConvexAlgorithm);
+    return info;
+}
+
+/**
+ * Gets the unique ids of the broadphase proxies of the objects of a manifold, lowest first.
+ *
+ * The ids are assigned in the order the objects were added to the world.
+ */
+static void getManifoldKey(const btPersistentManifold* manifold, int* first, int* second)
+{
+    GP_ASSERT(manifold);
+
+    const btBroadphaseProxy* proxy0 = manifold->getBody0()->getBroadphaseHandle();
+    const btBroadphaseProxy* proxy1 = manifold->getBody1()->getBroadphaseHandle();
+    *first = proxy0 ? proxy0->m_uniqueId : -1;
+    *second = proxy1 ? proxy1->m_uniqueId : -1;
+    if (*first > *second)
+        std::swap(*first, *second);
+}
+
+/**
+ * Orders manifolds by the pair of objects they belong to.
+ */
+static bool compareManifolds(const btPersistentManifold* a, const btPersistentManifold* b)
+{
+    int a0, a1, b0, b1;
+    getManifoldKey(a, &a0, &a1);
+    getManifoldKey(b, &b0, &b1);
+    return a0 != b0 ? a0 < b0 : a1 < b1;
+}
+
+/**
+ * Ray test callback that finds the closest physics object hit, subject to a hit filter.
+ */
+class RayTestCallback : public btCollisionWorld::ClosestRayResultCallback
+{
+private:
+
+    PhysicsController::HitFilter* filter;
+    PhysicsController::HitResult hitResult;
+
+public:
+
+    RayTestCallback(const btVector3& rayFromWorld, const btVector3& rayToWorld, PhysicsController::HitFilter* filter)
+        : btCollisionWorld::ClosestRayResultCallback(rayFromWorld, rayToWorld), filter(filter)
+    {
+    }
+
+    virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+    {
+        if (!btCollisionWorld::ClosestRayResultCallback::needsCollision(proxy0))
+            return false;
+
+        btCollisionObject* co = reinterpret_cast<btCollisionObject*>(proxy0->m_clientObject);
+        PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(co->getUserPointer());
+        if (object == NULL)
+            return false;
+
+        return filter ? !filter->filter(object) : true;
+    }
+
+    btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace)
+    {
+        GP_ASSERT(rayResult.m_collisionObject);
+        PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(rayResult.m_collisionObject->getUserPointer());
+
+        if (object == NULL)
+            return 1.0f; // ignore
+
+        float result = btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult, normalInWorldSpace);
+
+        hitResult.object = object;
+        hitResult.point.set(m_hitPointWorld.x(), m_hitPointWorld.y(), m_hitPointWorld.z());
+        hitResult.fraction = m_closestHitFraction;
+        hitResult.normal.set(m_hitNormalWorld.x(), m_hitNormalWorld.y(), m_hitNormalWorld.z());
+
+        if (filter && !filter->hit(hitResult))
+            return 1.0f; // process next collision
+
+        return result; // continue normally
+    }
+};
+
+/**
+ * Sweep test callback that finds the closest physics object hit by another one, subject to a hit filter.
+ */
+class SweepTestCallback : public btCollisionWorld::ClosestConvexResultCallback
+{
+private:
+
+    PhysicsCollisionObject* me;
+    PhysicsController::HitFilter* filter;
+    PhysicsController::HitResult hitResult;
+
+public:
+
+    SweepTestCallback(PhysicsCollisionObject* me, PhysicsController::HitFilter* filter)
+        : btCollisionWorld::ClosestConvexResultCallback(btVector3(0.0, 0.0, 0.0), btVector3(0.0, 0.0, 0.0)), me(me), filter(filter)
+    {
+    }
+
+    virtual bool needsCollision(btBroadphaseProxy* proxy0) const
+    {
+        if (!btCollisionWorld::ClosestConvexResultCallback::needsCollision(proxy0))
+            return false;
+
+        btCollisionObject* co = reinterpret_cast<btCollisionObject*>(proxy0->m_clientObject);
+        PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(co->getUserPointer());
+        if (object == NULL || object == me)
+            return false;
+
+        return filter ? !filter->filter(object) : true;
+    }
+
+    btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
+    {
+        GP_ASSERT(convexResult.m_hitCollisionObject);
+        PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(convexResult.m_hitCollisionObject->getUserPointer());
+
+        if (object == NULL)
+            return 1.0f;
+
+        float result = ClosestConvexResultCallback::addSingleResult(convexResult, normalInWorldSpace);
+
+        hitResult.object = object;
+        hitResult.point.set(m_hitPointWorld.x(), m_hitPointWorld.y(), m_hitPointWorld.z());
+        hitResult.fraction = m_closestHitFraction;
+        hitResult.normal.set(m_hitNormalWorld.x(), m_hitNormalWorld.y(), m_hitNormalWorld.z());
+
+        if (filter && !filter->hit(hitResult))
+            return 1.0f;
+
+        return result;
+    }
+};
+
+/**
+ * Collects the broadphase proxies whose bounds overlap a box.
+ */
+class ProxyCollector : public btBroadphaseAabbCallback
+{
+public:
+
+    ProxyCollector(std::vector<const btBroadphaseProxy*>& proxies) : proxies(proxies) { }
+
+    bool process(const btBroadphaseProxy* proxy)
+    {
+        proxies.push_back(proxy);
+        return true;
+    }
+
+    std::vector<const btBroadphaseProxy*>& proxies;
+};
+
+/**
+ * Gets the shape and start transform of a sweep test of an object.
+ *
+ * @return The convex shape to sweep, or NULL if the shape of the object is not supported.
+ */
+static btConvexShape* getSweepShape(PhysicsCollisionObject* object, btTransform* start)
+{
+    GP_ASSERT(object && object->getCollisionShape());
+    GP_ASSERT(start);
+
+    PhysicsCollisionShape* shape = object->getCollisionShape();
+    PhysicsCollisionShape::Type type = shape->getType();
+    if (type != PhysicsCollisionShape::SHAPE_BOX && type != PhysicsCollisionShape::SHAPE_SPHERE && type != PhysicsCollisionShape::SHAPE_CAPSULE)
+        return NULL; // unsupported type
+
+    // Define the start transform.
+    start->setIdentity();
+    if (object->getNode())
+    {
+        Vector3 translation;
+        Quaternion rotation;
+        const Matrix& m = object->getNode()->getWorldMatrix();
+        m.getTranslation(&translation);
+        m.getRotation(&rotation);
+
+        start->setOrigin(BV(translation));
+        start->setRotation(BQ(rotation));
+    }
+
+    return static_cast<btConvexShape*>(shape->getShape());
+}
+
+/**
+ * Tests a ray against the objects of the given broadphase proxies, as the world's ray test
+ * does for the proxies it finds along the ray.
+ */
+static void rayTestProxies(const std::vector<const btBroadphaseProxy*>& proxies, RayTestCallback& callback)
+{
+    btTransform rayFromTrans;
+    rayFromTrans.setIdentity();
+    rayFromTrans.setOrigin(callback.m_rayFromWorld);
+    btTransform rayToTrans;
+    rayToTrans.setIdentity();
+    rayToTrans.setOrigin(callback.m_rayToWorld);
+
+    for (size_t i = 0, count = proxies.size(); i < count; ++i)
+    {
+        // Stop once the ray hits something at its start.
+        if (callback.m_closestHitFraction == 0.0f)
+            break;
+
+        // Skip objects whose bounds the ray does not reach before its closest hit so far.
+        const btBroadphaseProxy* proxy = proxies[i];
+        btScalar fraction = callback.m_closestHitFraction;
+        btVector3 normal;
+        if (!btRayAabb(callback.m_rayFromWorld, callback.m_rayToWorld, proxy->m_aabbMin, proxy->m_aabbMax, fraction, normal))
+            continue;
+
+        btCollisionObject* collisionObject = static_cast<btCollisionObject*>(proxy->m_clientObject);
+        if (callback.needsCollision(collisionObject->getBroadphaseHandle()))
+            btCollisionWorld::rayTestSingle(rayFromTrans, rayToTrans, collisionObject, collisionObject->getCollisionShape(), collisionObject->getWorldTransform(), callback);
+    }
+}
+
+/**
+ * Tests a sweep against the objects of the given broadphase proxies, as the world's sweep test
+ * does for the proxies it finds along the sweep.
+ */
+static void sweepTestProxies(const std::vector<const btBroadphaseProxy*>& proxies, const btConvexShape* shape, const btTransform& start, const btTransform& end,
+                             btScalar allowedPenetration, SweepTestCallback& callback)
+{
+    // The bounds of the shape relative to its origin, by which the bounds of the objects are
+    // extended so that the sweep can be tested against them as a ray from start to end.
+    btVector3 shapeMin, shapeMax;
+    shape->getAabb(start, shapeMin, shapeMax);
+    shapeMin -= start.getOrigin();
+    shapeMax -= start.getOrigin();
+
+    for (size_t i = 0, count = proxies.size(); i < count; ++i)
+    {
+        if (callback.m_closestHitFraction == 0.0f)
+            break;
+
+        const btBroadphaseProxy* proxy = proxies[i];
+        btScalar fraction = callback.m_closestHitFraction;
+        btVector3 normal;
+        if (!btRayAabb(start.getOrigin(), end.getOrigin(), proxy->m_aabbMin - shapeMax, proxy->m_aabbMax - shapeMin, fraction, normal))
+            continue;
+
+        btCollisionObject* collisionObject = static_cast<btCollisionObject*>(proxy->m_clientObject);
+        if (callback.needsCollision(collisionObject->getBroadphaseHandle()))
+            btCollisionWorld::objectQuerySingle(shape, start, end, collisionObject, collisionObject->getCollisionShape(), collisionObject->getWorldTransform(), callback, allowedPenetration);
+    }
+}
 
 PhysicsController::PhysicsController()
   : _isUpdating(false), _collisionConfiguration(NULL), _dispatcher(NULL),
     _overlappingPairCache(NULL), _solver(NULL), _world(NULL), _ghostPairCallback(NULL),
     _debugDrawer(NULL), _status(PhysicsController::Listener::DEACTIVATED), _listeners(NULL),
-    _gravity(btScalar(0.0), btScalar(-9.8), btScalar(0.0)), _collisionCallback(NULL)
+    _gravity(btScalar(0.0), btScalar(-9.8), btScalar(0.0)), _stepRate(60.0f), _maxSubSteps(10), _stepBudget(0.0f),
+    _interpolationEnabled(false), _threadCount(1), _stepAccumulator(0.0), _averageStepTime(0.0f), _stepStartTime(0.0),
+    _collisionFrame(0), _collisionRemovalPending(false)
 {
     // Default gravity is 9.8 along the negative Y axis.
-    _collisionCallback = new CollisionCallback(this);
-
-    addScriptEvent("statusEvent", "[PhysicsController::Listener::EventType]");
+    addScriptEvent(&__statusEvent);
 }
 
 PhysicsController::~PhysicsController()
 {
-    SAFE_DELETE(_collisionCallback);
     SAFE_DELETE(_ghostPairCallback);
     SAFE_DELETE(_debugDrawer);
     SAFE_DELETE(_listeners);
@@ -154,67 +491,84 @@ void PhysicsController::setGravity(const Vector3& gravity)
         _world->setGravity(BV(_gravity));
 }
 
-void PhysicsController::drawDebug(const Matrix& viewProjection)
+float PhysicsController::getStepRate() const
 {
-    GP_ASSERT(_debugDrawer);
-    GP_ASSERT(_world);
-
-    _debugDrawer->begin(viewProjection);
-    _world->debugDrawWorld();
-    _debugDrawer->end();
+    return _stepRate;
 }
 
-bool PhysicsController::rayTest(const Ray& ray, float distance, PhysicsController::HitResult* result, PhysicsController::HitFilter* filter)
+void PhysicsController::setStepRate(float rate)
 {
-    class RayTestCallback : public btCollisionWorld::ClosestRayResultCallback
-    {
-    private:
+    GP_ASSERT(rate > 0.0f);
+    _stepRate = rate;
+}
 
-        HitFilter* filter;
-        HitResult hitResult;
+unsigned int PhysicsController::getMaxSubSteps() const
+{
+    return _maxSubSteps;
+}
 
-    public:
+void PhysicsController::setMaxSubSteps(unsigned int maxSubSteps)
+{
+    GP_ASSERT(maxSubSteps > 0);
+    _maxSubSteps = maxSubSteps;
+}
 
-        RayTestCallback(const btVector3& rayFromWorld, const btVector3& rayToWorld, PhysicsController::HitFilter* filter)
-            : btCollisionWorld::ClosestRayResultCallback(rayFromWorld, rayToWorld), filter(filter)
-        {
-        }
+float PhysicsController::getStepBudget() const
+{
+    return _stepBudget;
+}
 
-        virtual bool needsCollision(btBroadphaseProxy* proxy0) const
-        {
-            if (!btCollisionWorld::ClosestRayResultCallback::needsCollision(proxy0))
-                return false;
+void PhysicsController::setStepBudget(float budget)
+{
+    _stepBudget = budget;
+}
 
-            btCollisionObject* co = reinterpret_cast<btCollisionObject*>(proxy0->m_clientObject);
-            PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(co->getUserPointer());
-            if (object == NULL)
-                return false;
+bool PhysicsController::isInterpolationEnabled() const
+{
+    return _interpolationEnabled;
+}
 
-            return filter ? !filter->filter(object) : true;
-        }
+void PhysicsController::setInterpolationEnabled(bool enabled)
+{
+    if (_interpolationEnabled && !enabled && _world)
+    {
+        // Move the nodes that are still between two states to the last one.
+        interpolateTransforms(1.0f);
+    }
+    _interpolationEnabled = enabled;
+}
 
-        btScalar addSingleResult(btCollisionWorld::LocalRayResult& rayResult, bool normalInWorldSpace)
-        {
-            GP_ASSERT(rayResult.m_collisionObject);
-            PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(rayResult.m_collisionObject->getUserPointer());
+unsigned int PhysicsController::getThreadCount() const
+{
+    return _threadCount;
+}
 
-            if (object == NULL)
-                return 1.0f; // ignore
+void PhysicsController::setThreadCount(unsigned int count)
+{
+    GP_ASSERT(count > 0);
+    _threadCount = count;
 
-            float result = btCollisionWorld::ClosestRayResultCallback::addSingleResult(rayResult, normalInWorldSpace);
+    if (_dispatcher)
+        _dispatcher->setThreadCount(count);
+}
 
-            hitResult.object = object;
-            hitResult.point.set(m_hitPointWorld.x(), m_hitPointWorld.y(), m_hitPointWorld.z());
-            hitResult.fraction = m_closestHitFraction;
-            hitResult.normal.set(m_hitNormalWorld.x(), m_hitNormalWorld.y(), m_hitNormalWorld.z());
+const PhysicsController::StepStatistics& PhysicsController::getStepStatistics() const
+{
+    return _stepStatistics;
+}
 
-            if (filter && !filter->hit(hitResult))
-                return 1.0f; // process next collision
+void PhysicsController::drawDebug(const Matrix& viewProjection)
+{
+    GP_ASSERT(_debugDrawer);
+    GP_ASSERT(_world);
 
-            return result; // continue normally
-        }
-    };
+    _debugDrawer->begin(viewProjection);
+    _world->debugDrawWorld();
+    _debugDrawer->end();
+}
 
+bool PhysicsController::rayTest(const Ray& ray, float distance, PhysicsController::HitResult* result, PhysicsController::HitFilter* filter)
+{
     GP_ASSERT(_world);
 
     btVector3 rayFromWorld(BV(ray.getOrigin()));
@@ -240,77 +594,10 @@ bool PhysicsController::rayTest(const Ray& ray, float distance, PhysicsControlle
 
 bool PhysicsController::sweepTest(PhysicsCollisionObject* object, const Vector3& endPosition, PhysicsController::HitResult* result, PhysicsController::HitFilter* filter)
 {
-    class SweepTestCallback : public btCollisionWorld::ClosestConvexResultCallback
-    {
-    private:
-
-        PhysicsCollisionObject* me;
-        PhysicsController::HitFilter* filter;
-        PhysicsController::HitResult hitResult;
-
-    public:
-
-        SweepTestCallback(PhysicsCollisionObject* me, PhysicsController::HitFilter* filter)
-            : btCollisionWorld::ClosestConvexResultCallback(btVector3(0.0, 0.0, 0.0), btVector3(0.0, 0.0, 0.0)), me(me), filter(filter)
-        {
-        }
-
-        virtual bool needsCollision(btBroadphaseProxy* proxy0) const
-        {
-            if (!btCollisionWorld::ClosestConvexResultCallback::needsCollision(proxy0))
-                return false;
-
-            btCollisionObject* co = reinterpret_cast<btCollisionObject*>(proxy0->m_clientObject);
-            PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(co->getUserPointer());
-            if (object == NULL || object == me)
-                return false;
-
-            return filter ? !filter->filter(object) : true;
-        }
-
-        btScalar addSingleResult(btCollisionWorld::LocalConvexResult& convexResult, bool normalInWorldSpace)
-        {
-            GP_ASSERT(convexResult.m_hitCollisionObject);
-            PhysicsCollisionObject* object = reinterpret_cast<PhysicsCollisionObject*>(convexResult.m_hitCollisionObject->getUserPointer());
-
-            if (object == NULL)
-                return 1.0f;
-
-            float result = ClosestConvexResultCallback::addSingleResult(convexResult, normalInWorldSpace);
-
-            hitResult.object = object;
-            hitResult.point.set(m_hitPointWorld.x(), m_hitPointWorld.y(), m_hitPointWorld.z());
-            hitResult.fraction = m_closestHitFraction;
-            hitResult.normal.set(m_hitNormalWorld.x(), m_hitNormalWorld.y(), m_hitNormalWorld.z());
-
-            if (filter && !filter->hit(hitResult))
-                return 1.0f;
-
-            return result;
-        }
-    };
-
-    GP_ASSERT(object && object->getCollisionShape());
-    PhysicsCollisionShape* shape = object->getCollisionShape();
-    PhysicsCollisionShape::Type type = shape->getType();
-    if (type != PhysicsCollisionShape::SHAPE_BOX && type != PhysicsCollisionShape::SHAPE_SPHERE && type != PhysicsCollisionShape::SHAPE_CAPSULE)
-        return false; // unsupported type
-
-    // Define the start transform.
     btTransform start;
-    start.setIdentity();
-    if (object->getNode())
-    {
-        Vector3 translation;
-        Quaternion rotation;
-        const Matrix& m = object->getNode()->getWorldMatrix();
-        m.getTranslation(&translation);
-        m.getRotation(&rotation);
-
-        start.setIdentity();
-        start.setOrigin(BV(translation));
-        start.setRotation(BQ(rotation));
-    }
+    btConvexShape* shape = getSweepShape(object, &start);
+    if (!shape)
+        return false; // unsupported type
 
     // Define the end transform.
     btTransform end(start);
@@ -326,16 +613,16 @@ bool PhysicsController::sweepTest(PhysicsCollisionObject* object, const Vector3&
     {
     case PhysicsCollisionObject::GHOST_OBJECT:
     case PhysicsCollisionObject::CHARACTER:
-        static_cast<PhysicsGhostObject*>(object)->_ghostObject->convexSweepTest(static_cast<btConvexShape*>(shape->getShape()), start, end, callback, _world->getDispatchInfo().m_allowedCcdPenetration);
+        static_cast<PhysicsGhostObject*>(object)->_ghostObject->convexSweepTest(shape, start, end, callback, _world->getDispatchInfo().m_allowedCcdPenetration);
         break;
 
     default:
-        _world->convexSweepTest(static_cast<btConvexShape*>(shape->getShape()), start, end, callback, _world->getDispatchInfo().m_allowedCcdPenetration);
+        _world->convexSweepTest(shape, start, end, callback, _world->getDispatchInfo().m_allowedCcdPenetration);
         break;
     }*/
 
     GP_ASSERT(_world);
-    _world->convexSweepTest(static_cast<btConvexShape*>(shape->getShape()), start, end, callback, _world->getDispatchInfo().m_allowedCcdPenetration);
+    _world->convexSweepTest(shape, start, end, callback, _world->getDispatchInfo().m_allowedCcdPenetration);
 
     // Check for hits and store results.
     if (callback.hasHit())
@@ -354,83 +641,250 @@ bool PhysicsController::sweepTest(PhysicsCollisionObject* object, const Vector3&
     return false;
 }
 
-btScalar PhysicsController::CollisionCallback::addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* a, int partIdA, int indexA, 
-    const btCollisionObjectWrapper* b, int partIdB, int indexB)
+unsigned int PhysicsController::rayTest(const RayQuery* queries, unsigned int count, PhysicsController::HitResult* results, bool parallel)
+{
+    GP_ASSERT(queries || count == 0);
+    GP_ASSERT(results || count == 0);
+
+    QueryBatch batch;
+    batch.controller = this;
+    batch.rays = queries;
+    batch.sweeps = NULL;
+    batch.sweepShapes = NULL;
+    batch.sweepStarts = NULL;
+    batch.count = count;
+    batch.results = results;
+    batch.parallel = parallel;
+    return runQueryBatch(batch);
+}
+
+unsigned int PhysicsController::sweepTest(const SweepQuery* queries, unsigned int count, PhysicsController::HitResult* results, bool parallel)
 {
-    GP_ASSERT(_pc);
+    GP_ASSERT(queries || count == 0);
+    GP_ASSERT(results || count == 0);
+
+    // Get the start transforms here, since getting the world matrices of nodes may update them.
+    std::vector<btConvexShape*> shapes(count);
+    btAlignedObjectArray<btTransform> starts;
+    starts.resize(count);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        shapes[i] = getSweepShape(queries[i].object, &starts[i]);
+    }
+
+    QueryBatch batch;
+    batch.controller = this;
+    batch.rays = NULL;
+    batch.sweeps = queries;
+    batch.sweepShapes = count ? &shapes[0] : NULL;
+    batch.sweepStarts = count ? &starts[0] : NULL;
+    batch.count = count;
+    batch.results = results;
+    batch.parallel = parallel;
+    return runQueryBatch(batch);
+}
 
-    // Get pointers to the PhysicsCollisionObject objects.
-    PhysicsCollisionObject* objectA = _pc->getCollisionObject(a->m_collisionObject);
-    PhysicsCollisionObject* objectB = _pc->getCollisionObject(b->m_collisionObject);
+unsigned int PhysicsController::runQueryBatch(QueryBatch& batch)
+{
+    GP_ASSERT(_world);
 
-    // If the given collision object pair has collided in the past, then
-    // we notify the listeners only if the pair was not colliding
-    // during the previous frame. Otherwise, it's a new pair, so add a
-    // new entry to the cache with the appropriate listeners and notify them.
-    PhysicsCollisionObject::CollisionPair pair(objectA, objectB);
+    unsigned int groupCount = (batch.count + QUERY_GROUP_SIZE - 1) / QUERY_GROUP_SIZE;
+    if (batch.parallel)
+    {
+        Game::getInstance()->getJobScheduler()->parallelFor(groupCount, &queryJob, &batch);
+    }
+    else
+    {
+        for (unsigned int i = 0; i < groupCount; ++i)
+        {
+            queryJob(i, &batch);
+        }
+    }
 
-    CollisionInfo* collisionInfo;
-    if (_pc->_collisionStatus.count(pair) > 0)
+    unsigned int hitCount = 0;
+    for (unsigned int i = 0; i < batch.count; ++i)
     {
-        collisionInfo = &_pc->_collisionStatus[pair];
+        if (batch.results[i].object)
+            ++hitCount;
     }
+    return hitCount;
+}
+
+void PhysicsController::queryJob(unsigned int index, void* cookie)
+{
+    QueryBatch* batch = (QueryBatch*)cookie;
+    GP_ASSERT(batch && batch->controller);
+
+    unsigned int first = index * QUERY_GROUP_SIZE;
+    unsigned int count = std::min(batch->count - first, (unsigned int)QUERY_GROUP_SIZE);
+    if (batch->rays)
+        batch->controller->rayTestGroup(*batch, first, count);
     else
+        batch->controller->sweepTestGroup(*batch, first, count);
+}
+
+void PhysicsController::rayTestGroup(const QueryBatch& batch, unsigned int first, unsigned int count)
+{
+    GP_ASSERT(_world && _world->getBroadphase());
+
+    // Find the objects within the bounds of all the rays of the group.
+    btVector3 groupMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+    btVector3 groupMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+    for (unsigned int i = first, last = first + count; i < last; ++i)
+    {
+        const RayQuery& query = batch.rays[i];
+        btVector3 rayFromWorld(BV(query.ray.getOrigin()));
+        btVector3 rayToWorld(rayFromWorld + BV(query.ray.getDirection() * query.distance));
+        groupMin.setMin(rayFromWorld);
+        groupMin.setMin(rayToWorld);
+        groupMax.setMax(rayFromWorld);
+        groupMax.setMax(rayToWorld);
+    }
+
+    std::vector<const btBroadphaseProxy*> proxies;
+    ProxyCollector collector(proxies);
+    _world->getBroadphase()->aabbTest(groupMin, groupMax, collector);
+
+    // Rays that are far apart bound many more objects together than each of them passes
+    // near, in which case each ray is tested on its own.
+    bool shared = proxies.size() <= QUERY_GROUP_PROXIES;
+
+    for (unsigned int i = first, last = first + count; i < last; ++i)
     {
-        // Add a new collision pair for these objects.
-        collisionInfo = &_pc->_collisionStatus[pair];
+        const RayQuery& query = batch.rays[i];
+        btVector3 rayFromWorld(BV(query.ray.getOrigin()));
+        btVector3 rayToWorld(rayFromWorld + BV(query.ray.getDirection() * query.distance));
 
-        // Add the appropriate listeners.
-        PhysicsCollisionObject::CollisionPair p1(pair.objectA, NULL);
-        if (_pc->_collisionStatus.count(p1) > 0)
+        RayTestCallback callback(rayFromWorld, rayToWorld, query.filter);
+        if (shared)
         {
-            const CollisionInfo& ci = _pc->_collisionStatus[p1];
-            std::vector<PhysicsCollisionObject::CollisionListener*>::const_iterator iter = ci._listeners.begin();
-            for (; iter != ci._listeners.end(); iter++)
-            {
-                GP_ASSERT(*iter);
-                collisionInfo->_listeners.push_back(*iter);
-            }
+            rayTestProxies(proxies, callback);
         }
-        PhysicsCollisionObject::CollisionPair p2(pair.objectB, NULL);
-        if (_pc->_collisionStatus.count(p2) > 0)
+        else if (!batch.parallel)
         {
-            const CollisionInfo& ci = _pc->_collisionStatus[p2];
-            std::vector<PhysicsCollisionObject::CollisionListener*>::const_iterator iter = ci._listeners.begin();
-            for (; iter != ci._listeners.end(); iter++)
-            {
-                GP_ASSERT(*iter);
-                collisionInfo->_listeners.push_back(*iter);
-            }
+            _world->rayTest(rayFromWorld, rayToWorld, callback);
+        }
+        else
+        {
+            // The broadphase's own ray test keeps its traversal stack in the broadphase,
+            // so it is not safe to use on several threads at once.
+            btVector3 rayMin(rayFromWorld);
+            btVector3 rayMax(rayFromWorld);
+            rayMin.setMin(rayToWorld);
+            rayMax.setMax(rayToWorld);
+            proxies.clear();
+            _world->getBroadphase()->aabbTest(rayMin, rayMax, collector);
+            rayTestProxies(proxies, callback);
+        }
+
+        HitResult& result = batch.results[i];
+        if (callback.hasHit())
+        {
+            result.object = getCollisionObject(callback.m_collisionObject);
+            result.point.set(callback.m_hitPointWorld.x(), callback.m_hitPointWorld.y(), callback.m_hitPointWorld.z());
+            result.fraction = callback.m_closestHitFraction;
+            result.normal.set(callback.m_hitNormalWorld.x(), callback.m_hitNormalWorld.y(), callback.m_hitNormalWorld.z());
+        }
+        else
+        {
+            result.object = NULL;
+            result.point.set(0.0f, 0.0f, 0.0f);
+            result.fraction = 1.0f;
+            result.normal.set(0.0f, 0.0f, 0.0f);
         }
     }
+}
+
+void PhysicsController::sweepTestGroup(const QueryBatch& batch, unsigned int first, unsigned int count)
+{
+    GP_ASSERT(_world && _world->getBroadphase());
+
+    // Find the objects within the bounds of all the sweeps of the group.
+    btVector3 groupMin(BT_LARGE_FLOAT, BT_LARGE_FLOAT, BT_LARGE_FLOAT);
+    btVector3 groupMax(-BT_LARGE_FLOAT, -BT_LARGE_FLOAT, -BT_LARGE_FLOAT);
+    for (unsigned int i = first, last = first + count; i < last; ++i)
+    {
+        const btConvexShape* shape = batch.sweepShapes[i];
+        if (!shape)
+            continue;
+
+        btTransform start(batch.sweepStarts[i]);
+        btTransform end(start);
+        end.setOrigin(BV(batch.sweeps[i].endPosition));
+
+        btVector3 shapeMin, shapeMax;
+        shape->getAabb(start, shapeMin, shapeMax);
+        groupMin.setMin(shapeMin);
+        groupMax.setMax(shapeMax);
+        shape->getAabb(end, shapeMin, shapeMax);
+        groupMin.setMin(shapeMin);
+        groupMax.setMax(shapeMax);
+    }
+
+    std::vector<const btBroadphaseProxy*> proxies;
+    ProxyCollector collector(proxies);
+    if (groupMin.x() <= groupMax.x())
+        _world->getBroadphase()->aabbTest(groupMin, groupMax, collector);
+
+    bool shared = proxies.size() <= QUERY_GROUP_PROXIES;
+    btScalar allowedPenetration = _world->getDispatchInfo().m_allowedCcdPenetration;
 
-    // Fire collision event.
-    if ((collisionInfo->_status & COLLISION) == 0)
+    for (unsigned int i = first, last = first + count; i < last; ++i)
     {
-        std::vector<PhysicsCollisionObject::CollisionListener*>::const_iterator iter = collisionInfo->_listeners.begin();
-        for (; iter != collisionInfo->_listeners.end(); iter++)
+        const SweepQuery& query = batch.sweeps[i];
+        const btConvexShape* shape = batch.sweepShapes[i];
+        SweepTestCallback callback(query.object, query.filter);
+        if (shape)
         {
-            GP_ASSERT(*iter);
-            if ((collisionInfo->_status & REMOVE) == 0)
+            btTransform start(batch.sweepStarts[i]);
+            btTransform end(start);
+            end.setOrigin(BV(query.endPosition));
+
+            if (shared)
+            {
+                sweepTestProxies(proxies, shape, start, end, allowedPenetration, callback);
+            }
+            else if (!batch.parallel)
+            {
+                _world->convexSweepTest(shape, start, end, callback, allowedPenetration);
+            }
+            else
             {
-                (*iter)->collisionEvent(PhysicsCollisionObject::CollisionListener::COLLIDING, pair, Vector3(cp.getPositionWorldOnA().x(), cp.getPositionWorldOnA().y(), cp.getPositionWorldOnA().z()),
-                    Vector3(cp.getPositionWorldOnB().x(), cp.getPositionWorldOnB().y(), cp.getPositionWorldOnB().z()));
+                // As with rays, the world's sweep test uses the broadphase's ray test.
+                btVector3 sweepMin, sweepMax, shapeMin, shapeMax;
+                shape->getAabb(start, sweepMin, sweepMax);
+                shape->getAabb(end, shapeMin, shapeMax);
+                sweepMin.setMin(shapeMin);
+                sweepMax.setMax(shapeMax);
+                proxies.clear();
+                _world->getBroadphase()->aabbTest(sweepMin, sweepMax, collector);
+                sweepTestProxies(proxies, shape, start, end, allowedPenetration, callback);
             }
         }
-    }
 
-    // Update the collision status cache (we remove the dirty bit
-    // set in the controller's update so that this particular collision pair's
-    // status is not reset to 'no collision' when the controller's update completes).
-    collisionInfo->_status &= ~DIRTY;
-    collisionInfo->_status |= COLLISION;
-    return 0.0f;
+        HitResult& result = batch.results[i];
+        if (callback.hasHit())
+        {
+            result.object = getCollisionObject(callback.m_hitCollisionObject);
+            result.point.set(callback.m_hitPointWorld.x(), callback.m_hitPointWorld.y(), callback.m_hitPointWorld.z());
+            result.fraction = callback.m_closestHitFraction;
+            result.normal.set(callback.m_hitNormalWorld.x(), callback.m_hitNormalWorld.y(), callback.m_hitNormalWorld.z());
+        }
+        else
+        {
+            result.object = NULL;
+            result.point.set(0.0f, 0.0f, 0.0f);
+            result.fraction = 1.0f;
+            result.normal.set(0.0f, 0.0f, 0.0f);
+        }
+    }
 }
 
 void PhysicsController::initialize()
 {
-    _collisionConfiguration = bullet_new<btDefaultCollisionConfiguration>();
-    _dispatcher = bullet_new<btCollisionDispatcher>(_collisionConfiguration);
+    _collisionConfiguration = bullet_new<CollisionConfiguration>();
+    _dispatcher = bullet_new<CollisionDispatcher>(_collisionConfiguration);
+    _dispatcher->setThreadCount(_threadCount);
     _overlappingPairCache = bullet_new<btDbvtBroadphase>();
     _solver = bullet_new<btSequentialImpulseConstraintSolver>();
 
@@ -444,6 +898,12 @@ void PhysicsController::initialize()
     _world->getPairCache()->setInternalGhostPairCallback(_ghostPairCallback);
     _world->getDispatchInfo().m_allowedCcdPenetration = 0.0001f;
 
+    // Time each simulation step.
+    _world->setInternalTickCallback(&stepCallback, this);
+    _stepAccumulator = 0.0;
+    _averageStepTime = 0.0f;
+    memset(&_stepStatistics, 0, sizeof(_stepStatistics));
+
     // Set up debug drawing.
     _debugDrawer = new DebugDrawer();
     _world->setDebugDrawer(_debugDrawer);
@@ -475,15 +935,11 @@ void PhysicsController::update(float elapsedTime)
     GP_ASSERT(_world);
     _isUpdating = true;
 
-    // Update the physics simulation, with a maximum
-    // of 10 simulation steps being performed in a given frame.
-    //
-    // Note that stepSimulation takes elapsed time in seconds
-    // so we divide by 1000 to convert from milliseconds.
-    _world->stepSimulation(elapsedTime * 0.001f, 10);
+    // Update the physics simulation.
+    stepSimulation(elapsedTime);
 
     // If we have status listeners, then check if our status has changed.
-    if (_listeners || _callbacks["statusEvent"])
+    if (_listeners || hasScriptCallbacks())
     {
         Listener::EventType oldStatus = _status;
 
@@ -528,68 +984,17 @@ void PhysicsController::update(float elapsedTime)
                 }
             }
 
-            fireScriptEvent<void>("statusEvent", _status);
-        }
-    }
-
-    // All statuses are set with the DIRTY bit before collision processing occurs.
-    // During collision processing, if a collision occurs, the status is 
-    // set to COLLISION and the DIRTY bit is cleared. Then, after collision processing 
-    // is finished, if a given status is still dirty, the COLLISION bit is cleared.
-    //
-    // If an entry was marked for removal in the last frame, remove it now.
-
-    // Dirty the collision status cache entries.
-    std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo>::iterator iter = _collisionStatus.begin();
-    for (; iter != _collisionStatus.end();)
-    {
-        if ((iter->second._status & REMOVE) != 0)
-        {
-            std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo>::iterator eraseIter = iter;
-            iter++;
-            _collisionStatus.erase(eraseIter);
-        }
-        else
-        {
-            iter->second._status |= DIRTY;
-            iter++;
-        }
-    }
-
-    // Go through the collision status cache and perform all registered collision tests.
-    iter = _collisionStatus.begin();
-    for (; iter != _collisionStatus.end(); iter++)
-    {
-        // If this collision pair was one that was registered for listening, then perform the collision test.
-        // (In the case where we register for all collisions with a rigid body, there will be a lot
-        // of collision pairs in the status cache that we did not explicitly register for.)
-        if ((iter->second._status & REGISTERED) != 0 && (iter->second._status & REMOVE) == 0)
-        {
-            if (iter->first.objectB)
-                _world->contactPairTest(iter->first.objectA->getCollisionObject(), iter->first.objectB->getCollisionObject(), *_collisionCallback);
-            else
-                _world->contactTest(iter->first.objectA->getCollisionObject(), *_collisionCallback);
+            fireScriptEvent<void>(&__statusEvent, _status);
         }
     }
 
-    // Update all the collision status cache entries.
-    iter = _collisionStatus.begin();
-    for ( ; iter != _collisionStatus.end(); iter++)
-    {
-        if ((iter->second._status & DIRTY) != 0)
-        {
-            if ((iter->second._status & COLLISION) != 0 && iter->first.objectB)
-            {
-                size_t size = iter->second._listeners.size();
-                for (size_t i = 0; i < size; i++)
-                {
-                    iter->second._listeners[i]->collisionEvent(PhysicsCollisionObject::CollisionListener::NOT_COLLIDING, iter->first);
-                }
-            }
+    // Erase the collision status cache entries that were marked for removal since the last update.
+    if (_collisionRemovalPending)
+        removeCollisionInfos();
 
-            iter->second._status &= ~COLLISION;
-        }
-    }
+    // Find the pairs that started or stopped colliding, and notify their listeners.
+    updateCollisionStatus();
+    fireCollisionEvents();
 
     _isUpdating = false;
 }
@@ -600,10 +1005,12 @@ void PhysicsController::addCollisionListener(PhysicsCollisionObject::CollisionLi
     
     // One of the collision objects in the pair must be non-null.
     GP_ASSERT(objectA || objectB);
-    PhysicsCollisionObject::CollisionPair pair(objectA, objectB);
 
     // Add the listener and ensure the status includes that this collision pair is registered.
-    CollisionInfo& info = _collisionStatus[pair];
+    int index = findCollisionInfo(objectA, objectB);
+    if (index < 0)
+        index = (int)addCollisionInfo(objectA, objectB);
+    CollisionInfo& info = _collisionStatus[index];
     info._listeners.push_back(listener);
     info._status |= PhysicsController::REGISTERED;
 }
@@ -612,12 +1019,25 @@ void PhysicsController::removeCollisionListener(PhysicsCollisionObject::Collisio
 {
     // One of the collision objects in the pair must be non-null.
     GP_ASSERT(objectA || objectB);
-    PhysicsCollisionObject::CollisionPair pair(objectA, objectB);
 
     // Mark the collision pair for these objects for removal.
-    if (_collisionStatus.count(pair) > 0)
+    int index = findCollisionInfo(objectA, objectB);
+    if (index < 0)
+        return;
+    _collisionStatus[index]._status |= REMOVE;
+    _collisionRemovalPending = true;
+
+    // The pairs that were added because they collided with an object registered for all of
+    // its collisions were only tracked on behalf of that registration, so they go with it.
+    if (!objectA || !objectB)
     {
-        _collisionStatus[pair]._status |= REMOVE;
+        PhysicsCollisionObject* object = objectA ? objectA : objectB;
+        for (size_t i = 0, count = _collisionStatus.size(); i < count; ++i)
+        {
+            CollisionInfo& info = _collisionStatus[i];
+            if ((info._status & REGISTERED) == 0 && (info._pair.objectA == object || info._pair.objectB == object))
+                info._status |= REMOVE;
+        }
     }
 }
 
@@ -675,16 +1095,27 @@ void PhysicsController::removeCollisionObject(PhysicsCollisionObject* object, bo
             GP_ERROR("Unsupported collision object type (%d).", object->getType());
             break;
         }
+
+        // Once the world is empty, reset the broadphase and the solver, so that objects added
+        // again (such as those of a scene that is reloaded) are simulated the same way.
+        if (_world->getNumCollisionObjects() == 0)
+        {
+            _overlappingPairCache->resetPool(_dispatcher);
+            _solver->reset();
+        }
     }
 
     // Find all references to the object in the collision status cache and mark them for removal.
     if (removeListeners)
     {
-        std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo>::iterator iter = _collisionStatus.begin();
-        for (; iter != _collisionStatus.end(); iter++)
+        for (size_t i = 0, count = _collisionStatus.size(); i < count; ++i)
         {
-            if (iter->first.objectA == object || iter->first.objectB == object)
-                iter->second._status |= REMOVE;
+            CollisionInfo& info = _collisionStatus[i];
+            if (info._pair.objectA == object || info._pair.objectB == object)
+            {
+                info._status |= REMOVE;
+                _collisionRemovalPending = true;
+            }
         }
     }
 }
@@ -696,6 +1127,316 @@ PhysicsCollisionObject* PhysicsController::getCollisionObject(const btCollisionO
     return reinterpret_cast<PhysicsCollisionObject*>(collisionObject->getUserPointer());
 }
 
+void PhysicsController::stepSimulation(float elapsedTime)
+{
+    GP_ASSERT(_world);
+    GP_ASSERT(_stepRate > 0.0f);
+
+    _stepStatistics.steps = 0;
+    _stepStatistics.droppedSteps = 0;
+    _stepStatistics.simulationTime = 0.0f;
+    _stepStatistics.stepTime = 0.0f;
+    _stepStatistics.maxStepTime = 0.0f;
+
+    // Find the number of steps due, and how many of them can be simulated in this update. Elapsed
+    // times that add up to a whole step should make it due despite rounding, hence the tolerance.
+    double stepTime = 1000.0 / _stepRate;
+    _stepAccumulator += elapsedTime;
+    unsigned int dueSteps = (unsigned int)(_stepAccumulator / stepTime + STEP_TOLERANCE);
+    unsigned int steps = std::min(dueSteps, _maxSubSteps);
+    if (_stepBudget > 0.0f && steps > 1 && _averageStepTime > 0.0f)
+    {
+        unsigned int affordableSteps = (unsigned int)(_stepBudget / _averageStepTime);
+        steps = std::min(steps, std::max(affordableSteps, 1u));
+    }
+
+    // The time of the steps left out is dropped, so that a slow frame slows the simulation
+    // down instead of making the next updates simulate even more steps.
+    _stepAccumulator -= dueSteps * stepTime;
+    _stepStatistics.droppedSteps = dueSteps - steps;
+
+    if (steps > 0)
+    {
+        // Bullet simulates one fixed step for each whole step of the time it has accumulated,
+        // up to the given number of substeps, and carries the rest over. Giving it half a step
+        // more than the steps wanted keeps rounding from losing one; the count is clamped to
+        // the steps wanted, and the time it carries over stays under one step.
+        //
+        // Note that stepSimulation takes time in seconds.
+        btScalar fixedTimeStep = (btScalar)(stepTime * 0.001);
+        double startTime = Game::getAbsoluteTime();
+        _stepStartTime = startTime;
+        _world->stepSimulation(fixedTimeStep * (steps + 0.5f), (int)steps, fixedTimeStep);
+
+        _stepStatistics.steps = steps;
+        _stepStatistics.totalSteps += steps;
+        _stepStatistics.simulationTime = (float)(Game::getAbsoluteTime() - startTime);
+        _stepStatistics.stepTime = _stepStatistics.simulationTime / steps;
+        if (_averageStepTime > 0.0f)
+            _averageStepTime += (_stepStatistics.stepTime - _averageStepTime) * STEP_TIME_SMOOTHING;
+        else
+            _averageStepTime = _stepStatistics.stepTime;
+    }
+    else
+    {
+        // Bullet clears the forces applied to bodies at the end of each simulation, so the
+        // forces applied before an update without a step are cleared as well.
+        _world->clearForces();
+    }
+
+    if (_interpolationEnabled)
+    {
+        _stepStatistics.interpolation = std::max((float)(_stepAccumulator / stepTime), 0.0f);
+        interpolateTransforms(_stepStatistics.interpolation);
+    }
+    else
+    {
+        _stepStatistics.interpolation = 1.0f;
+    }
+}
+
+void PhysicsController::interpolateTransforms(float alpha)
+{
+    GP_ASSERT(_world);
+
+    for (int i = 0, count = _world->getNumCollisionObjects(); i < count; ++i)
+    {
+        btRigidBody* body = btRigidBody::upcast(_world->getCollisionObjectArray()[i]);
+        if (body && body->getMotionState() && !body->isStaticOrKinematicObject())
+        {
+            PhysicsCollisionObject* object = getCollisionObject(body);
+            GP_ASSERT(object && object->_motionState);
+            object->_motionState->interpolate(alpha);
+        }
+    }
+}
+
+void PhysicsController::stepCallback(btDynamicsWorld* world, btScalar timeStep)
+{
+    GP_ASSERT(world);
+    PhysicsController* controller = static_cast<PhysicsController*>(world->getWorldUserInfo());
+    GP_ASSERT(controller);
+
+    double time = Game::getAbsoluteTime();
+    float stepTime = (float)(time - controller->_stepStartTime);
+    controller->_stepStartTime = time;
+    if (stepTime > controller->_stepStatistics.maxStepTime)
+        controller->_stepStatistics.maxStepTime = stepTime;
+}
+
+int PhysicsController::findCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB) const
+{
+    if (_collisionIndex.empty())
+        return -1;
+
+    unsigned int mask = (unsigned int)_collisionIndex.size() - 1;
+    for (unsigned int slot = hashCollisionPair(objectA, objectB) & mask; _collisionIndex[slot] != 0; slot = (slot + 1) & mask)
+    {
+        unsigned int index = _collisionIndex[slot] - 1;
+        const PhysicsCollisionObject::CollisionPair& pair = _collisionStatus[index]._pair;
+        if ((pair.objectA == objectA && pair.objectB == objectB) || (pair.objectA == objectB && pair.objectB == objectA))
+            return (int)index;
+    }
+    return -1;
+}
+
+unsigned int PhysicsController::addCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB)
+{
+    unsigned int index = (unsigned int)_collisionStatus.size();
+    _collisionStatus.push_back(CollisionInfo(PhysicsCollisionObject::CollisionPair(objectA, objectB)));
+
+    // Keep the table at most half full.
+    if (_collisionIndex.size() < _collisionStatus.size() * 2)
+    {
+        buildCollisionIndex();
+    }
+    else
+    {
+        unsigned int mask = (unsigned int)_collisionIndex.size() - 1;
+        unsigned int slot = hashCollisionPair(objectA, objectB) & mask;
+        while (_collisionIndex[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        _collisionIndex[slot] = index + 1;
+    }
+    return index;
+}
+
+void PhysicsController::buildCollisionIndex()
+{
+    unsigned int count = (unsigned int)_collisionStatus.size();
+    unsigned int tableSize = 64;
+    while (tableSize < count * 2)
+        tableSize <<= 1;
+
+    _collisionIndex.assign(tableSize, 0);
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        const PhysicsCollisionObject::CollisionPair& pair = _collisionStatus[i]._pair;
+        unsigned int slot = hashCollisionPair(pair.objectA, pair.objectB) & (tableSize - 1);
+        while (_collisionIndex[slot] != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        _collisionIndex[slot] = i + 1;
+    }
+}
+
+void PhysicsController::removeCollisionInfos()
+{
+    // Compact the remaining entries, which moves them, so the colliding pairs are found again too.
+    unsigned int count = 0;
+    _collidingPairs.clear();
+    for (unsigned int i = 0, size = (unsigned int)_collisionStatus.size(); i < size; ++i)
+    {
+        if ((_collisionStatus[i]._status & REMOVE) != 0)
+            continue;
+
+        if (count != i)
+            _collisionStatus[count] = _collisionStatus[i];
+        if ((_collisionStatus[count]._status & COLLISION) != 0)
+            _collidingPairs.push_back(count);
+        ++count;
+    }
+    _collisionStatus.erase(_collisionStatus.begin() + count, _collisionStatus.end());
+
+    buildCollisionIndex();
+    _collisionRemovalPending = false;
+}
+
+void PhysicsController::updateCollisionStatus()
+{
+    GP_ASSERT(_dispatcher);
+
+    if (_collisionStatus.empty())
+        return;
+
+    // Rather than testing each registered pair for contacts again, read the contacts that the
+    // simulation step found from the persistent manifolds of the colliding pairs. Entries found
+    // in contact are stamped with the current frame; the ones that were colliding in the last
+    // update but are not stamped have stopped colliding.
+    ++_collisionFrame;
+
+    for (int i = 0, count = _dispatcher->getNumManifolds(); i < count; ++i)
+    {
+        const btPersistentManifold* manifold = _dispatcher->getManifoldByIndexInternal(i);
+        GP_ASSERT(manifold);
+        if (manifold->getNumContacts() == 0)
+            continue;
+
+        const btCollisionObject* body0 = static_cast<const btCollisionObject*>(manifold->getBody0());
+        PhysicsCollisionObject* objectA = getCollisionObject(body0);
+        PhysicsCollisionObject* objectB = getCollisionObject(static_cast<const btCollisionObject*>(manifold->getBody1()));
+        if (!objectA || !objectB)
+            continue;
+
+        int index = findCollisionInfo(objectA, objectB);
+        if (index < 0)
+        {
+            // The pair was not registered, so it is only tracked if one of its objects is registered
+            // for all of its collisions. The new entry gets the listeners of both registrations, and
+            // lists a registered object first.
+            int indexA = findCollisionInfo(objectA, NULL);
+            if (indexA >= 0 && (_collisionStatus[indexA]._status & REMOVE) != 0)
+                indexA = -1;
+            int indexB = findCollisionInfo(objectB, NULL);
+            if (indexB >= 0 && (_collisionStatus[indexB]._status & REMOVE) != 0)
+                indexB = -1;
+            if (indexA < 0 && indexB < 0)
+                continue;
+
+            if (indexA >= 0)
+                index = (int)addCollisionInfo(objectA, objectB);
+            else
+                index = (int)addCollisionInfo(objectB, objectA);
+
+            CollisionInfo& info = _collisionStatus[index];
+            if (indexA >= 0)
+                info._listeners = _collisionStatus[indexA]._listeners;
+            if (indexB >= 0)
+                info._listeners.insert(info._listeners.end(), _collisionStatus[indexB]._listeners.begin(), _collisionStatus[indexB]._listeners.end());
+        }
+
+        // A pair can have several manifolds (for example with compound shapes); only the first one counts.
+        CollisionInfo& info = _collisionStatus[index];
+        if ((info._status & REMOVE) != 0 || info._frame == _collisionFrame)
+            continue;
+        info._frame = _collisionFrame;
+
+        if ((info._status & COLLISION) == 0)
+        {
+            info._status |= COLLISION;
+            _collidingPairs.push_back(index);
+
+            // Report the deepest contact point, with the points ordered as the objects of the pair.
+            int deepest = 0;
+            for (int j = 1, contactCount = manifold->getNumContacts(); j < contactCount; ++j)
+            {
+                if (manifold->getContactPoint(j).getDistance() < manifold->getContactPoint(deepest).getDistance())
+                    deepest = j;
+            }
+            const btManifoldPoint& point = manifold->getContactPoint(deepest);
+            bool swapped = info._pair.objectA->getCollisionObject() != body0;
+            const btVector3& pointA = swapped ? point.getPositionWorldOnB() : point.getPositionWorldOnA();
+            const btVector3& pointB = swapped ? point.getPositionWorldOnA() : point.getPositionWorldOnB();
+
+            CollisionEvent event;
+            event.index = index;
+            event.type = PhysicsCollisionObject::CollisionListener::COLLIDING;
+            event.contactPointA.set(pointA.x(), pointA.y(), pointA.z());
+            event.contactPointB.set(pointB.x(), pointB.y(), pointB.z());
+            _collisionEvents.push_back(event);
+        }
+    }
+
+    // Only the pairs that were colliding need to be checked for the end of their contact.
+    size_t colliding = 0;
+    for (size_t i = 0, count = _collidingPairs.size(); i < count; ++i)
+    {
+        unsigned int index = _collidingPairs[i];
+        CollisionInfo& info = _collisionStatus[index];
+        if (info._frame == _collisionFrame)
+        {
+            _collidingPairs[colliding++] = index;
+            continue;
+        }
+
+        info._status &= ~COLLISION;
+
+        CollisionEvent event;
+        event.index = index;
+        event.type = PhysicsCollisionObject::CollisionListener::NOT_COLLIDING;
+        _collisionEvents.push_back(event);
+    }
+    _collidingPairs.resize(colliding);
+}
+
+void PhysicsController::fireCollisionEvents()
+{
+    for (size_t i = 0; i < _collisionEvents.size(); ++i)
+    {
+        const CollisionEvent& event = _collisionEvents[i];
+
+        // Listeners may add listeners of their own, which can move the cache entries, so the entry
+        // is looked up again for each call. Listeners added by these calls are notified from the
+        // next update on.
+        size_t listenerCount = _collisionStatus[event.index]._listeners.size();
+        for (size_t j = 0; j < listenerCount; ++j)
+        {
+            const CollisionInfo& info = _collisionStatus[event.index];
+            if ((info._status & REMOVE) != 0)
+                break;
+
+            PhysicsCollisionObject::CollisionListener* listener = info._listeners[j];
+            GP_ASSERT(listener);
+            PhysicsCollisionObject::CollisionPair pair = info._pair;
+            listener->collisionEvent(event.type, pair, event.contactPointA, event.contactPointB);
+        }
+    }
+    _collisionEvents.clear();
+}
+
 static void getBoundingBox(Node* node, BoundingBox* out, bool merge = false)
 {
     GP_ASSERT(node);
@@ -1083,37 +1824,92 @@ PhysicsCollisionShape* PhysicsController::createMesh(Mesh* mesh, const Vector3&
 
     // The mesh must have a valid URL (i.e. it must have been loaded from a Bundle)
     // in order to fetch mesh data for computing mesh rigid body.
-    if (strlen(mesh->getUrl()) == 0)
+    const char* url = mesh->getUrl();
+    if (strlen(url) == 0)
     {
         GP_ERROR("Cannot create mesh rigid body for mesh without valid URL.");
         return NULL;
     }
 
-    Bundle::MeshData* data = Bundle::readMeshData(mesh->getUrl());
+    // Return the mesh shape from the cache if it already exists.
+    PhysicsCollisionShape* shape = findMeshShape(url, scale);
+    if (shape)
+    {
+        shape->addRef();
+        return shape;
+    }
+
+    // Building the triangle data and BVH of a mesh is expensive, so it is only done once per mesh,
+    // without scaling. Shapes for other scales wrap the unscaled shape and share its BVH.
+    if (scale == Vector3::one())
+        return createMeshShape(url);
+
+    PhysicsCollisionShape* source = findMeshShape(url, Vector3::one());
+    if (source)
+        source->addRef();
+    else
+        source = createMeshShape(url);
+    if (!source)
+        return NULL;
+
+    PhysicsCollisionShape::MeshData* shapeMeshData = new PhysicsCollisionShape::MeshData();
+    shapeMeshData->vertexData = NULL;
+    shapeMeshData->url = url;
+    shapeMeshData->scale = scale;
+    shapeMeshData->source = source;
+
+    btBvhTriangleMeshShape* sourceShape = static_cast<btBvhTriangleMeshShape*>(source->_shape);
+    shape = new PhysicsCollisionShape(PhysicsCollisionShape::SHAPE_MESH, bullet_new<btScaledBvhTriangleMeshShape>(sourceShape, BV(scale)));
+    shape->_shapeData.meshData = shapeMeshData;
+
+    _shapes.push_back(shape);
+
+    return shape;
+}
+
+PhysicsCollisionShape* PhysicsController::findMeshShape(const char* url, const Vector3& scale) const
+{
+    GP_ASSERT(url);
+
+    for (size_t i = 0, count = _shapes.size(); i < count; ++i)
+    {
+        PhysicsCollisionShape* shape = _shapes[i];
+        GP_ASSERT(shape);
+        if (shape->getType() == PhysicsCollisionShape::SHAPE_MESH)
+        {
+            const PhysicsCollisionShape::MeshData* meshData = shape->_shapeData.meshData;
+            if (meshData && meshData->scale == scale && meshData->url == url)
+                return shape;
+        }
+    }
+    return NULL;
+}
+
+PhysicsCollisionShape* PhysicsController::createMeshShape(const char* url)
+{
+    GP_ASSERT(url);
+
+    Bundle::MeshData* data = Bundle::readMeshData(url);
     if (data == NULL)
     {
-        GP_ERROR("Failed to load mesh data from url '%s'.", mesh->getUrl());
+        GP_ERROR("Failed to load mesh data from url '%s'.", url);
         return NULL;
     }
 
     // Create mesh data to be populated and store in returned collision shape.
     PhysicsCollisionShape::MeshData* shapeMeshData = new PhysicsCollisionShape::MeshData();
     shapeMeshData->vertexData = NULL;
+    shapeMeshData->url = url;
+    shapeMeshData->scale = Vector3::one();
+    shapeMeshData->source = NULL;
 
-    // Copy the scaled vertex position data to the rigid body's local buffer.
-    Matrix m;
-    Matrix::createScale(scale, &m);
+    // Copy the vertex position data to the rigid body's local buffer.
     unsigned int vertexCount = data->vertexCount;
     shapeMeshData->vertexData = new float[vertexCount * 3];
-    Vector3 v;
     int vertexStride = data->vertexFormat.getVertexSize();
     for (unsigned int i = 0; i < data->vertexCount; i++)
     {
-        v.set(*((float*)&data->vertexData[i * vertexStride + 0 * sizeof(float)]),
-              *((float*)&data->vertexData[i * vertexStride + 1 * sizeof(float)]),
-              *((float*)&data->vertexData[i * vertexStride + 2 * sizeof(float)]));
-        v *= m;
-        memcpy(&(shapeMeshData->vertexData[i * 3]), &v, sizeof(float) * 3);
+        memcpy(&(shapeMeshData->vertexData[i * 3]), &data->vertexData[i * vertexStride], sizeof(float) * 3);
     }
 
     btTriangleIndexVertexArray* meshInterface = bullet_new<btTriangleIndexVertexArray>();
@@ -1214,16 +2010,23 @@ void PhysicsController::destroyShape(PhysicsCollisionShape* shape)
 {
     if (shape)
     {
+        PhysicsCollisionShape* source = NULL;
         if (shape->getRefCount() == 1)
         {
             // Remove shape from shape cache.
             std::vector<PhysicsCollisionShape*>::iterator shapeItr = std::find(_shapes.begin(), _shapes.end(), shape);
             if (shapeItr != _shapes.end())
                 _shapes.erase(shapeItr);
+
+            // A scaled mesh shape holds a reference to the unscaled shape it wraps.
+            if (shape->getType() == PhysicsCollisionShape::SHAPE_MESH && shape->_shapeData.meshData)
+                source = shape->_shapeData.meshData->source;
         }
 
         // Release the shape.
         shape->release();
+
+        destroyShape(source);
     }
 }
 
@@ -1280,6 +2083,170 @@ void PhysicsController::removeConstraint(PhysicsConstraint* constraint)
     }
 }
 
+PhysicsController::CollisionConfiguration::CollisionConfiguration()
+    : btDefaultCollisionConfiguration(getCollisionConstructionInfo()), _convexConvexCreateFunc(NULL)
+{
+    _convexConvexCreateFunc = bullet_new<ConvexConvexAlgorithm::CreateFunc>((btConvexConvexAlgorithm::CreateFunc*)m_convexConvexCreateFunc);
+}
+
+PhysicsController::CollisionConfiguration::~CollisionConfiguration()
+{
+    SAFE_DELETE(_convexConvexCreateFunc);
+}
+
+btCollisionAlgorithmCreateFunc* PhysicsController::CollisionConfiguration::getCollisionAlgorithmCreateFunc(int proxyType0, int proxyType1)
+{
+    btCollisionAlgorithmCreateFunc* createFunc = btDefaultCollisionConfiguration::getCollisionAlgorithmCreateFunc(proxyType0, proxyType1);
+    if (createFunc == m_convexConvexCreateFunc)
+        return _convexConvexCreateFunc;
+    return createFunc;
+}
+
+PhysicsController::CollisionDispatcher::CollisionDispatcher(btCollisionConfiguration* configuration)
+    : btCollisionDispatcher(configuration), _threadCount(1), _parallel(false), _pairs(NULL), _pairCount(0), _jobCount(0), _dispatchInfo(NULL)
+{
+}
+
+PhysicsController::CollisionDispatcher::~CollisionDispatcher()
+{
+}
+
+void PhysicsController::CollisionDispatcher::setThreadCount(unsigned int count)
+{
+    GP_ASSERT(count > 0);
+    _threadCount = count;
+}
+
+void PhysicsController::CollisionDispatcher::dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo, btDispatcher* dispatcher)
+{
+    GP_ASSERT(pairCache);
+
+    if (_threadCount <= 1)
+    {
+        btCollisionDispatcher::dispatchAllCollisionPairs(pairCache, dispatchInfo, dispatcher);
+        return;
+    }
+
+    _pairCount = pairCache->getNumOverlappingPairs();
+    if (_pairCount == 0)
+        return;
+    _pairs = pairCache->getOverlappingPairArrayPtr();
+    _dispatchInfo = &dispatchInfo;
+
+    // The pairs are processed in blocks, which the jobs take in turn.
+    JobScheduler* scheduler = Game::getInstance()->getJobScheduler();
+    GP_ASSERT(scheduler);
+    unsigned int blockCount = (unsigned int)(_pairCount + DISPATCH_BLOCK_SIZE - 1) / DISPATCH_BLOCK_SIZE;
+    _jobCount = std::min(std::min(_threadCount, scheduler->getThreadCount()), blockCount);
+
+    int firstManifold = getNumManifolds();
+    _parallel = true;
+    scheduler->parallelFor(_jobCount, &dispatchJob, this);
+    _parallel = false;
+    mergeManifolds(firstManifold);
+
+    _pairs = NULL;
+    _pairCount = 0;
+    _dispatchInfo = NULL;
+}
+
+btPersistentManifold* PhysicsController::CollisionDispatcher::getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1)
+{
+    if (!_parallel)
+        return btCollisionDispatcher::getNewManifold(b0, b1);
+
+    _mutex.lock();
+    btPersistentManifold* manifold = btCollisionDispatcher::getNewManifold(b0, b1);
+    _mutex.unlock();
+    return manifold;
+}
+
+void PhysicsController::CollisionDispatcher::releaseManifold(btPersistentManifold* manifold)
+{
+    if (!_parallel)
+    {
+        btCollisionDispatcher::releaseManifold(manifold);
+        return;
+    }
+
+    // Releasing a manifold moves the last one into its place, so this waits until the jobs have finished.
+    _mutex.lock();
+    _releasedManifolds.push_back(manifold);
+    _mutex.unlock();
+}
+
+void* PhysicsController::CollisionDispatcher::allocateCollisionAlgorithm(int size)
+{
+    if (!_parallel)
+        return btCollisionDispatcher::allocateCollisionAlgorithm(size);
+
+    _mutex.lock();
+    void* ptr = btCollisionDispatcher::allocateCollisionAlgorithm(size);
+    _mutex.unlock();
+    return ptr;
+}
+
+void PhysicsController::CollisionDispatcher::freeCollisionAlgorithm(void* ptr)
+{
+    if (!_parallel)
+    {
+        btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+        return;
+    }
+
+    _mutex.lock();
+    btCollisionDispatcher::freeCollisionAlgorithm(ptr);
+    _mutex.unlock();
+}
+
+void PhysicsController::CollisionDispatcher::dispatchJob(unsigned int index, void* cookie)
+{
+    CollisionDispatcher* dispatcher = (CollisionDispatcher*)cookie;
+    GP_ASSERT(dispatcher);
+    GP_ASSERT(dispatcher->_pairs);
+    GP_ASSERT(dispatcher->_dispatchInfo);
+
+    btNearCallback nearCallback = dispatcher->getNearCallback();
+    int pairCount = dispatcher->_pairCount;
+    int stride = (int)dispatcher->_jobCount * DISPATCH_BLOCK_SIZE;
+    for (int begin = (int)index * DISPATCH_BLOCK_SIZE; begin < pairCount; begin += stride)
+    {
+        int end = std::min(begin + DISPATCH_BLOCK_SIZE, pairCount);
+        for (int i = begin; i < end; ++i)
+        {
+            nearCallback(dispatcher->_pairs[i], *dispatcher, *dispatcher->_dispatchInfo);
+        }
+    }
+}
+
+void PhysicsController::CollisionDispatcher::mergeManifolds(int firstManifold)
+{
+    // The jobs append new manifolds in whatever order they get to them, but the manifolds of
+    // a pair are all created by one job, in order. Sorting the new manifolds by pair, keeping
+    // that order within each pair, makes the order the solver sees them in independent of the
+    // timing of the jobs.
+    int manifoldCount = m_manifoldsPtr.size();
+    if (manifoldCount - firstManifold > 1)
+    {
+        btPersistentManifold** manifolds = &m_manifoldsPtr[0];
+        std::stable_sort(manifolds + firstManifold, manifolds + manifoldCount, &compareManifolds);
+        for (int i = firstManifold; i < manifoldCount; ++i)
+        {
+            manifolds[i]->m_index1a = i;
+        }
+    }
+
+    if (!_releasedManifolds.empty())
+    {
+        std::stable_sort(_releasedManifolds.begin(), _releasedManifolds.end(), &compareManifolds);
+        for (size_t i = 0, count = _releasedManifolds.size(); i < count; ++i)
+        {
+            btCollisionDispatcher::releaseManifold(_releasedManifolds[i]);
+        }
+        _releasedManifolds.clear();
+    }
+}
+
 PhysicsController::DebugDrawer::DebugDrawer()
     : _mode(btIDebugDraw::DBG_DrawAabb | btIDebugDraw::DBG_DrawConstraintLimits | btIDebugDraw::DBG_DrawConstraints | 
        btIDebugDraw::DBG_DrawContactPoints | btIDebugDraw::DBG_DrawWireframe), _meshBatch(NULL), _lineCount(0)
@@ -1432,4 +2399,14 @@ bool PhysicsController::HitFilter::hit(const PhysicsController::HitResult& resul
     return true;
 }
 
+PhysicsController::RayQuery::RayQuery()
+    : distance(0.0f), filter(NULL)
+{
+}
+
+PhysicsController::SweepQuery::SweepQuery()
+    : object(NULL), filter(NULL)
+{
+}
+
 }
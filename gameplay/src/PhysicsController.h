@@ -10,6 +10,7 @@
 #include "PhysicsCollisionObject.h"
 #include "MeshBatch.h"
 #include "HeightField.h"
+#include "JobScheduler.h"
 #include "ScriptTarget.h"
 
 namespace gameplay
@@ -94,6 +95,52 @@ public:
         Vector3 normal;
     };
 
+    /**
+     * The work done by the simulation in the last update.
+     *
+     * @see PhysicsController::getStepStatistics()
+     * @script{ignore}
+     */
+    struct StepStatistics
+    {
+        /**
+         * The number of fixed time steps simulated in the last update.
+         */
+        unsigned int steps;
+
+        /**
+         * The number of fixed time steps that were due in the last update but were skipped,
+         * because of the maximum number of substeps or the step budget.
+         */
+        unsigned int droppedSteps;
+
+        /**
+         * The total number of fixed time steps simulated since the controller was initialized.
+         */
+        unsigned int totalSteps;
+
+        /**
+         * The time taken by the simulation in the last update, in milliseconds.
+         */
+        float simulationTime;
+
+        /**
+         * The average time taken by a step in the last update, in milliseconds.
+         */
+        float stepTime;
+
+        /**
+         * The longest time taken by a step in the last update, in milliseconds.
+         */
+        float maxStepTime;
+
+        /**
+         * The fraction of a step between the last two simulated states that the transforms of
+         * the nodes were interpolated to, or 1 if interpolation is disabled.
+         */
+        float interpolation;
+    };
+
     /**
      * Class that can be overridden to provide custom hit test filters for ray
      * and sweep tests.
@@ -142,6 +189,64 @@ public:
         virtual bool hit(const HitResult& result);
     };
 
+    /**
+     * A ray test of a batch of ray tests.
+     *
+     * @see PhysicsController::rayTest(const RayQuery*, unsigned int, HitResult*, bool)
+     * @script{ignore}
+     */
+    struct RayQuery
+    {
+        /**
+         * Constructor.
+         */
+        RayQuery();
+
+        /**
+         * The ray to test intersection with.
+         */
+        Ray ray;
+
+        /**
+         * How far along the ray to test for intersections.
+         */
+        float distance;
+
+        /**
+         * Optional filter used to control which objects are tested, or NULL.
+         */
+        HitFilter* filter;
+    };
+
+    /**
+     * A sweep test of a batch of sweep tests.
+     *
+     * @see PhysicsController::sweepTest(const SweepQuery*, unsigned int, HitResult*, bool)
+     * @script{ignore}
+     */
+    struct SweepQuery
+    {
+        /**
+         * Constructor.
+         */
+        SweepQuery();
+
+        /**
+         * The collision object to sweep from its current world position.
+         */
+        PhysicsCollisionObject* object;
+
+        /**
+         * The end position of the sweep, in world space.
+         */
+        Vector3 endPosition;
+
+        /**
+         * Optional filter used to control which objects are tested, or NULL.
+         */
+        HitFilter* filter;
+    };
+
     /**
      * Adds a listener to the physics controller.
      * 
@@ -287,6 +392,111 @@ public:
      */
     void setGravity(const Vector3& gravity);
 
+    /**
+     * Gets the number of fixed time steps simulated per second.
+     *
+     * @return The step rate, in steps per second.
+     */
+    float getStepRate() const;
+
+    /**
+     * Sets the number of fixed time steps simulated per second (60 by default).
+     *
+     * Each update simulates the whole number of steps that fit in the time elapsed since the
+     * previous steps, and carries the rest of the time over to the next update.
+     *
+     * @param rate The step rate, in steps per second.
+     */
+    void setStepRate(float rate);
+
+    /**
+     * Gets the maximum number of steps simulated in a single update.
+     *
+     * @return The maximum number of substeps.
+     */
+    unsigned int getMaxSubSteps() const;
+
+    /**
+     * Sets the maximum number of steps simulated in a single update (10 by default).
+     *
+     * When a frame takes longer than this number of steps, the time of the steps beyond it is
+     * dropped, and the simulation runs slower than real time rather than falling further behind.
+     *
+     * @param maxSubSteps The maximum number of substeps, at least 1.
+     */
+    void setMaxSubSteps(unsigned int maxSubSteps);
+
+    /**
+     * Gets the time the simulation may take in a single update.
+     *
+     * @return The step budget, in milliseconds, or 0 if it is unlimited.
+     */
+    float getStepBudget() const;
+
+    /**
+     * Sets the time the simulation may take in a single update (unlimited by default).
+     *
+     * The number of steps simulated in an update is limited to the ones that fit in the budget,
+     * estimated from the time taken by recent steps. At least one step is simulated in each
+     * update that is due one. As with the maximum number of substeps, the time of the steps
+     * left out is dropped.
+     *
+     * @param budget The step budget, in milliseconds, or 0 for no limit.
+     */
+    void setStepBudget(float budget);
+
+    /**
+     * Determines whether the transforms of rigid bodies are interpolated between steps.
+     *
+     * @return true if interpolation is enabled, false otherwise.
+     */
+    bool isInterpolationEnabled() const;
+
+    /**
+     * Sets whether the transforms of rigid bodies are interpolated between steps (disabled by default).
+     *
+     * When interpolation is disabled, the node of a dynamic rigid body is set to the state of its
+     * body after each step. When it is enabled, the node is set once per update to a blend of the
+     * states of the last two steps, by the fraction of a step of time carried over to the next
+     * update. Nodes then move smoothly when the game updates more often than the simulation steps,
+     * at the cost of trailing the simulation by up to one step.
+     *
+     * @param enabled true to enable interpolation, false to disable it.
+     */
+    void setInterpolationEnabled(bool enabled);
+
+    /**
+     * Gets the number of threads that detect collisions in parallel during a step.
+     *
+     * @return The number of physics threads.
+     */
+    unsigned int getThreadCount() const;
+
+    /**
+     * Sets the number of threads that detect collisions in parallel during a step (1 by default).
+     *
+     * With a count of 1 the simulation runs entirely on the calling thread. With a larger count,
+     * the overlapping pairs of objects found by the broadphase are split into that many jobs,
+     * which run the narrowphase collision detection of their pairs on the threads of the game's
+     * job scheduler. The number of jobs running at once is also limited by the number of threads
+     * of the job scheduler.
+     *
+     * The contact manifolds created while the jobs run are put in a fixed order afterwards, so
+     * the simulation is deterministic for a given thread count greater than 1, and gives the
+     * same results for all such counts. The constraint solver still runs on the calling thread.
+     *
+     * @param count The number of physics threads, at least 1.
+     */
+    void setThreadCount(unsigned int count);
+
+    /**
+     * Returns the work done by the simulation in the last update.
+     *
+     * @return The step statistics.
+     * @script{ignore}
+     */
+    const StepStatistics& getStepStatistics() const;
+
     /**
      * Draws debugging information (rigid body outlines, etc.) using the given view projection matrix.
      * 
@@ -327,33 +537,52 @@ public:
      */
     bool sweepTest(PhysicsCollisionObject* object, const Vector3& endPosition, PhysicsController::HitResult* result = NULL, PhysicsController::HitFilter* filter = NULL);
 
-private:
-
     /**
-     * Internal class used to integrate with Bullet collision callbacks.
+     * Performs a batch of ray tests on the physics world.
+     *
+     * Each result is the same as that of the corresponding single ray test; rays that
+     * hit nothing have a NULL object and a fraction of 1. Consecutive rays share their
+     * traversal of the broadphase, so rays that are close to each other (such as those
+     * cast from the same sensor) should be adjacent in the array.
+     *
+     * When tested in parallel, the rays are spread over the threads of the game's job
+     * scheduler and the hit filters may be called from several threads at once. The
+     * physics world must not be modified until the call returns.
+     *
+     * @param queries The ray tests to perform.
+     * @param count The number of ray tests.
+     * @param results The array of count hit results to store the result of each test in.
+     * @param parallel True to perform the tests on the worker threads of the job scheduler.
+     *
+     * @return The number of rays that collided with a physics object.
+     * @script{ignore}
      */
-    class CollisionCallback : public btCollisionWorld::ContactResultCallback
-    {
-    public:
-        /**
-         * Constructor.
-         * 
-         * @param pc The physics controller that owns the callback.
-         */
-        CollisionCallback(PhysicsController* pc) : _pc(pc) {}
+    unsigned int rayTest(const RayQuery* queries, unsigned int count, PhysicsController::HitResult* results, bool parallel = false);
 
-    protected:
-        /**
-            * Internal function used for Bullet integration (do not use or override).
-            */
-        btScalar addSingleResult(btManifoldPoint& cp, const btCollisionObjectWrapper* a, int partIdA, int indexA, const btCollisionObjectWrapper* b, int partIdB, int indexB);    
+    /**
+     * Performs a batch of sweep tests on the physics world.
+     *
+     * Each result is the same as that of the corresponding single sweep test; sweeps
+     * that hit nothing have a NULL object and a fraction of 1. Consecutive sweeps share
+     * their traversal of the broadphase, as with batched ray tests.
+     *
+     * When tested in parallel, the sweeps are spread over the threads of the game's job
+     * scheduler and the hit filters may be called from several threads at once. The
+     * physics world must not be modified until the call returns.
+     *
+     * @param queries The sweep tests to perform.
+     * @param count The number of sweep tests.
+     * @param results The array of count hit results to store the result of each test in.
+     * @param parallel True to perform the tests on the worker threads of the job scheduler.
+     *
+     * @return The number of sweeps that intersected other physics objects.
+     * @script{ignore}
+     */
+    unsigned int sweepTest(const SweepQuery* queries, unsigned int count, PhysicsController::HitResult* results, bool parallel = false);
 
-    private:
-        PhysicsController* _pc;
-    };
+private:
 
     // Internal constants for the collision status cache.
-    static const int DIRTY;
     static const int COLLISION;
     static const int REGISTERED;
     static const int REMOVE;
@@ -361,10 +590,35 @@ private:
     // Represents the collision listeners and status for a given collision pair (used by the collision status cache).
     struct CollisionInfo
     {
-        CollisionInfo() : _status(0) { }
+        CollisionInfo(const PhysicsCollisionObject::CollisionPair& pair) : _pair(pair), _status(0), _frame(0) { }
 
+        PhysicsCollisionObject::CollisionPair _pair;
         std::vector<PhysicsCollisionObject::CollisionListener*> _listeners;
         int _status;
+        // The last update in which the pair was found to be in contact.
+        unsigned int _frame;
+    };
+
+    // A batch of ray or sweep tests being performed, shared by the jobs that perform them.
+    struct QueryBatch
+    {
+        PhysicsController* controller;
+        const RayQuery* rays;
+        const SweepQuery* sweeps;
+        btConvexShape* const* sweepShapes;
+        const btTransform* sweepStarts;
+        unsigned int count;
+        HitResult* results;
+        bool parallel;
+    };
+
+    // A collision event waiting to be delivered to the listeners of a collision status cache entry.
+    struct CollisionEvent
+    {
+        unsigned int index;
+        PhysicsCollisionObject::CollisionListener::EventType type;
+        Vector3 contactPointA;
+        Vector3 contactPointB;
     };
 
     /**
@@ -417,6 +671,45 @@ private:
     // Gets the corresponding GamePlay object for the given Bullet object.
     PhysicsCollisionObject* getCollisionObject(const btCollisionObject* collisionObject) const;
 
+    // Performs the groups of tests of a batch of ray or sweep tests and returns the number of hits.
+    unsigned int runQueryBatch(QueryBatch& batch);
+
+    // Performs the group of tests of a batch with the given index (a job of the job scheduler).
+    static void queryJob(unsigned int index, void* cookie);
+
+    // Performs the given consecutive ray tests of a batch.
+    void rayTestGroup(const QueryBatch& batch, unsigned int first, unsigned int count);
+
+    // Performs the given consecutive sweep tests of a batch.
+    void sweepTestGroup(const QueryBatch& batch, unsigned int first, unsigned int count);
+
+    // Simulates the fixed time steps due after the given elapsed time (in milliseconds).
+    void stepSimulation(float elapsedTime);
+
+    // Sets the nodes of the dynamic rigid bodies to their states interpolated by the given fraction of a step.
+    void interpolateTransforms(float alpha);
+
+    // Called by Bullet after each simulation step, to time it.
+    static void stepCallback(btDynamicsWorld* world, btScalar timeStep);
+
+    // Returns the index of the collision status cache entry for the given pair (in either order), or -1 if there is none.
+    int findCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB) const;
+
+    // Adds a collision status cache entry for the given pair and returns its index.
+    unsigned int addCollisionInfo(PhysicsCollisionObject* objectA, PhysicsCollisionObject* objectB);
+
+    // Rebuilds the hash table of the collision status cache.
+    void buildCollisionIndex();
+
+    // Erases the collision status cache entries marked for removal.
+    void removeCollisionInfos();
+
+    // Updates the collision status cache from the contact manifolds of the last simulation step.
+    void updateCollisionStatus();
+
+    // Delivers the collision events queued by updateCollisionStatus() to the collision listeners.
+    void fireCollisionEvents();
+
     // Creates a collision shape for the given node and gameplay shape definition.
     // Populates 'centerOfMassOffset' with the correct calculated center of mass offset.
     PhysicsCollisionShape* createShape(Node* node, const PhysicsCollisionShape::Definition& shape, Vector3* centerOfMassOffset);
@@ -436,6 +729,12 @@ private:
     // Creates a triangle mesh collision shape.
     PhysicsCollisionShape* createMesh(Mesh* mesh, const Vector3& scale);
 
+    // Builds the unscaled triangle mesh collision shape (and its BVH) for the mesh with the given URL.
+    PhysicsCollisionShape* createMeshShape(const char* url);
+
+    // Returns the cached triangle mesh collision shape for the given mesh URL and scale, or NULL if there is none.
+    PhysicsCollisionShape* findMeshShape(const char* url, const Vector3& scale) const;
+
     // Destroys a collision shape created through PhysicsController
     void destroyShape(PhysicsCollisionShape* shape);
 
@@ -454,6 +753,89 @@ private:
     // Removes the given constraint from the simulated physics world.
     void removeConstraint(PhysicsConstraint* constraint);
     
+    /**
+     * Collision configuration whose algorithms can detect collisions of different pairs in parallel.
+     *
+     * The default convex-convex algorithms all share one simplex solver, which holds state while
+     * detecting collisions; the algorithms created by this configuration each have their own.
+     * @script{ignore}
+     */
+    class CollisionConfiguration : public btDefaultCollisionConfiguration
+    {
+    public:
+
+        /**
+         * Constructor.
+         */
+        CollisionConfiguration();
+
+        /**
+         * Destructor.
+         */
+        ~CollisionConfiguration();
+
+        // Overridden Bullet functions from btDefaultCollisionConfiguration.
+        btCollisionAlgorithmCreateFunc* getCollisionAlgorithmCreateFunc(int proxyType0, int proxyType1);
+
+    private:
+
+        btCollisionAlgorithmCreateFunc* _convexConvexCreateFunc;
+    };
+
+    /**
+     * Collision dispatcher that runs the narrowphase collision detection of pairs on the job scheduler.
+     * @script{ignore}
+     */
+    class CollisionDispatcher : public btCollisionDispatcher
+    {
+    public:
+
+        /**
+         * Constructor.
+         */
+        CollisionDispatcher(btCollisionConfiguration* configuration);
+
+        /**
+         * Destructor.
+         */
+        ~CollisionDispatcher();
+
+        /**
+         * Sets the number of jobs the pairs are split into, or 1 to process them on the calling thread.
+         */
+        void setThreadCount(unsigned int count);
+
+        // Overridden Bullet functions from btCollisionDispatcher.
+        void dispatchAllCollisionPairs(btOverlappingPairCache* pairCache, const btDispatcherInfo& dispatchInfo, btDispatcher* dispatcher);
+        btPersistentManifold* getNewManifold(const btCollisionObject* b0, const btCollisionObject* b1);
+        void releaseManifold(btPersistentManifold* manifold);
+        void* allocateCollisionAlgorithm(int size);
+        void freeCollisionAlgorithm(void* ptr);
+
+    private:
+
+        /**
+         * Processes the blocks of pairs assigned to a job.
+         */
+        static void dispatchJob(unsigned int index, void* cookie);
+
+        /**
+         * Orders the manifolds created by the jobs and releases the ones they have released.
+         */
+        void mergeManifolds(int firstManifold);
+
+        unsigned int _threadCount;
+        bool _parallel;
+        btBroadphasePair* _pairs;
+        int _pairCount;
+        unsigned int _jobCount;
+        const btDispatcherInfo* _dispatchInfo;
+        // Guards the manifold and collision algorithm pools while the jobs run.
+        JobScheduler::Mutex _mutex;
+        // Manifolds released while the jobs run, which are only removed once they have finished.
+        std::vector<btPersistentManifold*> _releasedManifolds;
+    };
+
     /**
      * Draws Bullet debug information.
      * @script{ignore}
@@ -535,7 +917,7 @@ private:
 
     bool _isUpdating;
     btDefaultCollisionConfiguration* _collisionConfiguration;
-    btCollisionDispatcher* _dispatcher;
+    CollisionDispatcher* _dispatcher;
     btBroadphaseInterface* _overlappingPairCache;
     btSequentialImpulseConstraintSolver* _solver;
     btDynamicsWorld* _world;
@@ -545,8 +927,24 @@ private:
     Listener::EventType _status;
     std::vector<Listener*>* _listeners;
     Vector3 _gravity;
-    std::map<PhysicsCollisionObject::CollisionPair, CollisionInfo> _collisionStatus;
-    CollisionCallback* _collisionCallback;
+    float _stepRate;
+    unsigned int _maxSubSteps;
+    float _stepBudget;
+    bool _interpolationEnabled;
+    unsigned int _threadCount;
+    // Time elapsed since the last step, in milliseconds.
+    double _stepAccumulator;
+    // Recent average time taken by a step, in milliseconds (used to fit steps in the step budget).
+    float _averageStepTime;
+    double _stepStartTime;
+    StepStatistics _stepStatistics;
+    std::vector<CollisionInfo> _collisionStatus;
+    // Open addressing hash table of collision status cache entries, holding entry indices plus one (zero marks an empty slot).
+    std::vector<unsigned int> _collisionIndex;
+    std::vector<unsigned int> _collidingPairs;
+    std::vector<CollisionEvent> _collisionEvents;
+    unsigned int _collisionFrame;
+    bool _collisionRemovalPending;
 };
 
 }
@@ -0,0 +1,222 @@
+#include "Base.h"
+#include "RenderQueue.h"
+#include "Camera.h"
+#include "MeshBatch.h"
+#include "MeshPart.h"
+#include "Model.h"
+#include "Pass.h"
+
+namespace gameplay
+{
+
+RenderQueue::RenderQueue()
+    : _sortByDepth(false), _sorted(true)
+{
+    memset(&_statistics, 0, sizeof(_statistics));
+}
+
+RenderQueue::~RenderQueue()
+{
+}
+
+void RenderQueue::start(Camera* camera)
+{
+    _items.clear();
+    _sorted = true;
+
+    _sortByDepth = (camera != NULL);
+    if (camera)
+    {
+        _view = camera->getViewMatrix();
+    }
+}
+
+void RenderQueue::finish()
+{
+    if (!_sorted)
+    {
+        std::sort(_items.begin(), _items.end(), &compareItems);
+        _sorted = true;
+    }
+}
+
+void RenderQueue::draw()
+{
+    finish();
+
+    memset(&_statistics, 0, sizeof(_statistics));
+    if (_items.empty())
+        return;
+
+    unsigned int textureBindCount = Effect::getTextureBindCount();
+    Effect::setTextureTrackingEnabled(true);
+
+    Effect* boundEffect = NULL;
+    Pass* boundPass = NULL;
+    VertexAttributeBinding* boundBinding = NULL;
+    IndexBufferHandle boundIndexBuffer = 0;
+    bool indexBufferBound = false;
+
+    for (size_t i = 0, count = _items.size(); i < count; ++i)
+    {
+        const Item& item = _items[i];
+        Pass* pass = item.pass;
+
+        if (item.effect != boundEffect)
+        {
+            item.effect->bind();
+            boundEffect = item.effect;
+            ++_statistics.programBinds;
+        }
+
+        // Consecutive draws with the same pass (such as the parts of a model sharing a
+        // material) have the same parameters, so they are only bound for the first one.
+        if (pass != boundPass)
+        {
+            pass->RenderState::bind(pass);
+            boundPass = pass;
+            ++_statistics.stateChanges;
+        }
+
+        VertexAttributeBinding* binding = pass->getVertexAttributeBinding();
+        if (binding != boundBinding)
+        {
+            if (boundBinding)
+                boundBinding->unbind();
+            if (binding)
+                binding->bind();
+            boundBinding = binding;
+
+            // The index buffer binding is part of the state of a vertex array object.
+            indexBufferBound = false;
+        }
+
+        IndexBufferHandle indexBuffer = item.part ? item.part->getIndexBuffer() : 0;
+        if (!indexBufferBound || indexBuffer != boundIndexBuffer)
+        {
+            GL_ASSERT( glBindBuffer(GL_ELEMENT_ARRAY_BUFFER, indexBuffer) );
+            boundIndexBuffer = indexBuffer;
+            indexBufferBound = true;
+        }
+
+        if (item.batch)
+            item.batch->drawGeometry();
+        else
+            item.model->drawGeometry(item.pass, item.part, item.wireframe);
+        ++_statistics.drawCalls;
+    }
+
+    if (boundBinding)
+        boundBinding->unbind();
+
+    Effect::setTextureTrackingEnabled(false);
+    _statistics.textureBinds = Effect::getTextureBindCount() - textureBindCount;
+}
+
+unsigned int RenderQueue::getItemCount() const
+{
+    return (unsigned int)_items.size();
+}
+
+const RenderQueue::Statistics& RenderQueue::getStatistics() const
+{
+    return _statistics;
+}
+
+void RenderQueue::add(Pass* pass, unsigned int passIndex, Model* model, MeshPart* part, bool wireframe, const Vector3& position)
+{
+    GP_ASSERT(model);
+
+    Item item;
+    item.pass = pass;
+    item.passIndex = passIndex;
+    item.model = model;
+    item.part = part;
+    item.batch = NULL;
+    item.wireframe = wireframe;
+    addItem(item, position);
+}
+
+void RenderQueue::add(Pass* pass, unsigned int passIndex, MeshBatch* batch, const Vector3& position)
+{
+    GP_ASSERT(batch);
+
+    Item item;
+    item.pass = pass;
+    item.passIndex = passIndex;
+    item.model = NULL;
+    item.part = NULL;
+    item.batch = batch;
+    item.wireframe = false;
+    addItem(item, position);
+}
+
+void RenderQueue::addItem(Item& item, const Vector3& position)
+{
+    GP_ASSERT(item.pass);
+    GP_ASSERT(item.pass->getEffect());
+
+    item.effect = item.pass->getEffect();
+    item.material = item.pass->getTopmost(NULL);
+    item.transparent = item.pass->isBlendEnabled();
+
+    // Sort by the first texture of the pass, looking up from the pass to its material.
+    item.texture = 0;
+    for (RenderState* rs = item.pass; rs && !item.texture; rs = rs->_parent)
+    {
+        for (size_t i = 0, count = rs->_parameters.size(); i < count; ++i)
+        {
+            Texture::Sampler* sampler = rs->_parameters[i]->getSampler();
+            if (sampler && sampler->getTexture())
+            {
+                item.texture = sampler->getTexture()->getHandle();
+                break;
+            }
+        }
+    }
+
+    // The depth is the distance in front of the camera.
+    item.depth = 0;
+    if (_sortByDepth)
+    {
+        Vector3 viewPosition;
+        _view.transformPoint(position, &viewPosition);
+        item.depth = -viewPosition.z;
+    }
+
+    item.sequence = (unsigned int)_items.size();
+    _items.push_back(item);
+    _sorted = false;
+}
+
+bool RenderQueue::compareItems(const Item& a, const Item& b)
+{
+    // Opaque draws are drawn before blended ones.
+    if (a.transparent != b.transparent)
+        return b.transparent;
+
+    if (a.transparent)
+    {
+        // Blended draws are drawn back to front, in the order they were added at equal depths.
+        if (a.depth != b.depth)
+            return a.depth > b.depth;
+        return a.sequence < b.sequence;
+    }
+
+    // Opaque draws are grouped by state, and drawn front to back within each group. Models
+    // usually have materials of their own, so the texture is compared before the material;
+    // draws sharing a material share its texture too and so remain grouped.
+    if (a.passIndex != b.passIndex)
+        return a.passIndex < b.passIndex;
+    if (a.effect != b.effect)
+        return a.effect < b.effect;
+    if (a.texture != b.texture)
+        return a.texture < b.texture;
+    if (a.material != b.material)
+        return a.material < b.material;
+    if (a.depth != b.depth)
+        return a.depth < b.depth;
+    return a.sequence < b.sequence;
+}
+
+}
@@ -0,0 +1,171 @@
+#ifndef RENDERQUEUE_H_
+#define RENDERQUEUE_H_
+
+#include "Matrix.h"
+
+namespace gameplay
+{
+
+class Camera;
+class Effect;
+class MeshBatch;
+class MeshPart;
+class Model;
+class Pass;
+class RenderState;
+
+/**
+ * Defines a queue of draw items that are sorted by render state before being drawn.
+ *
+ * Drawing a Model binds each of its passes and draws it immediately, so the draws are
+ * issued in the order the scene is traversed. Models, terrains and particle emitters can
+ * instead add their draws to a render queue, which orders them to minimize the changes
+ * of render state between draws:
+ *
+ * - Opaque draws are drawn first, grouped by pass index, effect, texture and material,
+ *   and then ordered front to back.
+ * - Draws with blending enabled are drawn last, ordered back to front.
+ *
+ * When drawing the queue, programs, vertex attribute bindings, index buffers and textures
+ * are only bound when they differ from those of the previous draw.
+ *
+ * The items added to the queue refer to the objects that added them, which must not be
+ * modified or destroyed until the queue has been drawn.
+ */
+class RenderQueue
+{
+    friend class Model;
+    friend class MeshBatch;
+
+public:
+
+    /**
+     * The work done to draw a render queue.
+     */
+    struct Statistics
+    {
+        /**
+         * The number of draw calls issued.
+         */
+        unsigned int drawCalls;
+
+        /**
+         * The number of times a program was bound.
+         */
+        unsigned int programBinds;
+
+        /**
+         * The number of times a texture was bound.
+         */
+        unsigned int textureBinds;
+
+        /**
+         * The number of times the pass changed between two draws, which requires the
+         * render state and the material parameters of the new pass to be bound.
+         */
+        unsigned int stateChanges;
+    };
+
+    /**
+     * Constructor.
+     */
+    RenderQueue();
+
+    /**
+     * Destructor.
+     */
+    ~RenderQueue();
+
+    /**
+     * Removes all items from the queue and starts recording new ones.
+     *
+     * @param camera The camera whose view the items are sorted by depth for, or NULL to
+     *      not sort the items by depth.
+     */
+    void start(Camera* camera = NULL);
+
+    /**
+     * Sorts the items added since start() was called.
+     */
+    void finish();
+
+    /**
+     * Draws the items of the queue in sorted order.
+     *
+     * The queue keeps its items, so it can be drawn again until start() is called.
+     */
+    void draw();
+
+    /**
+     * Returns the number of items in the queue.
+     *
+     * @return The number of items in the queue.
+     */
+    unsigned int getItemCount() const;
+
+    /**
+     * Returns the statistics of the last time the queue was drawn.
+     *
+     * @return The statistics.
+     * @script{ignore}
+     */
+    const Statistics& getStatistics() const;
+
+private:
+
+    /**
+     * A single draw of a mesh part, mesh or mesh batch with a pass.
+     */
+    struct Item
+    {
+        Pass* pass;
+        Model* model;
+        MeshPart* part;
+        MeshBatch* batch;
+        Effect* effect;
+        RenderState* material;
+        TextureHandle texture;
+        unsigned int passIndex;
+        float depth;
+        unsigned int sequence;
+        bool transparent;
+        bool wireframe;
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    RenderQueue(const RenderQueue& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    RenderQueue& operator=(const RenderQueue&);
+
+    /**
+     * Adds the draw of a mesh part of a model, or of the whole mesh if part is NULL.
+     */
+    void add(Pass* pass, unsigned int passIndex, Model* model, MeshPart* part, bool wireframe, const Vector3& position);
+
+    /**
+     * Adds the draw of a mesh batch.
+     */
+    void add(Pass* pass, unsigned int passIndex, MeshBatch* batch, const Vector3& position);
+
+    /**
+     * Initializes the sort keys of an item and appends it to the queue.
+     */
+    void addItem(Item& item, const Vector3& position);
+
+    static bool compareItems(const Item& a, const Item& b);
+
+    std::vector<Item> _items;
+    Matrix _view;
+    bool _sortByDepth;
+    bool _sorted;
+    Statistics _statistics;
+};
+
+}
+
+#endif
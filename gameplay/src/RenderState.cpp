@@ -462,6 +462,16 @@ RenderState* RenderState::getTopmost(RenderState* below)
     return NULL;
 }
 
+bool RenderState::isBlendEnabled() const
+{
+    for (const RenderState* rs = this; rs; rs = rs->_parent)
+    {
+        if (rs->_state && (rs->_state->_bits & RS_BLEND))
+            return rs->_state->_blendEnabled;
+    }
+    return false;
+}
+
 void RenderState::cloneInto(RenderState* renderState, NodeCloneContext& context) const
 {
     GP_ASSERT(renderState);
@@ -587,7 +597,9 @@ void RenderState::StateBlock::bindNoRestore()
 
 void RenderState::StateBlock::restore(long stateOverrideBits)
 {
-    GP_ASSERT(_defaultState);
+    // The default state is created at game startup. Every bind restores state first,
+    // so create it here for binds made without a running game, such as from tools.
+    RenderState::initialize();
 
     // If there is no state to restore (i.e. no non-default state), do nothing.
     if (_defaultState->_bits == 0)
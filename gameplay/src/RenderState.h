@@ -23,6 +23,7 @@ class RenderState : public Ref
     friend class Technique;
     friend class Pass;
     friend class Model;
+    friend class RenderQueue;
 
 public:
 
@@ -478,6 +479,12 @@ protected:
      */
     RenderState* getTopmost(RenderState* below);
 
+    /**
+     * Determines whether blending is enabled by this RenderState or, if it does not
+     * set the blend state, by the closest of its parents that does.
+     */
+    bool isBlendEnabled() const;
+
     /**
      * Copies the data from this RenderState into the given RenderState.
      * 
@@ -6,6 +6,7 @@
 #include "Joint.h"
 #include "Terrain.h"
 #include "Bundle.h"
+#include "SpatialIndex.h"
 
 namespace gameplay
 {
@@ -61,7 +62,8 @@ static bool endsWith(const char* str, const char* suffix, bool ignoreCase)
 
 Scene::Scene(const char* id)
     : _id(id ? id : ""), _activeCamera(NULL), _firstNode(NULL), _lastNode(NULL), _nodeCount(0), 
-    _lightColor(1,1,1), _lightDirection(0,-1,0), _bindAudioListenerToCamera(true), _debugBatch(NULL)
+    _lightColor(1,1,1), _lightDirection(0,-1,0), _bindAudioListenerToCamera(true), _debugBatch(NULL),
+    _flatTransforms(false), _transformOrderDirty(true), _spatialIndex(NULL)
 {
     __sceneList.push_back(this);
 }
@@ -82,6 +84,7 @@ Scene::~Scene()
 
     // Remove all nodes from the scene
     removeAllNodes();
+    SAFE_DELETE(_spatialIndex);
     SAFE_DELETE(_debugBatch);
 
     // Remove the scene from global list
@@ -270,6 +273,13 @@ void Scene::addNode(Node* node)
 
     ++_nodeCount;
 
+    if (_spatialIndex)
+    {
+        addToSpatialIndex(node);
+    }
+
+    _transformOrderDirty = true;
+
     // If we don't have an active camera set, then check for one and set it.
     if (_activeCamera == NULL)
     {
@@ -303,6 +313,8 @@ void Scene::removeNode(Node* node)
     SAFE_RELEASE(node);
 
     --_nodeCount;
+
+    _transformOrderDirty = true;
 }
 
 void Scene::removeAllNodes()
@@ -403,6 +415,255 @@ void Scene::setLightDirection(const Vector3& direction)
     _lightDirection = direction;
 }
 
+void Scene::setFlatTransformsEnabled(bool enabled)
+{
+    if (_flatTransforms != enabled)
+    {
+        _flatTransforms = enabled;
+        _transformOrderDirty = true;
+
+        if (!_flatTransforms)
+        {
+            // Release the flattened hierarchy since it is no longer maintained.
+            std::vector<Node*>().swap(_transformNodes);
+            std::vector<int>().swap(_transformParents);
+        }
+    }
+}
+
+bool Scene::isFlatTransformsEnabled() const
+{
+    return _flatTransforms;
+}
+
+void Scene::updateTransforms()
+{
+    if (!_flatTransforms)
+        return;
+
+    if (_transformOrderDirty)
+    {
+        buildTransformOrder();
+    }
+
+    if (!_transformNodes.empty())
+    {
+        Node::resolveWorldMatrices(&_transformNodes[0], &_transformParents[0], _transformNodes.size());
+    }
+}
+
+void Scene::buildTransformOrder()
+{
+    _transformOrderDirty = false;
+
+    _transformNodes.clear();
+    _transformParents.clear();
+
+    // Depth-first pre-order traversal guarantees that every parent is stored before its
+    // children. An explicit stack is used so that very deep hierarchies cannot overflow.
+    std::vector<std::pair<Node*, int> > stack;
+    for (Node* node = _lastNode; node != NULL; node = node->getPreviousSibling())
+    {
+        stack.push_back(std::make_pair(node, -1));
+    }
+
+    while (!stack.empty())
+    {
+        Node* node = stack.back().first;
+        int parent = stack.back().second;
+        stack.pop_back();
+
+        int index = (int)_transformNodes.size();
+        _transformNodes.push_back(node);
+        _transformParents.push_back(parent);
+
+        for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+        {
+            stack.push_back(std::make_pair(child, index));
+        }
+    }
+}
+
+void Scene::setSpatialIndexEnabled(bool enabled)
+{
+    if (enabled == (_spatialIndex != NULL))
+        return;
+
+    if (enabled)
+    {
+        _spatialIndex = new SpatialIndex();
+        for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+        {
+            addToSpatialIndex(node);
+        }
+    }
+    else
+    {
+        for (Node* node = _firstNode; node != NULL; node = node->_nextSibling)
+        {
+            removeFromSpatialIndex(node);
+        }
+        SAFE_DELETE(_spatialIndex);
+        std::vector<Node*>().swap(_spatialUpdates);
+    }
+}
+
+bool Scene::isSpatialIndexEnabled() const
+{
+    return _spatialIndex != NULL;
+}
+
+void Scene::addToSpatialIndex(Node* node)
+{
+    GP_ASSERT(_spatialIndex);
+
+    // Nodes are inserted on the next update, once their bounds are needed.
+    if (!node->_spatialQueued)
+    {
+        node->_spatialQueued = true;
+        _spatialUpdates.push_back(node);
+    }
+
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        addToSpatialIndex(child);
+    }
+}
+
+void Scene::removeFromSpatialIndex(Node* node)
+{
+    GP_ASSERT(_spatialIndex);
+
+    bool queued = false;
+    std::vector<Node*> stack(1, node);
+    while (!stack.empty())
+    {
+        Node* n = stack.back();
+        stack.pop_back();
+
+        if (n->_spatialProxy >= 0)
+        {
+            _spatialIndex->remove(n->_spatialProxy);
+            n->_spatialProxy = -1;
+        }
+        if (n->_spatialQueued)
+        {
+            n->_spatialQueued = false;
+            queued = true;
+        }
+
+        for (Node* child = n->getFirstChild(); child != NULL; child = child->getNextSibling())
+        {
+            stack.push_back(child);
+        }
+    }
+
+    if (queued)
+    {
+        // The removed nodes may be released once they leave the scene, so drop them from the queue now.
+        size_t count = 0;
+        for (size_t i = 0; i < _spatialUpdates.size(); ++i)
+        {
+            if (_spatialUpdates[i]->_spatialQueued)
+                _spatialUpdates[count++] = _spatialUpdates[i];
+        }
+        _spatialUpdates.resize(count);
+    }
+}
+
+void Scene::updateSpatialIndex()
+{
+    GP_ASSERT(_spatialIndex);
+
+    for (size_t i = 0, count = _spatialUpdates.size(); i < count; ++i)
+    {
+        Node* node = _spatialUpdates[i];
+        node->_spatialQueued = false;
+
+        const BoundingSphere& sphere = node->getBoundingSphere();
+        if (node->_spatialProxy >= 0)
+            _spatialIndex->update(node->_spatialProxy, sphere);
+        else
+            node->_spatialProxy = _spatialIndex->insert(node, sphere);
+    }
+    _spatialUpdates.clear();
+}
+
+static bool intersectsSphere(const Frustum& frustum, const BoundingSphere& sphere)
+{
+    return frustum.intersects(sphere);
+}
+
+static bool intersectsSphere(const BoundingSphere& volume, const BoundingSphere& sphere)
+{
+    return volume.intersects(sphere);
+}
+
+static bool intersectsSphere(const BoundingBox& box, const BoundingSphere& sphere)
+{
+    return box.intersects(sphere);
+}
+
+static bool intersectsSphere(const Ray& ray, const BoundingSphere& sphere)
+{
+    return ray.intersects(sphere) != Ray::INTERSECTS_NONE;
+}
+
+template <class T>
+static void collectNodes(Node* node, const T& volume, std::vector<Node*>& nodes)
+{
+    if (intersectsSphere(volume, node->getBoundingSphere()))
+        nodes.push_back(node);
+
+    for (Node* child = node->getFirstChild(); child != NULL; child = child->getNextSibling())
+    {
+        collectNodes(child, volume, nodes);
+    }
+}
+
+template <class T>
+static unsigned int queryScene(SpatialIndex* index, Node* firstNode, const T& volume, std::vector<Node*>& nodes)
+{
+    if (index)
+        return index->query(volume, nodes);
+
+    // Without an index, test every node of the hierarchy.
+    size_t size = nodes.size();
+    for (Node* node = firstNode; node != NULL; node = node->getNextSibling())
+    {
+        collectNodes(node, volume, nodes);
+    }
+    return (unsigned int)(nodes.size() - size);
+}
+
+unsigned int Scene::queryNodes(const Frustum& frustum, std::vector<Node*>& nodes)
+{
+    if (_spatialIndex)
+        updateSpatialIndex();
+    return queryScene(_spatialIndex, _firstNode, frustum, nodes);
+}
+
+unsigned int Scene::queryNodes(const BoundingSphere& sphere, std::vector<Node*>& nodes)
+{
+    if (_spatialIndex)
+        updateSpatialIndex();
+    return queryScene(_spatialIndex, _firstNode, sphere, nodes);
+}
+
+unsigned int Scene::queryNodes(const BoundingBox& box, std::vector<Node*>& nodes)
+{
+    if (_spatialIndex)
+        updateSpatialIndex();
+    return queryScene(_spatialIndex, _firstNode, box, nodes);
+}
+
+unsigned int Scene::queryNodes(const Ray& ray, std::vector<Node*>& nodes)
+{
+    if (_spatialIndex)
+        updateSpatialIndex();
+    return queryScene(_spatialIndex, _firstNode, ray, nodes);
+}
+
 static Material* createDebugMaterial()
 {
     // Vertex shader for drawing colored lines.
@@ -520,22 +781,33 @@ static void drawDebugBox(MeshBatch* batch, const BoundingBox& box, const Matrix&
     worldSpaceBox.transform(matrix);
 
     // Get box corners
-    static Vector3 corners[8];
+    Vector3 corners[8];
     worldSpaceBox.getCorners(corners);
 
-    // Draw box lines
-    drawDebugLine(batch, corners[0], corners[1], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[1], corners[2], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[2], corners[3], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[3], corners[0], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[4], corners[5], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[5], corners[6], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[6], corners[7], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[7], corners[4], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[0], corners[7], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[1], corners[6], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[2], corners[5], DEBUG_BOX_COLOR);
-    drawDebugLine(batch, corners[3], corners[4], DEBUG_BOX_COLOR);
+    // The corners joined by each of the box lines
+    static const unsigned int lines[24] =
+    {
+        0, 1, 1, 2, 2, 3, 3, 0,
+        4, 5, 5, 6, 6, 7, 7, 4,
+        0, 7, 1, 6, 2, 5, 3, 4
+    };
+
+    // Lay out the line vertices and draw them all at once
+    static DebugVertex verts[24];
+    Vector3 color = DEBUG_BOX_COLOR;
+    for (unsigned int i = 0; i < 24; ++i)
+    {
+        const Vector3& corner = corners[lines[i]];
+        verts[i].x = corner.x;
+        verts[i].y = corner.y;
+        verts[i].z = corner.z;
+        verts[i].r = color.x;
+        verts[i].g = color.y;
+        verts[i].b = color.z;
+        verts[i].a = 1.0f;
+    }
+
+    batch->add(verts, 24);
 }
 
 static void drawDebugSphere(MeshBatch* batch, const BoundingSphere& sphere)
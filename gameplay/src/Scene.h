@@ -9,11 +9,15 @@
 namespace gameplay
 {
 
+class SpatialIndex;
+
 /**
  * Represents the root container for a hierarchy of nodes.
  */
 class Scene : public Ref
 {
+    friend class Node;
+
 public:
 
     /**
@@ -230,6 +234,117 @@ public:
      */
     void setLightDirection(const Vector3& direction);
 
+    /**
+     * Sets whether the scene resolves node world matrices in a flat, linear pass.
+     *
+     * When enabled, the scene keeps its nodes in an array sorted so that every node comes
+     * after its parent, along with the index of each node's parent. Calling updateTransforms()
+     * once per frame then resolves every dirty world matrix in a single loop over this array,
+     * rather than lazily and recursively through Node::getWorldMatrix(). The matrices are
+     * still stored in the nodes, and the results are identical to the lazy path, which
+     * remains available for nodes queried between passes.
+     *
+     * This mode is disabled by default.
+     *
+     * @param enabled true to enable flat transform updates, false to disable them.
+     */
+    void setFlatTransformsEnabled(bool enabled);
+
+    /**
+     * Returns whether the scene resolves node world matrices in a flat, linear pass.
+     *
+     * @return true if flat transform updates are enabled, false otherwise.
+     * @see setFlatTransformsEnabled(bool)
+     */
+    bool isFlatTransformsEnabled() const;
+
+    /**
+     * Resolves the world matrices of all dirty nodes in the scene.
+     *
+     * This method should be called once per frame, after the scene has been updated
+     * and before it is drawn. It has no effect unless flat transform updates are enabled.
+     *
+     * @see setFlatTransformsEnabled(bool)
+     */
+    void updateTransforms();
+
+    /**
+     * Sets whether the scene maintains a spatial index of the bounding volumes of its nodes.
+     *
+     * The spatial index is a bounding volume hierarchy over the bounding spheres of all the
+     * nodes in the scene hierarchy. It is updated incrementally: nodes whose transform or
+     * bounds change are queued and re-fitted into the hierarchy before the next query, so
+     * static nodes cost nothing after they have been inserted. This allows the queryNodes()
+     * methods to find the nodes intersecting a volume in time proportional to the size of
+     * the result rather than to the number of nodes in the scene.
+     *
+     * This is disabled by default; queries then test the bounding sphere of every node.
+     * Both ways find the same nodes.
+     *
+     * @param enabled true to enable the spatial index, false to disable it.
+     */
+    void setSpatialIndexEnabled(bool enabled);
+
+    /**
+     * Returns whether the scene maintains a spatial index of the bounding volumes of its nodes.
+     *
+     * @return true if the spatial index is enabled, false otherwise.
+     * @see setSpatialIndexEnabled(bool)
+     */
+    bool isSpatialIndexEnabled() const;
+
+    /**
+     * Finds the nodes in the scene whose bounding sphere intersects the given frustum.
+     *
+     * This is typically used to find the nodes visible to a camera. A node is found if
+     * <code>frustum.intersects(node->getBoundingSphere())</code> is true; the nodes are
+     * appended to the vector in no particular order.
+     *
+     * @param frustum The frustum to test against, in world space.
+     * @param nodes The vector the nodes found are appended to.
+     *
+     * @return The number of nodes found.
+     * @see setSpatialIndexEnabled(bool)
+     * @script{ignore}
+     */
+    unsigned int queryNodes(const Frustum& frustum, std::vector<Node*>& nodes);
+
+    /**
+     * Finds the nodes in the scene whose bounding sphere intersects the given sphere.
+     *
+     * @param sphere The sphere to test against, in world space.
+     * @param nodes The vector the nodes found are appended to, in no particular order.
+     *
+     * @return The number of nodes found.
+     * @see setSpatialIndexEnabled(bool)
+     * @script{ignore}
+     */
+    unsigned int queryNodes(const BoundingSphere& sphere, std::vector<Node*>& nodes);
+
+    /**
+     * Finds the nodes in the scene whose bounding sphere intersects the given box.
+     *
+     * @param box The box to test against, in world space.
+     * @param nodes The vector the nodes found are appended to, in no particular order.
+     *
+     * @return The number of nodes found.
+     * @see setSpatialIndexEnabled(bool)
+     * @script{ignore}
+     */
+    unsigned int queryNodes(const BoundingBox& box, std::vector<Node*>& nodes);
+
+    /**
+     * Finds the nodes in the scene whose bounding sphere is intersected by the given ray.
+     *
+     * @param ray The ray to test against, in world space.
+     * @param nodes The vector the nodes found are appended to, in no particular order.
+     *
+     * @return The number of nodes found.
+     * @see setSpatialIndexEnabled(bool)
+     * @script{ignore}
+     */
+    unsigned int queryNodes(const Ray& ray, std::vector<Node*>& nodes);
+
     /**
      * Visits each node in the scene and calls the specified method pointer.
      *
@@ -335,6 +450,26 @@ private:
      */
     void visitNode(Node* node, const char* visitMethod);
 
+    /**
+     * Rebuilds the topologically sorted node array used for flat transform updates.
+     */
+    void buildTransformOrder();
+
+    /**
+     * Queues the given node and its descendants for insertion into the spatial index.
+     */
+    void addToSpatialIndex(Node* node);
+
+    /**
+     * Removes the given node and its descendants from the spatial index.
+     */
+    void removeFromSpatialIndex(Node* node);
+
+    /**
+     * Inserts or re-fits the queued nodes in the spatial index.
+     */
+    void updateSpatialIndex();
+
     std::string _id;
     Camera* _activeCamera;
     Node* _firstNode;
@@ -345,6 +480,12 @@ private:
     Vector3 _lightDirection;
     bool _bindAudioListenerToCamera;
     MeshBatch* _debugBatch;
+    bool _flatTransforms;
+    bool _transformOrderDirty;
+    std::vector<Node*> _transformNodes;
+    std::vector<int> _transformParents;
+    SpatialIndex* _spatialIndex;
+    std::vector<Node*> _spatialUpdates;
 };
 
 template <class T>
@@ -899,9 +899,20 @@ void SceneLoader::loadPhysics(Properties* physics, Scene* scene)
     GP_ASSERT(Game::getInstance()->getPhysicsController());
 
     // Go through the supported global physics properties and apply them.
+    PhysicsController* controller = Game::getInstance()->getPhysicsController();
     Vector3 gravity;
     if (physics->getVector3("gravity", &gravity))
-        Game::getInstance()->getPhysicsController()->setGravity(gravity);
+        controller->setGravity(gravity);
+    if (physics->exists("stepRate"))
+        controller->setStepRate(physics->getFloat("stepRate"));
+    if (physics->exists("maxSubSteps"))
+        controller->setMaxSubSteps((unsigned int)physics->getInt("maxSubSteps"));
+    if (physics->exists("stepBudget"))
+        controller->setStepBudget(physics->getFloat("stepBudget"));
+    if (physics->exists("interpolation"))
+        controller->setInterpolationEnabled(physics->getBool("interpolation"));
+    if (physics->exists("threadCount"))
+        controller->setThreadCount((unsigned int)physics->getInt("threadCount"));
 
     Properties* constraint;
     const char* name;
@@ -1,103 +1,139 @@
 #include "Base.h"
 #include "ScriptController.h"
 #include "ScriptTarget.h"
+#include "JobScheduler.h"
+
+// The maximum number of distinct events that script targets can support.
+#define SCRIPT_TARGET_MAX_EVENTS 32
+
+// Compilers without va_copy either provide __va_copy or use a va_list that can be copied by assignment.
+#ifndef va_copy
+#ifdef __va_copy
+#define va_copy(dst, src) __va_copy(dst, src)
+#else
+#define va_copy(dst, src) ((dst) = (src))
+#endif
+#endif
 
 namespace gameplay
 {
 
 extern void splitURL(const std::string& url, std::string* file, std::string* id);
 
+// The events supported by any script target so far; the index of an event in this
+// list is its bit in ScriptTarget::_events.
+static const ScriptTarget::Event* __events[SCRIPT_TARGET_MAX_EVENTS];
+static unsigned int __eventCount = 0;
+
+// Script targets such as nodes may be created on worker threads, which register their events.
+static JobScheduler::Mutex __eventsMutex;
+
 ScriptTarget::ScriptTarget()
+    : _events(0), _callbacks(NULL), _firing(0)
 {
 }
 
 ScriptTarget::~ScriptTarget()
 {
-    std::map<std::string, std::vector<Callback>* >::iterator iter = _callbacks.begin();
-    for (; iter != _callbacks.end(); iter++)
-    {
-        SAFE_DELETE(iter->second);
-    }
+    SAFE_DELETE(_callbacks);
 }
 
-template<> void ScriptTarget::fireScriptEvent<void>(const char* eventName, ...)
+template<> void ScriptTarget::fireScriptEvent<void>(const Event* event, ...)
 {
+    GP_ASSERT(event);
+
+    if (!_callbacks)
+        return;
+
     va_list list;
-    va_start(list, eventName);
+    va_start(list, event);
 
-    std::map<std::string, std::vector<Callback>* >::iterator iter = _callbacks.find(eventName);
-    if (iter != _callbacks.end() && iter->second != NULL)
+    ++_firing;
+    ScriptController* sc = Game::getInstance()->getScriptController();
+    for (unsigned int i = 0; i < _callbacks->size(); i++)
     {
-        ScriptController* sc = Game::getInstance()->getScriptController();
+        if ((*_callbacks)[i].event != event)
+            continue;
+
+        // Copy the function name, since the callback may remove itself and shift the vector.
+        std::string function = (*_callbacks)[i].function;
 
-        if (_events[eventName].size() > 0)
+        if (event->args && event->args[0] != '\0')
         {
-            for (unsigned int i = 0; i < iter->second->size(); i++)
-            {
-                sc->executeFunction<void>((*iter->second)[i].function.c_str(), _events[eventName].c_str(), &list);
-            }
+            // Each callback consumes the argument list, so give each its own copy.
+            va_list args;
+            va_copy(args, list);
+            sc->executeFunction<void>(function.c_str(), event->args, &args);
+            va_end(args);
         }
         else
         {
-            for (unsigned int i = 0; i < iter->second->size(); i++)
-            {
-                sc->executeFunction<void>((*iter->second)[i].function.c_str(), _events[eventName].c_str());
-            }
+            sc->executeFunction<void>(function.c_str(), "");
         }
     }
 
     va_end(list);
+    endScriptEvent();
 }
 
-template<> bool ScriptTarget::fireScriptEvent<bool>(const char* eventName, ...)
+template<> bool ScriptTarget::fireScriptEvent<bool>(const Event* event, ...)
 {
+    GP_ASSERT(event);
+
+    if (!_callbacks)
+        return false;
+
     va_list list;
-    va_start(list, eventName);
+    va_start(list, event);
 
-    std::map<std::string, std::vector<Callback>* >::iterator iter = _callbacks.find(eventName);
-    if (iter != _callbacks.end() && iter->second)
+    ++_firing;
+    ScriptController* sc = Game::getInstance()->getScriptController();
+    for (unsigned int i = 0; i < _callbacks->size(); i++)
     {
-        ScriptController* sc = Game::getInstance()->getScriptController();
+        if ((*_callbacks)[i].event != event)
+            continue;
 
-        if (_events[eventName].size() > 0)
+        // Copy the function name, since the callback may remove itself and shift the vector.
+        std::string function = (*_callbacks)[i].function;
+
+        bool result;
+        if (event->args && event->args[0] != '\0')
         {
-            for (unsigned int i = 0; i < iter->second->size(); i++)
-            {
-                if (sc->executeFunction<bool>((*iter->second)[i].function.c_str(), _events[eventName].c_str(), &list))
-                {
-                    va_end(list);
-                    return true;
-                }
-            }
+            // Each callback consumes the argument list, so give each its own copy.
+            va_list args;
+            va_copy(args, list);
+            result = sc->executeFunction<bool>(function.c_str(), event->args, &args);
+            va_end(args);
         }
         else
         {
-            for (unsigned int i = 0; i < iter->second->size(); i++)
-            {
-                if (sc->executeFunction<bool>((*iter->second)[i].function.c_str(), _events[eventName].c_str()))
-                {
-                    va_end(list);
-                    return true;
-                }
-            }
+            result = sc->executeFunction<bool>(function.c_str(), "");
+        }
+
+        if (result)
+        {
+            va_end(list);
+            endScriptEvent();
+            return true;
         }
     }
 
     va_end(list);
+    endScriptEvent();
     return false;
 }
 
 void ScriptTarget::addScriptCallback(const std::string& eventName, const std::string& function)
 {
-    std::map<std::string, std::vector<Callback>* >::iterator iter = _callbacks.find(eventName);
-    if (iter != _callbacks.end())
+    const Event* event = findScriptEvent(eventName);
+    if (event)
     {
-        if (!iter->second)
-            iter->second = new std::vector<Callback>();
+        if (!_callbacks)
+            _callbacks = new std::vector<Callback>();
 
         // Add the function to the list of callbacks.
         std::string functionName = Game::getInstance()->getScriptController()->loadUrl(function.c_str());
-        iter->second->push_back(Callback(functionName));
+        _callbacks->push_back(Callback(event, functionName));
     }
     else
     {
@@ -107,10 +143,10 @@ void ScriptTarget::addScriptCallback(const std::string& eventName, const std::st
 
 void ScriptTarget::removeScriptCallback(const std::string& eventName, const std::string& function)
 {
-    std::map<std::string, std::vector<Callback>* >::iterator iter = _callbacks.find(eventName);
-    if (iter != _callbacks.end())
+    const Event* event = findScriptEvent(eventName);
+    if (event)
     {
-        if (!iter->second)
+        if (!_callbacks)
             return;
 
         std::string file;
@@ -122,14 +158,21 @@ void ScriptTarget::removeScriptCallback(const std::string& eventName, const std:
             return;
 
         // Remove the function from the list of callbacks.
-        for (unsigned int i = 0; i < iter->second->size(); i++)
+        for (unsigned int i = 0; i < _callbacks->size(); i++)
         {
-            if ((*iter->second)[i].function == id)
+            if ((*_callbacks)[i].event == event && (*_callbacks)[i].function == id)
             {
-                iter->second->erase(iter->second->begin() + i);
-                return;
+                _callbacks->erase(_callbacks->begin() + i);
+                break;
             }
         }
+
+        // Return to the fast path once the last callback is gone, unless an event
+        // is still iterating over the callbacks; then the outermost one deletes them.
+        if (_callbacks->empty() && _firing == 0)
+        {
+            SAFE_DELETE(_callbacks);
+        }
     }
     else
     {
@@ -137,13 +180,60 @@ void ScriptTarget::removeScriptCallback(const std::string& eventName, const std:
     }
 }
 
-void ScriptTarget::addScriptEvent(const std::string& eventName, const char* argsString)
+void ScriptTarget::endScriptEvent()
+{
+    GP_ASSERT(_firing > 0);
+
+    if (--_firing == 0 && _callbacks && _callbacks->empty())
+    {
+        SAFE_DELETE(_callbacks);
+    }
+}
+
+void ScriptTarget::addScriptEvent(const Event* event)
+{
+    GP_ASSERT(event && event->name);
+
+    // Look the event up in the registered events, registering it the first time it is seen.
+    __eventsMutex.lock();
+    unsigned int index = 0;
+    while (index < __eventCount && __events[index] != event)
+    {
+        ++index;
+    }
+    if (index == __eventCount && index < SCRIPT_TARGET_MAX_EVENTS)
+    {
+        __events[__eventCount++] = event;
+    }
+    __eventsMutex.unlock();
+
+    if (index >= SCRIPT_TARGET_MAX_EVENTS)
+    {
+        GP_ERROR("Too many script events; failed to register event '%s'.", event->name);
+        return;
+    }
+
+    _events |= (1u << index);
+}
+
+const ScriptTarget::Event* ScriptTarget::findScriptEvent(const std::string& eventName) const
 {
-    _events[eventName] = (argsString ? argsString : "");
-    _callbacks[eventName] = NULL;
+    const Event* event = NULL;
+    __eventsMutex.lock();
+    for (unsigned int i = 0; i < __eventCount; ++i)
+    {
+        if ((_events & (1u << i)) != 0 && eventName == __events[i]->name)
+        {
+            event = __events[i];
+            break;
+        }
+    }
+    __eventsMutex.unlock();
+    return event;
 }
 
-ScriptTarget::Callback::Callback(const std::string& function) : function(function)
+ScriptTarget::Callback::Callback(const Event* event, const std::string& function)
+    : event(event), function(function)
 {
 }
 
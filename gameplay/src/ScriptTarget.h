@@ -13,6 +13,24 @@ class ScriptTarget
 {
 public:
 
+    /**
+     * Describes an event that script targets can fire.
+     *
+     * Each event is defined once, as a static object in the source file of the class
+     * that fires it, and is identified by its address. This makes supporting and firing
+     * events free of string handling and allocations.
+     *
+     * @script{ignore}
+     */
+    struct Event
+    {
+        /** The name of the event, as passed to addScriptCallback(). */
+        const char* name;
+
+        /** The argument string for the event ({@link ScriptController::executeFunction}). */
+        const char* args;
+    };
+
     /**
      * Adds the given Lua script function as a callback for the given event.
      * 
@@ -44,46 +62,76 @@ protected:
     virtual ~ScriptTarget();
 
     /**
-     * Adds the given event with the given Lua script parameter string ({@link ScriptController::executeFunction})
-     * as a supported event for this script target.
+     * Adds the given event as a supported event for this script target.
      * 
-     * @param eventName The name of the event.
-     * @param argsString The argument string for the event.
+     * @param event The event, which must remain valid for the lifetime of the program.
      */
-    void addScriptEvent(const std::string& eventName, const char* argsString = NULL);
+    void addScriptEvent(const Event* event);
 
     /**
-     * Fires the event with the given event name and the given arguments.
+     * Returns whether any script callbacks are registered with this script target.
+     *
+     * Hot code paths can check this before firing events, to skip the call entirely
+     * for objects that are not scripted.
+     *
+     * @return true if there are script callbacks for any of this target's events.
+     */
+    inline bool hasScriptCallbacks() const;
+
+    /**
+     * Fires the given event with the given arguments.
      * 
-     * @param eventName The name of the event.
+     * @param event The event to fire.
      */
-    template<typename T> T fireScriptEvent(const char* eventName, ...);
+    template<typename T> T fireScriptEvent(const Event* event, ...);
 
-    /** Used to store a script callbacks for given event. */
+    /** Used to store a script callback for a given event. */
     struct Callback
     {
         /** Constructor. */
-        Callback(const std::string& string);
+        Callback(const Event* event, const std::string& function);
+
+        /** The event the callback is registered for. */
+        const Event* event;
 
         /** Holds the Lua script callback function. */
         std::string function;
     };
 
-    /** Holds the supported events for this script target. */
-    std::map<std::string, std::string> _events;
-    /** Holds the callbacks for this script target's events. */
-    std::map<std::string, std::vector<Callback>*> _callbacks;
+    /** The supported events of this script target, as a bit mask of registered event indices. */
+    unsigned int _events;
+    /** Holds the callbacks for this script target's events, or NULL when there are none. */
+    std::vector<Callback>* _callbacks;
+    /** The number of fireScriptEvent calls in progress, which keeps _callbacks alive while a callback removes itself. */
+    unsigned int _firing;
+
+private:
+
+    /**
+     * Finds a supported event of this script target by name.
+     */
+    const Event* findScriptEvent(const std::string& eventName) const;
+
+    /**
+     * Ends a fireScriptEvent call, deleting the callbacks if the last one was removed while it fired.
+     */
+    void endScriptEvent();
 };
 
-template<typename T> T ScriptTarget::fireScriptEvent(const char* eventName, ...)
+inline bool ScriptTarget::hasScriptCallbacks() const
+{
+    return _callbacks != NULL;
+}
+
+template<typename T> T ScriptTarget::fireScriptEvent(const Event* event, ...)
 {
     GP_ERROR("Unsupported return type!");
 }
 
 /** Template specialization. */
-template<> void ScriptTarget::fireScriptEvent<void>(const char* eventName, ...);
+template<> void ScriptTarget::fireScriptEvent<void>(const Event* event, ...);
 /** Template specialization. */
-template<> bool ScriptTarget::fireScriptEvent<bool>(const char* eventName, ...);
+template<> bool ScriptTarget::fireScriptEvent<bool>(const Event* event, ...);
 
 }
 
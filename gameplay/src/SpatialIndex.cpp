@@ -0,0 +1,527 @@
+#include "Base.h"
+#include "SpatialIndex.h"
+#include "Frustum.h"
+#include "Ray.h"
+
+// Fraction of a sphere's radius that its leaf box is enlarged by.
+#define LEAF_MARGIN 0.25f
+
+// A leaf box this many margins larger than its sphere is shrunk back.
+#define LEAF_SHRINK_MARGINS 4.0f
+
+namespace gameplay
+{
+
+static void boxFromSphere(const BoundingSphere& sphere, float margin, BoundingBox* box)
+{
+    float extent = sphere.radius + margin;
+    box->min.set(sphere.center.x - extent, sphere.center.y - extent, sphere.center.z - extent);
+    box->max.set(sphere.center.x + extent, sphere.center.y + extent, sphere.center.z + extent);
+}
+
+static bool contains(const BoundingBox& outer, const BoundingBox& inner)
+{
+    return outer.min.x <= inner.min.x && outer.min.y <= inner.min.y && outer.min.z <= inner.min.z &&
+           outer.max.x >= inner.max.x && outer.max.y >= inner.max.y && outer.max.z >= inner.max.z;
+}
+
+static float surfaceArea(const BoundingBox& box)
+{
+    float x = box.max.x - box.min.x;
+    float y = box.max.y - box.min.y;
+    float z = box.max.z - box.min.z;
+    return 2.0f * (x * y + y * z + z * x);
+}
+
+static void mergeBoxes(const BoundingBox& a, const BoundingBox& b, BoundingBox* dst)
+{
+    *dst = a;
+    dst->merge(b);
+}
+
+SpatialIndex::SpatialIndex()
+    : _root(-1), _freeList(-1), _count(0)
+{
+}
+
+SpatialIndex::~SpatialIndex()
+{
+}
+
+int SpatialIndex::insert(Node* node, const BoundingSphere& sphere)
+{
+    GP_ASSERT(node);
+
+    int leaf = allocateNode();
+    TreeNode& treeNode = _nodes[leaf];
+    treeNode.node = node;
+    treeNode.sphere = sphere;
+    boxFromSphere(sphere, sphere.radius * LEAF_MARGIN, &treeNode.box);
+    insertLeaf(leaf);
+    ++_count;
+
+    return leaf;
+}
+
+void SpatialIndex::update(int proxy, const BoundingSphere& sphere)
+{
+    GP_ASSERT(proxy >= 0 && proxy < (int)_nodes.size() && _nodes[proxy].isLeaf());
+
+    TreeNode& treeNode = _nodes[proxy];
+    treeNode.sphere = sphere;
+
+    // Leave the tree alone while the sphere stays inside its leaf box and fills enough of it.
+    float margin = sphere.radius * LEAF_MARGIN;
+    BoundingBox box, shrinkBox;
+    boxFromSphere(sphere, 0.0f, &box);
+    boxFromSphere(sphere, margin * LEAF_SHRINK_MARGINS, &shrinkBox);
+    if (contains(treeNode.box, box) && contains(shrinkBox, treeNode.box))
+        return;
+
+    removeLeaf(proxy);
+    boxFromSphere(sphere, margin, &_nodes[proxy].box);
+    insertLeaf(proxy);
+}
+
+void SpatialIndex::remove(int proxy)
+{
+    GP_ASSERT(proxy >= 0 && proxy < (int)_nodes.size() && _nodes[proxy].isLeaf());
+
+    removeLeaf(proxy);
+    freeNode(proxy);
+    --_count;
+}
+
+unsigned int SpatialIndex::getCount() const
+{
+    return _count;
+}
+
+unsigned int SpatialIndex::getHeight() const
+{
+    return _root >= 0 ? (unsigned int)_nodes[_root].height + 1 : 0;
+}
+
+unsigned int SpatialIndex::query(const Frustum& frustum, std::vector<Node*>& nodes) const
+{
+    size_t size = nodes.size();
+    if (_root >= 0)
+    {
+        const Plane* planes[6] = { &frustum.getNear(), &frustum.getFar(), &frustum.getLeft(),
+            &frustum.getRight(), &frustum.getBottom(), &frustum.getTop() };
+        queryFrustum(_root, planes, 0x3F, nodes);
+    }
+    return (unsigned int)(nodes.size() - size);
+}
+
+unsigned int SpatialIndex::query(const BoundingSphere& sphere, std::vector<Node*>& nodes) const
+{
+    size_t size = nodes.size();
+    std::vector<int> stack;
+    if (_root >= 0)
+        stack.push_back(_root);
+
+    while (!stack.empty())
+    {
+        const TreeNode& treeNode = _nodes[stack.back()];
+        stack.pop_back();
+
+        if (treeNode.isLeaf())
+        {
+            if (sphere.intersects(treeNode.sphere))
+                nodes.push_back(treeNode.node);
+        }
+        else if (sphere.intersects(treeNode.box))
+        {
+            stack.push_back(treeNode.child1);
+            stack.push_back(treeNode.child2);
+        }
+    }
+    return (unsigned int)(nodes.size() - size);
+}
+
+unsigned int SpatialIndex::query(const BoundingBox& box, std::vector<Node*>& nodes) const
+{
+    size_t size = nodes.size();
+    std::vector<int> stack;
+    if (_root >= 0)
+        stack.push_back(_root);
+
+    while (!stack.empty())
+    {
+        const TreeNode& treeNode = _nodes[stack.back()];
+        stack.pop_back();
+
+        if (treeNode.isLeaf())
+        {
+            if (box.intersects(treeNode.sphere))
+                nodes.push_back(treeNode.node);
+        }
+        else if (box.intersects(treeNode.box))
+        {
+            stack.push_back(treeNode.child1);
+            stack.push_back(treeNode.child2);
+        }
+    }
+    return (unsigned int)(nodes.size() - size);
+}
+
+unsigned int SpatialIndex::query(const Ray& ray, std::vector<Node*>& nodes) const
+{
+    size_t size = nodes.size();
+    std::vector<int> stack;
+    if (_root >= 0)
+        stack.push_back(_root);
+
+    while (!stack.empty())
+    {
+        const TreeNode& treeNode = _nodes[stack.back()];
+        stack.pop_back();
+
+        if (treeNode.isLeaf())
+        {
+            if (ray.intersects(treeNode.sphere) != Ray::INTERSECTS_NONE)
+                nodes.push_back(treeNode.node);
+        }
+        else if (ray.intersects(treeNode.box) != Ray::INTERSECTS_NONE)
+        {
+            stack.push_back(treeNode.child1);
+            stack.push_back(treeNode.child2);
+        }
+    }
+    return (unsigned int)(nodes.size() - size);
+}
+
+void SpatialIndex::queryFrustum(int index, const Plane* const* planes, unsigned int planeMask, std::vector<Node*>& nodes) const
+{
+    const TreeNode& treeNode = _nodes[index];
+
+    if (treeNode.isLeaf())
+    {
+        // Same test as BoundingSphere::intersects(const Frustum&), skipping the planes
+        // that an ancestor box (and so this sphere) lies entirely in front of.
+        const BoundingSphere& sphere = treeNode.sphere;
+        for (unsigned int i = 0; i < 6; ++i)
+        {
+            if (planeMask & (1 << i))
+            {
+                const Vector3& normal = planes[i]->getNormal();
+                float distance = normal.x * sphere.center.x + normal.y * sphere.center.y + normal.z * sphere.center.z + planes[i]->getDistance();
+                if (distance < -sphere.radius)
+                    return;
+            }
+        }
+        nodes.push_back(treeNode.node);
+        return;
+    }
+
+    const BoundingBox& box = treeNode.box;
+    float centerX = (box.min.x + box.max.x) * 0.5f;
+    float centerY = (box.min.y + box.max.y) * 0.5f;
+    float centerZ = (box.min.z + box.max.z) * 0.5f;
+    float extentX = (box.max.x - box.min.x) * 0.5f;
+    float extentY = (box.max.y - box.min.y) * 0.5f;
+    float extentZ = (box.max.z - box.min.z) * 0.5f;
+
+    for (unsigned int i = 0; i < 6; ++i)
+    {
+        if (!(planeMask & (1 << i)))
+            continue;
+
+        const Vector3& normal = planes[i]->getNormal();
+        float distance = normal.x * centerX + normal.y * centerY + normal.z * centerZ + planes[i]->getDistance();
+        float radius = extentX * fabs(normal.x) + extentY * fabs(normal.y) + extentZ * fabs(normal.z);
+        if (distance < -radius)
+            return;
+        if (distance > radius)
+            planeMask &= ~(1 << i);
+    }
+
+    if (planeMask == 0)
+    {
+        // The box is entirely inside the frustum, so every sphere below it is too.
+        collectLeaves(index, nodes);
+        return;
+    }
+
+    queryFrustum(treeNode.child1, planes, planeMask, nodes);
+    queryFrustum(treeNode.child2, planes, planeMask, nodes);
+}
+
+void SpatialIndex::collectLeaves(int index, std::vector<Node*>& nodes) const
+{
+    const TreeNode& treeNode = _nodes[index];
+    if (treeNode.isLeaf())
+    {
+        nodes.push_back(treeNode.node);
+    }
+    else
+    {
+        collectLeaves(treeNode.child1, nodes);
+        collectLeaves(treeNode.child2, nodes);
+    }
+}
+
+int SpatialIndex::allocateNode()
+{
+    int index;
+    if (_freeList >= 0)
+    {
+        index = _freeList;
+        _freeList = _nodes[index].parent;
+    }
+    else
+    {
+        index = (int)_nodes.size();
+        _nodes.push_back(TreeNode());
+    }
+
+    TreeNode& treeNode = _nodes[index];
+    treeNode.node = NULL;
+    treeNode.parent = -1;
+    treeNode.child1 = -1;
+    treeNode.child2 = -1;
+    treeNode.height = 0;
+    return index;
+}
+
+void SpatialIndex::freeNode(int index)
+{
+    // Free nodes are chained through their parent index.
+    _nodes[index].node = NULL;
+    _nodes[index].parent = _freeList;
+    _nodes[index].height = -1;
+    _freeList = index;
+}
+
+void SpatialIndex::insertLeaf(int leaf)
+{
+    if (_root < 0)
+    {
+        _root = leaf;
+        _nodes[leaf].parent = -1;
+        return;
+    }
+
+    // Descend towards the sibling that minimizes the increase in surface area of the tree.
+    BoundingBox leafBox = _nodes[leaf].box;
+    BoundingBox merged;
+    int index = _root;
+    while (!_nodes[index].isLeaf())
+    {
+        const TreeNode& treeNode = _nodes[index];
+
+        mergeBoxes(treeNode.box, leafBox, &merged);
+        float mergedArea = surfaceArea(merged);
+
+        // Cost of pairing the leaf with this node, and the cost pushed down to its children.
+        float cost = 2.0f * mergedArea;
+        float inheritedCost = 2.0f * (mergedArea - surfaceArea(treeNode.box));
+
+        float childCosts[2];
+        int children[2] = { treeNode.child1, treeNode.child2 };
+        for (int i = 0; i < 2; ++i)
+        {
+            const TreeNode& child = _nodes[children[i]];
+            mergeBoxes(child.box, leafBox, &merged);
+            childCosts[i] = surfaceArea(merged) + inheritedCost;
+            if (!child.isLeaf())
+                childCosts[i] -= surfaceArea(child.box);
+        }
+
+        if (cost < childCosts[0] && cost < childCosts[1])
+            break;
+
+        index = childCosts[0] < childCosts[1] ? children[0] : children[1];
+    }
+
+    // Replace the sibling with a new parent of the sibling and the leaf.
+    int sibling = index;
+    int oldParent = _nodes[sibling].parent;
+    int newParent = allocateNode();
+    TreeNode& parentNode = _nodes[newParent];
+    parentNode.parent = oldParent;
+    mergeBoxes(_nodes[sibling].box, leafBox, &parentNode.box);
+    parentNode.height = _nodes[sibling].height + 1;
+    parentNode.child1 = sibling;
+    parentNode.child2 = leaf;
+    _nodes[sibling].parent = newParent;
+    _nodes[leaf].parent = newParent;
+
+    if (oldParent >= 0)
+    {
+        if (_nodes[oldParent].child1 == sibling)
+            _nodes[oldParent].child1 = newParent;
+        else
+            _nodes[oldParent].child2 = newParent;
+    }
+    else
+    {
+        _root = newParent;
+    }
+
+    refit(newParent);
+}
+
+void SpatialIndex::removeLeaf(int leaf)
+{
+    if (leaf == _root)
+    {
+        _root = -1;
+        return;
+    }
+
+    // Replace the parent of the leaf with the leaf's sibling.
+    int parent = _nodes[leaf].parent;
+    int grandParent = _nodes[parent].parent;
+    int sibling = _nodes[parent].child1 == leaf ? _nodes[parent].child2 : _nodes[parent].child1;
+
+    if (grandParent >= 0)
+    {
+        if (_nodes[grandParent].child1 == parent)
+            _nodes[grandParent].child1 = sibling;
+        else
+            _nodes[grandParent].child2 = sibling;
+        _nodes[sibling].parent = grandParent;
+        freeNode(parent);
+
+        refit(grandParent);
+    }
+    else
+    {
+        _root = sibling;
+        _nodes[sibling].parent = -1;
+        freeNode(parent);
+    }
+
+    _nodes[leaf].parent = -1;
+}
+
+void SpatialIndex::refit(int index)
+{
+    // Rebalance and recompute the boxes and heights of the ancestors of a changed node.
+    while (index >= 0)
+    {
+        index = balance(index);
+
+        TreeNode& treeNode = _nodes[index];
+        const TreeNode& child1 = _nodes[treeNode.child1];
+        const TreeNode& child2 = _nodes[treeNode.child2];
+        treeNode.height = 1 + std::max(child1.height, child2.height);
+        mergeBoxes(child1.box, child2.box, &treeNode.box);
+
+        index = treeNode.parent;
+    }
+}
+
+int SpatialIndex::balance(int indexA)
+{
+    // Rotates the taller child of A up into A's place if A's subtrees differ in height by more than one.
+    TreeNode& a = _nodes[indexA];
+    if (a.isLeaf() || a.height < 2)
+        return indexA;
+
+    int indexB = a.child1;
+    int indexC = a.child2;
+    TreeNode& b = _nodes[indexB];
+    TreeNode& c = _nodes[indexC];
+    int difference = c.height - b.height;
+
+    if (difference > 1)
+    {
+        // Rotate C up.
+        int indexF = c.child1;
+        int indexG = c.child2;
+        TreeNode& f = _nodes[indexF];
+        TreeNode& g = _nodes[indexG];
+
+        c.child1 = indexA;
+        c.parent = a.parent;
+        a.parent = indexC;
+
+        if (c.parent >= 0)
+        {
+            if (_nodes[c.parent].child1 == indexA)
+                _nodes[c.parent].child1 = indexC;
+            else
+                _nodes[c.parent].child2 = indexC;
+        }
+        else
+        {
+            _root = indexC;
+        }
+
+        if (f.height > g.height)
+        {
+            c.child2 = indexF;
+            a.child2 = indexG;
+            g.parent = indexA;
+            mergeBoxes(b.box, g.box, &a.box);
+            mergeBoxes(a.box, f.box, &c.box);
+            a.height = 1 + std::max(b.height, g.height);
+            c.height = 1 + std::max(a.height, f.height);
+        }
+        else
+        {
+            c.child2 = indexG;
+            a.child2 = indexF;
+            f.parent = indexA;
+            mergeBoxes(b.box, f.box, &a.box);
+            mergeBoxes(a.box, g.box, &c.box);
+            a.height = 1 + std::max(b.height, f.height);
+            c.height = 1 + std::max(a.height, g.height);
+        }
+        return indexC;
+    }
+
+    if (difference < -1)
+    {
+        // Rotate B up.
+        int indexD = b.child1;
+        int indexE = b.child2;
+        TreeNode& d = _nodes[indexD];
+        TreeNode& e = _nodes[indexE];
+
+        b.child1 = indexA;
+        b.parent = a.parent;
+        a.parent = indexB;
+
+        if (b.parent >= 0)
+        {
+            if (_nodes[b.parent].child1 == indexA)
+                _nodes[b.parent].child1 = indexB;
+            else
+                _nodes[b.parent].child2 = indexB;
+        }
+        else
+        {
+            _root = indexB;
+        }
+
+        if (d.height > e.height)
+        {
+            b.child2 = indexD;
+            a.child1 = indexE;
+            e.parent = indexA;
+            mergeBoxes(c.box, e.box, &a.box);
+            mergeBoxes(a.box, d.box, &b.box);
+            a.height = 1 + std::max(c.height, e.height);
+            b.height = 1 + std::max(a.height, d.height);
+        }
+        else
+        {
+            b.child2 = indexE;
+            a.child1 = indexD;
+            d.parent = indexA;
+            mergeBoxes(c.box, d.box, &a.box);
+            mergeBoxes(a.box, e.box, &b.box);
+            a.height = 1 + std::max(c.height, d.height);
+            b.height = 1 + std::max(a.height, e.height);
+        }
+        return indexB;
+    }
+
+    return indexA;
+}
+
+}
@@ -0,0 +1,175 @@
+#ifndef SPATIALINDEX_H_
+#define SPATIALINDEX_H_
+
+#include "BoundingBox.h"
+#include "BoundingSphere.h"
+
+namespace gameplay
+{
+
+class Frustum;
+class Node;
+class Plane;
+class Ray;
+
+/**
+ * Defines a bounding volume hierarchy over the bounding spheres of nodes.
+ *
+ * The index is a dynamic AABB tree. Each sphere is stored in a leaf whose box is
+ * enlarged by a margin, so that nodes moving by small amounts do not change the
+ * shape of the tree. Inserting and removing leaves keeps the tree balanced with
+ * tree rotations, so queries descend O(log n) levels. Queries only visit subtrees
+ * whose boxes overlap the query volume, and test the exact spheres at the leaves.
+ *
+ * @see Scene::setSpatialIndexEnabled(bool)
+ * @script{ignore}
+ */
+class SpatialIndex
+{
+public:
+
+    /**
+     * Constructor.
+     */
+    SpatialIndex();
+
+    /**
+     * Destructor.
+     */
+    ~SpatialIndex();
+
+    /**
+     * Adds a node to the index.
+     *
+     * @param node The node to add.
+     * @param sphere The bounding sphere of the node, in world space.
+     *
+     * @return The proxy identifying the node within the index.
+     */
+    int insert(Node* node, const BoundingSphere& sphere);
+
+    /**
+     * Updates the bounding sphere of a node in the index.
+     *
+     * The tree is only changed if the sphere has left the enlarged box of its leaf
+     * or has become much smaller than it.
+     *
+     * @param proxy The proxy returned when the node was added.
+     * @param sphere The new bounding sphere of the node, in world space.
+     */
+    void update(int proxy, const BoundingSphere& sphere);
+
+    /**
+     * Removes a node from the index.
+     *
+     * @param proxy The proxy returned when the node was added.
+     */
+    void remove(int proxy);
+
+    /**
+     * Returns the number of nodes in the index.
+     *
+     * @return The number of nodes in the index.
+     */
+    unsigned int getCount() const;
+
+    /**
+     * Returns the height of the tree, which is 0 when the index is empty.
+     *
+     * @return The height of the tree.
+     */
+    unsigned int getHeight() const;
+
+    /**
+     * Finds the nodes whose bounding sphere intersects the given frustum.
+     *
+     * @param frustum The frustum to test against.
+     * @param nodes The vector the nodes found are appended to.
+     *
+     * @return The number of nodes found.
+     */
+    unsigned int query(const Frustum& frustum, std::vector<Node*>& nodes) const;
+
+    /**
+     * Finds the nodes whose bounding sphere intersects the given sphere.
+     *
+     * @param sphere The sphere to test against.
+     * @param nodes The vector the nodes found are appended to.
+     *
+     * @return The number of nodes found.
+     */
+    unsigned int query(const BoundingSphere& sphere, std::vector<Node*>& nodes) const;
+
+    /**
+     * Finds the nodes whose bounding sphere intersects the given box.
+     *
+     * @param box The box to test against.
+     * @param nodes The vector the nodes found are appended to.
+     *
+     * @return The number of nodes found.
+     */
+    unsigned int query(const BoundingBox& box, std::vector<Node*>& nodes) const;
+
+    /**
+     * Finds the nodes whose bounding sphere is intersected by the given ray.
+     *
+     * @param ray The ray to test against.
+     * @param nodes The vector the nodes found are appended to.
+     *
+     * @return The number of nodes found.
+     */
+    unsigned int query(const Ray& ray, std::vector<Node*>& nodes) const;
+
+private:
+
+    /**
+     * A node of the tree; either a leaf holding a scene node or an internal node with two children.
+     */
+    struct TreeNode
+    {
+        BoundingBox box;
+        BoundingSphere sphere;
+        Node* node;
+        int parent;
+        int child1;
+        int child2;
+        int height;
+
+        bool isLeaf() const { return child1 < 0; }
+    };
+
+    /**
+     * Hidden copy constructor.
+     */
+    SpatialIndex(const SpatialIndex& copy);
+
+    /**
+     * Hidden copy assignment operator.
+     */
+    SpatialIndex& operator=(const SpatialIndex&);
+
+    int allocateNode();
+
+    void freeNode(int index);
+
+    void insertLeaf(int leaf);
+
+    void removeLeaf(int leaf);
+
+    int balance(int index);
+
+    void refit(int index);
+
+    void queryFrustum(int index, const Plane* const* planes, unsigned int planeMask, std::vector<Node*>& nodes) const;
+
+    void collectLeaves(int index, std::vector<Node*>& nodes) const;
+
+    std::vector<TreeNode> _nodes;
+    int _root;
+    int _freeList;
+    unsigned int _count;
+};
+
+}
+
+#endif
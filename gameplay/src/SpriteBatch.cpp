@@ -369,6 +369,13 @@ void SpriteBatch::finish()
     _batch->draw();
 }
 
+void SpriteBatch::finish(RenderQueue* queue, const Vector3& position)
+{
+    // Finish the batch and add it to the queue
+    _batch->finish();
+    _batch->draw(queue, position);
+}
+
 RenderState::StateBlock* SpriteBatch::getStateBlock() const
 {
     return _batch->getMaterial()->getStateBlock();
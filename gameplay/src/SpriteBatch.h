@@ -245,6 +245,17 @@ public:
      */
     void finish();
 
+    /**
+     * Finishes sprite drawing, adding the sprites drawn since the last call to start()
+     * to a render queue instead of drawing them.
+     *
+     * The batch must not be started again until the queue has been drawn.
+     *
+     * @param queue The render queue to add the sprites to.
+     * @param position The world space position the sprites are ordered by depth from.
+     */
+    void finish(RenderQueue* queue, const Vector3& position);
+
     /**
      * Gets the texture sampler. 
      *
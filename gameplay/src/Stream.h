@@ -66,6 +66,24 @@ public:
      */
     virtual size_t read(void* ptr, size_t size, size_t count) = 0;
 
+    /**
+     * Reads <code>size</code> bytes without copying them, by returning a pointer to
+     * where they are already held in memory.
+     *
+     * This is only supported by streams whose contents are mapped into memory, such as
+     * streams opened with FileSystem::MAPPED. The returned memory is read-only and remains
+     * valid until the stream is closed.
+     *
+     * @param size The number of bytes to read.
+     *
+     * @return A pointer to the bytes read, or NULL if the stream does not support reading
+     *         in place or fewer than <code>size</code> bytes remain. The position of the
+     *         stream is left unchanged when NULL is returned.
+     *
+     * @see read()
+     */
+    virtual const void* readInPlace(size_t size) { return NULL; }
+
     /**
      * Reads a line from the stream.
      * 
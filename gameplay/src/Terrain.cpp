@@ -517,6 +517,14 @@ void Terrain::draw(bool wireframe)
     }
 }
 
+void Terrain::draw(RenderQueue* queue, bool wireframe)
+{
+    for (size_t i = 0, count = _patches.size(); i < count; ++i)
+    {
+        _patches[i]->draw(queue, wireframe);
+    }
+}
+
 void Terrain::transformChanged(Transform* transform, long cookie)
 {
     _dirtyFlags |= TERRAIN_DIRTY_WORLD_MATRIX | TERRAIN_DIRTY_INV_WORLD_MATRIX | TERRAIN_DIRTY_NORMAL_MATRIX;
@@ -12,6 +12,7 @@ namespace gameplay
 {
 
 class Node;
+class RenderQueue;
 class TerrainPatch;
 
 /**
@@ -314,6 +315,14 @@ public:
      */
     void draw(bool wireframe = false);
 
+    /**
+     * Adds the draws of the visible terrain patches to a render queue instead of drawing them.
+     *
+     * @param queue The render queue to add the draws to.
+     * @param wireframe True to draw the terrain as wireframe, false to draw it solid (default).
+     */
+    void draw(RenderQueue* queue, bool wireframe = false);
+
     /**
      * @see Transform::Listener::transformChanged.
      *
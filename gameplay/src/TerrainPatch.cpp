@@ -515,26 +515,44 @@ bool TerrainPatch::updateMaterial()
 
 void TerrainPatch::draw(bool wireframe)
 {
+    BoundingBox bounds;
+    Model* model = getModelToDraw(&bounds);
+    if (model)
+        model->draw(wireframe);
+}
+
+void TerrainPatch::draw(RenderQueue* queue, bool wireframe)
+{
+    BoundingBox bounds;
+    Model* model = getModelToDraw(&bounds);
+    if (model)
+        model->addToQueue(queue, wireframe, bounds.getCenter());
+}
+
+Model* TerrainPatch::getModelToDraw(BoundingBox* bounds)
+{
+    GP_ASSERT(bounds);
+
     Scene* scene = _terrain->_node ? _terrain->_node->getScene() : NULL;
     Camera* camera = scene ? scene->getActiveCamera() : NULL;
     if (!camera)
-        return;
+        return NULL;
 
     // Get our world-space bounding box
-    BoundingBox bounds = getBoundingBox(true);
+    *bounds = getBoundingBox(true);
 
     // If the box does not intersect the view frustum, cull it
-    if (_terrain->isFlagSet(Terrain::FRUSTUM_CULLING) && !camera->getFrustum().intersects(bounds))
-        return;
+    if (_terrain->isFlagSet(Terrain::FRUSTUM_CULLING) && !camera->getFrustum().intersects(*bounds))
+        return NULL;
 
     if (!updateMaterial())
-        return;
+        return NULL;
 
     // Compute the LOD level from the camera's perspective
-    size_t lod = computeLOD(camera, bounds);
+    size_t lod = computeLOD(camera, *bounds);
 
-    // Draw the model for the current LOD
-    _levels[lod]->model->draw(wireframe);
+    // The model for the current LOD
+    return _levels[lod]->model;
 }
 
 bool TerrainPatch::isVisible() const
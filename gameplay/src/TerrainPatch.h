@@ -7,6 +7,7 @@
 namespace gameplay
 {
 
+class RenderQueue;
 class Terrain;
 
 /**
@@ -121,6 +122,19 @@ private:
      */
     void draw(bool wireframe);
 
+    /**
+     * Adds the draw of the terrain patch to a render queue.
+     */
+    void draw(RenderQueue* queue, bool wireframe);
+
+    /**
+     * Culls the patch against the view frustum of the active camera and returns the model
+     * of the LOD to draw it with, or NULL if the patch is not visible.
+     *
+     * @param bounds Set to the world space bounding box of the patch.
+     */
+    Model* getModelToDraw(BoundingBox* bounds);
+
     /**
      * Updates the material for the patch.
      */
@@ -929,4 +929,12 @@ void Texture::Sampler::bind()
     }
 }
 
+bool Texture::Sampler::isStateApplied() const
+{
+    GP_ASSERT(_texture);
+
+    return _texture->_minFilter == _minFilter && _texture->_magFilter == _magFilter &&
+           _texture->_wrapS == _wrapS && _texture->_wrapT == _wrapT;
+}
+
 }
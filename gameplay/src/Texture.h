@@ -62,6 +62,7 @@ public:
     class Sampler : public Ref
     {
         friend class Texture;
+        friend class Effect;
 
     public:
 
@@ -131,6 +132,11 @@ public:
          */
         Sampler& operator=(const Sampler&);
 
+        /**
+         * Determines whether the wrap and filter modes of this sampler are those last applied to its texture.
+         */
+        bool isStateApplied() const;
+
         Texture* _texture;
         Wrap _wrapS;
         Wrap _wrapT;
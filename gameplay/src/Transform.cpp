@@ -6,6 +6,8 @@
 namespace gameplay
 {
 
+static const ScriptTarget::Event __transformChangedEvent = { "transformChanged", "<Transform>" };
+
 int Transform::_suspendTransformChanged(0);
 std::vector<Transform*> Transform::_transformsChanged;
 
@@ -14,7 +16,7 @@ Transform::Transform()
 {
     _targetType = AnimationTarget::TRANSFORM;
     _scale.set(Vector3::one());
-    addScriptEvent("transformChanged", "<Transform>");
+    addScriptEvent(&__transformChangedEvent);
 }
 
 Transform::Transform(const Vector3& scale, const Quaternion& rotation, const Vector3& translation)
@@ -22,7 +24,7 @@ Transform::Transform(const Vector3& scale, const Quaternion& rotation, const Vec
 {
     _targetType = AnimationTarget::TRANSFORM;
     set(scale, rotation, translation);
-    addScriptEvent("transformChanged", "<Transform>");
+    addScriptEvent(&__transformChangedEvent);
 }
 
 Transform::Transform(const Vector3& scale, const Matrix& rotation, const Vector3& translation)
@@ -30,7 +32,7 @@ Transform::Transform(const Vector3& scale, const Matrix& rotation, const Vector3
 {
     _targetType = AnimationTarget::TRANSFORM;
     set(scale, rotation, translation);
-    addScriptEvent("transformChanged", "<Transform>");
+    addScriptEvent(&__transformChangedEvent);
 }
 
 Transform::Transform(const Transform& copy)
@@ -38,7 +40,7 @@ Transform::Transform(const Transform& copy)
 {
     _targetType = AnimationTarget::TRANSFORM;
     set(copy);
-    addScriptEvent("transformChanged", "<Transform>");
+    addScriptEvent(&__transformChangedEvent);
 }
 
 Transform::~Transform()
@@ -991,7 +993,10 @@ void Transform::transformChanged()
             l.listener->transformChanged(this, l.cookie);
         }
     }
-    fireScriptEvent<void>("transformChanged", this);
+    if (hasScriptCallbacks())
+    {
+        fireScriptEvent<void>(&__transformChangedEvent, this);
+    }
 }
 
 void Transform::cloneInto(Transform* transform, NodeCloneContext &context) const
@@ -13,11 +13,9 @@ VertexFormat::VertexFormat(const Element* elements, unsigned int elementCount)
     for (unsigned int i = 0; i < elementCount; ++i)
     {
         // Copy element
-        Element element;
-        memcpy(&element, &elements[i], sizeof(Element));
-        _elements.push_back(element);
+        _elements.push_back(elements[i]);
 
-        _vertexSize += element.size * sizeof(float);
+        _vertexSize += elements[i].getByteSize();
     }
 }
 
@@ -62,18 +60,28 @@ bool VertexFormat::operator != (const VertexFormat& f) const
 }
 
 VertexFormat::Element::Element() :
-    usage(POSITION), size(0)
+    usage(POSITION), size(0), type(FLOAT), normalized(false)
 {
 }
 
 VertexFormat::Element::Element(Usage usage, unsigned int size) :
-    usage(usage), size(size)
+    usage(usage), size(size), type(FLOAT), normalized(false)
 {
 }
 
+VertexFormat::Element::Element(Usage usage, unsigned int size, Type type, bool normalized) :
+    usage(usage), size(size), type(type), normalized(normalized)
+{
+}
+
+unsigned int VertexFormat::Element::getByteSize() const
+{
+    return (size * getTypeSize(type) + 3) & ~3u;
+}
+
 bool VertexFormat::Element::operator == (const VertexFormat::Element& e) const
 {
-    return (size == e.size && usage == e.usage);
+    return (size == e.size && usage == e.usage && type == e.type && normalized == e.normalized);
 }
 
 bool VertexFormat::Element::operator != (const VertexFormat::Element& e) const
@@ -120,4 +128,19 @@ const char* VertexFormat::toString(Usage usage)
     }
 }
 
+unsigned int VertexFormat::getTypeSize(Type type)
+{
+    switch (type)
+    {
+    case BYTE:
+    case UNSIGNED_BYTE:
+        return 1;
+    case SHORT:
+    case UNSIGNED_SHORT:
+        return 2;
+    default:
+        return sizeof(float);
+    }
+}
+
 }
@@ -36,13 +36,27 @@ public:
         TEXCOORD7 = 15
     };
 
+    /**
+     * Defines the data types of the values in a vertex element.
+     */
+    enum Type
+    {
+        FLOAT = 0,
+        BYTE = 1,
+        UNSIGNED_BYTE = 2,
+        SHORT = 3,
+        UNSIGNED_SHORT = 4
+    };
+
     /**
      * Defines a single element within a vertex format.
      *
-     * All vertex elements are assumed to be of type float, but can
-     * have a varying number of float values (1-4), which is represented
-     * by the size attribute. Additionally, vertex elements are assumed
-     * to be tightly packed.
+     * A vertex element has a varying number of values (1-4), which is
+     * represented by the size attribute, all of the same type. Elements are
+     * of type float unless specified otherwise; integer elements may be
+     * normalized, in which case they are read by shaders as floats in the
+     * range [0, 1] (unsigned) or [-1, 1] (signed). Each element starts on a
+     * four byte boundary, and elements are otherwise tightly packed.
      */
     class Element
     {
@@ -57,6 +71,16 @@ public:
          */
         unsigned int size;
 
+        /**
+         * The type of the values in the vertex element.
+         */
+        Type type;
+
+        /**
+         * Whether integer values are normalized when read by a shader.
+         */
+        bool normalized;
+
         /**
          * Constructor.
          */
@@ -70,6 +94,24 @@ public:
          */
         Element(Usage usage, unsigned int size);
 
+        /**
+         * Constructor.
+         *
+         * @param usage The vertex element usage semantic.
+         * @param size The number of values in the vertex element.
+         * @param type The type of the values in the vertex element.
+         * @param normalized Whether integer values are normalized when read by a shader.
+         */
+        Element(Usage usage, unsigned int size, Type type, bool normalized);
+
+        /**
+         * Gets the number of bytes occupied by this element in a vertex,
+         * including the padding up to the next four byte boundary.
+         *
+         * @return The size of the element in bytes.
+         */
+        unsigned int getByteSize() const;
+
         /**
          * Compares two vertex elements for equality.
          *
@@ -146,6 +188,15 @@ public:
      */
     static const char* toString(Usage usage);
 
+    /**
+     * Gets the size (in bytes) of a single value of the given type.
+     *
+     * @param type The value type.
+     *
+     * @return The size of the type in bytes.
+     */
+    static unsigned int getTypeSize(Type type);
+
 private:
 
     std::vector<Element> _elements;
@@ -35,6 +35,7 @@
 #include "Effect.h"
 #include "Material.h"
 #include "RenderState.h"
+#include "RenderQueue.h"
 #include "VertexFormat.h"
 #include "VertexAttributeBinding.h"
 #include "Model.h"
@@ -0,0 +1,291 @@
+#include "Test.h"
+
+using namespace gameplay;
+
+// Largest difference allowed between the results of Matrix and the double precision
+// reference, relative to the sum of the magnitudes of the terms that make up each result.
+#define MATRIX_TOLERANCE 1e-5
+
+// Number of random matrices each operation is checked with.
+#define MATRIX_ITERATIONS 200
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+/**
+ * Returns a random matrix that is far from singular, with a translation.
+ */
+static Matrix randomMatrix()
+{
+    Matrix m;
+    for (unsigned int i = 0; i < 16; ++i)
+        m.m[i] = randomFloat(-2.0f, 2.0f);
+    m.m[0] += 8.0f;
+    m.m[5] += 8.0f;
+    m.m[10] += 8.0f;
+    m.m[3] = m.m[7] = m.m[11] = 0.0f;
+    m.m[12] = randomFloat(-50.0f, 50.0f);
+    m.m[13] = randomFloat(-50.0f, 50.0f);
+    m.m[14] = randomFloat(-50.0f, 50.0f);
+    m.m[15] = 1.0f;
+    return m;
+}
+
+/**
+ * Checks a result against its reference value and the sum of the magnitudes of its terms.
+ */
+static bool withinTolerance(float result, double reference, double magnitude)
+{
+    return fabs(result - reference) <= MATRIX_TOLERANCE * (1.0 + magnitude);
+}
+
+/**
+ * Transforms the vector (x, y, z, w) by the column-major matrix m in double precision and
+ * returns the number of components of dst that differ from the result.
+ */
+static unsigned int compareTransform(const float* m, float x, float y, float z, float w, const float* dst, unsigned int components)
+{
+    const double v[4] = { x, y, z, w };
+    unsigned int mismatches = 0;
+    for (unsigned int row = 0; row < components; ++row)
+    {
+        double reference = 0.0;
+        double magnitude = 0.0;
+        for (unsigned int k = 0; k < 4; ++k)
+        {
+            reference += (double)m[k * 4 + row] * v[k];
+            magnitude += fabs((double)m[k * 4 + row] * v[k]);
+        }
+        if (!withinTolerance(dst[row], reference, magnitude))
+            ++mismatches;
+    }
+    return mismatches;
+}
+
+/**
+ * Inverts the column-major matrix m in double precision by Gauss-Jordan elimination with
+ * partial pivoting.
+ */
+static void invertReference(const float* m, double* dst)
+{
+    double a[4][8];
+    for (unsigned int row = 0; row < 4; ++row)
+    {
+        for (unsigned int col = 0; col < 4; ++col)
+        {
+            a[row][col] = m[col * 4 + row];
+            a[row][col + 4] = row == col ? 1.0 : 0.0;
+        }
+    }
+
+    for (unsigned int col = 0; col < 4; ++col)
+    {
+        unsigned int pivot = col;
+        for (unsigned int row = col + 1; row < 4; ++row)
+        {
+            if (fabs(a[row][col]) > fabs(a[pivot][col]))
+                pivot = row;
+        }
+        for (unsigned int k = 0; k < 8; ++k)
+            std::swap(a[col][k], a[pivot][k]);
+
+        double scale = 1.0 / a[col][col];
+        for (unsigned int k = 0; k < 8; ++k)
+            a[col][k] *= scale;
+
+        for (unsigned int row = 0; row < 4; ++row)
+        {
+            if (row == col)
+                continue;
+            double factor = a[row][col];
+            for (unsigned int k = 0; k < 8; ++k)
+                a[row][k] -= factor * a[col][k];
+        }
+    }
+
+    for (unsigned int row = 0; row < 4; ++row)
+    {
+        for (unsigned int col = 0; col < 4; ++col)
+            dst[col * 4 + row] = a[row][col + 4];
+    }
+}
+
+/**
+ * Checks the matrix products, including those that write to one of their operands.
+ */
+static int testMultiply()
+{
+    int failures = 0;
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < MATRIX_ITERATIONS; ++i)
+    {
+        Matrix m1 = randomMatrix();
+        Matrix m2 = randomMatrix();
+
+        Matrix product;
+        Matrix::multiply(m1, m2, &product);
+        Matrix left = m1;
+        left.multiply(m2);
+        Matrix right = m2;
+        Matrix::multiply(m1, right, &right);
+
+        for (unsigned int col = 0; col < 4; ++col)
+        {
+            for (unsigned int row = 0; row < 4; ++row)
+            {
+                double reference = 0.0;
+                double magnitude = 0.0;
+                for (unsigned int k = 0; k < 4; ++k)
+                {
+                    reference += (double)m1.m[k * 4 + row] * m2.m[col * 4 + k];
+                    magnitude += fabs((double)m1.m[k * 4 + row] * m2.m[col * 4 + k]);
+                }
+                unsigned int index = col * 4 + row;
+                if (!withinTolerance(product.m[index], reference, magnitude))
+                    ++mismatches;
+                if (left.m[index] != product.m[index] || right.m[index] != product.m[index])
+                    ++mismatches;
+            }
+        }
+    }
+    CHECK(mismatches == 0);
+    return failures;
+}
+
+/**
+ * Checks the transforms of single points and vectors.
+ */
+static int testTransform()
+{
+    int failures = 0;
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < MATRIX_ITERATIONS; ++i)
+    {
+        Matrix m = randomMatrix();
+        Vector4 v(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-2.0f, 2.0f));
+
+        Vector3 point(v.x, v.y, v.z);
+        m.transformPoint(&point);
+        mismatches += compareTransform(m.m, v.x, v.y, v.z, 1.0f, &point.x, 3);
+
+        Vector3 vector;
+        m.transformVector(Vector3(v.x, v.y, v.z), &vector);
+        mismatches += compareTransform(m.m, v.x, v.y, v.z, 0.0f, &vector.x, 3);
+
+        Vector4 vector4 = v;
+        m.transformVector(&vector4);
+        mismatches += compareTransform(m.m, v.x, v.y, v.z, v.w, &vector4.x, 4);
+    }
+    CHECK(mismatches == 0);
+    return failures;
+}
+
+/**
+ * Checks the transforms of arrays of points and vectors for counts that are not a multiple
+ * of the number of elements the SIMD kernels transform together, with packed and strided
+ * arrays, and in place.
+ */
+static int testTransformArrays()
+{
+    int failures = 0;
+    unsigned int mismatches = 0;
+    static const unsigned int counts[] = { 1, 2, 3, 4, 5, 7, 8, 9, 17 };
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+    {
+        unsigned int count = counts[c];
+        Matrix m = randomMatrix();
+
+        // Points and vectors packed together, and strided through the vertices of a mesh.
+        std::vector<Vector3> packed(count);
+        std::vector<Vector4> vertices(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            packed[i].set(randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f), randomFloat(-10.0f, 10.0f));
+            vertices[i].set(packed[i].x, packed[i].y, packed[i].z, 7.0f);
+        }
+
+        std::vector<Vector3> points(count);
+        m.transformPoints(&packed[0], count, &points[0]);
+        std::vector<Vector3> vectors(count);
+        m.transformVectors(&packed[0], count, &vectors[0]);
+        std::vector<Vector4> stridedPoints(vertices);
+        m.transformPoints((Vector3*)&stridedPoints[0], count, (Vector3*)&stridedPoints[0], sizeof(Vector4), sizeof(Vector4));
+        std::vector<Vector4> vectors4(count);
+        m.transformVectors(&vertices[0], count, &vectors4[0]);
+
+        std::vector<float> x(count), y(count), z(count);
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            x[i] = packed[i].x;
+            y[i] = packed[i].y;
+            z[i] = packed[i].z;
+        }
+        m.transformPoints(&x[0], &y[0], &z[0], count);
+
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            const Vector3& v = packed[i];
+            mismatches += compareTransform(m.m, v.x, v.y, v.z, 1.0f, &points[i].x, 3);
+            mismatches += compareTransform(m.m, v.x, v.y, v.z, 0.0f, &vectors[i].x, 3);
+            mismatches += compareTransform(m.m, v.x, v.y, v.z, 1.0f, &stridedPoints[i].x, 3);
+            mismatches += compareTransform(m.m, v.x, v.y, v.z, 7.0f, &vectors4[i].x, 4);
+
+            // The fourth component of each strided vertex is left as it is.
+            if (stridedPoints[i].w != 7.0f)
+                ++mismatches;
+
+            const float planar[3] = { x[i], y[i], z[i] };
+            mismatches += compareTransform(m.m, v.x, v.y, v.z, 1.0f, planar, 3);
+        }
+    }
+    CHECK(mismatches == 0);
+    return failures;
+}
+
+/**
+ * Checks the inverses of matrices against inverses computed in double precision.
+ */
+static int testInvert()
+{
+    int failures = 0;
+    unsigned int mismatches = 0;
+    for (unsigned int i = 0; i < MATRIX_ITERATIONS; ++i)
+    {
+        Matrix m = randomMatrix();
+        double reference[16];
+        invertReference(m.m, reference);
+
+        Matrix inverse;
+        CHECK(m.invert(&inverse));
+        Matrix inPlace = m;
+        CHECK(inPlace.invert());
+
+        // The elements of the inverse are computed from sums of many terms, so they are
+        // compared relative to the largest element of the matrix and its inverse.
+        double magnitude = 0.0;
+        for (unsigned int j = 0; j < 16; ++j)
+            magnitude = std::max(magnitude, std::max(fabs((double)m.m[j]), fabs(reference[j])));
+        for (unsigned int j = 0; j < 16; ++j)
+        {
+            if (!withinTolerance(inverse.m[j], reference[j], magnitude) || inPlace.m[j] != inverse.m[j])
+                ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    // A singular matrix has no inverse and leaves dst unchanged.
+    Matrix singular = Matrix::zero();
+    Matrix dst = Matrix::identity();
+    CHECK(!singular.invert(&dst));
+    CHECK(dst.isIdentity());
+
+    return failures;
+}
+
+int testMath()
+{
+    srand(1);
+    return testMultiply() + testTransform() + testTransformArrays() + testInvert();
+}
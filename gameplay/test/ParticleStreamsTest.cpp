@@ -0,0 +1,153 @@
+#include "Test.h"
+#include "ParticleStreams.h"
+
+using namespace gameplay;
+
+// Largest relative difference allowed between the vectorized and scalar updates. NEON
+// divides through a refined reciprocal estimate, so its results are not bit exact.
+#define PARTICLE_TOLERANCE 1e-5f
+
+// Number of frames each set of particles is updated for.
+#define PARTICLE_FRAMES 3
+
+// Elapsed time of each frame, in milliseconds.
+#define PARTICLE_ELAPSED_TIME 16.7f
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+/**
+ * Fills the first count particles with random attributes, placing about half of them
+ * inside the frustum of the test.
+ */
+static void fill(ParticleStreams* p, unsigned int count)
+{
+    for (unsigned int i = 0; i < count; ++i)
+    {
+        p->_positionX[i] = randomFloat(-20.0f, 20.0f);
+        p->_positionY[i] = randomFloat(-20.0f, 20.0f);
+        p->_positionZ[i] = randomFloat(-60.0f, 0.0f);
+        p->_velocityX[i] = randomFloat(-5.0f, 5.0f);
+        p->_velocityY[i] = randomFloat(-5.0f, 5.0f);
+        p->_velocityZ[i] = randomFloat(-5.0f, 5.0f);
+        p->_accelerationX[i] = randomFloat(-10.0f, 10.0f);
+        p->_accelerationY[i] = randomFloat(-10.0f, 10.0f);
+        p->_accelerationZ[i] = randomFloat(-10.0f, 10.0f);
+        p->_colorStartR[i] = randomFloat(0.0f, 1.0f);
+        p->_colorStartG[i] = randomFloat(0.0f, 1.0f);
+        p->_colorStartB[i] = randomFloat(0.0f, 1.0f);
+        p->_colorStartA[i] = randomFloat(0.0f, 1.0f);
+        p->_colorEndR[i] = randomFloat(0.0f, 1.0f);
+        p->_colorEndG[i] = randomFloat(0.0f, 1.0f);
+        p->_colorEndB[i] = randomFloat(0.0f, 1.0f);
+        p->_colorEndA[i] = randomFloat(0.0f, 1.0f);
+        p->_rotationPerParticleSpeed[i] = randomFloat(-3.0f, 3.0f);
+        p->_angle[i] = randomFloat(0.0f, 6.0f);
+        p->_energyStart[i] = randomFloat(100.0f, 2000.0f);
+        p->_energy[i] = (int)randomFloat(0.0f, p->_energyStart[i]);
+        p->_sizeStart[i] = randomFloat(0.1f, 5.0f);
+        p->_sizeEnd[i] = randomFloat(0.1f, 5.0f);
+        p->_visible[i] = ~0;
+    }
+}
+
+static bool equal(float a, float b)
+{
+    return fabs(a - b) <= PARTICLE_TOLERANCE * std::max(1.0f, std::max(fabs(a), fabs(b)));
+}
+
+/**
+ * Returns the distance of a point to the nearest plane of the frustum.
+ */
+static float distanceToBoundary(const Frustum& frustum, float x, float y, float z)
+{
+    Vector3 point(x, y, z);
+    float distance = fabs(frustum.getNear().distance(point));
+    distance = std::min(distance, (float)fabs(frustum.getFar().distance(point)));
+    distance = std::min(distance, (float)fabs(frustum.getLeft().distance(point)));
+    distance = std::min(distance, (float)fabs(frustum.getRight().distance(point)));
+    distance = std::min(distance, (float)fabs(frustum.getTop().distance(point)));
+    distance = std::min(distance, (float)fabs(frustum.getBottom().distance(point)));
+    return distance;
+}
+
+int testParticleStreams()
+{
+    int failures = 0;
+
+    Matrix projection;
+    Matrix::createPerspective(45.0f, 1.0f, 1.0f, 50.0f, &projection);
+    Frustum frustum(projection);
+
+    // Counts below, at and around multiples of the four particles updated together. With
+    // no spare capacity the streams of the attributes are packed back to back, so most of
+    // them start at addresses that are not 16-byte aligned, and writing past the end of
+    // one stream would change the first particle of the next.
+    static const unsigned int counts[] = { 1, 2, 3, 4, 5, 6, 7, 8, 9, 13, 31, 64, 67 };
+    static const unsigned int spares[] = { 0, 1, 3 };
+    for (unsigned int c = 0; c < sizeof(counts) / sizeof(counts[0]); ++c)
+    {
+        for (unsigned int s = 0; s < sizeof(spares) / sizeof(spares[0]); ++s)
+        {
+            unsigned int count = counts[c];
+            unsigned int capacity = count + spares[s];
+            unsigned int seed = c * 16 + s + 1;
+            ParticleStreams vectorized(capacity);
+            ParticleStreams scalar(capacity);
+            ParticleStreams initial(capacity);
+            srand(seed);
+            fill(&vectorized, capacity);
+            srand(seed);
+            fill(&scalar, capacity);
+            srand(seed);
+            fill(&initial, capacity);
+
+            for (unsigned int frame = 0; frame < PARTICLE_FRAMES; ++frame)
+            {
+                vectorized.update(count, PARTICLE_ELAPSED_TIME, frustum, true);
+                scalar.update(count, PARTICLE_ELAPSED_TIME, frustum, false);
+            }
+
+            unsigned int mismatches = 0;
+            for (unsigned int i = 0; i < capacity; ++i)
+            {
+                const float* a[] = { vectorized._positionX, vectorized._positionY, vectorized._positionZ,
+                    vectorized._velocityX, vectorized._velocityY, vectorized._velocityZ,
+                    vectorized._colorR, vectorized._colorG, vectorized._colorB, vectorized._colorA,
+                    vectorized._angle, vectorized._size };
+                const float* b[] = { scalar._positionX, scalar._positionY, scalar._positionZ,
+                    scalar._velocityX, scalar._velocityY, scalar._velocityZ,
+                    scalar._colorR, scalar._colorG, scalar._colorB, scalar._colorA,
+                    scalar._angle, scalar._size };
+                for (unsigned int j = 0; j < sizeof(a) / sizeof(a[0]); ++j)
+                {
+                    if (!equal(a[j][i], b[j][i]))
+                        ++mismatches;
+                }
+                if (vectorized._energy[i] != scalar._energy[i])
+                    ++mismatches;
+
+                // Visibility may only differ for particles lying on a plane of the frustum.
+                if (vectorized._visible[i] != scalar._visible[i] &&
+                    distanceToBoundary(frustum, scalar._positionX[i], scalar._positionY[i], scalar._positionZ[i]) > PARTICLE_TOLERANCE)
+                {
+                    ++mismatches;
+                }
+            }
+            CHECK(mismatches == 0);
+
+            // The spare particles after the updated ones are left untouched.
+            for (unsigned int i = count; i < capacity; ++i)
+            {
+                CHECK(vectorized._positionX[i] == initial._positionX[i]);
+                CHECK(vectorized._size[i] == initial._size[i]);
+                CHECK(vectorized._energy[i] == initial._energy[i]);
+                CHECK(vectorized._visible[i] == initial._visible[i]);
+            }
+        }
+    }
+
+    return failures;
+}
@@ -0,0 +1,515 @@
+#include "Test.h"
+#include "RecordingGL.h"
+
+using namespace gameplay;
+
+// Rate of the fixed steps of the simulation, in steps per second.
+#define PHYSICS_STEP_RATE 120.0f
+
+// Number of steps each pile of boxes is simulated for.
+#define PHYSICS_STEPS 180
+
+// Number of boxes along each side of a layer of the pile, and number of layers.
+#define PILE_COLUMNS 8
+#define PILE_LAYERS 4
+
+// Largest relative difference allowed between the results of batched and single queries.
+#define QUERY_TOLERANCE 1e-5f
+
+// Number of objects along each side of the field the queries are tested against, and the
+// distance between them.
+#define FIELD_COLUMNS 20
+#define FIELD_SPACING 5.0f
+
+// Number of sensors, which each cast a fan of short rays from one point, and number of rays
+// of each sensor. The rays of a sensor are tested as a group.
+#define SENSOR_COUNT 256
+#define SENSOR_RAYS 16
+
+// Number of probes, which are each swept to several nearby and distant positions, and number
+// of sweeps of each kind for each probe.
+#define PROBE_COUNT 16
+#define PROBE_SWEEPS 16
+
+// Number of times the rays are tested for the benchmark.
+#define QUERY_BENCHMARK_REPEATS 10
+
+static float randomFloat(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / (float)RAND_MAX);
+}
+
+/**
+ * A game with no content of its own, which starts up the systems of the engine so that the
+ * tests can use its physics world and job scheduler.
+ */
+class PhysicsTestGame : public Game
+{
+public:
+
+    /**
+     * Updates the physics world once, by the time elapsed since the last update.
+     */
+    void step()
+    {
+        updateOnce();
+    }
+
+protected:
+
+    void initialize()
+    {
+    }
+
+    void finalize()
+    {
+    }
+
+    void update(float elapsedTime)
+    {
+    }
+
+    void render(float elapsedTime)
+    {
+    }
+};
+
+/**
+ * Returns the game shared by the physics tests, starting it up the first time. The game is
+ * never shut down, since there can only be one game in the lifetime of the process.
+ */
+static PhysicsTestGame* getGame()
+{
+    static PhysicsTestGame* game = NULL;
+    if (!game)
+    {
+        RecordingGL::install();
+        game = new PhysicsTestGame();
+        if (game->run() != 0)
+            GP_ERROR("Failed to start up the game of the physics tests.");
+
+        // Each update simulates at most one step, so the state of the world after a number
+        // of steps does not depend on how long the steps took.
+        PhysicsController* physics = game->getPhysicsController();
+        physics->setStepRate(PHYSICS_STEP_RATE);
+        physics->setMaxSubSteps(1);
+    }
+    return game;
+}
+
+/**
+ * Creates a static ground and a pile of boxes above it, in layers that are offset and turned
+ * so that the boxes tumble over each other as they fall.
+ */
+static void createPile(std::vector<Node*>* nodes)
+{
+    PhysicsRigidBody::Parameters parameters;
+    Node* ground = Node::create("ground");
+    ground->setTranslation(0.0f, -0.5f, 0.0f);
+    ground->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, PhysicsCollisionShape::box(Vector3(40.0f, 1.0f, 40.0f)), &parameters);
+    nodes->push_back(ground);
+
+    parameters.mass = 1.0f;
+    for (unsigned int layer = 0; layer < PILE_LAYERS; ++layer)
+    {
+        float offset = (layer % 2) * 0.5f - PILE_COLUMNS * 0.55f;
+        for (unsigned int x = 0; x < PILE_COLUMNS; ++x)
+        {
+            for (unsigned int z = 0; z < PILE_COLUMNS; ++z)
+            {
+                Node* box = Node::create();
+                box->setTranslation(offset + x * 1.1f, 1.0f + layer * 1.5f, offset + z * 1.1f);
+                box->rotateY((x * PILE_COLUMNS + z) * 0.1f);
+                box->rotateX(layer * 0.2f);
+                box->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, PhysicsCollisionShape::box(Vector3::one()), &parameters);
+                nodes->push_back(box);
+            }
+        }
+    }
+}
+
+/**
+ * Drops a pile of boxes with the given number of physics threads, and stores the velocities
+ * of the boxes after each step. Returns the average time taken by a step, in milliseconds.
+ */
+static float simulate(unsigned int threadCount, std::vector<float>* velocities)
+{
+    PhysicsTestGame* game = getGame();
+    PhysicsController* physics = game->getPhysicsController();
+    physics->setThreadCount(threadCount);
+
+    std::vector<Node*> nodes;
+    createPile(&nodes);
+
+    // The velocities are those of the bodies themselves, unlike the transforms of the nodes,
+    // which are extrapolated by the time Bullet carries over to the next step.
+    velocities->clear();
+    const PhysicsController::StepStatistics& statistics = physics->getStepStatistics();
+    unsigned int lastStep = statistics.totalSteps + PHYSICS_STEPS;
+    double simulationTime = 0.0;
+    while (statistics.totalSteps < lastStep)
+    {
+        game->step();
+        if (statistics.steps == 0)
+            continue;
+
+        simulationTime += statistics.simulationTime;
+        for (size_t i = 1; i < nodes.size(); ++i)
+        {
+            PhysicsRigidBody* body = static_cast<PhysicsRigidBody*>(nodes[i]->getCollisionObject());
+            Vector3 linear = body->getLinearVelocity();
+            Vector3 angular = body->getAngularVelocity();
+            velocities->push_back(linear.x);
+            velocities->push_back(linear.y);
+            velocities->push_back(linear.z);
+            velocities->push_back(angular.x);
+            velocities->push_back(angular.y);
+            velocities->push_back(angular.z);
+        }
+    }
+
+    // Removing all the bodies resets the broadphase, so the next pile is simulated the same way.
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        SAFE_RELEASE(nodes[i]);
+    }
+
+    return (float)(simulationTime / PHYSICS_STEPS);
+}
+
+int testPhysicsThreads()
+{
+    int failures = 0;
+
+    unsigned int schedulerThreads = getGame()->getJobScheduler()->getThreadCount();
+    fprintf(stdout, "PhysicsThreads: %u boxes, %u steps, %u job scheduler threads.\n",
+        PILE_COLUMNS * PILE_COLUMNS * PILE_LAYERS, PHYSICS_STEPS, schedulerThreads);
+
+    // The runs with one thread are the baseline of the speedups. With more threads the contact
+    // manifolds are sorted after the collision detection jobs, so all those runs must match.
+    std::vector<float> single, reference, velocities;
+    float singleTime = simulate(1, &single);
+    fprintf(stdout, "PhysicsThreads: 1 thread: %.3f ms per step.\n", singleTime);
+
+    static const unsigned int threadCounts[] = { 2, 4, 8 };
+    for (unsigned int i = 0; i < sizeof(threadCounts) / sizeof(threadCounts[0]); ++i)
+    {
+        float time = simulate(threadCounts[i], i == 0 ? &reference : &velocities);
+        fprintf(stdout, "PhysicsThreads: %u threads: %.3f ms per step, %.2fx.\n",
+            threadCounts[i], time, time > 0.0f ? singleTime / time : 0.0f);
+        if (i > 0)
+            CHECK(velocities == reference);
+    }
+
+    // Running the same thread count again gives the same results.
+    simulate(1, &velocities);
+    CHECK(velocities == single);
+    simulate(2, &velocities);
+    CHECK(velocities == reference);
+
+    getGame()->getPhysicsController()->setThreadCount(1);
+
+    return failures;
+}
+
+/**
+ * A hit filter that leaves out spheres.
+ */
+class SphereFilter : public PhysicsController::HitFilter
+{
+public:
+
+    bool filter(PhysicsCollisionObject* object)
+    {
+        return object->getCollisionShape()->getType() == PhysicsCollisionShape::SHAPE_SPHERE;
+    }
+};
+
+/**
+ * Creates a field of static spheres and boxes of various sizes at random heights.
+ */
+static void createField(std::vector<Node*>* nodes)
+{
+    PhysicsRigidBody::Parameters parameters;
+    for (unsigned int x = 0; x < FIELD_COLUMNS; ++x)
+    {
+        for (unsigned int z = 0; z < FIELD_COLUMNS; ++z)
+        {
+            float offsetX = randomFloat(-1.0f, 1.0f);
+            float offsetZ = randomFloat(-1.0f, 1.0f);
+            float height = randomFloat(0.0f, 4.0f);
+            Node* node = Node::create();
+            node->setTranslation(x * FIELD_SPACING + offsetX, height, z * FIELD_SPACING + offsetZ);
+            node->rotateY(randomFloat(0.0f, MATH_PI));
+            if ((x + z) % 2)
+            {
+                node->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, PhysicsCollisionShape::sphere(randomFloat(0.5f, 1.0f)), &parameters);
+            }
+            else
+            {
+                float width = randomFloat(1.0f, 2.0f);
+                float depth = randomFloat(1.0f, 2.0f);
+                node->setCollisionObject(PhysicsCollisionObject::RIGID_BODY, PhysicsCollisionShape::box(Vector3(width, 2.0f, depth)), &parameters);
+            }
+            nodes->push_back(node);
+        }
+    }
+}
+
+/**
+ * Returns a random point above the field, at up to the given height.
+ */
+static Vector3 randomPoint(float height)
+{
+    float x = randomFloat(0.0f, FIELD_COLUMNS * FIELD_SPACING);
+    float y = randomFloat(0.0f, height);
+    float z = randomFloat(0.0f, FIELD_COLUMNS * FIELD_SPACING);
+    return Vector3(x, y, z);
+}
+
+/**
+ * Creates the rays of the sensors. The rays of a sensor are close to each other, so a group
+ * of them shares the objects found by one broadphase query.
+ */
+static void createSensorRays(std::vector<PhysicsController::RayQuery>* rays, PhysicsController::HitFilter* filter)
+{
+    for (unsigned int i = 0; i < SENSOR_COUNT; ++i)
+    {
+        Vector3 origin = randomPoint(4.0f);
+        float heading = randomFloat(0.0f, MATH_PIX2);
+        for (unsigned int j = 0; j < SENSOR_RAYS; ++j)
+        {
+            float angle = heading + j * (MATH_PIOVER2 / SENSOR_RAYS);
+            PhysicsController::RayQuery query;
+            query.ray.set(origin, Vector3(cos(angle), 0.0f, sin(angle)));
+            query.distance = 15.0f;
+            query.filter = i % 3 == 0 ? filter : NULL;
+            rays->push_back(query);
+        }
+    }
+}
+
+/**
+ * Creates long rays in random directions from random points. The bounds of a group of them
+ * cover most of the field, so they are tested one by one.
+ */
+static void createScatteredRays(std::vector<PhysicsController::RayQuery>* rays, PhysicsController::HitFilter* filter)
+{
+    for (unsigned int i = 0; i < SENSOR_COUNT * SENSOR_RAYS; ++i)
+    {
+        Vector3 origin = randomPoint(4.0f);
+        float x = randomFloat(-1.0f, 1.0f);
+        float y = randomFloat(-0.2f, 1.0f);
+        float z = randomFloat(-1.0f, 1.0f);
+        PhysicsController::RayQuery query;
+        query.ray.set(origin, Vector3(x, y, z));
+        query.distance = 60.0f;
+        query.filter = i % 3 == 0 ? filter : NULL;
+        rays->push_back(query);
+    }
+}
+
+/**
+ * Creates the probes, which are ghost spheres above the field, and the sweeps of each probe:
+ * short ones to nearby positions, which are tested as a group, and long ones across the field,
+ * which are tested one by one.
+ */
+static void createSweeps(std::vector<Node*>* nodes, std::vector<PhysicsController::SweepQuery>* nearSweeps,
+    std::vector<PhysicsController::SweepQuery>* farSweeps, PhysicsController::HitFilter* filter)
+{
+    for (unsigned int i = 0; i < PROBE_COUNT; ++i)
+    {
+        Vector3 start = randomPoint(6.0f);
+        Node* node = Node::create();
+        node->setTranslation(start);
+        PhysicsCollisionObject* probe = node->setCollisionObject(PhysicsCollisionObject::GHOST_OBJECT, PhysicsCollisionShape::sphere(0.5f));
+        nodes->push_back(node);
+
+        for (unsigned int j = 0; j < PROBE_SWEEPS; ++j)
+        {
+            PhysicsController::SweepQuery query;
+            query.object = probe;
+            query.filter = j % 3 == 0 ? filter : NULL;
+            float x = randomFloat(-8.0f, 8.0f);
+            float y = randomFloat(-2.0f, 2.0f);
+            float z = randomFloat(-8.0f, 8.0f);
+            query.endPosition = start + Vector3(x, y, z);
+            nearSweeps->push_back(query);
+            query.endPosition = randomPoint(12.0f);
+            farSweeps->push_back(query);
+        }
+    }
+}
+
+static bool equal(float a, float b)
+{
+    return fabs(a - b) <= QUERY_TOLERANCE * std::max(1.0f, std::max(fabs(a), fabs(b)));
+}
+
+static bool equal(const Vector3& a, const Vector3& b)
+{
+    return equal(a.x, b.x) && equal(a.y, b.y) && equal(a.z, b.z);
+}
+
+/**
+ * Returns the number of batched results that differ from the corresponding single results.
+ */
+static unsigned int compareResults(const std::vector<PhysicsController::HitResult>& batched, const std::vector<PhysicsController::HitResult>& single)
+{
+    unsigned int mismatches = 0;
+    for (size_t i = 0; i < single.size(); ++i)
+    {
+        const PhysicsController::HitResult& a = batched[i];
+        const PhysicsController::HitResult& b = single[i];
+        if (a.object != b.object)
+            ++mismatches;
+        else if (!a.object && a.fraction != 1.0f)
+            ++mismatches;
+        else if (a.object && (!equal(a.fraction, b.fraction) || !equal(a.point, b.point) || !equal(a.normal, b.normal)))
+            ++mismatches;
+    }
+    return mismatches;
+}
+
+/**
+ * Fills results with values that the batched queries must overwrite.
+ */
+static void clearResults(std::vector<PhysicsController::HitResult>* results, unsigned int count, PhysicsCollisionObject* object)
+{
+    PhysicsController::HitResult result;
+    result.object = object;
+    result.point.set(-1.0f, -1.0f, -1.0f);
+    result.fraction = -1.0f;
+    result.normal.set(-1.0f, -1.0f, -1.0f);
+    results->assign(count, result);
+}
+
+/**
+ * Tests the rays one by one, storing a NULL object and a fraction of 1 for those that hit
+ * nothing, and returns the number of hits.
+ */
+static unsigned int rayTestSingly(PhysicsController* physics, const std::vector<PhysicsController::RayQuery>& rays, std::vector<PhysicsController::HitResult>* results)
+{
+    unsigned int hitCount = 0;
+    clearResults(results, rays.size(), NULL);
+    for (size_t i = 0; i < rays.size(); ++i)
+    {
+        PhysicsController::HitResult& result = (*results)[i];
+        result.fraction = 1.0f;
+        if (physics->rayTest(rays[i].ray, rays[i].distance, &result, rays[i].filter))
+            ++hitCount;
+    }
+    return hitCount;
+}
+
+/**
+ * Tests the sweeps one by one, as rayTestSingly() does the rays.
+ */
+static unsigned int sweepTestSingly(PhysicsController* physics, const std::vector<PhysicsController::SweepQuery>& sweeps, std::vector<PhysicsController::HitResult>* results)
+{
+    unsigned int hitCount = 0;
+    clearResults(results, sweeps.size(), NULL);
+    for (size_t i = 0; i < sweeps.size(); ++i)
+    {
+        PhysicsController::HitResult& result = (*results)[i];
+        result.fraction = 1.0f;
+        if (physics->sweepTest(sweeps[i].object, sweeps[i].endPosition, &result, sweeps[i].filter))
+            ++hitCount;
+    }
+    return hitCount;
+}
+
+/**
+ * Prints the number of rays tested per millisecond one by one, in a batch and in a batch spread
+ * over the threads of the job scheduler.
+ */
+static void benchmarkRays(const char* name, PhysicsController* physics, const std::vector<PhysicsController::RayQuery>& rays)
+{
+    unsigned int count = rays.size();
+    std::vector<PhysicsController::HitResult> results(count);
+    double singleTime = 0.0;
+    double batchedTime = 0.0;
+    double parallelTime = 0.0;
+    for (unsigned int repeat = 0; repeat < QUERY_BENCHMARK_REPEATS; ++repeat)
+    {
+        double startTime = Game::getAbsoluteTime();
+        for (unsigned int i = 0; i < count; ++i)
+        {
+            physics->rayTest(rays[i].ray, rays[i].distance, &results[i], rays[i].filter);
+        }
+        double singleEndTime = Game::getAbsoluteTime();
+        physics->rayTest(&rays[0], count, &results[0], false);
+        double batchedEndTime = Game::getAbsoluteTime();
+        physics->rayTest(&rays[0], count, &results[0], true);
+        double parallelEndTime = Game::getAbsoluteTime();
+
+        singleTime += singleEndTime - startTime;
+        batchedTime += batchedEndTime - singleEndTime;
+        parallelTime += parallelEndTime - batchedEndTime;
+    }
+
+    double total = (double)count * QUERY_BENCHMARK_REPEATS;
+    fprintf(stdout, "PhysicsQueries: %s rays: %.0f single, %.0f batched, %.0f parallel batched rays per ms.\n", name,
+        singleTime > 0.0 ? total / singleTime : 0.0,
+        batchedTime > 0.0 ? total / batchedTime : 0.0,
+        parallelTime > 0.0 ? total / parallelTime : 0.0);
+}
+
+int testPhysicsQueries()
+{
+    int failures = 0;
+    PhysicsController* physics = getGame()->getPhysicsController();
+
+    srand(1);
+    SphereFilter filter;
+    std::vector<Node*> nodes;
+    createField(&nodes);
+    std::vector<PhysicsController::RayQuery> sensorRays, scatteredRays;
+    createSensorRays(&sensorRays, &filter);
+    createScatteredRays(&scatteredRays, &filter);
+    std::vector<PhysicsController::SweepQuery> nearSweeps, farSweeps;
+    createSweeps(&nodes, &nearSweeps, &farSweeps, &filter);
+
+    // The batched queries of a group either share the objects found by one broadphase query
+    // (the sensor rays and near sweeps) or are tested one by one (the scattered rays and far
+    // sweeps), through the broadphase's own tests when they are not tested in parallel.
+    PhysicsCollisionObject* stale = nodes[0]->getCollisionObject();
+    std::vector<PhysicsController::HitResult> single, batched;
+    const std::vector<PhysicsController::RayQuery>* raySets[] = { &sensorRays, &scatteredRays };
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        const std::vector<PhysicsController::RayQuery>& rays = *raySets[i];
+        unsigned int hitCount = rayTestSingly(physics, rays, &single);
+        CHECK(hitCount > 0 && hitCount < rays.size());
+        for (unsigned int parallel = 0; parallel < 2; ++parallel)
+        {
+            clearResults(&batched, rays.size(), stale);
+            CHECK(physics->rayTest(&rays[0], rays.size(), &batched[0], parallel != 0) == hitCount);
+            CHECK(compareResults(batched, single) == 0);
+        }
+    }
+
+    const std::vector<PhysicsController::SweepQuery>* sweepSets[] = { &nearSweeps, &farSweeps };
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        const std::vector<PhysicsController::SweepQuery>& sweeps = *sweepSets[i];
+        unsigned int hitCount = sweepTestSingly(physics, sweeps, &single);
+        CHECK(hitCount > 0);
+        for (unsigned int parallel = 0; parallel < 2; ++parallel)
+        {
+            clearResults(&batched, sweeps.size(), stale);
+            CHECK(physics->sweepTest(&sweeps[0], sweeps.size(), &batched[0], parallel != 0) == hitCount);
+            CHECK(compareResults(batched, single) == 0);
+        }
+    }
+
+    benchmarkRays("Sensor", physics, sensorRays);
+    benchmarkRays("Scattered", physics, scatteredRays);
+
+    for (size_t i = 0; i < nodes.size(); ++i)
+    {
+        SAFE_RELEASE(nodes[i]);
+    }
+
+    return failures;
+}
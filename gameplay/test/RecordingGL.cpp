@@ -0,0 +1,275 @@
+#include "RecordingGL.h"
+
+// Number of texture units whose bound textures are tracked.
+#define RECORDING_TEXTURE_UNITS 32
+
+namespace gameplay
+{
+
+static GLuint __nextHandle = 1;
+static GLuint __program = 0;
+static GLuint __activeUnit = 0;
+static GLuint __textures[RECORDING_TEXTURE_UNITS];
+static GLuint __indexBuffer = 0;
+static bool __blend = false;
+static std::vector<RecordingGL::Draw> __draws;
+static unsigned int __programBindCount = 0;
+static unsigned int __textureBindCount = 0;
+static unsigned int __blendChangeCount = 0;
+
+static void recordDraw()
+{
+    RecordingGL::Draw draw;
+    draw.program = __program;
+    draw.texture = __textures[0];
+    draw.indexBuffer = __indexBuffer;
+    draw.blend = __blend;
+    __draws.push_back(draw);
+}
+
+static void setCapability(GLenum cap, bool enabled)
+{
+    if (cap == GL_BLEND)
+    {
+        __blend = enabled;
+        ++__blendChangeCount;
+    }
+}
+
+static void generateHandles(GLsizei n, GLuint* handles)
+{
+    for (GLsizei i = 0; i < n; ++i)
+    {
+        handles[i] = __nextHandle++;
+    }
+}
+
+static void copyName(const char* name, GLsizei bufSize, GLsizei* length, GLchar* dst)
+{
+    GLsizei count = std::min((GLsizei)strlen(name), bufSize - 1);
+    memcpy(dst, name, count);
+    dst[count] = '\0';
+    if (length)
+        *length = count;
+}
+
+// Programs and shaders.
+
+static GLuint GLAPIENTRY recordCreateShader(GLenum type) { return __nextHandle++; }
+static void GLAPIENTRY recordShaderSource(GLuint shader, GLsizei count, const GLchar* const* string, const GLint* length) { }
+static void GLAPIENTRY recordCompileShader(GLuint shader) { }
+static void GLAPIENTRY recordDeleteShader(GLuint shader) { }
+static void GLAPIENTRY recordGetShaderInfoLog(GLuint shader, GLsizei bufSize, GLsizei* length, GLchar* infoLog) { copyName("", bufSize, length, infoLog); }
+static GLuint GLAPIENTRY recordCreateProgram() { return __nextHandle++; }
+static void GLAPIENTRY recordAttachShader(GLuint program, GLuint shader) { }
+static void GLAPIENTRY recordLinkProgram(GLuint program) { }
+static void GLAPIENTRY recordDeleteProgram(GLuint program) { }
+static void GLAPIENTRY recordGetProgramInfoLog(GLuint program, GLsizei bufSize, GLsizei* length, GLchar* infoLog) { copyName("", bufSize, length, infoLog); }
+static void GLAPIENTRY recordBindAttribLocation(GLuint program, GLuint index, const GLchar* name) { }
+static GLint GLAPIENTRY recordGetAttribLocation(GLuint program, const GLchar* name) { return 0; }
+static GLint GLAPIENTRY recordGetUniformLocation(GLuint program, const GLchar* name) { return 0; }
+
+static void GLAPIENTRY recordGetShaderiv(GLuint shader, GLenum pname, GLint* params)
+{
+    *params = (pname == GL_COMPILE_STATUS) ? GL_TRUE : 0;
+}
+
+static void GLAPIENTRY recordGetProgramiv(GLuint program, GLenum pname, GLint* params)
+{
+    switch (pname)
+    {
+    case GL_LINK_STATUS:
+        *params = GL_TRUE;
+        break;
+    case GL_ACTIVE_ATTRIBUTES:
+    case GL_ACTIVE_UNIFORMS:
+        *params = 1;
+        break;
+    case GL_ACTIVE_ATTRIBUTE_MAX_LENGTH:
+    case GL_ACTIVE_UNIFORM_MAX_LENGTH:
+        *params = 32;
+        break;
+    default:
+        *params = 0;
+        break;
+    }
+}
+
+static void GLAPIENTRY recordGetActiveAttrib(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    *size = 1;
+    *type = GL_FLOAT_VEC3;
+    copyName(VERTEX_ATTRIBUTE_POSITION_NAME, bufSize, length, name);
+}
+
+static void GLAPIENTRY recordGetActiveUniform(GLuint program, GLuint index, GLsizei bufSize, GLsizei* length, GLint* size, GLenum* type, GLchar* name)
+{
+    *size = 1;
+    *type = GL_SAMPLER_2D;
+    copyName("u_diffuseTexture", bufSize, length, name);
+}
+
+static void GLAPIENTRY recordUseProgram(GLuint program)
+{
+    __program = program;
+    ++__programBindCount;
+}
+
+// Uniforms.
+
+static void GLAPIENTRY recordUniform1i(GLint location, GLint v0) { }
+static void GLAPIENTRY recordUniform1iv(GLint location, GLsizei count, const GLint* value) { }
+static void GLAPIENTRY recordUniform1f(GLint location, GLfloat v0) { }
+static void GLAPIENTRY recordUniform2f(GLint location, GLfloat v0, GLfloat v1) { }
+static void GLAPIENTRY recordUniform3f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2) { }
+static void GLAPIENTRY recordUniform4f(GLint location, GLfloat v0, GLfloat v1, GLfloat v2, GLfloat v3) { }
+static void GLAPIENTRY recordUniform1fv(GLint location, GLsizei count, const GLfloat* value) { }
+static void GLAPIENTRY recordUniform2fv(GLint location, GLsizei count, const GLfloat* value) { }
+static void GLAPIENTRY recordUniform3fv(GLint location, GLsizei count, const GLfloat* value) { }
+static void GLAPIENTRY recordUniform4fv(GLint location, GLsizei count, const GLfloat* value) { }
+static void GLAPIENTRY recordUniformMatrix4fv(GLint location, GLsizei count, GLboolean transpose, const GLfloat* value) { }
+
+// Buffers and vertex attributes.
+
+static void GLAPIENTRY recordGenBuffers(GLsizei n, GLuint* buffers) { generateHandles(n, buffers); }
+static void GLAPIENTRY recordDeleteBuffers(GLsizei n, const GLuint* buffers) { }
+static void GLAPIENTRY recordBufferData(GLenum target, GLsizeiptr size, const GLvoid* data, GLenum usage) { }
+static void GLAPIENTRY recordBufferSubData(GLenum target, GLintptr offset, GLsizeiptr size, const GLvoid* data) { }
+static void GLAPIENTRY recordEnableVertexAttribArray(GLuint index) { }
+static void GLAPIENTRY recordDisableVertexAttribArray(GLuint index) { }
+static void GLAPIENTRY recordVertexAttribPointer(GLuint index, GLint size, GLenum type, GLboolean normalized, GLsizei stride, const GLvoid* pointer) { }
+static void GLAPIENTRY recordVertexAttrib4fv(GLuint index, const GLfloat* v) { }
+
+static void GLAPIENTRY recordBindBuffer(GLenum target, GLuint buffer)
+{
+    if (target == GL_ELEMENT_ARRAY_BUFFER)
+        __indexBuffer = buffer;
+}
+
+// Textures.
+
+static void GLAPIENTRY recordActiveTexture(GLenum texture)
+{
+    __activeUnit = texture - GL_TEXTURE0;
+}
+
+static void GLAPIENTRY recordGenerateMipmap(GLenum target) { }
+
+void RecordingGL::install()
+{
+    // Vertex array objects are left unsupported, so vertex attribute bindings are applied directly.
+    __glewCreateShader = recordCreateShader;
+    *(void**)&__glewShaderSource = (void*)&recordShaderSource;
+    __glewCompileShader = recordCompileShader;
+    __glewDeleteShader = recordDeleteShader;
+    __glewGetShaderiv = recordGetShaderiv;
+    __glewGetShaderInfoLog = recordGetShaderInfoLog;
+    __glewCreateProgram = recordCreateProgram;
+    __glewAttachShader = recordAttachShader;
+    __glewLinkProgram = recordLinkProgram;
+    __glewDeleteProgram = recordDeleteProgram;
+    __glewGetProgramiv = recordGetProgramiv;
+    __glewGetProgramInfoLog = recordGetProgramInfoLog;
+    __glewBindAttribLocation = recordBindAttribLocation;
+    __glewGetActiveAttrib = recordGetActiveAttrib;
+    __glewGetAttribLocation = recordGetAttribLocation;
+    __glewGetActiveUniform = recordGetActiveUniform;
+    __glewGetUniformLocation = recordGetUniformLocation;
+    __glewUseProgram = recordUseProgram;
+    __glewUniform1i = recordUniform1i;
+    __glewUniform1iv = recordUniform1iv;
+    __glewUniform1f = recordUniform1f;
+    __glewUniform2f = recordUniform2f;
+    __glewUniform3f = recordUniform3f;
+    __glewUniform4f = recordUniform4f;
+    __glewUniform1fv = recordUniform1fv;
+    __glewUniform2fv = recordUniform2fv;
+    __glewUniform3fv = recordUniform3fv;
+    __glewUniform4fv = recordUniform4fv;
+    __glewUniformMatrix4fv = recordUniformMatrix4fv;
+    __glewGenBuffers = recordGenBuffers;
+    __glewDeleteBuffers = recordDeleteBuffers;
+    __glewBindBuffer = recordBindBuffer;
+    __glewBufferData = recordBufferData;
+    __glewBufferSubData = recordBufferSubData;
+    __glewEnableVertexAttribArray = recordEnableVertexAttribArray;
+    __glewDisableVertexAttribArray = recordDisableVertexAttribArray;
+    __glewVertexAttribPointer = recordVertexAttribPointer;
+    __glewVertexAttrib4fv = recordVertexAttrib4fv;
+    __glewActiveTexture = recordActiveTexture;
+    __glewGenerateMipmap = recordGenerateMipmap;
+
+    __program = 0;
+    __activeUnit = 0;
+    memset(__textures, 0, sizeof(__textures));
+    __indexBuffer = 0;
+    __blend = false;
+    clear();
+}
+
+void RecordingGL::clear()
+{
+    __draws.clear();
+    __programBindCount = 0;
+    __textureBindCount = 0;
+    __blendChangeCount = 0;
+}
+
+GLuint RecordingGL::getProgram()
+{
+    return __program;
+}
+
+const std::vector<RecordingGL::Draw>& RecordingGL::getDraws()
+{
+    return __draws;
+}
+
+unsigned int RecordingGL::getProgramBindCount()
+{
+    return __programBindCount;
+}
+
+unsigned int RecordingGL::getTextureBindCount()
+{
+    return __textureBindCount;
+}
+
+unsigned int RecordingGL::getBlendChangeCount()
+{
+    return __blendChangeCount;
+}
+
+}
+
+using namespace gameplay;
+
+// The GL 1.1 entry points, which are linked directly rather than loaded through GLEW.
+
+GLenum GLAPIENTRY glGetError() { return GL_NO_ERROR; }
+void GLAPIENTRY glEnable(GLenum cap) { setCapability(cap, true); }
+void GLAPIENTRY glDisable(GLenum cap) { setCapability(cap, false); }
+void GLAPIENTRY glBlendFunc(GLenum sfactor, GLenum dfactor) { }
+void GLAPIENTRY glCullFace(GLenum mode) { }
+void GLAPIENTRY glDepthMask(GLboolean flag) { }
+void GLAPIENTRY glDepthFunc(GLenum func) { }
+void GLAPIENTRY glHint(GLenum target, GLenum mode) { }
+void GLAPIENTRY glPixelStorei(GLenum pname, GLint param) { }
+void GLAPIENTRY glGenTextures(GLsizei n, GLuint* textures) { generateHandles(n, textures); }
+void GLAPIENTRY glDeleteTextures(GLsizei n, const GLuint* textures) { }
+void GLAPIENTRY glTexParameteri(GLenum target, GLenum pname, GLint param) { }
+void GLAPIENTRY glTexImage2D(GLenum target, GLint level, GLint internalformat, GLsizei width, GLsizei height, GLint border, GLenum format, GLenum type, const GLvoid* pixels) { }
+void GLAPIENTRY glDrawArrays(GLenum mode, GLint first, GLsizei count) { recordDraw(); }
+void GLAPIENTRY glDrawElements(GLenum mode, GLsizei count, GLenum type, const GLvoid* indices) { recordDraw(); }
+
+void GLAPIENTRY glGetIntegerv(GLenum pname, GLint* params)
+{
+    *params = (pname == GL_MAX_VERTEX_ATTRIBS) ? 16 : 0;
+}
+
+void GLAPIENTRY glBindTexture(GLenum target, GLuint texture)
+{
+    if (__activeUnit < RECORDING_TEXTURE_UNITS)
+        __textures[__activeUnit] = texture;
+    ++__textureBindCount;
+}
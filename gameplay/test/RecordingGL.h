@@ -0,0 +1,77 @@
+#ifndef RECORDINGGL_H_
+#define RECORDINGGL_H_
+
+#include "Base.h"
+
+namespace gameplay
+{
+
+/**
+ * Replaces the OpenGL entry points used by the renderer with stubs that track the bound
+ * state and record the draw calls, so that rendering can be tested without a GL context.
+ *
+ * The GL 1.1 functions are defined by the stub itself, which takes precedence over the
+ * system GL library when linked into the test executable. The later functions are loaded
+ * through GLEW, so install() points GLEW's function pointers at the stub instead.
+ *
+ * The stub reports every program as compiled and linked, with the vertex attribute
+ * "a_position" and the sampler uniform "u_diffuseTexture".
+ */
+class RecordingGL
+{
+public:
+
+    /**
+     * A recorded draw call, with the state bound when it was issued.
+     */
+    struct Draw
+    {
+        /** The bound program. */
+        GLuint program;
+        /** The texture bound to texture unit 0. */
+        GLuint texture;
+        /** The bound element array buffer. */
+        GLuint indexBuffer;
+        /** Whether blending was enabled. */
+        bool blend;
+    };
+
+    /**
+     * Points the GLEW function pointers at the stub and resets the tracked state.
+     */
+    static void install();
+
+    /**
+     * Clears the recorded draws and call counts, keeping the tracked state.
+     */
+    static void clear();
+
+    /**
+     * Returns the program that is currently bound.
+     */
+    static GLuint getProgram();
+
+    /**
+     * Returns the draws recorded since the last call to clear().
+     */
+    static const std::vector<Draw>& getDraws();
+
+    /**
+     * Returns the number of glUseProgram calls since the last call to clear().
+     */
+    static unsigned int getProgramBindCount();
+
+    /**
+     * Returns the number of glBindTexture calls since the last call to clear().
+     */
+    static unsigned int getTextureBindCount();
+
+    /**
+     * Returns the number of glEnable or glDisable calls for GL_BLEND since the last call to clear().
+     */
+    static unsigned int getBlendChangeCount();
+};
+
+}
+
+#endif
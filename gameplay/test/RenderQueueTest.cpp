@@ -0,0 +1,248 @@
+#include "Test.h"
+#include "RecordingGL.h"
+
+using namespace gameplay;
+
+// Number of models drawn by the test.
+#define MODEL_COUNT 8
+
+/**
+ * The setup of one of the test models.
+ */
+struct ModelSetup
+{
+    unsigned int effect;
+    unsigned int texture;
+    int sharedMaterial;
+    float z;
+    bool transparent;
+};
+
+/**
+ * The sort keys of a test model, looked up from a recorded draw by its index buffer.
+ */
+struct ModelKeys
+{
+    IndexBufferHandle indexBuffer;
+    Effect* effect;
+    GLuint program;
+    TextureHandle texture;
+    Material* material;
+    float depth;
+    bool transparent;
+};
+
+static const ModelKeys* findKeys(const ModelKeys* keys, IndexBufferHandle indexBuffer)
+{
+    for (unsigned int i = 0; i < MODEL_COUNT; ++i)
+    {
+        if (keys[i].indexBuffer == indexBuffer)
+            return &keys[i];
+    }
+    return NULL;
+}
+
+int testRenderQueue()
+{
+    int failures = 0;
+
+    RecordingGL::install();
+
+    // Two effects and two textures, shared by the models in different combinations. Models
+    // 2 and 3 also share a material; the others have materials of their own.
+    static const ModelSetup setups[MODEL_COUNT] =
+    {
+        { 1, 0, -1, -5.0f, false },
+        { 0, 1, -1, -3.0f, false },
+        { 0, 0,  0, -8.0f, false },
+        { 0, 0,  0, -2.0f, false },
+        { 1, 0, -1, -1.0f, false },
+        { 0, 1, -1, -4.0f, true },
+        { 1, 0, -1, -9.0f, true },
+        { 0, 1, -1, -6.0f, true }
+    };
+
+    Effect* effects[2];
+    effects[0] = Effect::createFromSource("void main() {}", "void main() {}", "EFFECT_A");
+    effects[1] = Effect::createFromSource("void main() {}", "void main() {}", "EFFECT_B");
+    GLuint programs[2];
+    for (unsigned int i = 0; i < 2; ++i)
+    {
+        effects[i]->bind();
+        programs[i] = RecordingGL::getProgram();
+    }
+
+    unsigned char pixel[4] = { 255, 255, 255, 255 };
+    Texture* textures[2];
+    textures[0] = Texture::create(Texture::RGBA, 1, 1, pixel);
+    textures[1] = Texture::create(Texture::RGBA, 1, 1, pixel);
+
+    Material* sharedMaterial = NULL;
+    Node* nodes[MODEL_COUNT];
+    ModelKeys keys[MODEL_COUNT];
+    VertexFormat::Element elements[] = { VertexFormat::Element(VertexFormat::POSITION, 3) };
+    float vertices[] = { 0, 0, 0,  1, 0, 0,  0, 1, 0 };
+    unsigned short indices[] = { 0, 1, 2 };
+    for (unsigned int i = 0; i < MODEL_COUNT; ++i)
+    {
+        const ModelSetup& setup = setups[i];
+
+        // Each model has a mesh of its own, so its draw can be told apart by the index buffer.
+        Mesh* mesh = Mesh::createMesh(VertexFormat(elements, 1), 3);
+        mesh->setVertexData(vertices);
+        MeshPart* part = mesh->addPart(Mesh::TRIANGLES, Mesh::INDEX16, 3);
+        part->setIndexData(indices, 0, 3);
+
+        Material* material;
+        if (setup.sharedMaterial >= 0 && sharedMaterial)
+        {
+            material = sharedMaterial;
+            material->addRef();
+        }
+        else
+        {
+            material = Material::create(effects[setup.effect]);
+            Texture::Sampler* sampler = Texture::Sampler::create(textures[setup.texture]);
+            material->getParameter("u_diffuseTexture")->setValue(sampler);
+            SAFE_RELEASE(sampler);
+            if (setup.transparent)
+            {
+                material->getStateBlock()->setBlend(true);
+                material->getStateBlock()->setBlendSrc(RenderState::BLEND_SRC_ALPHA);
+                material->getStateBlock()->setBlendDst(RenderState::BLEND_ONE_MINUS_SRC_ALPHA);
+            }
+            if (setup.sharedMaterial >= 0)
+                sharedMaterial = material;
+        }
+
+        Model* model = Model::create(mesh);
+        model->setMaterial(material);
+        nodes[i] = Node::create();
+        nodes[i]->setModel(model);
+        nodes[i]->setTranslation(0.0f, 0.0f, setup.z);
+
+        keys[i].indexBuffer = part->getIndexBuffer();
+        keys[i].effect = effects[setup.effect];
+        keys[i].program = programs[setup.effect];
+        keys[i].texture = textures[setup.texture]->getHandle();
+        keys[i].material = material;
+        keys[i].depth = -setup.z;
+        keys[i].transparent = setup.transparent;
+
+        SAFE_RELEASE(model);
+        SAFE_RELEASE(material);
+        SAFE_RELEASE(mesh);
+    }
+
+    // Draw the models through the queue. The camera is not attached to a node, so its view
+    // is the identity and the depth of each model is -z.
+    Camera* camera = Camera::createPerspective(45.0f, 1.0f, 1.0f, 100.0f);
+    RenderQueue queue;
+    queue.start(camera);
+    for (unsigned int i = 0; i < MODEL_COUNT; ++i)
+    {
+        nodes[i]->getModel()->draw(&queue);
+    }
+    queue.finish();
+    CHECK(queue.getItemCount() == MODEL_COUNT);
+
+    RecordingGL::clear();
+    queue.draw();
+    const std::vector<RecordingGL::Draw>& draws = RecordingGL::getDraws();
+    const RenderQueue::Statistics& statistics = queue.getStatistics();
+    CHECK(draws.size() == MODEL_COUNT);
+    CHECK(statistics.drawCalls == MODEL_COUNT);
+
+    const ModelKeys* previous = NULL;
+    unsigned int programChanges = 0;
+    unsigned int textureChanges = 0;
+    unsigned int materialChanges = 0;
+    bool drawn[MODEL_COUNT] = { false };
+    for (size_t i = 0; i < draws.size(); ++i)
+    {
+        const RecordingGL::Draw& draw = draws[i];
+        const ModelKeys* current = findKeys(keys, draw.indexBuffer);
+        CHECK(current != NULL);
+        if (!current)
+            continue;
+
+        // Every model is drawn once, with the program, texture and blending of its material.
+        CHECK(!drawn[current - keys]);
+        drawn[current - keys] = true;
+        CHECK(draw.program == current->program);
+        CHECK(draw.texture == current->texture);
+        CHECK(draw.blend == current->transparent);
+
+        if (previous)
+        {
+            // Opaque draws come first, grouped by effect, texture and material, and front
+            // to back within a group. Transparent draws come last, back to front.
+            CHECK(!previous->transparent || current->transparent);
+            if (current->transparent && previous->transparent)
+            {
+                CHECK(previous->depth >= current->depth);
+            }
+            else if (!current->transparent)
+            {
+                bool ordered = previous->effect != current->effect ? previous->effect < current->effect :
+                    previous->texture != current->texture ? previous->texture < current->texture :
+                    previous->material != current->material ? previous->material < current->material :
+                    previous->depth <= current->depth;
+                CHECK(ordered);
+            }
+        }
+
+        if (!previous || draw.program != draws[i - 1].program)
+            ++programChanges;
+        if (!previous || draw.texture != draws[i - 1].texture)
+            ++textureChanges;
+        if (!previous || current->material != previous->material)
+            ++materialChanges;
+        previous = current;
+    }
+
+    // The models sharing a material are drawn one after the other, front to back.
+    for (size_t i = 1; i < draws.size(); ++i)
+    {
+        if (draws[i].indexBuffer == keys[2].indexBuffer)
+            CHECK(draws[i - 1].indexBuffer == keys[3].indexBuffer);
+    }
+
+    // Programs and samplers are only bound when they change between draws, and the pass
+    // state only when the material changes; blending is enabled once for all transparent draws.
+    CHECK(RecordingGL::getProgramBindCount() == programChanges);
+    CHECK(statistics.programBinds == programChanges);
+    CHECK(RecordingGL::getTextureBindCount() == textureChanges);
+    CHECK(statistics.textureBinds == textureChanges);
+    CHECK(statistics.stateChanges == materialChanges);
+    CHECK(RecordingGL::getBlendChangeCount() == 1);
+
+    // Draw the models one by one for comparison, binding every pass in full.
+    RecordingGL::clear();
+    for (unsigned int i = 0; i < MODEL_COUNT; ++i)
+    {
+        nodes[i]->getModel()->draw();
+    }
+    unsigned int directProgramBinds = RecordingGL::getProgramBindCount();
+    unsigned int directTextureBinds = RecordingGL::getTextureBindCount();
+    CHECK(RecordingGL::getDraws().size() == MODEL_COUNT);
+    CHECK(programChanges < directProgramBinds);
+    CHECK(textureChanges < directTextureBinds);
+
+    fprintf(stdout, "Drawn directly: %u program binds, %u texture binds.\n", directProgramBinds, directTextureBinds);
+    fprintf(stdout, "Drawn through the queue: %u program binds, %u texture binds, %u state changes.\n",
+        statistics.programBinds, statistics.textureBinds, statistics.stateChanges);
+
+    queue.start();
+    SAFE_RELEASE(camera);
+    for (unsigned int i = 0; i < MODEL_COUNT; ++i)
+    {
+        SAFE_RELEASE(nodes[i]);
+    }
+    SAFE_RELEASE(textures[0]);
+    SAFE_RELEASE(textures[1]);
+    SAFE_RELEASE(effects[0]);
+    SAFE_RELEASE(effects[1]);
+
+    return failures;
+}
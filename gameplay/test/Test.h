@@ -0,0 +1,53 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include "gameplay.h"
+
+/**
+ * Records a failed check, along with its location, in the local variable 'failures'
+ * of the test function, and continues with the test.
+ */
+#define CHECK(condition) do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (0)
+
+/**
+ * A test run by gameplay-test. Returns the number of failed checks.
+ */
+typedef int (*TestFunction)();
+
+/**
+ * Draws models through a render queue and checks the order of the draws and the binds it skips.
+ */
+int testRenderQueue();
+
+/**
+ * Updates particles with and without SIMD and checks the results agree, including counts
+ * that are not a multiple of the SIMD width.
+ */
+int testParticleStreams();
+
+/**
+ * Checks the matrix products, transforms and inverses against a double precision reference,
+ * whether they are built on the SSE, NEON or scalar kernels.
+ */
+int testMath();
+
+/**
+ * Simulates a pile of boxes with one to eight physics threads, checks that all the runs with
+ * more than one thread give the same results, and prints the time taken by a step with each.
+ */
+int testPhysicsThreads();
+
+/**
+ * Checks that batched ray and sweep tests, in parallel or not, give the same results as single
+ * tests against a field of objects, and prints the number of rays tested per millisecond.
+ */
+int testPhysicsQueries();
+
+#endif
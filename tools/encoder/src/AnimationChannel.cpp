@@ -1,12 +1,14 @@
 #include "Base.h"
 #include "AnimationChannel.h"
 #include "Transform.h"
+#include "Quaternion.h"
 
 namespace gameplay
 {
 
 AnimationChannel::AnimationChannel(void) :
-    _targetAttrib(0)
+    _targetAttrib(0),
+    _quantized(false)
 {
 }
 
@@ -33,7 +35,21 @@ void AnimationChannel::writeBinary(FILE* file)
     {
         write((unsigned int)*i, file);
     }
-    write(_keyValues, file);
+    if (_quantized)
+    {
+        std::vector<float> offsets, scales;
+        std::vector<unsigned short> values;
+        quantizeKeyValues(&offsets, &scales, &values);
+        write((unsigned int)KEYS_UNORM16, file);
+        write(offsets, file);
+        write(scales, file);
+        write(values, file);
+    }
+    else
+    {
+        write((unsigned int)KEYS_FLOAT, file);
+        write(_keyValues, file);
+    }
     write(_tangentsIn, file);
     write(_tangentsOut, file);
     write(_interpolations, file);
@@ -45,6 +61,7 @@ void AnimationChannel::writeText(FILE* file)
     fprintfElement(file, "targetId", _targetId);
     fprintf(file, "<%s>%u %s</%s>\n", "targetAttrib", _targetAttrib, Transform::getPropertyString(_targetAttrib), "targetAttrib");
     fprintfElement(file, "%f ", "keytimes", _keytimes);
+    fprintfElement(file, "quantized", _quantized ? "true" : "false");
     fprintfElement(file, "%f ", "values", _keyValues);
     fprintfElement(file, "%f ", "tangentsIn", _tangentsIn);
     fprintfElement(file, "%f ", "tangentsOut", _tangentsOut);
@@ -175,6 +192,116 @@ void AnimationChannel::removeDuplicates()
     LOG(3, "      Removed %d duplicate keyframes from channel.\n", startCount- _keytimes.size());
 }
 
+void AnimationChannel::reduceKeyframes(float tolerance, float angleTolerance)
+{
+    const size_t propSize = Transform::getPropertySize(_targetAttrib);
+    const size_t keyCount = _keytimes.size();
+
+    // Only linear channels without per key frame data can be reduced.
+    if (propSize == 0 || keyCount < 3 || _keyValues.size() != keyCount * propSize || _interpolations.size() > 1 ||
+        (!_interpolations.empty() && _interpolations[0] != LINEAR) || !_tangentsIn.empty() || !_tangentsOut.empty())
+    {
+        return;
+    }
+
+    std::vector<float> keyTimes;
+    std::vector<float> keyValues;
+    std::vector<float> value(propSize);
+    keyTimes.push_back(_keytimes[0]);
+    keyValues.insert(keyValues.end(), _keyValues.begin(), _keyValues.begin() + propSize);
+
+    size_t start = 0;
+    while (start < keyCount - 1)
+    {
+        // Extend the segment from the start key frame for as long as interpolating across it
+        // reproduces all of the key frames it skips.
+        size_t end = start + 1;
+        while (end + 1 < keyCount)
+        {
+            const size_t next = end + 1;
+            const float duration = _keytimes[next] - _keytimes[start];
+            bool fits = true;
+            for (size_t k = start + 1; k < next && fits; ++k)
+            {
+                float s = duration > 0.0f ? (_keytimes[k] - _keytimes[start]) / duration : 0.0f;
+                interpolate(&_keyValues[start * propSize], &_keyValues[next * propSize], s, &value[0]);
+                float error, angleError;
+                measureError(&value[0], &_keyValues[k * propSize], &error, &angleError);
+                fits = error <= tolerance && angleError <= angleTolerance;
+            }
+            if (!fits)
+                break;
+            end = next;
+        }
+
+        keyTimes.push_back(_keytimes[end]);
+        keyValues.insert(keyValues.end(), _keyValues.begin() + end * propSize, _keyValues.begin() + (end + 1) * propSize);
+        start = end;
+    }
+
+    LOG(3, "      Reduced %lu key frames to %lu.\n", keyCount, keyTimes.size());
+    _keytimes.swap(keyTimes);
+    _keyValues.swap(keyValues);
+}
+
+void AnimationChannel::setQuantized(bool quantized)
+{
+    // The runtime decodes quantized channels into linear curves, so only linear channels
+    // without tangents can be quantized without changing how they play back.
+    _quantized = quantized && Transform::getPropertySize(_targetAttrib) > 0 &&
+        _keyValues.size() == _keytimes.size() * Transform::getPropertySize(_targetAttrib) && _interpolations.size() <= 1 &&
+        (_interpolations.empty() || _interpolations[0] == LINEAR) && _tangentsIn.empty() && _tangentsOut.empty();
+}
+
+void AnimationChannel::computeError(const std::vector<float>& keyTimes, const std::vector<float>& keyValues, float* error, float* angleError) const
+{
+    assert(error && angleError);
+
+    *error = 0.0f;
+    *angleError = 0.0f;
+    const size_t propSize = Transform::getPropertySize(_targetAttrib);
+    if (propSize == 0 || _keytimes.empty() || keyValues.size() != keyTimes.size() * propSize)
+        return;
+
+    std::vector<float> values;
+    getWrittenKeyValues(&values);
+
+    std::vector<float> value(propSize);
+    size_t segment = 0;
+    for (size_t i = 0; i < keyTimes.size(); ++i)
+    {
+        float time = keyTimes[i];
+        while (segment + 2 < _keytimes.size() && time > _keytimes[segment + 1])
+            ++segment;
+
+        if (_keytimes.size() == 1 || time <= _keytimes[segment])
+        {
+            std::copy(values.begin() + segment * propSize, values.begin() + (segment + 1) * propSize, value.begin());
+        }
+        else
+        {
+            float duration = _keytimes[segment + 1] - _keytimes[segment];
+            float s = duration > 0.0f ? std::min((time - _keytimes[segment]) / duration, 1.0f) : 1.0f;
+            interpolate(&values[segment * propSize], &values[(segment + 1) * propSize], s, &value[0]);
+        }
+
+        float keyError, keyAngleError;
+        measureError(&value[0], &keyValues[i * propSize], &keyError, &keyAngleError);
+        *error = std::max(*error, keyError);
+        *angleError = std::max(*angleError, keyAngleError);
+    }
+}
+
+unsigned int AnimationChannel::getKeyDataSize() const
+{
+    unsigned int size = (unsigned int)(_keytimes.size() * sizeof(unsigned int));
+    if (_quantized)
+        size += (unsigned int)(_keyValues.size() * sizeof(unsigned short) + Transform::getPropertySize(_targetAttrib) * 2 * sizeof(float));
+    else
+        size += (unsigned int)(_keyValues.size() * sizeof(float));
+    return size;
+}
+
 unsigned int AnimationChannel::getInterpolationType(const char* str)
 {
     unsigned int value = 0;
@@ -245,4 +372,110 @@ void AnimationChannel::deleteRange(size_t begin, size_t end, size_t propSize)
     // TODO: also remove key frames from _tangentsIn and _tangentsOut once other curve types are supported.
 }
 
+int AnimationChannel::getQuaternionOffset() const
+{
+    // Matches the rotation offsets used by the runtime.
+    switch (_targetAttrib)
+    {
+    case Transform::ANIMATE_ROTATE:
+    case Transform::ANIMATE_ROTATE_TRANSLATE:
+        return 0;
+    case Transform::ANIMATE_SCALE_ROTATE_TRANSLATE:
+        return 3;
+    default:
+        return -1;
+    }
+}
+
+void AnimationChannel::interpolate(const float* from, const float* to, float s, float* dst) const
+{
+    const size_t propSize = Transform::getPropertySize(_targetAttrib);
+    const int quaternionOffset = getQuaternionOffset();
+    for (size_t i = 0; i < propSize; ++i)
+    {
+        if ((int)i == quaternionOffset)
+        {
+            Quaternion q;
+            Quaternion::slerp(Quaternion(from[i], from[i + 1], from[i + 2], from[i + 3]), Quaternion(to[i], to[i + 1], to[i + 2], to[i + 3]), s, &q);
+            dst[i] = q.x;
+            dst[i + 1] = q.y;
+            dst[i + 2] = q.z;
+            dst[i + 3] = q.w;
+            i += 3;
+        }
+        else
+        {
+            dst[i] = from[i] + (to[i] - from[i]) * s;
+        }
+    }
+}
+
+void AnimationChannel::measureError(const float* a, const float* b, float* error, float* angleError) const
+{
+    const size_t propSize = Transform::getPropertySize(_targetAttrib);
+    const int quaternionOffset = getQuaternionOffset();
+    *error = 0.0f;
+    *angleError = 0.0f;
+    for (size_t i = 0; i < propSize; ++i)
+    {
+        if ((int)i == quaternionOffset)
+        {
+            // The angle between two rotations is twice the angle between their quaternions (q and -q are the same rotation).
+            float dot = a[i] * b[i] + a[i + 1] * b[i + 1] + a[i + 2] * b[i + 2] + a[i + 3] * b[i + 3];
+            float lengths = sqrt((a[i] * a[i] + a[i + 1] * a[i + 1] + a[i + 2] * a[i + 2] + a[i + 3] * a[i + 3]) *
+                                 (b[i] * b[i] + b[i + 1] * b[i + 1] + b[i + 2] * b[i + 2] + b[i + 3] * b[i + 3]));
+            if (lengths > 0.0f)
+                *angleError = 2.0f * acos(std::min((float)fabs(dot) / lengths, 1.0f));
+            i += 3;
+        }
+        else
+        {
+            *error = std::max(*error, (float)fabs(a[i] - b[i]));
+        }
+    }
+}
+
+void AnimationChannel::quantizeKeyValues(std::vector<float>* offsets, std::vector<float>* scales, std::vector<unsigned short>* values) const
+{
+    // Each component is stored as offset + scale * value / 65535, over the range of its values.
+    const size_t propSize = Transform::getPropertySize(_targetAttrib);
+    offsets->assign(propSize, FLT_MAX);
+    scales->assign(propSize, 0.0f);
+    std::vector<float> maxValues(propSize, -FLT_MAX);
+    for (size_t i = 0; i < _keyValues.size(); ++i)
+    {
+        (*offsets)[i % propSize] = std::min((*offsets)[i % propSize], _keyValues[i]);
+        maxValues[i % propSize] = std::max(maxValues[i % propSize], _keyValues[i]);
+    }
+    for (size_t i = 0; i < propSize; ++i)
+    {
+        (*scales)[i] = maxValues[i] > (*offsets)[i] ? maxValues[i] - (*offsets)[i] : 0.0f;
+    }
+
+    values->resize(_keyValues.size());
+    for (size_t i = 0; i < _keyValues.size(); ++i)
+    {
+        float scale = (*scales)[i % propSize];
+        float value = scale > 0.0f ? (_keyValues[i] - (*offsets)[i % propSize]) / scale : 0.0f;
+        (*values)[i] = (unsigned short)floor(std::min(std::max(value, 0.0f), 1.0f) * 65535.0f + 0.5f);
+    }
+}
+
+void AnimationChannel::getWrittenKeyValues(std::vector<float>* values) const
+{
+    *values = _keyValues;
+    if (!_quantized)
+        return;
+
+    // Decode the quantized values the way the runtime does.
+    std::vector<float> offsets, scales;
+    std::vector<unsigned short> quantized;
+    quantizeKeyValues(&offsets, &scales, &quantized);
+    const size_t propSize = offsets.size();
+    for (size_t i = 0; i < values->size(); ++i)
+    {
+        (*values)[i] = offsets[i % propSize] + (scales[i % propSize] / 65535.0f) * quantized[i];
+    }
+}
+
 }
@@ -10,6 +10,15 @@ class AnimationChannel : public Object
 {
 public:
 
+    /**
+     * The encodings of the key values.
+     */
+    enum KeyEncoding
+    {
+        KEYS_FLOAT = 0,
+        KEYS_UNORM16 = 1
+    };
+
     enum InterpolationTypes
     {
         LINEAR = 1,
@@ -65,6 +74,38 @@ public:
      */
     void removeDuplicates();
 
+    /**
+     * Removes the key frames that linear interpolation between the remaining key frames
+     * reproduces within the given tolerances. The rotation of transform channels is compared
+     * by the angle between the rotations.
+     *
+     * @param tolerance The largest difference allowed for components other than rotations.
+     * @param angleTolerance The largest angle (in radians) allowed between rotations.
+     */
+    void reduceKeyframes(float tolerance, float angleTolerance);
+
+    /**
+     * Sets whether the key values are written quantized to 16 bits per component, relative
+     * to the range of each component. Only linear channels without tangents are quantized.
+     */
+    void setQuantized(bool quantized);
+
+    /**
+     * Measures how far the key values, as they are written, are from the given key frames
+     * when interpolated at the given key times.
+     *
+     * @param keyTimes The key times to evaluate the channel at.
+     * @param keyValues The key values to compare against.
+     * @param error Set to the largest difference of a component other than rotations.
+     * @param angleError Set to the largest angle (in radians) between rotations.
+     */
+    void computeError(const std::vector<float>& keyTimes, const std::vector<float>& keyValues, float* error, float* angleError) const;
+
+    /**
+     * Returns the number of bytes the key times and values are written with.
+     */
+    unsigned int getKeyDataSize() const;
+
     /**
      * Returns the interpolation type value for the given string or zero if not valid.
      * Example: "LINEAR" returns AnimationChannel::LINEAR
@@ -86,6 +127,32 @@ private:
      */
     void deleteRange(size_t begin, size_t end, size_t propSize);
 
+    /**
+     * Returns the offset of the rotation quaternion within the key values, or -1 if there is none.
+     */
+    int getQuaternionOffset() const;
+
+    /**
+     * Interpolates linearly between two key values, spherically for the rotation.
+     */
+    void interpolate(const float* from, const float* to, float s, float* dst) const;
+
+    /**
+     * Measures the difference between two key values, returning the largest difference of the
+     * components other than rotations in error and the angle between the rotations in angleError.
+     */
+    void measureError(const float* a, const float* b, float* error, float* angleError) const;
+
+    /**
+     * Quantizes the key values to 16 bits, relative to the offset and scale of each component.
+     */
+    void quantizeKeyValues(std::vector<float>* offsets, std::vector<float>* scales, std::vector<unsigned short>* values) const;
+
+    /**
+     * Returns the key values as they are decoded after being written.
+     */
+    void getWrittenKeyValues(std::vector<float>* values) const;
+
 private:
 
     std::string _targetId;
@@ -95,6 +162,7 @@ private:
     std::vector<float> _tangentsIn;
     std::vector<float> _tangentsOut;
     std::vector<unsigned int> _interpolations;
+    bool _quantized;
 };
 
 }
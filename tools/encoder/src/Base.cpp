@@ -1,5 +1,11 @@
 #include "Base.h"
 
+#ifdef WIN32
+#include <Windows.h>
+#else
+#include <sys/time.h>
+#endif
+
 namespace gameplay
 {
 
@@ -23,4 +29,18 @@ std::string getBaseName(const std::string& filepath)
     return output;
 }
 
+double getTimeSeconds()
+{
+#ifdef WIN32
+    LARGE_INTEGER frequency, counter;
+    QueryPerformanceFrequency(&frequency);
+    QueryPerformanceCounter(&counter);
+    return (double)counter.QuadPart / (double)frequency.QuadPart;
+#else
+    timeval time;
+    gettimeofday(&time, NULL);
+    return time.tv_sec + time.tv_usec * 0.000001;
+#endif
+}
+
 }
\ No newline at end of file
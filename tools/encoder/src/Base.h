@@ -70,6 +70,19 @@ enum VertexUsage
     TEXCOORD7 = 15
 };
 
+/**
+ * Defines how the values of a vertex element are stored.
+ */
+enum VertexEncoding
+{
+    ENCODING_FLOAT = 0,
+    ENCODING_SNORM16 = 1,
+    ENCODING_OCTAHEDRAL16 = 2,
+    ENCODING_UNORM16 = 3,
+    ENCODING_UNORM8 = 4,
+    ENCODING_UINT8 = 5
+};
+
 void fillArray(float values[], float value, size_t length);
 
 /**
@@ -82,6 +95,13 @@ void fillArray(float values[], float value, size_t length);
  */
 std::string getBaseName(const std::string& filepath);
 
+/**
+ * Returns the wall clock time in seconds, for reporting how long encoding steps take.
+ *
+ * Unlike clock(), this does not add up the time of all threads.
+ */
+double getTimeSeconds();
+
 #define ISZERO(x) (fabs(x) < MATH_EPSILON)
 #define ISONE(x) ((x - 1.0f) < MATH_EPSILON)
 
@@ -24,6 +24,12 @@ EncoderArguments::EncoderArguments(size_t argc, const char** argv) :
     _fontPreview(false),
     _textOutput(false),
     _optimizeAnimations(false),
+    _optimizeMeshes(false),
+    _quantizeVertices(false),
+    _compressAnimations(false),
+    _animationTolerance(0.0f),
+    _animationAngleTolerance(0.0f),
+    _weldTolerance(0.0f),
     _animationGrouping(ANIMATIONGROUP_PROMPT),
     _outputMaterial(false)
 {
@@ -257,6 +263,24 @@ void EncoderArguments::printUsage() const
         "\t\tremoving any channels that contain default/identity values\n" \
         "\t\tand removing any duplicate contiguous keyframes, which are \n" \
         "\t\tcommon when exporting baked animation data.\n" \
+    "  -ac <tolerance>,<angle>\n" \
+        "\t\tCompresses node animations by removing the key frames that\n" \
+        "\t\tinterpolation reproduces within the given tolerance for\n" \
+        "\t\ttranslations and scales and the given angle (in degrees) for\n" \
+        "\t\trotations, and by storing key values as 16-bit values.\n" \
+    "  -om\n" \
+        "\t\tOptimizes meshes by reordering triangles for the vertex cache\n" \
+        "\t\tand vertices for fetch locality, and by using 16-bit indices\n" \
+        "\t\tfor mesh parts that allow it.\n" \
+    "  -qv\n" \
+        "\t\tQuantizes mesh vertices: positions are stored as 16-bit values\n" \
+        "\t\trelative to the mesh bounds, normals, tangents and binormals\n" \
+        "\t\tas 16-bit octahedral vectors, and texture coordinates, colors,\n" \
+        "\t\tblend weights and blend indices as 8 or 16-bit values when\n" \
+        "\t\tthey are in range.\n" \
+    "  -weld <tolerance>\n" \
+        "\t\tWelds mesh vertices whose attributes differ by no more than the\n" \
+        "\t\ttolerance. By default only identical vertices are welded.\n" \
     "  -h <size> \"<node ids>\" <filename>\n" \
         "\t\tGenerates a single heightmap image using meshes from the \n" \
         "\t\tspecified nodes. \n" \
@@ -305,6 +329,36 @@ bool EncoderArguments::optimizeAnimationsEnabled() const
     return _optimizeAnimations;
 }
 
+bool EncoderArguments::optimizeMeshesEnabled() const
+{
+    return _optimizeMeshes;
+}
+
+bool EncoderArguments::quantizeVerticesEnabled() const
+{
+    return _quantizeVertices;
+}
+
+bool EncoderArguments::compressAnimationsEnabled() const
+{
+    return _compressAnimations;
+}
+
+float EncoderArguments::getAnimationTolerance() const
+{
+    return _animationTolerance;
+}
+
+float EncoderArguments::getAnimationAngleTolerance() const
+{
+    return _animationAngleTolerance;
+}
+
+float EncoderArguments::getWeldTolerance() const
+{
+    return _weldTolerance;
+}
+
 bool EncoderArguments::outputMaterialEnabled() const
 {
     return _outputMaterial;
@@ -378,6 +432,26 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
     }
     switch (str[1])
     {
+    case 'a':
+        if (str == "-ac")
+        {
+            // Read animation compression tolerances
+            (*index)++;
+            std::vector<std::string> parts;
+            if (*index < options.size())
+            {
+                splitString(options[*index].c_str(), &parts);
+            }
+            if (parts.size() != 2 || (_animationTolerance = (float)atof(parts[0].c_str())) < 0.0f ||
+                (_animationAngleTolerance = MATH_DEG_TO_RAD((float)atof(parts[1].c_str()))) < 0.0f)
+            {
+                LOG(1, "Error: missing or invalid tolerance argument for -ac.\n");
+                _parseError = true;
+                return;
+            }
+            _compressAnimations = true;
+        }
+        break;
     case 'g':
         if (str.compare("-groupAnimations:auto") == 0 || str.compare("-g:auto") == 0)
         {
@@ -423,6 +497,11 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
             // Optimize animations
             _optimizeAnimations = true;
         }
+        else if (str == "-om")
+        {
+            // Optimize meshes
+            _optimizeMeshes = true;
+        }
         break;
     case 'h':
         {
@@ -501,6 +580,18 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
         _normalMap = true;
         break;
     case 'w':
+        if (str.compare("-weld") == 0)
+        {
+            // Read vertex weld tolerance
+            (*index)++;
+            if (*index >= options.size() || (_weldTolerance = (float)atof(options[*index].c_str())) < 0.0f)
+            {
+                LOG(1, "Error: missing or invalid tolerance argument for -weld.\n");
+                _parseError = true;
+                return;
+            }
+        }
+        else
         {
             // Read world size
             (*index)++;
@@ -532,6 +623,13 @@ void EncoderArguments::readOption(const std::vector<std::string>& options, size_
     case 'p':
         _fontPreview = true;
         break;
+    case 'q':
+        if (str == "-qv")
+        {
+            // Quantize vertices
+            _quantizeVertices = true;
+        }
+        break;
     case 's':
         if (_normalMap)
         {
@@ -154,8 +154,26 @@ public:
     bool fontPreviewEnabled() const;
     bool textOutputEnabled() const;
     bool optimizeAnimationsEnabled() const;
+    bool optimizeMeshesEnabled() const;
+    bool quantizeVerticesEnabled() const;
+    bool compressAnimationsEnabled() const;
     bool outputMaterialEnabled() const;
 
+    /**
+     * Returns the tolerance used to weld mesh vertices, or zero to only weld identical vertices.
+     */
+    float getWeldTolerance() const;
+
+    /**
+     * Returns the largest error allowed for animated translations and scales when compressing animations.
+     */
+    float getAnimationTolerance() const;
+
+    /**
+     * Returns the largest error allowed for animated rotations when compressing animations, in radians.
+     */
+    float getAnimationAngleTolerance() const;
+
     const char* getNodeId() const;
     unsigned int getFontSize() const;
 
@@ -202,6 +220,12 @@ private:
     bool _fontPreview;
     bool _textOutput;
     bool _optimizeAnimations;
+    bool _optimizeMeshes;
+    bool _quantizeVertices;
+    bool _compressAnimations;
+    float _animationTolerance;
+    float _animationAngleTolerance;
+    float _weldTolerance;
     AnimationGroupOption _animationGrouping;
     bool _outputMaterial;
 
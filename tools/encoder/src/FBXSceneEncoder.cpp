@@ -1221,6 +1221,8 @@ Mesh* FBXSceneEncoder::loadMesh(FbxMesh* fbxMesh)
         id.append("_Mesh");
         mesh->setId(id);
     }
+    mesh->setWeldTolerance(EncoderArguments::getInstance()->getWeldTolerance());
+    clock_t weldStart = clock();
 
     // The number of mesh parts is equal to the number of materials that affect this mesh.
     // There is always at least one mesh part.
@@ -1286,19 +1288,13 @@ Mesh* FBXSceneEncoder::loadMesh(FbxMesh* fbxMesh)
             }
 
             // Add the vertex to the mesh if it hasn't already been added and find the vertex index.
-            unsigned int index;
-            if (mesh->contains(vertex))
-            {
-                index = mesh->getVertexIndex(vertex);
-            }
-            else
-            {
-                index = mesh->addVertex(vertex);
-            }
+            unsigned int index = mesh->weldVertex(vertex);
             meshParts[meshPartIndex]->addIndex(index);
             vertexIndex++;
         }
     }
+    LOG(2, "Welded %d vertices of mesh '%s' into %u in %.1f ms.\n", vertexIndex, mesh->getId().c_str(),
+        (unsigned int)mesh->getVertexCount(), (clock() - weldStart) * 1000.0 / CLOCKS_PER_SEC);
 
     const size_t meshpartsSize = meshParts.size();
     for (size_t i = 0; i < meshpartsSize; ++i)
@@ -326,6 +326,25 @@ void GPBFile::adjust()
         optimizeAnimations();
     }
 
+    if (EncoderArguments::getInstance()->compressAnimationsEnabled())
+    {
+        LOG(1, "Compressing animations.\n");
+        compressAnimations(EncoderArguments::getInstance()->getAnimationTolerance(),
+            EncoderArguments::getInstance()->getAnimationAngleTolerance());
+    }
+
+    if (EncoderArguments::getInstance()->optimizeMeshesEnabled())
+    {
+        LOG(1, "Optimizing meshes.\n");
+        optimizeMeshes();
+    }
+
+    if (EncoderArguments::getInstance()->quantizeVerticesEnabled())
+    {
+        LOG(1, "Quantizing mesh vertices.\n");
+        quantizeMeshes();
+    }
+
     // TODO:
     // remove ambient _lights
     // for each node
@@ -398,6 +417,70 @@ void GPBFile::computeBounds(Node* node)
     }
 }
 
+void GPBFile::optimizeMeshes()
+{
+    // ACMR is reported for a FIFO cache of this size.
+    const unsigned int cacheSize = 32;
+
+    clock_t start = clock();
+    double missesBefore = 0.0;
+    double missesAfter = 0.0;
+    double triangles = 0.0;
+    for (std::list<Mesh*>::const_iterator i = _geometry.begin(); i != _geometry.end(); ++i)
+    {
+        Mesh* mesh = *i;
+        unsigned int triangleCount = 0;
+        for (std::vector<MeshPart*>::const_iterator j = mesh->parts.begin(); j != mesh->parts.end(); ++j)
+        {
+            triangleCount += (unsigned int)(*j)->getIndicesCount() / 3;
+        }
+
+        float acmrBefore = mesh->computeACMR(cacheSize);
+        mesh->optimize();
+        float acmrAfter = mesh->computeACMR(cacheSize);
+        LOG(2, "Optimized mesh '%s': ACMR %.3f -> %.3f (%u triangles).\n", mesh->getId().c_str(), acmrBefore, acmrAfter, triangleCount);
+
+        missesBefore += (double)acmrBefore * triangleCount;
+        missesAfter += (double)acmrAfter * triangleCount;
+        triangles += triangleCount;
+    }
+
+    if (triangles > 0.0)
+    {
+        LOG(1, "Optimized %u mesh(es) in %.2f s, ACMR %.3f -> %.3f.\n", (unsigned int)_geometry.size(),
+            (double)(clock() - start) / CLOCKS_PER_SEC, missesBefore / triangles, missesAfter / triangles);
+    }
+}
+
+void GPBFile::quantizeMeshes()
+{
+    double bytesBefore = 0.0;
+    double bytesAfter = 0.0;
+    float maxPositionError = 0.0f;
+    float maxDirectionError = 0.0f;
+    for (std::list<Mesh*>::const_iterator i = _geometry.begin(); i != _geometry.end(); ++i)
+    {
+        Mesh* mesh = *i;
+        unsigned int sizeBefore = mesh->getVertexByteSize();
+        float positionError, directionError;
+        mesh->quantizeVertices(&positionError, &directionError);
+        unsigned int sizeAfter = mesh->getVertexByteSize();
+        LOG(2, "Quantized mesh '%s': %u -> %u bytes per vertex, max position error %g, max normal error %.4f degrees.\n",
+            mesh->getId().c_str(), sizeBefore, sizeAfter, positionError, directionError);
+
+        bytesBefore += (double)sizeBefore * mesh->getVertexCount();
+        bytesAfter += (double)sizeAfter * mesh->getVertexCount();
+        maxPositionError = std::max(maxPositionError, positionError);
+        maxDirectionError = std::max(maxDirectionError, directionError);
+    }
+
+    if (bytesBefore > 0.0)
+    {
+        LOG(1, "Quantized %u mesh(es): vertex data %.0f -> %.0f bytes (%.0f%%), max position error %g, max normal error %.4f degrees.\n",
+            (unsigned int)_geometry.size(), bytesBefore, bytesAfter, 100.0 * bytesAfter / bytesBefore, maxPositionError, maxDirectionError);
+    }
+}
+
 void GPBFile::optimizeAnimations()
 {
     const unsigned int animationCount = _animations.getAnimationCount();
@@ -432,6 +515,60 @@ void GPBFile::optimizeAnimations()
     }
 }
 
+void GPBFile::compressAnimations(float tolerance, float angleTolerance)
+{
+    unsigned int channels = 0;
+    double keysBefore = 0.0;
+    double keysAfter = 0.0;
+    double bytesBefore = 0.0;
+    double bytesAfter = 0.0;
+    float maxError = 0.0f;
+    float maxAngleError = 0.0f;
+
+    const unsigned int animationCount = _animations.getAnimationCount();
+    for (unsigned int animationIndex = 0; animationIndex < animationCount; ++animationIndex)
+    {
+        Animation* animation = _animations.getAnimation(animationIndex);
+        assert(animation);
+
+        for (unsigned int channelIndex = 0, channelCount = animation->getAnimationChannelCount(); channelIndex < channelCount; ++channelIndex)
+        {
+            AnimationChannel* channel = animation->getAnimationChannel(channelIndex);
+            assert(channel);
+
+            const Object* obj = _refTable.get(channel->getTargetId());
+            if (!obj || obj->getTypeId() != Object::NODE_ID)
+                continue;
+
+            const std::vector<float> keyTimes = channel->getKeyTimes();
+            const std::vector<float> keyValues = channel->getKeyValues();
+            unsigned int sizeBefore = channel->getKeyDataSize();
+
+            channel->reduceKeyframes(tolerance, angleTolerance);
+            channel->setQuantized(true);
+
+            float error, angleError;
+            channel->computeError(keyTimes, keyValues, &error, &angleError);
+            LOG(3, "    Compressed channel %s:%u: %u -> %u key frames, max error %g, max rotation error %.4f degrees.\n",
+                animation->getId().c_str(), channelIndex + 1, (unsigned int)keyTimes.size(), (unsigned int)channel->getKeyTimes().size(), error, MATH_RAD_TO_DEG(angleError));
+
+            ++channels;
+            keysBefore += keyTimes.size();
+            keysAfter += channel->getKeyTimes().size();
+            bytesBefore += sizeBefore;
+            bytesAfter += channel->getKeyDataSize();
+            maxError = std::max(maxError, error);
+            maxAngleError = std::max(maxAngleError, angleError);
+        }
+    }
+
+    if (bytesBefore > 0.0)
+    {
+        LOG(1, "Compressed %u animation channel(s): %.0f -> %.0f key frames, key data %.0f -> %.0f bytes (%.0f%%), max error %g, max rotation error %.4f degrees.\n",
+            channels, keysBefore, keysAfter, bytesBefore, bytesAfter, 100.0 * bytesAfter / bytesBefore, maxError, MATH_RAD_TO_DEG(maxAngleError));
+    }
+}
+
 void GPBFile::decomposeTransformAnimationChannel(Animation* animation, AnimationChannel* channel, int channelIndex)
 {
     LOG(2, "  Optimizing animaton channel %s:%d.\n", animation->getId().c_str(), channelIndex+1);
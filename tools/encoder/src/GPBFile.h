@@ -21,7 +21,7 @@ namespace gameplay
  * Increment the version number when making a change that break binary compatibility.
  * [0] is major, [1] is minor.
  */
-const unsigned char GPB_VERSION[2] = {1, 2};
+const unsigned char GPB_VERSION[2] = {1, 4};
 
 /**
  * The GamePlay Binary file class handles writing the GamePlay Binary file.
@@ -132,6 +132,25 @@ private:
      */
     void optimizeAnimations();
 
+    /**
+     * Removes the key frames of node animation channels that interpolation reproduces within
+     * the given tolerances, quantizes their key values, and reports the savings and errors.
+     *
+     * @param tolerance The largest error allowed for translations and scales.
+     * @param angleTolerance The largest error allowed for rotations, in radians.
+     */
+    void compressAnimations(float tolerance, float angleTolerance);
+
+    /**
+     * Optimizes the meshes for the vertex cache and vertex fetch, and reports their ACMR.
+     */
+    void optimizeMeshes();
+
+    /**
+     * Quantizes the vertices of the meshes, and reports the vertex data savings and errors.
+     */
+    void quantizeMeshes();
+
     /**
      * Decomposes an ANIMATE_SCALE_ROTATE_TRANSLATE channel into 3 new channels. (Scale, Rotate and Translate)
      * 
@@ -2,10 +2,150 @@
 #include "Mesh.h"
 #include "Model.h"
 
+// Number of floats compared when welding vertices.
+#define VERTEX_VALUE_COUNT (Vertex::POSITION_COUNT + Vertex::NORMAL_COUNT + Vertex::TANGENT_COUNT + Vertex::BINORMAL_COUNT + \
+    Vertex::TEXCOORD_COUNT * MAX_UV_SETS + Vertex::DIFFUSE_COUNT + Vertex::BLEND_WEIGHTS_COUNT + Vertex::BLEND_INDICES_COUNT)
+
 namespace gameplay
 {
 
-Mesh::Mesh(void) : model(NULL)
+/**
+ * Copies all of the attributes of the vertex that take part in welding into values.
+ */
+static void getVertexValues(const Vertex& vertex, float* values)
+{
+    memcpy(values, &vertex.position.x, sizeof(float) * 3);
+    memcpy(values + 3, &vertex.normal.x, sizeof(float) * 3);
+    memcpy(values + 6, &vertex.tangent.x, sizeof(float) * 3);
+    memcpy(values + 9, &vertex.binormal.x, sizeof(float) * 3);
+    for (unsigned int i = 0; i < MAX_UV_SETS; ++i)
+    {
+        values[12 + i * 2] = vertex.texCoord[i].x;
+        values[13 + i * 2] = vertex.texCoord[i].y;
+    }
+    values += 12 + MAX_UV_SETS * 2;
+    memcpy(values, &vertex.diffuse.x, sizeof(float) * 4);
+    memcpy(values + 4, &vertex.blendWeights.x, sizeof(float) * 4);
+    memcpy(values + 8, &vertex.blendIndices.x, sizeof(float) * 4);
+}
+
+/**
+ * Returns the integer key of a vertex value. Equal values have equal keys, so -0 is treated as 0.
+ */
+static unsigned int getValueKey(float value)
+{
+    if (value == 0.0f)
+        value = 0.0f;
+    unsigned int bits;
+    memcpy(&bits, &value, sizeof(bits));
+    return bits;
+}
+
+// The largest coordinate of a cell of the weld grid (2^40). Values that are huge compared to
+// the tolerance, and values that are not numbers, are clamped to the cells at the ends of the
+// grid, so that cell coordinates and those of their neighbours always fit in a long long.
+#define WELD_CELL_MAX 1099511627776.0
+
+/**
+ * Returns the coordinates of the cell of the weld grid containing a position. The cells are
+ * cubes twice the size of the weld tolerance, so that positions within the tolerance of each
+ * other are always in the same or adjacent cells, despite the rounding of the division.
+ */
+static void getWeldCell(const Vector3& position, float tolerance, long long* cell)
+{
+    const float values[3] = { position.x, position.y, position.z };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        double coordinate = floor((double)values[i] / (2.0 * tolerance));
+        if (!(coordinate >= -WELD_CELL_MAX))
+            coordinate = -WELD_CELL_MAX;
+        else if (coordinate > WELD_CELL_MAX)
+            coordinate = WELD_CELL_MAX;
+        cell[i] = (long long)coordinate;
+    }
+}
+
+/**
+ * Adds a key to a MurmurHash3 hash.
+ */
+static unsigned int hashKey(unsigned int hash, unsigned int key)
+{
+    key *= 0xcc9e2d51u;
+    key = (key << 15) | (key >> 17);
+    key *= 0x1b873593u;
+    hash ^= key;
+    hash = (hash << 13) | (hash >> 19);
+    return hash * 5 + 0xe6546b64u;
+}
+
+/**
+ * Mixes the bits of a MurmurHash3 hash once all of its keys have been added.
+ */
+static unsigned int finalizeHash(unsigned int hash)
+{
+    hash ^= hash >> 16;
+    hash *= 0x85ebca6bu;
+    hash ^= hash >> 13;
+    hash *= 0xc2b2ae35u;
+    hash ^= hash >> 16;
+    return hash;
+}
+
+/**
+ * Returns the hash of a cell of the weld grid.
+ */
+static unsigned int hashWeldCell(const long long* cell)
+{
+    unsigned int hash = 0;
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        unsigned long long coordinate = (unsigned long long)cell[i];
+        hash = hashKey(hash, (unsigned int)coordinate);
+        hash = hashKey(hash, (unsigned int)(coordinate >> 32));
+    }
+    return finalizeHash(hash);
+}
+
+/**
+ * Copies the values of the vertex attribute with the given usage into values (padded with zeros to 4 values).
+ */
+static void getElementValues(const Vertex& vertex, unsigned int usage, float* values)
+{
+    fillArray(values, 0.0f, 4);
+    switch (usage)
+    {
+    case POSITION:
+        memcpy(values, &vertex.position.x, sizeof(float) * 3);
+        break;
+    case NORMAL:
+        memcpy(values, &vertex.normal.x, sizeof(float) * 3);
+        break;
+    case TANGENT:
+        memcpy(values, &vertex.tangent.x, sizeof(float) * 3);
+        break;
+    case BINORMAL:
+        memcpy(values, &vertex.binormal.x, sizeof(float) * 3);
+        break;
+    case COLOR:
+        memcpy(values, &vertex.diffuse.x, sizeof(float) * 4);
+        break;
+    case BLENDWEIGHTS:
+        memcpy(values, &vertex.blendWeights.x, sizeof(float) * 4);
+        break;
+    case BLENDINDICES:
+        memcpy(values, &vertex.blendIndices.x, sizeof(float) * 4);
+        break;
+    default:
+        if (usage >= TEXCOORD0 && usage <= TEXCOORD7)
+        {
+            values[0] = vertex.texCoord[usage - TEXCOORD0].x;
+            values[1] = vertex.texCoord[usage - TEXCOORD0].y;
+        }
+        break;
+    }
+}
+
+Mesh::Mesh(void) : model(NULL), _weldTolerance(0.0f)
 {
 }
 
@@ -42,16 +182,46 @@ void Mesh::writeBinaryVertices(FILE* file)
 {
     if (vertices.size() > 0)
     {
-        // Assumes that all vertices are the same size.
-        // Write the number of bytes for the vertex data
-        const Vertex& vertex = vertices.front();
-        write((unsigned int)(vertices.size() * vertex.byteSize()), file); // (vertex count) * (vertex size)
+        bool quantized = false;
+        for (std::vector<VertexElement>::const_iterator i = _vertexFormat.begin(); i != _vertexFormat.end(); ++i)
+        {
+            quantized |= i->encoding != ENCODING_FLOAT;
+        }
 
-        // for each vertex
-        for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+        if (quantized)
         {
-            // Write this vertex
-            i->writeBinary(file);
+            // Write the number of bytes for the vertex data
+            unsigned int vertexByteSize = getVertexByteSize();
+            write((unsigned int)(vertices.size() * vertexByteSize), file);
+
+            // Encode each vertex element by element, in the order of the vertex format.
+            std::vector<unsigned char> buffer(vertexByteSize);
+            for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+            {
+                unsigned char* data = &buffer[0];
+                for (std::vector<VertexElement>::const_iterator j = _vertexFormat.begin(); j != _vertexFormat.end(); ++j)
+                {
+                    float values[4];
+                    getElementValues(*i, j->usage, values);
+                    j->encode(values, data);
+                    data += j->byteSize();
+                }
+                fwrite(&buffer[0], 1, vertexByteSize, file);
+            }
+        }
+        else
+        {
+            // Assumes that all vertices are the same size.
+            // Write the number of bytes for the vertex data
+            const Vertex& vertex = vertices.front();
+            write((unsigned int)(vertices.size() * vertex.byteSize()), file); // (vertex count) * (vertex size)
+
+            // for each vertex
+            for (std::vector<Vertex>::const_iterator i = vertices.begin(); i != vertices.end(); ++i)
+            {
+                // Write this vertex
+                i->writeBinary(file);
+            }
         }
     }
     else
@@ -148,22 +318,328 @@ const VertexElement& Mesh::getVertexElement(unsigned int index) const
 
 bool Mesh::contains(const Vertex& vertex) const
 {
-    return vertexLookupTable.count(vertex) > 0;
+    return findVertex(vertex) >= 0;
 }
 
 unsigned int Mesh::addVertex(const Vertex& vertex)
 {
     unsigned int index = getVertexCount();
     vertices.push_back(vertex);
-    vertexLookupTable[vertex] = index;
+    _vertexHashes.push_back(hashVertex(vertex));
+
+    // Keep the lookup table at most half full.
+    if (vertices.size() * 2 > _vertexLookupTable.size())
+    {
+        rebuildVertexLookupTable(vertices.size());
+    }
+    else
+    {
+        size_t mask = _vertexLookupTable.size() - 1;
+        size_t slot = _vertexHashes[index] & mask;
+        while (_vertexLookupTable[slot] != 0)
+        {
+            slot = (slot + 1) & mask;
+        }
+        _vertexLookupTable[slot] = index + 1;
+    }
     return index;
 }
 
 unsigned int Mesh::getVertexIndex(const Vertex& vertex)
 {
-    std::map<Vertex,unsigned int>::iterator it;
-    it = vertexLookupTable.find(vertex);
-    return it->second;
+    int index = findVertex(vertex);
+    assert(index >= 0);
+    return (unsigned int)index;
+}
+
+unsigned int Mesh::weldVertex(const Vertex& vertex)
+{
+    int index = findVertex(vertex);
+    if (index >= 0)
+        return (unsigned int)index;
+    return addVertex(vertex);
+}
+
+void Mesh::setWeldTolerance(float tolerance)
+{
+    assert(vertices.empty());
+    _weldTolerance = tolerance > 0.0f ? tolerance : 0.0f;
+}
+
+int Mesh::findVertex(const Vertex& vertex) const
+{
+    if (_vertexLookupTable.empty())
+        return -1;
+
+    if (_weldTolerance == 0.0f)
+        return findVertex(vertex, hashVertex(vertex));
+
+    // A vertex within the tolerance of this one has its position in the same cell of the weld
+    // grid or in one of the 26 cells around it. The first vertex added that matches is returned.
+    long long cell[3];
+    getWeldCell(vertex.position, _weldTolerance, cell);
+    int found = -1;
+    for (int z = -1; z <= 1; ++z)
+    {
+        for (int y = -1; y <= 1; ++y)
+        {
+            for (int x = -1; x <= 1; ++x)
+            {
+                long long neighbour[3] = { cell[0] + x, cell[1] + y, cell[2] + z };
+                int index = findVertex(vertex, hashWeldCell(neighbour));
+                if (index >= 0 && (found < 0 || index < found))
+                    found = index;
+            }
+        }
+    }
+    return found;
+}
+
+int Mesh::findVertex(const Vertex& vertex, unsigned int hash) const
+{
+    size_t mask = _vertexLookupTable.size() - 1;
+    for (size_t slot = hash & mask; _vertexLookupTable[slot] != 0; slot = (slot + 1) & mask)
+    {
+        unsigned int index = _vertexLookupTable[slot] - 1;
+        if (_vertexHashes[index] == hash && matchVertex(vertices[index], vertex))
+            return (int)index;
+    }
+    return -1;
+}
+
+unsigned int Mesh::hashVertex(const Vertex& vertex) const
+{
+    if (_weldTolerance > 0.0f)
+    {
+        long long cell[3];
+        getWeldCell(vertex.position, _weldTolerance, cell);
+        return hashWeldCell(cell);
+    }
+
+    float values[VERTEX_VALUE_COUNT];
+    getVertexValues(vertex, values);
+    unsigned int hash = 0;
+    for (unsigned int i = 0; i < VERTEX_VALUE_COUNT; ++i)
+    {
+        hash = hashKey(hash, getValueKey(values[i]));
+    }
+    return finalizeHash(hash);
+}
+
+bool Mesh::matchVertex(const Vertex& a, const Vertex& b) const
+{
+    if (_weldTolerance == 0.0f)
+        return a == b;
+
+    float valuesA[VERTEX_VALUE_COUNT];
+    float valuesB[VERTEX_VALUE_COUNT];
+    getVertexValues(a, valuesA);
+    getVertexValues(b, valuesB);
+    for (unsigned int i = 0; i < VERTEX_VALUE_COUNT; ++i)
+    {
+        if (!(fabs(valuesA[i] - valuesB[i]) <= _weldTolerance))
+            return false;
+    }
+    return true;
+}
+
+void Mesh::rebuildVertexLookupTable(size_t capacity)
+{
+    size_t tableSize = 16;
+    while (tableSize < capacity * 2)
+        tableSize <<= 1;
+
+    // Vertices are inserted in order, so the first of several equal vertices is found first.
+    _vertexLookupTable.assign(tableSize, 0);
+    for (size_t i = 0, count = vertices.size(); i < count; ++i)
+    {
+        size_t slot = _vertexHashes[i] & (tableSize - 1);
+        while (_vertexLookupTable[slot] != 0)
+        {
+            slot = (slot + 1) & (tableSize - 1);
+        }
+        _vertexLookupTable[slot] = (unsigned int)i + 1;
+    }
+}
+
+void Mesh::optimize()
+{
+    // Reorder the triangles of each part for the vertex cache.
+    const unsigned int vertexCount = (unsigned int)vertices.size();
+    for (std::vector<MeshPart*>::iterator i = parts.begin(); i != parts.end(); ++i)
+    {
+        (*i)->optimizeVertexCache(vertexCount);
+    }
+
+    // Renumber the vertices in the order they are first referenced, so that they are fetched
+    // sequentially. Vertices that are not referenced keep their relative order at the end.
+    const unsigned int unassigned = (unsigned int)-1;
+    std::vector<unsigned int> remap(vertexCount, unassigned);
+    unsigned int next = 0;
+    for (std::vector<MeshPart*>::iterator i = parts.begin(); i != parts.end(); ++i)
+    {
+        MeshPart* part = *i;
+        for (unsigned int j = 0, count = (unsigned int)part->getIndicesCount(); j < count; ++j)
+        {
+            unsigned int index = part->getIndex(j);
+            if (remap[index] == unassigned)
+                remap[index] = next++;
+        }
+    }
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        if (remap[i] == unassigned)
+            remap[i] = next++;
+    }
+
+    std::vector<Vertex> reordered(vertexCount);
+    std::vector<unsigned int> hashes(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        reordered[remap[i]] = vertices[i];
+        hashes[remap[i]] = _vertexHashes[i];
+    }
+    vertices.swap(reordered);
+    _vertexHashes.swap(hashes);
+    rebuildVertexLookupTable(vertices.size());
+
+    // Remapping also picks the smallest index format that fits each part.
+    for (std::vector<MeshPart*>::iterator i = parts.begin(); i != parts.end(); ++i)
+    {
+        (*i)->remapIndices(remap);
+    }
+}
+
+float Mesh::computeACMR(unsigned int cacheSize) const
+{
+    unsigned int misses = 0;
+    unsigned int triangles = 0;
+    for (std::vector<MeshPart*>::const_iterator i = parts.begin(); i != parts.end(); ++i)
+    {
+        misses += (*i)->computeCacheMisses(cacheSize, &triangles);
+    }
+    return triangles > 0 ? (float)misses / (float)triangles : 0.0f;
+}
+
+/**
+ * Returns the angle in degrees between two vectors. It is measured with atan2 rather than acos,
+ * which loses too much precision for the small angles left by quantization.
+ */
+static float angleBetween(const float* a, const float* b)
+{
+    double x = (double)a[1] * b[2] - (double)a[2] * b[1];
+    double y = (double)a[2] * b[0] - (double)a[0] * b[2];
+    double z = (double)a[0] * b[1] - (double)a[1] * b[0];
+    double dot = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+    return (float)MATH_RAD_TO_DEG(atan2(sqrt(x * x + y * y + z * z), dot));
+}
+
+void Mesh::quantizeVertices(float* positionError, float* directionError)
+{
+    assert(positionError && directionError);
+
+    *positionError = 0.0f;
+    *directionError = 0.0f;
+    if (vertices.empty())
+        return;
+
+    for (std::vector<VertexElement>::iterator i = _vertexFormat.begin(); i != _vertexFormat.end(); ++i)
+    {
+        VertexElement& element = *i;
+        if (element.size > 4)
+            continue;
+
+        // Find the range of the element's values.
+        float minValues[4], maxValues[4], values[4];
+        fillArray(minValues, FLT_MAX, 4);
+        fillArray(maxValues, -FLT_MAX, 4);
+        bool integers = true;
+        for (std::vector<Vertex>::const_iterator j = vertices.begin(); j != vertices.end(); ++j)
+        {
+            getElementValues(*j, element.usage, values);
+            for (unsigned int k = 0; k < element.size; ++k)
+            {
+                minValues[k] = std::min(minValues[k], values[k]);
+                maxValues[k] = std::max(maxValues[k], values[k]);
+                integers &= values[k] == floor(values[k]);
+            }
+        }
+        bool unitRange = true;
+        bool byteRange = integers;
+        for (unsigned int k = 0; k < element.size; ++k)
+        {
+            unitRange &= minValues[k] >= 0.0f && maxValues[k] <= 1.0f;
+            byteRange &= minValues[k] >= 0.0f && maxValues[k] <= 255.0f;
+        }
+
+        switch (element.usage)
+        {
+        case POSITION:
+            element.encoding = ENCODING_SNORM16;
+            for (unsigned int k = 0; k < element.size; ++k)
+            {
+                element.offset[k] = (minValues[k] + maxValues[k]) * 0.5f;
+                element.scale[k] = (maxValues[k] - minValues[k]) * 0.5f;
+            }
+            break;
+        case NORMAL:
+        case TANGENT:
+        case BINORMAL:
+            if (element.size == 3)
+                element.encoding = ENCODING_OCTAHEDRAL16;
+            break;
+        case COLOR:
+        case BLENDWEIGHTS:
+            if (unitRange)
+                element.encoding = ENCODING_UNORM8;
+            break;
+        case BLENDINDICES:
+            if (byteRange)
+                element.encoding = ENCODING_UINT8;
+            break;
+        default:
+            if (element.usage >= TEXCOORD0 && element.usage <= TEXCOORD7 && unitRange)
+                element.encoding = ENCODING_UNORM16;
+            break;
+        }
+
+        // Measure the error of the encoding by decoding the encoded values.
+        if (element.encoding != ENCODING_SNORM16 && element.encoding != ENCODING_OCTAHEDRAL16)
+            continue;
+
+        unsigned char encoded[16];
+        float decoded[4];
+        for (std::vector<Vertex>::const_iterator j = vertices.begin(); j != vertices.end(); ++j)
+        {
+            getElementValues(*j, element.usage, values);
+            element.encode(values, encoded);
+            element.decode(encoded, decoded);
+            if (element.encoding == ENCODING_SNORM16)
+            {
+                float distance = 0.0f;
+                for (unsigned int k = 0; k < element.size; ++k)
+                {
+                    float d = decoded[k] - values[k];
+                    distance += d * d;
+                }
+                *positionError = std::max(*positionError, (float)sqrt(distance));
+            }
+            else if (values[0] != 0.0f || values[1] != 0.0f || values[2] != 0.0f)
+            {
+                *directionError = std::max(*directionError, angleBetween(values, decoded));
+            }
+        }
+    }
+}
+
+unsigned int Mesh::getVertexByteSize() const
+{
+    unsigned int size = 0;
+    for (std::vector<VertexElement>::const_iterator i = _vertexFormat.begin(); i != _vertexFormat.end(); ++i)
+    {
+        size += i->byteSize();
+    }
+    return size;
 }
 
 bool Mesh::hasNormals() const
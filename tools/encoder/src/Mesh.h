@@ -60,6 +60,51 @@ public:
 
     unsigned int getVertexIndex(const Vertex& vertex);
 
+    /**
+     * Returns the index of the vertex matching the given vertex within the weld tolerance,
+     * adding the vertex to this mesh if there is no such vertex.
+     */
+    unsigned int weldVertex(const Vertex& vertex);
+
+    /**
+     * Sets the tolerance used to match vertices when they are added.
+     *
+     * Vertices match when none of their attribute values differ by more than the
+     * tolerance. A tolerance of zero (the default) only matches identical vertices.
+     * The tolerance must be set before any vertices are added.
+     */
+    void setWeldTolerance(float tolerance);
+
+    /**
+     * Reorders the triangles of each MeshPart for the post-transform vertex cache and then
+     * the vertices in the order they are first used, and picks the smallest index format
+     * for each MeshPart.
+     */
+    void optimize();
+
+    /**
+     * Returns the average number of vertex cache misses per triangle (ACMR) over all
+     * triangle MeshParts, simulating a FIFO cache of the given size.
+     */
+    float computeACMR(unsigned int cacheSize) const;
+
+    /**
+     * Picks compact encodings for the vertex elements: positions as 16-bit values relative to
+     * the bounds of the mesh, normals, tangents and binormals as 16-bit octahedral unit vectors,
+     * texture coordinates in the range [0, 1] as normalized 16-bit values, colors and blend
+     * weights in the range [0, 1] as normalized 8-bit values and blend indices as 8-bit integers.
+     *
+     * @param positionError Set to the largest distance between a position and its decoded value.
+     * @param directionError Set to the largest angle (in degrees) between a normal, tangent or
+     *      binormal and its decoded value.
+     */
+    void quantizeVertices(float* positionError, float* directionError);
+
+    /**
+     * Returns the number of bytes each vertex is written with.
+     */
+    unsigned int getVertexByteSize() const;
+
     bool hasNormals() const;
     bool hasVertexColors() const;
 
@@ -69,10 +114,40 @@ public:
     std::vector<Vertex> vertices;
     std::vector<MeshPart*> parts;
     BoundingVolume bounds;
-    std::map<Vertex, unsigned int> vertexLookupTable;
 
 private:
+
+    /**
+     * Returns the index of the vertex matching the given vertex, or -1 if there is none.
+     */
+    int findVertex(const Vertex& vertex) const;
+
+    /**
+     * Returns the index of the first vertex with the given hash that matches the given
+     * vertex, or -1 if there is none.
+     */
+    int findVertex(const Vertex& vertex, unsigned int hash) const;
+
+    /**
+     * Returns the hash of the given vertex. With a weld tolerance, it is the hash of the
+     * cell of the weld grid containing the vertex position.
+     */
+    unsigned int hashVertex(const Vertex& vertex) const;
+
+    /**
+     * Returns true if the two vertices match within the weld tolerance.
+     */
+    bool matchVertex(const Vertex& a, const Vertex& b) const;
+
+    /**
+     * Rebuilds the vertex lookup table, growing it to fit the given number of vertices.
+     */
+    void rebuildVertexLookupTable(size_t capacity);
+
     std::vector<VertexElement> _vertexFormat;
+    std::vector<unsigned int> _vertexLookupTable;
+    std::vector<unsigned int> _vertexHashes;
+    float _weldTolerance;
 
 };
 
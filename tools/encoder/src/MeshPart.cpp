@@ -1,9 +1,44 @@
 #include "Base.h"
 #include "MeshPart.h"
 
+// Size of the LRU vertex cache modelled when reordering triangles.
+#define VERTEX_CACHE_SIZE 32
+
 namespace gameplay
 {
 
+/**
+ * Returns the score of a vertex for the vertex cache optimization, from its position in
+ * the cache (-1 when it is not in the cache) and its number of triangles still to be added.
+ *
+ * This is the scoring function from Tom Forsyth's "Linear-Speed Vertex Cache Optimisation".
+ */
+static float scoreVertex(int cachePosition, unsigned int remainingTriangles)
+{
+    if (remainingTriangles == 0)
+        return -1.0f;
+
+    float score = 0.0f;
+    if (cachePosition >= 0)
+    {
+        if (cachePosition < 3)
+        {
+            // Vertices used by the last triangle score the same, so that the next triangle
+            // is not biased towards any of its edges.
+            score = 0.75f;
+        }
+        else
+        {
+            const float scale = 1.0f / (VERTEX_CACHE_SIZE - 3);
+            score = powf(1.0f - (cachePosition - 3) * scale, 1.5f);
+        }
+    }
+
+    // Favour vertices with few triangles left, to get rid of lone triangles early.
+    score += 2.0f * powf((float)remainingTriangles, -0.5f);
+    return score;
+}
+
 MeshPart::MeshPart(void) :
     _primitiveType(TRIANGLES),
     _indexFormat(INDEX16)
@@ -86,6 +121,163 @@ unsigned int MeshPart::getIndex(unsigned int i) const
     return _indices[i];
 }
 
+void MeshPart::optimizeVertexCache(unsigned int vertexCount)
+{
+    if (_primitiveType != TRIANGLES || _indices.size() < 6 || _indices.size() % 3 != 0)
+        return;
+
+    const unsigned int triangleCount = (unsigned int)_indices.size() / 3;
+
+    // Build the list of triangles using each vertex.
+    std::vector<unsigned int> triangleOffsets(vertexCount + 1, 0);
+    for (size_t i = 0, count = _indices.size(); i < count; ++i)
+    {
+        triangleOffsets[_indices[i] + 1]++;
+    }
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        triangleOffsets[i + 1] += triangleOffsets[i];
+    }
+    std::vector<unsigned int> remainingTriangles(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        remainingTriangles[i] = triangleOffsets[i + 1] - triangleOffsets[i];
+    }
+    std::vector<unsigned int> vertexTriangles(_indices.size());
+    {
+        std::vector<unsigned int> fill(triangleOffsets.begin(), triangleOffsets.end() - 1);
+        for (size_t i = 0, count = _indices.size(); i < count; ++i)
+        {
+            vertexTriangles[fill[_indices[i]]++] = (unsigned int)(i / 3);
+        }
+    }
+
+    // Start with the triangle with the highest score.
+    std::vector<float> vertexScores(vertexCount);
+    for (unsigned int i = 0; i < vertexCount; ++i)
+    {
+        vertexScores[i] = scoreVertex(-1, remainingTriangles[i]);
+    }
+    unsigned int bestTriangle = 0;
+    float bestScore = -1.0f;
+    for (unsigned int i = 0; i < triangleCount; ++i)
+    {
+        float score = vertexScores[_indices[i * 3]] + vertexScores[_indices[i * 3 + 1]] + vertexScores[_indices[i * 3 + 2]];
+        if (score > bestScore)
+        {
+            bestScore = score;
+            bestTriangle = i;
+        }
+    }
+    std::vector<bool> triangleAdded(triangleCount, false);
+
+    std::vector<unsigned int> optimized;
+    optimized.reserve(_indices.size());
+    std::vector<unsigned int> cache;
+    std::vector<unsigned int> newCache;
+    cache.reserve(VERTEX_CACHE_SIZE + 3);
+    newCache.reserve(VERTEX_CACHE_SIZE + 3);
+
+    unsigned int nextUnadded = 0;
+    for (unsigned int added = 0; added < triangleCount; ++added)
+    {
+        triangleAdded[bestTriangle] = true;
+        const unsigned int* triangle = &_indices[bestTriangle * 3];
+
+        // Emit the triangle and remove it from the triangle lists of its vertices.
+        newCache.clear();
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            unsigned int v = triangle[i];
+            optimized.push_back(v);
+            newCache.push_back(v);
+
+            unsigned int* first = &vertexTriangles[triangleOffsets[v]];
+            unsigned int* last = first + remainingTriangles[v];
+            *std::find(first, last, bestTriangle) = *(last - 1);
+            remainingTriangles[v]--;
+        }
+
+        // Move the triangle's vertices to the front of the cache.
+        for (size_t i = 0, count = cache.size(); i < count; ++i)
+        {
+            unsigned int v = cache[i];
+            if (v != triangle[0] && v != triangle[1] && v != triangle[2])
+                newCache.push_back(v);
+        }
+        cache.swap(newCache);
+
+        // Update the scores of the vertices in the cache, and of the ones that fell out of it,
+        // and pick the best of the triangles using them.
+        bestScore = -1.0f;
+        for (size_t i = 0, count = cache.size(); i < count; ++i)
+        {
+            unsigned int v = cache[i];
+            vertexScores[v] = scoreVertex(i < VERTEX_CACHE_SIZE ? (int)i : -1, remainingTriangles[v]);
+        }
+        for (size_t i = 0, count = cache.size(); i < count; ++i)
+        {
+            unsigned int v = cache[i];
+            for (unsigned int j = 0; j < remainingTriangles[v]; ++j)
+            {
+                unsigned int t = vertexTriangles[triangleOffsets[v] + j];
+                float score = vertexScores[_indices[t * 3]] + vertexScores[_indices[t * 3 + 1]] + vertexScores[_indices[t * 3 + 2]];
+                if (score > bestScore)
+                {
+                    bestScore = score;
+                    bestTriangle = t;
+                }
+            }
+        }
+        if (cache.size() > VERTEX_CACHE_SIZE)
+            cache.resize(VERTEX_CACHE_SIZE);
+
+        // When no triangle uses a cached vertex, continue with the first one not added yet.
+        if (bestScore < 0.0f && added + 1 < triangleCount)
+        {
+            while (triangleAdded[nextUnadded])
+                ++nextUnadded;
+            bestTriangle = nextUnadded;
+        }
+    }
+
+    _indices.swap(optimized);
+}
+
+void MeshPart::remapIndices(const std::vector<unsigned int>& remap)
+{
+    _indexFormat = INDEX16;
+    for (std::vector<unsigned int>::iterator i = _indices.begin(); i != _indices.end(); ++i)
+    {
+        *i = remap[*i];
+        updateIndexFormat(*i);
+    }
+}
+
+unsigned int MeshPart::computeCacheMisses(unsigned int cacheSize, unsigned int* triangleCount) const
+{
+    assert(triangleCount);
+
+    if (_primitiveType != TRIANGLES || cacheSize == 0)
+        return 0;
+
+    // FIFO cache: a hit does not change the order of the cache entries.
+    std::vector<unsigned int> cache(cacheSize, (unsigned int)-1);
+    unsigned int next = 0;
+    unsigned int misses = 0;
+    for (std::vector<unsigned int>::const_iterator i = _indices.begin(); i != _indices.end(); ++i)
+    {
+        if (std::find(cache.begin(), cache.end(), *i) == cache.end())
+        {
+            cache[next] = *i;
+            next = (next + 1) % cacheSize;
+            ++misses;
+        }
+    }
+    *triangleCount += (unsigned int)(_indices.size() / 3);
+    return misses;
+}
+
 void MeshPart::writeBinaryIndex(unsigned int index, FILE* file)
 {
     switch (_indexFormat)
@@ -62,6 +62,28 @@ public:
      */
     unsigned int getIndex(unsigned int i) const;
 
+    /**
+     * Reorders the triangles of this MeshPart so that they reuse vertices from the
+     * post-transform vertex cache as much as possible. Only applies to triangle lists.
+     *
+     * @param vertexCount The number of vertices in the mesh.
+     */
+    void optimizeVertexCache(unsigned int vertexCount);
+
+    /**
+     * Replaces each index i with remap[i] and picks the smallest index format that fits.
+     */
+    void remapIndices(const std::vector<unsigned int>& remap);
+
+    /**
+     * Returns the number of vertex cache misses when drawing this MeshPart, simulating
+     * a FIFO cache of the given size. Only applies to triangle lists.
+     *
+     * @param cacheSize The number of entries in the simulated cache.
+     * @param triangleCount Incremented by the number of triangles in this MeshPart.
+     */
+    unsigned int computeCacheMisses(unsigned int cacheSize, unsigned int* triangleCount) const;
+
 private:
 
     /**
@@ -1,6 +1,7 @@
 #include "NormalMapGenerator.h"
 #include "Image.h"
 #include "Base.h"
+#include "Thread.h"
 
 namespace gameplay
 {
@@ -30,34 +31,192 @@ bool equalsIgnoreCase(const std::string& s1, const std::string& s2)
     return true;
 }
 
-float getHeight(float* heights, int width, int height, int x, int y)
+// Number of rows of the normal map computed by a single job.
+#define NORMAL_MAP_ROWS_PER_JOB 16
+
+// SIMD
+#if defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+    #include <emmintrin.h>
+    #define USE_SSE
+#endif
+
+struct NormalPixel
+{
+    unsigned char r, g, b;
+};
+
+// Data shared by the threads computing the normal map.
+struct NormalMapJobData
+{
+    const float* heights;       // [in]
+    NormalPixel* pixels;        // [out]
+    int width;                  // [in]
+    int height;                 // [in]
+    float scaleX;               // [in]
+    float scaleZ;               // [in]
+    volatile long rowsDone;     // [in][out]
+};
+
+/**
+ * Computes the X and Z components of the two face normals of each quad in a row of quads.
+ *
+ * The Y component of every face normal is scaleX * scaleZ, and is not stored.
+ * The expressions are the cross products of the triangle edges (see the diagram in
+ * NormalMapGenerator::generate) expanded for a regular grid.
+ *
+ * Each component has its own loop. A loop writing all four reads and writes through more
+ * pointers than the compiler checks for aliasing at run time, so it would not be vectorized.
+ */
+static void computeFaceNormals(const float* top, const float* bottom, int quadCount, float scaleX, float scaleZ,
+    float* normal1X, float* normal1Z, float* normal2X, float* normal2Z)
 {
-    if (x < 0)
-        x = 0;
-    else if (x >= width)
-        x = width-1;
-    if (y < 0)
-        y = 0;
-    else if (y >= height)
-        y = height-1;
-    return heights[y*width+x];
+    for (int x = 0; x < quadCount; ++x)
+        normal1X[x] = scaleZ * (top[x] - top[x + 1]);
+    for (int x = 0; x < quadCount; ++x)
+        normal1Z[x] = scaleX * (top[x] - bottom[x]);
+    for (int x = 0; x < quadCount; ++x)
+        normal2X[x] = scaleZ * (bottom[x] - bottom[x + 1]);
+    for (int x = 0; x < quadCount; ++x)
+        normal2Z[x] = scaleX * (top[x + 1] - bottom[x + 1]);
 }
 
-void calculateNormal(
-    float x1, float y1, float z1,
-    float x2, float y2, float z2,
-    float x3, float y3, float z3,
-    Vector3* normal)
+/**
+ * Sums one component of the six face normals adjacent to each interior vertex of a row:
+ * the second triangle of the quad to its top left, both triangles of the quads to its
+ * bottom left and top right, and the first triangle of the quad to its bottom right.
+ * All the triangles have the same area, so the sum does not need to be weighted.
+ */
+static void sumVertexNormals(const float* above1, const float* above2, const float* below1, const float* below2,
+    int quadCount, float* dst)
 {
-    Vector3 E(x1, y1, z1);
-    Vector3 F(x2, y2, z2);
-    Vector3 G(x3, y3, z3);
+    for (int x = 1; x < quadCount; ++x)
+        dst[x] = above2[x - 1] + above1[x] + above2[x] + below1[x - 1] + below2[x - 1] + below1[x];
+}
 
-    Vector3 P, Q;
-    Vector3::subtract(F, E, &P);
-    Vector3::subtract(G, E, &Q);
+/**
+ * Computes the reciprocal of the length of each normal.
+ *
+ * Compilers that set errno from sqrtf do not vectorize a loop calling it, so the SSE
+ * version is written out. Both versions round the same way and give the same results.
+ */
+static void computeInverseLengths(const float* x, const float* y, const float* z, int count, float* dst)
+{
+    int i = 0;
+#ifdef USE_SSE
+    const __m128 one = _mm_set1_ps(1.0f);
+    for (; i + 4 <= count; i += 4)
+    {
+        __m128 vx = _mm_loadu_ps(x + i);
+        __m128 vy = _mm_loadu_ps(y + i);
+        __m128 vz = _mm_loadu_ps(z + i);
+        __m128 lengthSq = _mm_add_ps(_mm_add_ps(_mm_mul_ps(vx, vx), _mm_mul_ps(vy, vy)), _mm_mul_ps(vz, vz));
+        _mm_storeu_ps(dst + i, _mm_div_ps(one, _mm_sqrt_ps(lengthSq)));
+    }
+#endif
+    for (; i < count; ++i)
+        dst[i] = 1.0f / sqrtf(x[i] * x[i] + y[i] * y[i] + z[i] * z[i]);
+}
 
-    Vector3::cross(Q, P, normal);
+/**
+ * Scales one component of each normal to unit length and packs it into a byte.
+ */
+static void packNormals(const float* values, const float* inverseLengths, int count, unsigned char* dst)
+{
+    for (int i = 0; i < count; ++i)
+        dst[i] = (unsigned char)((values[i] * inverseLengths[i] + 1.0f) * 0.5f * 255.0f);
+}
+
+/**
+ * Computes rows [begin, end) of the normal map.
+ */
+static void generateNormalMapRows(int begin, int end, void* arg)
+{
+    NormalMapJobData* data = (NormalMapJobData*)arg;
+    const int width = data->width;
+    const int height = data->height;
+    const int quadCount = width - 1;
+    const float faceY = data->scaleX * data->scaleZ;
+
+    // Face normals of the quads above and below the current row of vertices. Quads outside
+    // of the heightmap have zero normals and are left out of the Y sum.
+    std::vector<float> faces(quadCount * 8, 0.0f);
+    float* above = &faces[0];
+    float* below = &faces[quadCount * 4];
+
+    // Vertex normals of the current row, their reciprocal lengths, and their packed
+    // components, each stored in its own array.
+    std::vector<float> vertices(width * 4);
+    float* normalX = &vertices[0];
+    float* normalY = &vertices[width];
+    float* normalZ = &vertices[width * 2];
+    float* inverseLengths = &vertices[width * 3];
+    std::vector<unsigned char> channels(width * 3);
+    unsigned char* red = &channels[0];
+    unsigned char* green = &channels[width];
+    unsigned char* blue = &channels[width * 2];
+
+    if (begin > 0)
+    {
+        computeFaceNormals(data->heights + (begin - 1) * width, data->heights + begin * width, quadCount,
+            data->scaleX, data->scaleZ, above, above + quadCount, above + quadCount * 2, above + quadCount * 3);
+    }
+
+    for (int z = begin; z < end; ++z)
+    {
+        const bool hasAbove = z > 0;
+        const bool hasBelow = z < height - 1;
+        if (hasBelow)
+        {
+            computeFaceNormals(data->heights + z * width, data->heights + (z + 1) * width, quadCount,
+                data->scaleX, data->scaleZ, below, below + quadCount, below + quadCount * 2, below + quadCount * 3);
+        }
+        else
+        {
+            std::fill(below, below + quadCount * 4, 0.0f);
+        }
+
+        const float* a1x = above;
+        const float* a1z = above + quadCount;
+        const float* a2x = above + quadCount * 2;
+        const float* a2z = above + quadCount * 3;
+        const float* b1x = below;
+        const float* b1z = below + quadCount;
+        const float* b2x = below + quadCount * 2;
+        const float* b2z = below + quadCount * 3;
+
+        // Interior vertices
+        sumVertexNormals(a1x, a2x, b1x, b2x, quadCount, normalX);
+        sumVertexNormals(a1z, a2z, b1z, b2z, quadCount, normalZ);
+        std::fill(normalY, normalY + width, faceY * ((hasAbove ? 3 : 0) + (hasBelow ? 3 : 0)));
+
+        // Left and right edges
+        int last = quadCount - 1;
+        normalX[0] = a1x[0] + a2x[0] + b1x[0];
+        normalY[0] = faceY * ((hasAbove ? 2 : 0) + (hasBelow ? 1 : 0));
+        normalZ[0] = a1z[0] + a2z[0] + b1z[0];
+        normalX[width - 1] = a2x[last] + b1x[last] + b2x[last];
+        normalY[width - 1] = faceY * ((hasAbove ? 1 : 0) + (hasBelow ? 2 : 0));
+        normalZ[width - 1] = a2z[last] + b1z[last] + b2z[last];
+
+        computeInverseLengths(normalX, normalY, normalZ, width, inverseLengths);
+        packNormals(normalX, inverseLengths, width, red);
+        packNormals(normalY, inverseLengths, width, green);
+        packNormals(normalZ, inverseLengths, width, blue);
+
+        // Interleave the channels into the pixels of the row.
+        NormalPixel* pixels = data->pixels + z * width;
+        for (int x = 0; x < width; ++x)
+        {
+            pixels[x].r = red[x];
+            pixels[x].g = green[x];
+            pixels[x].b = blue[x];
+        }
+
+        std::swap(above, below);
+    }
+
+    int rowsDone = atomicAdd(&data->rowsDone, end - begin);
+    LOG(1, "\rCalculating normals... %d%%", (int)((float)rowsDone / height * 100));
 }
 
 float normalizedHeightPacked(float r, float g, float b)
@@ -202,118 +361,36 @@ void NormalMapGenerator::generate()
     //
     ///////////////////////////////////////////////////////////////////////////////////////////////
 
-    struct NormalPixel
+    if (_resolutionX < 2 || _resolutionY < 2)
     {
-        unsigned char r, g, b;
-    };
-    NormalPixel* normalPixels = new NormalPixel[_resolutionX * _resolutionY];
+        LOG(1, "Heightmap must be at least 2x2 pixels: %s.\n", _inputFile.c_str());
+        delete[] heights;
+        return;
+    }
 
-    struct Face
-    {
-        Vector3 normal1;
-        Vector3 normal2;
-    };
+    NormalPixel* normalPixels = new NormalPixel[_resolutionX * _resolutionY];
 
-    int progressMax = (_resolutionX-1) * (_resolutionY-1) + _resolutionX * _resolutionY;
-    int progress = 0;
+    // Compute the vertex normals in parallel, in blocks of rows.
+    LOG(1, "Calculating normals... 0%%");
+    double startTime = getTimeSeconds();
 
-    Vector2 scale(_worldSize.x / (_resolutionX-1), _worldSize.z / (_resolutionY-1));
+    NormalMapJobData data;
+    data.heights = heights;
+    data.pixels = normalPixels;
+    data.width = _resolutionX;
+    data.height = _resolutionY;
+    data.scaleX = _worldSize.x / (_resolutionX-1);
+    data.scaleZ = _worldSize.z / (_resolutionY-1);
+    data.rowsDone = 0;
+    int threadCount = parallelFor(_resolutionY, NORMAL_MAP_ROWS_PER_JOB, &generateNormalMapRows, &data);
 
-    // First calculate all face normals for the heightmap
-    LOG(1, "Calculating normals... 0%%");
-    Face* faceNormals = new Face[(_resolutionX - 1) * (_resolutionY - 1)];
-    Vector3 v1, v2;
-    for (int z = 0; z < _resolutionY-1; z++)
-    {
-        for (int x = 0; x < _resolutionX-1; x++)
-        {
-            float topLeftHeight = getHeight(heights, _resolutionX, _resolutionY, x, z);
-            float bottomLeftHeight = getHeight(heights, _resolutionX, _resolutionY, x, z + 1);
-            float bottomRightHeight = getHeight(heights, _resolutionX, _resolutionY, x + 1, z + 1);
-            float topRightHeight = getHeight(heights, _resolutionX, _resolutionY, x + 1, z);
-
-            // Triangle 1
-            calculateNormal(
-                (float)x*scale.x, bottomLeftHeight, (float)(z + 1)*scale.y,
-                (float)x*scale.x, topLeftHeight, (float)z*scale.y,
-                (float)(x + 1)*scale.x, topRightHeight, (float)z*scale.y,
-                &faceNormals[z*(_resolutionX-1)+x].normal1);
-
-            // Triangle 2
-            calculateNormal(
-                (float)x*scale.x, bottomLeftHeight, (float)(z + 1)*scale.y,
-                (float)(x + 1)*scale.x, topRightHeight, (float)z*scale.y,
-                (float)(x + 1)*scale.x, bottomRightHeight, (float)(z + 1)*scale.y,
-                &faceNormals[z*(_resolutionX-1)+x].normal2);
-
-            ++progress;
-            LOG(1, "\rCalculating normals... %d%%", (int)(((float)progress / progressMax) * 100));
-        }
-    }
+    LOG(1, "\rCalculating normals... Done (%dx%d in %.2f s on %d threads).\n", _resolutionX, _resolutionY,
+        getTimeSeconds() - startTime, threadCount);
 
     // Free height array
     delete[] heights;
     heights = NULL;
 
-    // Smooth normals by taking an average for each vertex
-    Vector3 normal;
-    for (int z = 0; z < _resolutionY; z++)
-    {
-        for (int x = 0; x < _resolutionX; x++)
-        {
-            // Reset normal sum
-            normal.set(0, 0, 0);
-
-            if (x > 0)
-            {
-                if (z > 0)
-                {
-                    // Top left
-                    normal.add(faceNormals[(z-1)*(_resolutionX-1) + (x-1)].normal2);
-                }
-
-                if (z < (_resolutionY - 1))
-                {
-                    // Bottom left
-                    normal.add(faceNormals[z*(_resolutionX-1) + (x - 1)].normal1);
-                    normal.add(faceNormals[z*(_resolutionX-1) + (x - 1)].normal2);
-                }
-            }
-
-            if (x < (_resolutionX - 1))
-            {
-                if (z > 0)
-                {
-                    // Top right
-                    normal.add(faceNormals[(z-1)*(_resolutionX-1) + x].normal1);
-                    normal.add(faceNormals[(z-1)*(_resolutionX-1) + x].normal2);
-                }
-
-                if (z < (_resolutionY - 1))
-                {
-                    // Bottom right
-                    normal.add(faceNormals[z*(_resolutionX-1) + x].normal1);
-                }
-            }
-
-            // We don't have to worry about weighting the normals by
-            // the surface area of the triangles since a heightmap 
-            // guarantees that all triangles have the same surface area.
-            normal.normalize();
-
-            // Store this vertex normal
-            NormalPixel& pixel = normalPixels[z*_resolutionX + x];
-            pixel.r = (unsigned char)((normal.x + 1.0f) * 0.5f * 255.0f);
-            pixel.g = (unsigned char)((normal.y + 1.0f) * 0.5f * 255.0f);
-            pixel.b = (unsigned char)((normal.z + 1.0f) * 0.5f * 255.0f);
-
-            ++progress;
-            LOG(1, "\rCalculating normals... %d%%", (int)(((float)progress / progressMax) * 100));
-        }
-    }
-
-    LOG(1, "\rCalculating normals... Done.\n");
-
     // Create and save an image for the normal map
     Image* normalMap = Image::create(Image::RGB, _resolutionX, _resolutionY);
     normalMap->setData(normalPixels);
@@ -1,13 +1,18 @@
 #ifndef THREAD_H_
 #define THREAD_H_
 
+#ifdef WIN32
+    #include <Windows.h>
+#else
+    #include <pthread.h>
+    #include <unistd.h>
+#endif
+
 namespace gameplay
 {
 
 #ifdef WIN32
 
-    #include <Windows.h>
-
     typedef HANDLE THREAD_HANDLE;
 
     struct WindowsThreadData
@@ -16,7 +21,7 @@ namespace gameplay
         void* arg;
     };
 
-    DWORD WINAPI WindowsThreadProc(LPVOID lpParam)
+    static DWORD WINAPI WindowsThreadProc(LPVOID lpParam)
     {
         WindowsThreadData* data = (WindowsThreadData*)lpParam;
         int(*threadFunction)(void*) = data->threadFunction;
@@ -45,9 +50,19 @@ namespace gameplay
         CloseHandle(thread);
     }
 
-#else
+    static int getProcessorCount()
+    {
+        SYSTEM_INFO info;
+        GetSystemInfo(&info);
+        return (int)info.dwNumberOfProcessors;
+    }
 
-    #include <pthread.h>
+    inline int atomicAdd(volatile long* value, int amount)
+    {
+        return (int)InterlockedExchangeAdd(value, amount) + amount;
+    }
+
+#else
 
     typedef pthread_t THREAD_HANDLE;
 
@@ -57,7 +72,7 @@ namespace gameplay
         void* arg;
     };
 
-    void* PThreadProc(void* threadData)
+    static void* PThreadProc(void* threadData)
     {
         PThreadData* data = (PThreadData*)threadData;
         int(*threadFunction)(void*) = data->threadFunction;
@@ -92,8 +107,91 @@ namespace gameplay
         // nothing to do... waitForThreads (which calls join) cleans up
     }
 
+    static int getProcessorCount()
+    {
+        long count = sysconf(_SC_NPROCESSORS_ONLN);
+        return count > 0 ? (int)count : 1;
+    }
+
+    inline int atomicAdd(volatile long* value, int amount)
+    {
+        return (int)__sync_add_and_fetch(value, (long)amount);
+    }
+
 #endif
 
+    // Shared state of the threads running a parallelFor loop.
+    struct ParallelForData
+    {
+        void(*function)(int, int, void*);
+        void* arg;
+        int count;
+        int blockSize;
+        volatile long nextBlock;
+    };
+
+    inline int parallelForThread(void* threadData)
+    {
+        ParallelForData* data = (ParallelForData*)threadData;
+        while (true)
+        {
+            // Claim the next block of iterations.
+            int begin = (atomicAdd(&data->nextBlock, 1) - 1) * data->blockSize;
+            if (begin >= data->count)
+                break;
+            int end = begin + data->blockSize < data->count ? begin + data->blockSize : data->count;
+            data->function(begin, end, data->arg);
+        }
+        return 0;
+    }
+
+    /**
+     * Runs function(begin, end, arg) over the range [0, count) in blocks of blockSize
+     * iterations, on one thread per processor core (including the calling thread), and
+     * returns once all iterations have completed. Threads take the next unclaimed block
+     * when they finish one, so blocks of uneven cost are balanced across the threads.
+     *
+     * @return The number of threads that were used.
+     */
+    inline int parallelFor(int count, int blockSize, void(*function)(int, int, void*), void* arg)
+    {
+        if (count <= 0)
+            return 0;
+        if (blockSize <= 0)
+            blockSize = 1;
+
+        ParallelForData data;
+        data.function = function;
+        data.arg = arg;
+        data.count = count;
+        data.blockSize = blockSize;
+        data.nextBlock = 0;
+
+        int blockCount = (count + blockSize - 1) / blockSize;
+        int threadCount = getProcessorCount();
+        if (threadCount > blockCount)
+            threadCount = blockCount;
+
+        // The calling thread works too; if a thread fails to start the others take over its blocks.
+        std::vector<THREAD_HANDLE> threads;
+        for (int i = 1; i < threadCount; ++i)
+        {
+            THREAD_HANDLE thread;
+            if (!createThread(&thread, &parallelForThread, &data))
+                break;
+            threads.push_back(thread);
+        }
+        parallelForThread(&data);
+
+        if (!threads.empty())
+        {
+            waitForThreads((int)threads.size(), &threads[0]);
+            for (size_t i = 0; i < threads.size(); ++i)
+                closeThread(threads[i]);
+        }
+        return (int)threads.size() + 1;
+    }
+
 }
 
 #endif
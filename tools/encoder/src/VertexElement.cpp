@@ -4,10 +4,66 @@
 namespace gameplay
 {
 
+static short encodeSnorm16(float value)
+{
+    value = value < -1.0f ? -1.0f : (value > 1.0f ? 1.0f : value);
+    return (short)floor(value * 32767.0f + 0.5f);
+}
+
+static float decodeSnorm16(short value)
+{
+    return std::max(value / 32767.0f, -1.0f);
+}
+
+static unsigned int encodeUnorm(float value, unsigned int maxValue)
+{
+    value = value < 0.0f ? 0.0f : (value > 1.0f ? 1.0f : value);
+    return (unsigned int)floor(value * maxValue + 0.5f);
+}
+
+/**
+ * Encodes a vector as a point on the octahedron |x| + |y| + |z| = 1, with the lower half folded
+ * over the upper half, so that it can be stored as two values in [-1, 1].
+ */
+static void encodeOctahedral(const float* v, short* encoded)
+{
+    float sum = fabs(v[0]) + fabs(v[1]) + fabs(v[2]);
+    float x = sum > 0.0f ? v[0] / sum : 0.0f;
+    float y = sum > 0.0f ? v[1] / sum : 0.0f;
+    if (v[2] < 0.0f)
+    {
+        float unfoldedX = x;
+        x = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabs(unfoldedX)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+    encoded[0] = encodeSnorm16(x);
+    encoded[1] = encodeSnorm16(y);
+}
+
+static void decodeOctahedral(const short* encoded, float* v)
+{
+    float x = decodeSnorm16(encoded[0]);
+    float y = decodeSnorm16(encoded[1]);
+    float z = 1.0f - fabs(x) - fabs(y);
+    if (z < 0.0f)
+    {
+        float foldedX = x;
+        x = (1.0f - fabs(y)) * (x >= 0.0f ? 1.0f : -1.0f);
+        y = (1.0f - fabs(foldedX)) * (y >= 0.0f ? 1.0f : -1.0f);
+    }
+    float length = sqrt(x * x + y * y + z * z);
+    v[0] = x / length;
+    v[1] = y / length;
+    v[2] = z / length;
+}
+
 VertexElement::VertexElement(unsigned int t, unsigned int c) :
     usage(t),
-    size(c)
+    size(c),
+    encoding(ENCODING_FLOAT)
 {
+    fillArray(offset, 0.0f, 4);
+    fillArray(scale, 1.0f, 4);
 }
 
 VertexElement::~VertexElement(void)
@@ -23,15 +79,158 @@ void VertexElement::writeBinary(FILE* file)
     Object::writeBinary(file);
     write(usage, file);
     write(size, file);
+    write(encoding, file);
+    if (encoding == ENCODING_SNORM16)
+    {
+        write(offset, size, file);
+        write(scale, size, file);
+    }
 }
 void VertexElement::writeText(FILE* file)
 {
     fprintElementStart(file);
     fprintfElement(file, "usage", usageStr(usage));
     fprintfElement(file, "size", size);
+    fprintfElement(file, "encoding", encodingStr(encoding));
+    if (encoding == ENCODING_SNORM16)
+    {
+        fprintfElement(file, "offset", offset, size);
+        fprintfElement(file, "scale", scale, size);
+    }
     fprintElementEnd(file);
 }
 
+unsigned int VertexElement::byteSize() const
+{
+    switch (encoding)
+    {
+        case ENCODING_SNORM16:
+        case ENCODING_UNORM16:
+            return (size * 2 + 3) & ~3u;
+        case ENCODING_OCTAHEDRAL16:
+            return 4;
+        case ENCODING_UNORM8:
+        case ENCODING_UINT8:
+            return (size + 3) & ~3u;
+        default:
+            return size * sizeof(float);
+    }
+}
+
+void VertexElement::encode(const float* values, unsigned char* data) const
+{
+    memset(data, 0, byteSize());
+    switch (encoding)
+    {
+        case ENCODING_SNORM16:
+            {
+                short encoded[4];
+                for (unsigned int i = 0; i < size; ++i)
+                {
+                    encoded[i] = encodeSnorm16(scale[i] > 0.0f ? (values[i] - offset[i]) / scale[i] : 0.0f);
+                }
+                memcpy(data, encoded, size * sizeof(short));
+            }
+            break;
+        case ENCODING_OCTAHEDRAL16:
+            {
+                short encoded[2];
+                encodeOctahedral(values, encoded);
+                memcpy(data, encoded, sizeof(encoded));
+            }
+            break;
+        case ENCODING_UNORM16:
+            {
+                unsigned short encoded[4];
+                for (unsigned int i = 0; i < size; ++i)
+                {
+                    encoded[i] = (unsigned short)encodeUnorm(values[i], 65535);
+                }
+                memcpy(data, encoded, size * sizeof(unsigned short));
+            }
+            break;
+        case ENCODING_UNORM8:
+            {
+                float sum = 0.0f;
+                unsigned int encodedSum = 0;
+                unsigned int largest = 0;
+                for (unsigned int i = 0; i < size; ++i)
+                {
+                    data[i] = (unsigned char)encodeUnorm(values[i], 255);
+                    sum += values[i];
+                    encodedSum += data[i];
+                    if (values[i] > values[largest])
+                        largest = i;
+                }
+                // Keep blend weights that add up to one adding up to one after rounding.
+                if (usage == BLENDWEIGHTS && fabs(sum - 1.0f) < 0.001f)
+                {
+                    data[largest] = (unsigned char)((int)data[largest] + 255 - (int)encodedSum);
+                }
+            }
+            break;
+        case ENCODING_UINT8:
+            for (unsigned int i = 0; i < size; ++i)
+            {
+                data[i] = (unsigned char)values[i];
+            }
+            break;
+        default:
+            memcpy(data, values, size * sizeof(float));
+            break;
+    }
+}
+
+void VertexElement::decode(const unsigned char* data, float* values) const
+{
+    fillArray(values, 0.0f, 4);
+    switch (encoding)
+    {
+        case ENCODING_SNORM16:
+            {
+                short encoded[4];
+                memcpy(encoded, data, size * sizeof(short));
+                for (unsigned int i = 0; i < size; ++i)
+                {
+                    values[i] = offset[i] + scale[i] * decodeSnorm16(encoded[i]);
+                }
+            }
+            break;
+        case ENCODING_OCTAHEDRAL16:
+            {
+                short encoded[2];
+                memcpy(encoded, data, sizeof(encoded));
+                decodeOctahedral(encoded, values);
+            }
+            break;
+        case ENCODING_UNORM16:
+            {
+                unsigned short encoded[4];
+                memcpy(encoded, data, size * sizeof(unsigned short));
+                for (unsigned int i = 0; i < size; ++i)
+                {
+                    values[i] = encoded[i] / 65535.0f;
+                }
+            }
+            break;
+        case ENCODING_UNORM8:
+            for (unsigned int i = 0; i < size; ++i)
+            {
+                values[i] = data[i] / 255.0f;
+            }
+            break;
+        case ENCODING_UINT8:
+            for (unsigned int i = 0; i < size; ++i)
+            {
+                values[i] = data[i];
+            }
+            break;
+        default:
+            memcpy(values, data, size * sizeof(float));
+            break;
+    }
+}
+
 const char* VertexElement::usageStr(unsigned int usage)
 {
     switch (usage)
@@ -73,4 +272,25 @@ const char* VertexElement::usageStr(unsigned int usage)
     }
 }
 
+const char* VertexElement::encodingStr(unsigned int encoding)
+{
+    switch (encoding)
+    {
+        case ENCODING_FLOAT:
+            return "FLOAT";
+        case ENCODING_SNORM16:
+            return "SNORM16";
+        case ENCODING_OCTAHEDRAL16:
+            return "OCTAHEDRAL16";
+        case ENCODING_UNORM16:
+            return "UNORM16";
+        case ENCODING_UNORM8:
+            return "UNORM8";
+        case ENCODING_UINT8:
+            return "UINT8";
+        default:
+            return "";
+    }
+}
+
 }
@@ -24,10 +24,40 @@ public:
     virtual void writeBinary(FILE* file);
     virtual void writeText(FILE* file);
 
+    /**
+     * Returns the number of bytes used to store this element in a vertex, including the
+     * padding up to the next four byte boundary.
+     */
+    unsigned int byteSize() const;
+
+    /**
+     * Writes the values of this element to data (byteSize() bytes) with the element's encoding.
+     *
+     * @param values The values of the element, padded with zeros to 4 values.
+     * @param data The location to write the encoded element to.
+     */
+    void encode(const float* values, unsigned char* data) const;
+
+    /**
+     * Reads the values of this element from data, undoing the element's encoding.
+     *
+     * @param data The encoded element.
+     * @param values Set to the decoded values, padded with zeros to 4 values.
+     */
+    void decode(const unsigned char* data, float* values) const;
+
     static const char* usageStr(unsigned int usage);
+    static const char* encodingStr(unsigned int encoding);
 
     unsigned int usage;
     unsigned int size;
+    unsigned int encoding;
+
+    /**
+     * The range of ENCODING_SNORM16 elements: value = offset + scale * snorm.
+     */
+    float offset[4];
+    float scale[4];
 };
 
 }
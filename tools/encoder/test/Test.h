@@ -0,0 +1,30 @@
+#ifndef TEST_H_
+#define TEST_H_
+
+#include "Base.h"
+
+/**
+ * Records a failed check, along with its location, in the local variable 'failures'
+ * of the test function, and continues with the test.
+ */
+#define CHECK(condition) do \
+    { \
+        if (!(condition)) \
+        { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #condition); \
+            ++failures; \
+        } \
+    } while (0)
+
+/**
+ * A test run by gameplay-encoder-test. Returns the number of failed checks.
+ */
+typedef int (*TestFunction)();
+
+/**
+ * Encodes and decodes vertex elements and checks the decoded values are within the error
+ * bounds of their encodings.
+ */
+int testVertexElement();
+
+#endif
@@ -0,0 +1,142 @@
+#include "Test.h"
+#include "VertexElement.h"
+
+using namespace gameplay;
+
+// The largest angle (in degrees) between a vector and its decoded 16-bit octahedral encoding.
+#define OCTAHEDRAL16_MAX_ERROR 0.005
+
+/**
+ * Returns the largest error that the SNORM16 encoding of an element may introduce in one component:
+ * half a step of its range, plus the rounding of the float arithmetic.
+ */
+static double getSnorm16MaxError(const VertexElement& element, unsigned int component)
+{
+    return element.scale[component] * (0.5 / 32767.0) + (fabs(element.offset[component]) + element.scale[component]) * 1e-6;
+}
+
+/**
+ * Returns the angle in degrees between two vectors.
+ */
+static double angleBetween(const float* a, const float* b)
+{
+    double x = (double)a[1] * b[2] - (double)a[2] * b[1];
+    double y = (double)a[2] * b[0] - (double)a[0] * b[2];
+    double z = (double)a[0] * b[1] - (double)a[1] * b[0];
+    double dot = (double)a[0] * b[0] + (double)a[1] * b[1] + (double)a[2] * b[2];
+    return MATH_RAD_TO_DEG(atan2(sqrt(x * x + y * y + z * z), dot));
+}
+
+/**
+ * Checks positions across the range of an SNORM16 element, including both ends of the range,
+ * for ranges that are narrow, wide and far from the origin.
+ */
+static int testSnorm16()
+{
+    int failures = 0;
+    unsigned char encoded[16];
+    float values[4], decoded[4];
+
+    VertexElement position(POSITION, 3);
+    position.encoding = ENCODING_SNORM16;
+    CHECK(position.byteSize() == 8);
+
+    const float offsets[3] = { -3.5f, 100.0f, 0.0f };
+    const float scales[3] = { 2.25f, 0.001f, 1000.0f };
+    for (unsigned int i = 0; i < 3; ++i)
+    {
+        position.offset[i] = offsets[i];
+        position.scale[i] = scales[i];
+    }
+
+    unsigned int mismatches = 0;
+    for (int step = -1000; step <= 1000; ++step)
+    {
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            values[i] = position.offset[i] + position.scale[i] * (float)step / (1000.0f + (float)i * 0.37f);
+        }
+        position.encode(values, encoded);
+        position.decode(encoded, decoded);
+        for (unsigned int i = 0; i < 3; ++i)
+        {
+            if (fabs((double)decoded[i] - values[i]) > getSnorm16MaxError(position, i))
+                ++mismatches;
+        }
+        if (decoded[3] != 0.0f)
+            ++mismatches;
+    }
+    CHECK(mismatches == 0);
+
+    // Values outside of the range are clamped to its ends.
+    for (unsigned int i = 0; i < 3; ++i)
+        values[i] = position.offset[i] + position.scale[i] * 2.0f;
+    position.encode(values, encoded);
+    position.decode(encoded, decoded);
+    for (unsigned int i = 0; i < 3; ++i)
+        CHECK(fabs((double)decoded[i] - (position.offset[i] + position.scale[i])) <= getSnorm16MaxError(position, i));
+
+    return failures;
+}
+
+/**
+ * Checks directions over a grid of latitudes and longitudes, which includes the poles, the
+ * equator where the octahedron is folded, and the axes.
+ */
+static int testOctahedral16()
+{
+    int failures = 0;
+    unsigned char encoded[16];
+    float values[4], decoded[4];
+
+    VertexElement normal(NORMAL, 3);
+    normal.encoding = ENCODING_OCTAHEDRAL16;
+    CHECK(normal.byteSize() == 4);
+
+    unsigned int mismatches = 0;
+    for (int latitude = -90; latitude <= 90; ++latitude)
+    {
+        for (int longitude = 0; longitude < 360; ++longitude)
+        {
+            double theta = MATH_DEG_TO_RAD((double)latitude);
+            double phi = MATH_DEG_TO_RAD((double)longitude);
+            values[0] = (float)(cos(theta) * cos(phi));
+            values[1] = (float)(cos(theta) * sin(phi));
+            values[2] = (float)sin(theta);
+            normal.encode(values, encoded);
+            normal.decode(encoded, decoded);
+            if (angleBetween(values, decoded) > OCTAHEDRAL16_MAX_ERROR)
+                ++mismatches;
+
+            // Decoded directions are unit length.
+            double length = sqrt((double)decoded[0] * decoded[0] + (double)decoded[1] * decoded[1] + (double)decoded[2] * decoded[2]);
+            if (fabs(length - 1.0) > 1e-6)
+                ++mismatches;
+        }
+    }
+    CHECK(mismatches == 0);
+
+    return failures;
+}
+
+/**
+ * Checks that blend weights adding up to one still add up to one after 8-bit rounding.
+ */
+static int testUnorm8()
+{
+    int failures = 0;
+    unsigned char encoded[16];
+
+    VertexElement weights(BLENDWEIGHTS, 4);
+    weights.encoding = ENCODING_UNORM8;
+    const float values[4] = { 0.333f, 0.333f, 0.334f, 0.0f };
+    weights.encode(values, encoded);
+    CHECK(encoded[0] + encoded[1] + encoded[2] + encoded[3] == 255);
+
+    return failures;
+}
+
+int testVertexElement()
+{
+    return testSnorm16() + testOctahedral16() + testUnorm8();
+}
@@ -0,0 +1,53 @@
+#include "Test.h"
+
+/**
+ * A test, and the name that selects it on the command line.
+ */
+struct Test
+{
+    const char* name;
+    TestFunction function;
+};
+
+static const Test __tests[] =
+{
+    { "VertexElement", testVertexElement }
+};
+
+static const unsigned int __testCount = sizeof(__tests) / sizeof(__tests[0]);
+
+/**
+ * Runs the test named on the command line, or all tests when no name is given.
+ * The exit code is the number of tests that failed.
+ */
+int main(int argc, char** argv)
+{
+    const char* name = argc > 1 ? argv[1] : NULL;
+    int failedTests = 0;
+    bool found = false;
+    for (unsigned int i = 0; i < __testCount; ++i)
+    {
+        if (name && strcmp(name, __tests[i].name) != 0)
+            continue;
+
+        found = true;
+        int failures = __tests[i].function();
+        if (failures > 0)
+        {
+            fprintf(stderr, "%s: %d checks failed.\n", __tests[i].name, failures);
+            ++failedTests;
+        }
+        else
+        {
+            fprintf(stdout, "%s: passed.\n", __tests[i].name);
+        }
+    }
+
+    if (!found)
+    {
+        fprintf(stderr, "Unknown test '%s'.\n", name);
+        return 1;
+    }
+
+    return failedTests;
+}